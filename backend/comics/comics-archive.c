@@ -0,0 +1,793 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "comics-archive.h"
+
+/* Zip and tar archives are read in-process, so that listing the pages
+ * and reading them doesn't require spawning external commands. The
+ * directory of the archive is read once when the archive is opened,
+ * and every entry is read later on by seeking to its offset. Zip
+ * entries must be stored or deflated, and not encrypted; archives
+ * using anything else are left to the external commands.
+ */
+
+#define ZIP_LOCAL_HEADER_SIGNATURE   0x04034b50
+#define ZIP_LOCAL_HEADER_SIZE        30
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP_CENTRAL_HEADER_SIZE      46
+#define ZIP_END_SIGNATURE            0x06054b50
+#define ZIP_END_SIZE                 22
+#define ZIP64_END_LOCATOR_SIGNATURE  0x07064b50
+#define ZIP64_END_LOCATOR_SIZE       20
+#define ZIP64_END_SIGNATURE          0x06064b50
+#define ZIP64_END_SIZE               56
+#define ZIP64_EXTRA_FIELD_ID         0x0001
+#define ZIP_FLAG_ENCRYPTED           (1 << 0)
+#define ZIP_METHOD_STORED            0
+#define ZIP_METHOD_DEFLATED          8
+
+#define TAR_BLOCK_SIZE               512
+/* Maximum size of the GNU long name and pax headers we read */
+#define TAR_MAX_EXTENDED_HEADER_SIZE (1024 * 1024)
+
+typedef struct {
+	gchar    *name;
+	/* Offset of the local header for zip entries, and
+	 * of the data for tar entries */
+	goffset   offset;
+	/* Size of the data in the archive */
+	goffset   size;
+	gboolean  deflated;
+} ComicsArchiveEntry;
+
+struct _ComicsArchive {
+	GFile      *file;
+	gboolean    is_zip;
+	GPtrArray  *entries;
+	GHashTable *entries_by_name;
+};
+
+/* ComicsArchiveStream: reads at most a given number of bytes from
+ * the base stream, which is positioned at the start of an entry.
+ */
+#define COMICS_TYPE_ARCHIVE_STREAM (comics_archive_stream_get_type ())
+#define COMICS_ARCHIVE_STREAM(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), COMICS_TYPE_ARCHIVE_STREAM, ComicsArchiveStream))
+
+typedef struct {
+	GFilterInputStream parent_instance;
+
+	goffset remaining;
+} ComicsArchiveStream;
+
+typedef struct {
+	GFilterInputStreamClass parent_class;
+} ComicsArchiveStreamClass;
+
+GType comics_archive_stream_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_TYPE (ComicsArchiveStream, comics_archive_stream, G_TYPE_FILTER_INPUT_STREAM)
+
+static gssize
+comics_archive_stream_read (GInputStream *stream,
+			    void         *buffer,
+			    gsize         count,
+			    GCancellable *cancellable,
+			    GError      **error)
+{
+	ComicsArchiveStream *archive_stream = COMICS_ARCHIVE_STREAM (stream);
+	GInputStream        *base_stream = G_FILTER_INPUT_STREAM (stream)->base_stream;
+	gssize               bytes;
+
+	if (archive_stream->remaining <= 0)
+		return 0;
+
+	if ((goffset) count > archive_stream->remaining)
+		count = archive_stream->remaining;
+
+	bytes = g_input_stream_read (base_stream, buffer, count, cancellable, error);
+	if (bytes > 0)
+		archive_stream->remaining -= bytes;
+
+	return bytes;
+}
+
+static gssize
+comics_archive_stream_skip (GInputStream *stream,
+			    gsize         count,
+			    GCancellable *cancellable,
+			    GError      **error)
+{
+	ComicsArchiveStream *archive_stream = COMICS_ARCHIVE_STREAM (stream);
+	GInputStream        *base_stream = G_FILTER_INPUT_STREAM (stream)->base_stream;
+	gssize               bytes;
+
+	if (archive_stream->remaining <= 0)
+		return 0;
+
+	if ((goffset) count > archive_stream->remaining)
+		count = archive_stream->remaining;
+
+	bytes = g_input_stream_skip (base_stream, count, cancellable, error);
+	if (bytes > 0)
+		archive_stream->remaining -= bytes;
+
+	return bytes;
+}
+
+static void
+comics_archive_stream_init (ComicsArchiveStream *stream)
+{
+}
+
+static void
+comics_archive_stream_class_init (ComicsArchiveStreamClass *klass)
+{
+	GInputStreamClass *input_stream_class = G_INPUT_STREAM_CLASS (klass);
+
+	input_stream_class->read_fn = comics_archive_stream_read;
+	input_stream_class->skip = comics_archive_stream_skip;
+}
+
+static GInputStream *
+comics_archive_stream_new (GInputStream *base_stream,
+			   goffset       size)
+{
+	ComicsArchiveStream *stream;
+
+	stream = g_object_new (COMICS_TYPE_ARCHIVE_STREAM,
+			       "base-stream", base_stream,
+			       NULL);
+	stream->remaining = size;
+
+	return G_INPUT_STREAM (stream);
+}
+
+static guint16
+read_le16 (const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static guint32
+read_le32 (const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static guint64
+read_le64 (const guchar *p)
+{
+	return read_le32 (p) | ((guint64) read_le32 (p + 4) << 32);
+}
+
+static void
+set_corrupted_error (GError **error)
+{
+	g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "The archive is corrupted");
+}
+
+static gboolean
+comics_archive_read_at (GInputStream *stream,
+			goffset       offset,
+			void         *buffer,
+			gsize         count,
+			GError      **error)
+{
+	gsize bytes_read;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, NULL, error))
+		return FALSE;
+
+	if (!g_input_stream_read_all (stream, buffer, count, &bytes_read, NULL, error))
+		return FALSE;
+
+	if (bytes_read != count) {
+		set_corrupted_error (error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+comics_archive_entry_free (ComicsArchiveEntry *entry)
+{
+	g_free (entry->name);
+	g_slice_free (ComicsArchiveEntry, entry);
+}
+
+/* Takes ownership of @name */
+static void
+comics_archive_add_entry (ComicsArchive *archive,
+			  gchar         *name,
+			  goffset        offset,
+			  goffset        size,
+			  gboolean       deflated)
+{
+	ComicsArchiveEntry *entry;
+	gsize               length = strlen (name);
+
+	/* Directories */
+	if (length == 0 || name[length - 1] == '/') {
+		g_free (name);
+		return;
+	}
+
+	/* The last entry with a given name wins, like when extracting */
+	entry = g_hash_table_lookup (archive->entries_by_name, name);
+	if (entry) {
+		g_free (name);
+	} else {
+		entry = g_slice_new (ComicsArchiveEntry);
+		entry->name = name;
+		g_ptr_array_add (archive->entries, entry);
+		g_hash_table_insert (archive->entries_by_name, entry->name, entry);
+	}
+
+	entry->offset = offset;
+	entry->size = size;
+	entry->deflated = deflated;
+}
+
+/* Zip */
+static void
+zip_parse_zip64_extra_field (const guchar *extra,
+			     gsize         length,
+			     guint32       uncompressed_size,
+			     guint64      *compressed_size,
+			     guint64      *offset)
+{
+	while (length >= 4) {
+		guint16       id = read_le16 (extra);
+		guint16       size = read_le16 (extra + 2);
+		const guchar *data = extra + 4;
+		gsize         pos = 0;
+
+		if (size > length - 4)
+			return;
+
+		if (id != ZIP64_EXTRA_FIELD_ID) {
+			extra += 4 + size;
+			length -= 4 + size;
+			continue;
+		}
+
+		/* Only the fields that don't fit in the
+		 * central header are present, in this order */
+		if (uncompressed_size == G_MAXUINT32)
+			pos += 8;
+		if (*compressed_size == G_MAXUINT32 && pos + 8 <= size) {
+			*compressed_size = read_le64 (data + pos);
+			pos += 8;
+		}
+		if (*offset == G_MAXUINT32 && pos + 8 <= size)
+			*offset = read_le64 (data + pos);
+
+		return;
+	}
+}
+
+static gboolean
+zip_parse_central_directory (ComicsArchive *archive,
+			     const guchar  *directory,
+			     gsize          directory_size,
+			     guint64        n_entries,
+			     goffset        file_size,
+			     GError       **error)
+{
+	const guchar *p = directory;
+	const guchar *end = directory + directory_size;
+	guint64       i;
+
+	for (i = 0; i < n_entries; i++) {
+		guint16 flags, method;
+		guint16 name_length, extra_length, comment_length;
+		guint64 compressed_size, offset;
+		gchar  *name;
+
+		if (end - p < ZIP_CENTRAL_HEADER_SIZE ||
+		    read_le32 (p) != ZIP_CENTRAL_HEADER_SIGNATURE) {
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		flags = read_le16 (p + 8);
+		method = read_le16 (p + 10);
+		compressed_size = read_le32 (p + 20);
+		name_length = read_le16 (p + 28);
+		extra_length = read_le16 (p + 30);
+		comment_length = read_le16 (p + 32);
+		offset = read_le32 (p + 42);
+
+		if (end - p - ZIP_CENTRAL_HEADER_SIZE < name_length + extra_length + comment_length) {
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		zip_parse_zip64_extra_field (p + ZIP_CENTRAL_HEADER_SIZE + name_length,
+					     extra_length,
+					     read_le32 (p + 24),
+					     &compressed_size, &offset);
+		if (offset > (guint64) file_size ||
+		    compressed_size > (guint64) file_size - offset) {
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		name = g_strndup ((const gchar *) p + ZIP_CENTRAL_HEADER_SIZE, name_length);
+		p += ZIP_CENTRAL_HEADER_SIZE + name_length + extra_length + comment_length;
+
+		if (name[0] != '\0' && name[strlen (name) - 1] != '/' &&
+		    ((flags & ZIP_FLAG_ENCRYPTED) ||
+		     (method != ZIP_METHOD_STORED && method != ZIP_METHOD_DEFLATED))) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+				     "Unsupported zip entry “%s”", name);
+			g_free (name);
+			return FALSE;
+		}
+
+		comics_archive_add_entry (archive, name, offset, compressed_size,
+					  method == ZIP_METHOD_DEFLATED);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+zip_parse (ComicsArchive *archive,
+	   GInputStream  *stream,
+	   goffset        file_size,
+	   GError       **error)
+{
+	guchar       *tail;
+	const guchar *end_record = NULL;
+	guchar       *directory;
+	gsize         tail_size;
+	gssize        pos;
+	guint64       n_entries;
+	guint64       directory_size;
+	guint64       directory_offset;
+	gboolean      retval;
+
+	if (file_size < ZIP_END_SIZE) {
+		set_corrupted_error (error);
+		return FALSE;
+	}
+
+	/* The end of central directory record is followed by a
+	 * comment of up to 64 KB */
+	tail_size = MIN (file_size, ZIP_END_SIZE + G_MAXUINT16);
+	tail = g_malloc (tail_size);
+	if (!comics_archive_read_at (stream, file_size - tail_size, tail, tail_size, error)) {
+		g_free (tail);
+		return FALSE;
+	}
+
+	for (pos = tail_size - ZIP_END_SIZE; pos >= 0; pos--) {
+		if (read_le32 (tail + pos) == ZIP_END_SIGNATURE) {
+			end_record = tail + pos;
+			break;
+		}
+	}
+
+	if (!end_record) {
+		g_free (tail);
+		set_corrupted_error (error);
+		return FALSE;
+	}
+
+	n_entries = read_le16 (end_record + 10);
+	directory_size = read_le32 (end_record + 12);
+	directory_offset = read_le32 (end_record + 16);
+
+	if (n_entries == G_MAXUINT16 ||
+	    directory_size == G_MAXUINT32 ||
+	    directory_offset == G_MAXUINT32) {
+		const guchar *locator = end_record - ZIP64_END_LOCATOR_SIZE;
+		guchar        zip64_end[ZIP64_END_SIZE];
+		guint64       zip64_end_offset;
+
+		if (pos < ZIP64_END_LOCATOR_SIZE ||
+		    read_le32 (locator) != ZIP64_END_LOCATOR_SIGNATURE) {
+			g_free (tail);
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		zip64_end_offset = read_le64 (locator + 8);
+		g_free (tail);
+
+		if (zip64_end_offset > (guint64) file_size ||
+		    !comics_archive_read_at (stream, zip64_end_offset,
+					     zip64_end, ZIP64_END_SIZE, error))
+			return FALSE;
+
+		if (read_le32 (zip64_end) != ZIP64_END_SIGNATURE) {
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		n_entries = read_le64 (zip64_end + 32);
+		directory_size = read_le64 (zip64_end + 40);
+		directory_offset = read_le64 (zip64_end + 48);
+	} else {
+		g_free (tail);
+	}
+
+	if (directory_offset > (guint64) file_size ||
+	    directory_size > (guint64) file_size - directory_offset) {
+		set_corrupted_error (error);
+		return FALSE;
+	}
+
+	directory = g_malloc (directory_size);
+	retval = comics_archive_read_at (stream, directory_offset,
+					 directory, directory_size, error) &&
+		zip_parse_central_directory (archive, directory, directory_size,
+					     n_entries, file_size, error);
+	g_free (directory);
+
+	return retval;
+}
+
+/* Tar */
+static guint64
+tar_parse_number (const guchar *field,
+		  gsize         length)
+{
+	guint64 value = 0;
+	gsize   i = 0;
+
+	/* GNU tar stores numbers that don't fit in octal in base 256 */
+	if (field[0] & 0x80) {
+		value = field[0] & 0x7f;
+		for (i = 1; i < length; i++)
+			value = (value << 8) | field[i];
+
+		return value;
+	}
+
+	while (i < length && field[i] == ' ')
+		i++;
+	for (; i < length && field[i] >= '0' && field[i] <= '7'; i++)
+		value = value * 8 + (field[i] - '0');
+
+	return value;
+}
+
+static gboolean
+tar_header_is_valid (const guchar *header)
+{
+	guint64 checksum = 0;
+	gint    i;
+
+	/* The checksum field counts as spaces */
+	for (i = 0; i < TAR_BLOCK_SIZE; i++)
+		checksum += (i >= 148 && i < 156) ? ' ' : header[i];
+
+	return checksum == tar_parse_number (header + 148, 8);
+}
+
+static gchar *
+tar_header_get_name (const guchar *header)
+{
+	gchar *name;
+	gchar *prefix;
+	gchar *path;
+
+	name = g_strndup ((const gchar *) header, 100);
+
+	/* POSIX ustar archives split long names in a prefix and a name */
+	if (memcmp (header + 257, "ustar\0", 6) != 0 || header[345] == '\0')
+		return name;
+
+	prefix = g_strndup ((const gchar *) header + 345, 155);
+	path = g_strconcat (prefix, "/", name, NULL);
+	g_free (prefix);
+	g_free (name);
+
+	return path;
+}
+
+/* Gets the path from the records of a pax extended header,
+ * which look like "<length> <keyword>=<value>\n".
+ */
+static gchar *
+tar_parse_pax_path (const gchar *data,
+		    gsize        length)
+{
+	const gchar *p = data;
+	const gchar *end = data + length;
+
+	while (p < end) {
+		const gchar *record_end;
+		const gchar *keyword;
+		gchar       *endptr;
+		guint64      record_length;
+
+		record_length = g_ascii_strtoull (p, &endptr, 10);
+		if (endptr == p || *endptr != ' ' ||
+		    record_length == 0 || record_length > (guint64) (end - p))
+			return NULL;
+
+		keyword = endptr + 1;
+		record_end = p + record_length;
+		if (record_end - keyword > 6 && strncmp (keyword, "path=", 5) == 0)
+			return g_strndup (keyword + 5, record_end - keyword - 6);
+
+		p = record_end;
+	}
+
+	return NULL;
+}
+
+static gboolean
+tar_parse (ComicsArchive *archive,
+	   GInputStream  *stream,
+	   goffset        file_size,
+	   GError       **error)
+{
+	guchar   header[TAR_BLOCK_SIZE];
+	goffset  offset = 0;
+	gchar   *long_name = NULL;
+
+	while (offset + TAR_BLOCK_SIZE <= file_size) {
+		goffset data_offset;
+		guint64 size;
+		gchar  *data;
+
+		if (!comics_archive_read_at (stream, offset, header, TAR_BLOCK_SIZE, error)) {
+			g_free (long_name);
+			return FALSE;
+		}
+
+		/* End of archive */
+		if (header[0] == '\0' && offset > 0)
+			break;
+
+		if (!tar_header_is_valid (header)) {
+			g_free (long_name);
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		size = tar_parse_number (header + 124, 12);
+		data_offset = offset + TAR_BLOCK_SIZE;
+		if (size > (guint64) (file_size - data_offset)) {
+			g_free (long_name);
+			set_corrupted_error (error);
+			return FALSE;
+		}
+
+		switch (header[156]) {
+		case 'L':
+		case 'x':
+			/* GNU long name, and pax extended header */
+			if (size > TAR_MAX_EXTENDED_HEADER_SIZE) {
+				g_free (long_name);
+				set_corrupted_error (error);
+				return FALSE;
+			}
+
+			data = g_malloc (size + 1);
+			if (!comics_archive_read_at (stream, data_offset, data, size, error)) {
+				g_free (data);
+				g_free (long_name);
+				return FALSE;
+			}
+			data[size] = '\0';
+
+			g_free (long_name);
+			if (header[156] == 'L')
+				long_name = g_strdup (data);
+			else
+				long_name = tar_parse_pax_path (data, size);
+			g_free (data);
+			break;
+		case '\0':
+		case '0':
+		case '7':
+			comics_archive_add_entry (archive,
+						  long_name ? long_name : tar_header_get_name (header),
+						  data_offset, size, FALSE);
+			long_name = NULL;
+			break;
+		default:
+			/* Directories, links and special files */
+			g_free (long_name);
+			long_name = NULL;
+			break;
+		}
+
+		offset = data_offset + (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+	}
+
+	g_free (long_name);
+
+	return TRUE;
+}
+
+/**
+ * comics_archive_new:
+ * @filename: the archive file name
+ * @error: return location for an error, or %NULL
+ *
+ * Opens a zip or tar archive, and reads its directory.
+ *
+ * Returns: a new #ComicsArchive, or %NULL if the file isn't a
+ *   supported archive
+ */
+ComicsArchive *
+comics_archive_new (const gchar *filename,
+		    GError     **error)
+{
+	ComicsArchive    *archive;
+	GFileInputStream *stream;
+	GFileInfo        *info;
+	guchar            magic[4];
+	goffset           file_size;
+	gboolean          success;
+
+	archive = g_slice_new0 (ComicsArchive);
+	archive->file = g_file_new_for_path (filename);
+	archive->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) comics_archive_entry_free);
+	archive->entries_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+
+	stream = g_file_read (archive->file, NULL, error);
+	if (!stream) {
+		comics_archive_free (archive);
+		return NULL;
+	}
+
+	info = g_file_input_stream_query_info (stream, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					       NULL, error);
+	if (!info) {
+		g_object_unref (stream);
+		comics_archive_free (archive);
+		return NULL;
+	}
+	file_size = g_file_info_get_size (info);
+	g_object_unref (info);
+
+	success = comics_archive_read_at (G_INPUT_STREAM (stream), 0,
+					  magic, sizeof (magic), error);
+	if (success) {
+		if (read_le32 (magic) == ZIP_LOCAL_HEADER_SIGNATURE ||
+		    read_le32 (magic) == ZIP_END_SIGNATURE) {
+			archive->is_zip = TRUE;
+			success = zip_parse (archive, G_INPUT_STREAM (stream), file_size, error);
+		} else {
+			success = tar_parse (archive, G_INPUT_STREAM (stream), file_size, error);
+		}
+	}
+	g_object_unref (stream);
+
+	if (!success) {
+		comics_archive_free (archive);
+		return NULL;
+	}
+
+	return archive;
+}
+
+void
+comics_archive_free (ComicsArchive *archive)
+{
+	g_hash_table_destroy (archive->entries_by_name);
+	g_ptr_array_free (archive->entries, TRUE);
+	g_object_unref (archive->file);
+	g_slice_free (ComicsArchive, archive);
+}
+
+guint
+comics_archive_get_n_entries (ComicsArchive *archive)
+{
+	return archive->entries->len;
+}
+
+const gchar *
+comics_archive_get_entry_name (ComicsArchive *archive,
+			       guint          index)
+{
+	ComicsArchiveEntry *entry;
+
+	g_return_val_if_fail (index < archive->entries->len, NULL);
+
+	entry = g_ptr_array_index (archive->entries, index);
+
+	return entry->name;
+}
+
+/**
+ * comics_archive_open_entry:
+ * @archive: a #ComicsArchive
+ * @name: the name of an entry
+ * @error: return location for an error, or %NULL
+ *
+ * Opens the entry @name for reading. Every stream uses its own file
+ * descriptor, so entries can be read from several threads at once.
+ *
+ * Returns: (transfer full): a #GInputStream with the uncompressed
+ *   contents of the entry, or %NULL
+ */
+GInputStream *
+comics_archive_open_entry (ComicsArchive *archive,
+			   const gchar   *name,
+			   GError       **error)
+{
+	ComicsArchiveEntry *entry;
+	GFileInputStream   *file_stream;
+	GInputStream       *stream;
+	goffset             data_offset;
+
+	entry = g_hash_table_lookup (archive->entries_by_name, name);
+	if (!entry) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+			     "No entry “%s” in the archive", name);
+		return NULL;
+	}
+
+	file_stream = g_file_read (archive->file, NULL, error);
+	if (!file_stream)
+		return NULL;
+
+	data_offset = entry->offset;
+	if (archive->is_zip) {
+		guchar header[ZIP_LOCAL_HEADER_SIZE];
+
+		if (!comics_archive_read_at (G_INPUT_STREAM (file_stream), entry->offset,
+					     header, ZIP_LOCAL_HEADER_SIZE, error)) {
+			g_object_unref (file_stream);
+			return NULL;
+		}
+
+		if (read_le32 (header) != ZIP_LOCAL_HEADER_SIGNATURE) {
+			g_object_unref (file_stream);
+			set_corrupted_error (error);
+			return NULL;
+		}
+
+		/* The local header has its own name and extra field */
+		data_offset += ZIP_LOCAL_HEADER_SIZE + read_le16 (header + 26) + read_le16 (header + 28);
+	}
+
+	if (!g_seekable_seek (G_SEEKABLE (file_stream), data_offset, G_SEEK_SET, NULL, error)) {
+		g_object_unref (file_stream);
+		return NULL;
+	}
+
+	stream = comics_archive_stream_new (G_INPUT_STREAM (file_stream), entry->size);
+	g_object_unref (file_stream);
+
+	if (entry->deflated) {
+		GZlibDecompressor *decompressor;
+		GInputStream      *converter_stream;
+
+		decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+		converter_stream = g_converter_input_stream_new (stream, G_CONVERTER (decompressor));
+		g_object_unref (decompressor);
+		g_object_unref (stream);
+		stream = converter_stream;
+	}
+
+	return stream;
+}
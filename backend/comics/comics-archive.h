@@ -0,0 +1,39 @@
+/* comics-archive.h: In-process reader for zip and tar comic book archives
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __COMICS_ARCHIVE_H__
+#define __COMICS_ARCHIVE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ComicsArchive ComicsArchive;
+
+ComicsArchive *comics_archive_new            (const gchar   *filename,
+					      GError       **error);
+void           comics_archive_free           (ComicsArchive *archive);
+guint          comics_archive_get_n_entries  (ComicsArchive *archive);
+const gchar   *comics_archive_get_entry_name (ComicsArchive *archive,
+					      guint          index);
+GInputStream  *comics_archive_open_entry     (ComicsArchive *archive,
+					      const gchar   *name,
+					      GError       **error);
+
+G_END_DECLS
+
+#endif /* __COMICS_ARCHIVE_H__ */
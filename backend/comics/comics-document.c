@@ -37,6 +37,7 @@
 # include <sys/wait.h>
 #endif
 
+#include "comics-archive.h"
 #include "comics-document.h"
 #include "ev-document-misc.h"
 #include "ev-file-helpers.h"
@@ -72,6 +73,7 @@ struct _ComicsDocument
 	EvDocument parent_instance;
 
 	gchar    *archive, *dir;
+	ComicsArchive *reader;
 	GPtrArray *page_names;
 	gchar    *selected_command, *alternative_command;
 	gchar    *extract_command, *list_command, *decompress_tmp;
@@ -84,6 +86,9 @@ struct _ComicsDocument
 #define OFFSET_ZIP 2
 #define NO_OFFSET 0
 
+/* Size of the chunks read from archives opened in-process */
+#define READ_BUFFER_SIZE 65536
+
 /* For perfomance reasons of 7z* we've choosen to decompress on the temporary 
  * directory instead of decompressing on the stdout */
 
@@ -466,6 +471,70 @@ sort_page_names (gconstpointer a,
   return strcmp (* (const char **) a, * (const char **) b);
 }
 
+static gboolean
+comics_is_image_file_name (const gchar *name,
+			   GSList      *supported_extensions)
+{
+	const gchar *suffix;
+	gchar       *extension;
+	gboolean     retval;
+
+	suffix = g_strrstr (name, ".");
+	if (!suffix)
+		return FALSE;
+
+	extension = g_ascii_strdown (suffix + 1, -1);
+	retval = g_slist_find_custom (supported_extensions, extension,
+				      (GCompareFunc) strcmp) != NULL;
+	g_free (extension);
+
+	return retval;
+}
+
+static gboolean
+comics_document_sort_pages (ComicsDocument *comics_document,
+			    const char     *uri,
+			    GError        **error)
+{
+	if (comics_document->page_names->len == 0) {
+		g_set_error (error,
+			     EV_DOCUMENT_ERROR,
+			     EV_DOCUMENT_ERROR_INVALID,
+			     _("No images found in archive %s"),
+			     uri);
+		return FALSE;
+	}
+
+        /* Now sort the pages */
+        g_ptr_array_sort (comics_document->page_names, sort_page_names);
+
+	return TRUE;
+}
+
+static gboolean
+comics_document_load_archive (ComicsDocument *comics_document,
+			      const char     *uri,
+			      GError        **error)
+{
+	GSList *supported_extensions;
+	guint   i;
+
+	comics_document->page_names = g_ptr_array_sized_new (64);
+
+	supported_extensions = get_supported_image_extensions ();
+	for (i = 0; i < comics_archive_get_n_entries (comics_document->reader); i++) {
+		const gchar *name;
+
+		name = comics_archive_get_entry_name (comics_document->reader, i);
+		if (comics_is_image_file_name (name, supported_extensions))
+			g_ptr_array_add (comics_document->page_names, g_strdup (name));
+	}
+	g_slist_foreach (supported_extensions, (GFunc) g_free, NULL);
+	g_slist_free (supported_extensions);
+
+	return comics_document_sort_pages (comics_document, uri, error);
+}
+
 static gboolean
 comics_document_load (EvDocument *document,
 		      const char *uri,
@@ -484,6 +553,12 @@ comics_document_load (EvDocument *document,
 	if (!comics_document->archive)
 		return FALSE;
 
+	/* Zip and tar archives are read in-process, the external
+	 * commands are only used for the other formats. */
+	comics_document->reader = comics_archive_new (comics_document->archive, NULL);
+	if (comics_document->reader)
+		return comics_document_load_archive (comics_document, uri, error);
+
 	mime_type = ev_file_get_mime_type (uri, FALSE, &err);
 	if (mime_type == NULL)
 		return FALSE;
@@ -542,34 +617,16 @@ comics_document_load (EvDocument *document,
 		} else {
 			cb_file = cb_files[i];
 		}
-		gchar *suffix = g_strrstr (cb_file, ".");
-		if (!suffix)
-			continue;
-		suffix = g_ascii_strdown (suffix + 1, -1);
-		if (g_slist_find_custom (supported_extensions, suffix,
-					 (GCompareFunc) strcmp) != NULL) {
+		if (comics_is_image_file_name (cb_file, supported_extensions)) {
                         g_ptr_array_add (comics_document->page_names,
                                          g_strstrip (g_strdup (cb_file)));
 		}
-		g_free (suffix);
 	}
 	g_strfreev (cb_files);
 	g_slist_foreach (supported_extensions, (GFunc) g_free, NULL);
 	g_slist_free (supported_extensions);
 
-	if (comics_document->page_names->len == 0) {
-		g_set_error (error,
-			     EV_DOCUMENT_ERROR,
-			     EV_DOCUMENT_ERROR_INVALID,
-			     _("No images found in archive %s"),
-			     uri);
-		return FALSE;
-	}
-
-        /* Now sort the pages */
-        g_ptr_array_sort (comics_document->page_names, sort_page_names);
-
-	return TRUE;
+	return comics_document_sort_pages (comics_document, uri, error);
 }
 
 
@@ -594,6 +651,51 @@ comics_document_get_n_pages (EvDocument *document)
 	return comics_document->page_names->len;
 }
 
+/* Feeds @loader with the contents of @page, read from the archive,
+ * until the end of the image or until @done is set by one of the
+ * handlers of @loader.
+ */
+static void
+comics_document_load_page_from_archive (ComicsDocument  *comics_document,
+					gint             page,
+					GdkPixbufLoader *loader,
+					gboolean        *done)
+{
+	GInputStream *stream;
+	guchar       *buf;
+	gssize        bytes;
+	GError       *error = NULL;
+
+	stream = comics_archive_open_entry (comics_document->reader,
+					    comics_document->page_names->pdata[page],
+					    &error);
+	if (!stream) {
+		g_warning ("%s", error->message);
+		g_error_free (error);
+		gdk_pixbuf_loader_close (loader, NULL);
+		return;
+	}
+
+	buf = g_malloc (READ_BUFFER_SIZE);
+	while (!done || !*done) {
+		bytes = g_input_stream_read (stream, buf, READ_BUFFER_SIZE, NULL, &error);
+		if (bytes <= 0)
+			break;
+
+		if (!gdk_pixbuf_loader_write (loader, buf, bytes, NULL))
+			break;
+	}
+	g_free (buf);
+
+	if (error) {
+		g_warning ("%s", error->message);
+		g_error_free (error);
+	}
+
+	gdk_pixbuf_loader_close (loader, NULL);
+	g_object_unref (stream);
+}
+
 static void
 comics_document_get_page_size (EvDocument *document,
 			       EvPage     *page,
@@ -611,7 +713,23 @@ comics_document_get_page_size (EvDocument *document,
 	gchar *filename;
 	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
 	
-	if (!comics_document->decompress_tmp) {
+	if (comics_document->reader) {
+		loader = gdk_pixbuf_loader_new ();
+		g_signal_connect (loader, "area-prepared",
+				  G_CALLBACK (get_page_size_area_prepared_cb),
+				  &got_size);
+		comics_document_load_page_from_archive (comics_document, page->index,
+							loader, &got_size);
+
+		pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+		if (pixbuf) {
+			if (width)
+				*width = gdk_pixbuf_get_width (pixbuf);
+			if (height)
+				*height = gdk_pixbuf_get_height (pixbuf);
+		}
+		g_object_unref (loader);
+	} else if (!comics_document->decompress_tmp) {
 		argv = extract_argv (document, page->index);
 		success = g_spawn_async_with_pipes (NULL, argv, NULL,
 						    G_SPAWN_SEARCH_PATH | 
@@ -687,7 +805,19 @@ comics_document_render_pixbuf (EvDocument      *document,
 	gchar *filename;
 	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
 	
-	if (!comics_document->decompress_tmp) {
+	if (comics_document->reader) {
+		loader = gdk_pixbuf_loader_new ();
+		g_signal_connect (loader, "size-prepared",
+				  G_CALLBACK (render_pixbuf_size_prepared_cb),
+				  rc);
+		comics_document_load_page_from_archive (comics_document, rc->page->index,
+							loader, NULL);
+
+		tmp_pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+		rotated_pixbuf = tmp_pixbuf ?
+			gdk_pixbuf_rotate_simple (tmp_pixbuf, 360 - rc->rotation) : NULL;
+		g_object_unref (loader);
+	} else if (!comics_document->decompress_tmp) {
 		argv = extract_argv (document, rc->page->index);
 		success = g_spawn_async_with_pipes (NULL, argv, NULL,
 						    G_SPAWN_SEARCH_PATH | 
@@ -754,6 +884,9 @@ comics_document_render (EvDocument      *document,
 	cairo_surface_t *surface;
 
 	pixbuf = comics_document_render_pixbuf (document, rc);
+	if (!pixbuf)
+		return NULL;
+
 	surface = ev_document_misc_surface_from_pixbuf (pixbuf);
 	g_object_unref (pixbuf);
 	
@@ -816,6 +949,9 @@ comics_document_finalize (GObject *object)
 		g_free (comics_document->dir);
 	}
 	
+	if (comics_document->reader)
+		comics_archive_free (comics_document->reader);
+
 	if (comics_document->page_names) {
                 g_ptr_array_foreach (comics_document->page_names, (GFunc) g_free, NULL);
                 g_ptr_array_free (comics_document->page_names, TRUE);
@@ -19,6 +19,7 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <gdk/gdk.h>
 #ifdef HAVE_SPECTRE
 #include <libspectre/spectre.h>
@@ -26,8 +27,59 @@
 
 #include "cairo-device.h"
 
+/* Grey glyphs are kept for every shrink factor they were rendered with,
+ * so that going back and forth between zoom levels, or between pages
+ * and thumbnails, doesn't shrink all the glyphs again.
+ */
+#define GLYPH_CACHE_MAX_SIZE (8 * 1024 * 1024)
+
+typedef struct {
+	gchar  *fontname;
+	Int32   scale;
+	gint    hdpi;
+	gint    vdpi;
+	gint    code;
+	gint    hshrink;
+	gint    vshrink;
+
+	DviGlyph glyph;
+} DviCachedGlyph;
+
+/* Pages are not drawn while the DVI file is interpreted. The device only
+ * records what has to be painted, referencing the glyph masks, so that the
+ * DVI context, whose fonts are shared by all documents, is only needed for
+ * a short time, and the page can be rasterized without holding it.
+ */
+typedef enum {
+	DVI_CAIRO_OP_GLYPH,
+	DVI_CAIRO_OP_BOX,
+	DVI_CAIRO_OP_RULE,
+	DVI_CAIRO_OP_FILLED_RULE,
+	DVI_CAIRO_OP_IMAGE
+} DviCairoOpType;
+
+typedef struct {
+	DviCairoOpType   type;
+	gint             x;
+	gint             y;
+	gint             width;
+	gint             height;
+	Ulong            color;
+	cairo_surface_t *surface;
+} DviCairoOp;
+
+struct _DviCairoPage {
+	gint    width;
+	gint    height;
+
+	gdouble xscale;
+	gdouble yscale;
+
+	GArray *ops;
+};
+
 typedef struct {
-	cairo_t *cr;
+	DviCairoPage *page;
 
 	gint xmargin;
 	gint ymargin;
@@ -38,8 +90,140 @@ typedef struct {
 	Ulong fg;
 	Ulong bg;
 
+	GHashTable *glyph_cache;
+	gsize       glyph_cache_size;
 } DviCairoDevice;
 
+static cairo_user_data_key_t image_data_key;
+
+static guint
+cached_glyph_hash (gconstpointer key)
+{
+	const DviCachedGlyph *cached = key;
+
+	return g_str_hash (cached->fontname) ^
+		(cached->code << 8) ^
+		(cached->hshrink << 20) ^ (cached->vshrink << 26) ^
+		cached->scale;
+}
+
+static gboolean
+cached_glyph_equal (gconstpointer a,
+		    gconstpointer b)
+{
+	const DviCachedGlyph *cached_a = a;
+	const DviCachedGlyph *cached_b = b;
+
+	return cached_a->code == cached_b->code &&
+		cached_a->hshrink == cached_b->hshrink &&
+		cached_a->vshrink == cached_b->vshrink &&
+		cached_a->scale == cached_b->scale &&
+		cached_a->hdpi == cached_b->hdpi &&
+		cached_a->vdpi == cached_b->vdpi &&
+		strcmp (cached_a->fontname, cached_b->fontname) == 0;
+}
+
+static void
+cached_glyph_free (DviCachedGlyph *cached)
+{
+	cairo_surface_destroy ((cairo_surface_t *)cached->glyph.data);
+	g_free (cached->fontname);
+	g_free (cached);
+}
+
+static void
+cached_glyph_set_key (DviCachedGlyph *cached,
+		      DviFont        *font,
+		      DviFontChar    *ch,
+		      int             hshrink,
+		      int             vshrink)
+{
+	cached->fontname = font->fontname;
+	cached->scale = font->scale;
+	cached->hdpi = font->hdpi;
+	cached->vdpi = font->vdpi;
+	cached->code = font->loc + (ch - font->chars);
+	cached->hshrink = hshrink;
+	cached->vshrink = vshrink;
+}
+
+static int
+dvi_cairo_lookup_glyph (void        *device_data,
+			DviFont     *font,
+			DviFontChar *ch,
+			int          hshrink,
+			int          vshrink,
+			DviGlyph    *dest)
+{
+	DviCairoDevice *cairo_device = (DviCairoDevice *) device_data;
+	DviCachedGlyph  key;
+	DviCachedGlyph *cached;
+
+	cached_glyph_set_key (&key, font, ch, hshrink, vshrink);
+	cached = g_hash_table_lookup (cairo_device->glyph_cache, &key);
+	if (!cached)
+		return 0;
+
+	*dest = cached->glyph;
+	dest->data = cairo_surface_reference ((cairo_surface_t *)cached->glyph.data);
+
+	return 1;
+}
+
+static void
+dvi_cairo_store_glyph (void        *device_data,
+		       DviFont     *font,
+		       DviFontChar *ch,
+		       int          hshrink,
+		       int          vshrink,
+		       DviGlyph    *glyph)
+{
+	DviCairoDevice  *cairo_device = (DviCairoDevice *) device_data;
+	DviCachedGlyph  *cached;
+	cairo_surface_t *surface;
+	gsize            size;
+
+	surface = (cairo_surface_t *) glyph->data;
+	size = cairo_image_surface_get_stride (surface) * cairo_image_surface_get_height (surface);
+
+	if (cairo_device->glyph_cache_size + size > GLYPH_CACHE_MAX_SIZE) {
+		g_hash_table_remove_all (cairo_device->glyph_cache);
+		cairo_device->glyph_cache_size = 0;
+	}
+
+	cached = g_new (DviCachedGlyph, 1);
+	cached_glyph_set_key (cached, font, ch, hshrink, vshrink);
+	cached->fontname = g_strdup (font->fontname);
+	cached->glyph = *glyph;
+	cached->glyph.data = cairo_surface_reference (surface);
+
+	g_hash_table_replace (cairo_device->glyph_cache, cached, cached);
+	cairo_device->glyph_cache_size += size;
+}
+
+static void
+dvi_cairo_page_add_op (DviCairoPage    *page,
+		       DviCairoOpType   type,
+		       gint             x,
+		       gint             y,
+		       gint             width,
+		       gint             height,
+		       Ulong            color,
+		       cairo_surface_t *surface)
+{
+	DviCairoOp op;
+
+	op.type = type;
+	op.x = x;
+	op.y = y;
+	op.width = width;
+	op.height = height;
+	op.color = color;
+	op.surface = surface ? cairo_surface_reference (surface) : NULL;
+
+	g_array_append_val (page->ops, op);
+}
+
 static void
 dvi_cairo_draw_glyph (DviContext  *dvi,
 		      DviFontChar *ch,
@@ -50,7 +234,6 @@ dvi_cairo_draw_glyph (DviContext  *dvi,
 	int              x, y, w, h;
 	gboolean         isbox;
 	DviGlyph        *glyph;
-	cairo_surface_t *surface;
 
 	cairo_device = (DviCairoDevice *) dvi->device.device_data;
 
@@ -65,28 +248,24 @@ dvi_cairo_draw_glyph (DviContext  *dvi,
 	w = glyph->w;
 	h = glyph->h;
 
-	surface = cairo_get_target (cairo_device->cr);
 	if (x < 0 || y < 0
-	    || x + w > cairo_image_surface_get_width (surface)
-	    || y + h > cairo_image_surface_get_height (surface))
+	    || x + w > cairo_device->page->width
+	    || y + h > cairo_device->page->height)
 		return;
 
-	cairo_save (cairo_device->cr);
+	/* The glyph mask is referenced, it stays valid even if the font
+	 * drops it before the page is rasterized.
+	 */
 	if (isbox) {
-		cairo_rectangle (cairo_device->cr,
-				 x - cairo_device->xmargin,
-				 y - cairo_device->ymargin,
-				 w, h);
-		cairo_stroke (cairo_device->cr);
+		dvi_cairo_page_add_op (cairo_device->page, DVI_CAIRO_OP_BOX,
+				       x - cairo_device->xmargin,
+				       y - cairo_device->ymargin,
+				       w, h, cairo_device->fg, NULL);
 	} else {
-		cairo_translate (cairo_device->cr, x, y);
-		cairo_set_source_surface (cairo_device->cr,
-					  (cairo_surface_t *) glyph->data,
-					  0, 0);
-		cairo_paint (cairo_device->cr);
+		dvi_cairo_page_add_op (cairo_device->page, DVI_CAIRO_OP_GLYPH,
+				       x, y, w, h, cairo_device->fg,
+				       (cairo_surface_t *) glyph->data);
 	}
-
-	cairo_restore (cairo_device->cr);
 }
 
 static void
@@ -98,31 +277,14 @@ dvi_cairo_draw_rule (DviContext *dvi,
 		     int         fill)
 {
 	DviCairoDevice *cairo_device;
-	Ulong           color;
 
 	cairo_device = (DviCairoDevice *) dvi->device.device_data;
 
-	color = cairo_device->fg;
-	
-	cairo_save (cairo_device->cr);
-	cairo_scale (cairo_device->cr, cairo_device->xscale, cairo_device->yscale);
-
-	cairo_set_source_rgb (cairo_device->cr,
-			      ((color >> 16) & 0xff) / 255.,
-			      ((color >> 8) & 0xff) / 255.,
-			      ((color >> 0) & 0xff) / 255.);
-
-	cairo_rectangle (cairo_device->cr,
-			 (x + cairo_device->xmargin) / cairo_device->xscale,
-			 (y + cairo_device->ymargin) / cairo_device->yscale,
-			 width / cairo_device->xscale, height / cairo_device->yscale);
-	if (fill == 0) {
-		cairo_stroke (cairo_device->cr);
-	} else {
-		cairo_fill (cairo_device->cr);
-	}
-
-	cairo_restore (cairo_device->cr);
+	dvi_cairo_page_add_op (cairo_device->page,
+			       fill == 0 ? DVI_CAIRO_OP_RULE : DVI_CAIRO_OP_FILLED_RULE,
+			       x + cairo_device->xmargin,
+			       y + cairo_device->ymargin,
+			       width, height, cairo_device->fg, NULL);
 }
 
 #ifdef HAVE_SPECTRE
@@ -176,19 +338,14 @@ dvi_cairo_draw_ps (DviContext *dvi,
 						     CAIRO_FORMAT_RGB24,
 						     width, height,
 						     row_length);
+	/* The image outlives this function, free the data with it */
+	cairo_surface_set_user_data (image, &image_data_key, data, free);
 
-	cairo_save (cairo_device->cr);
-
-	cairo_translate (cairo_device->cr,
-			 x + cairo_device->xmargin,
-			 y + cairo_device->ymargin);
-	cairo_set_source_surface (cairo_device->cr, image, 0, 0); 
-	cairo_paint (cairo_device->cr);
-
-	cairo_restore (cairo_device->cr);
-
+	dvi_cairo_page_add_op (cairo_device->page, DVI_CAIRO_OP_IMAGE,
+			       x + cairo_device->xmargin,
+			       y + cairo_device->ymargin,
+			       width, height, 0, image);
 	cairo_surface_destroy (image);
-	free (data);
 }
 #endif /* HAVE_SPECTRE */
 
@@ -233,7 +390,17 @@ dvi_cairo_create_image (void *device_data,
 			Uint  height,
 			Uint  bpp)
 {
-	return cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+	cairo_surface_t *surface;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+
+	/* per cairo docs, must flush before modifying outside of cairo.
+	 * Nothing else draws on it until dvi_cairo_image_done(), so once
+	 * is enough.
+	 */
+	cairo_surface_flush (surface);
+
+	return surface;
 }
 
 static void
@@ -247,16 +414,17 @@ dvi_cairo_put_pixel (void *image, int x, int y, Ulong color)
 {
 	cairo_surface_t *surface;
 	gint             rowstride;
-	guint32         *p;
+	guchar          *p;
 
 	surface = (cairo_surface_t *) image;
 
 	rowstride = cairo_image_surface_get_stride (surface);
-	p = (guint32*) (cairo_image_surface_get_data (surface) + y * rowstride + x * 4);
+	p = cairo_image_surface_get_data (surface) + y * rowstride + x;
 
-        /* per cairo docs, must flush before modifying outside of cairo */
-        cairo_surface_flush(surface);
-	*p = color;
+	/* Only the alpha of the color table is kept, the color
+	 * itself is the source used to paint the glyph.
+	 */
+	*p = (color >> 24) & 0xff;
 }
 
 static void
@@ -278,7 +446,14 @@ dvi_cairo_set_color (void *device_data, Ulong fg, Ulong bg)
 void
 mdvi_cairo_device_init (DviDevice *device)
 {
-	device->device_data = g_new0 (DviCairoDevice, 1);
+	DviCairoDevice *cairo_device;
+
+	cairo_device = g_new0 (DviCairoDevice, 1);
+	cairo_device->glyph_cache = g_hash_table_new_full (cached_glyph_hash,
+							   cached_glyph_equal,
+							   NULL,
+							   (GDestroyNotify)cached_glyph_free);
+	device->device_data = cairo_device;
 
 	device->draw_glyph = dvi_cairo_draw_glyph;
 	device->draw_rule = dvi_cairo_draw_rule;
@@ -287,6 +462,8 @@ mdvi_cairo_device_init (DviDevice *device)
 	device->free_image = dvi_cairo_free_image;
 	device->put_pixel = dvi_cairo_put_pixel;
         device->image_done = dvi_cairo_image_done;
+	device->lookup_glyph = dvi_cairo_lookup_glyph;
+	device->store_glyph = dvi_cairo_store_glyph;
 	device->set_color = dvi_cairo_set_color;
 #ifdef HAVE_SPECTRE
 	device->draw_ps = dvi_cairo_draw_ps;
@@ -303,48 +480,134 @@ mdvi_cairo_device_free (DviDevice *device)
 
 	cairo_device = (DviCairoDevice *) device->device_data;
 
-	if (cairo_device->cr)
-		cairo_destroy (cairo_device->cr);
-
+	g_hash_table_destroy (cairo_device->glyph_cache);
 	g_free (cairo_device);
 }
 
-cairo_surface_t *
-mdvi_cairo_device_get_surface (DviDevice *device)
+/* Must be called with the context locked, the page interpreted in
+ * it and the glyph cache are shared with other renders.
+ */
+DviCairoPage *
+mdvi_cairo_device_record_page (DviContext *dvi)
 {
 	DviCairoDevice *cairo_device;
+	DviCairoPage   *page;
 
-	cairo_device = (DviCairoDevice *) device->device_data;
+	cairo_device = (DviCairoDevice *) dvi->device.device_data;
 
-	return cairo_surface_reference (cairo_get_target (cairo_device->cr));
+	page = g_new0 (DviCairoPage, 1);
+	page->width = dvi->dvi_page_w * dvi->params.conv + 2 * cairo_device->xmargin;
+	page->height = dvi->dvi_page_h * dvi->params.vconv + 2 * cairo_device->ymargin;
+	page->xscale = cairo_device->xscale;
+	page->yscale = cairo_device->yscale;
+	page->ops = g_array_new (FALSE, FALSE, sizeof (DviCairoOp));
+
+	cairo_device->page = page;
+	mdvi_dopage (dvi, dvi->currpage);
+	cairo_device->page = NULL;
+
+	return page;
 }
 
-void
-mdvi_cairo_device_render (DviContext* dvi)
+static void
+dvi_cairo_page_set_color (cairo_t *cr,
+			  Ulong    color)
+{
+	cairo_set_source_rgb (cr,
+			      ((color >> 16) & 0xff) / 255.,
+			      ((color >> 8) & 0xff) / 255.,
+			      ((color >> 0) & 0xff) / 255.);
+}
+
+/* Rasterizes a recorded page. It doesn't use the DVI context, so pages
+ * can be rasterized from different threads at the same time.
+ */
+cairo_surface_t *
+mdvi_cairo_page_render (DviCairoPage *page)
 {
-	DviCairoDevice  *cairo_device;
-	gint             page_width;
-	gint             page_height;
 	cairo_surface_t *surface;
+	cairo_t         *cr;
+	gboolean         source_is_color = FALSE;
+	Ulong            source_color = 0;
+	guint            i;
 
-	cairo_device = (DviCairoDevice *) dvi->device.device_data;
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+					      page->width, page->height);
+	cr = cairo_create (surface);
+
+	cairo_set_source_rgb (cr, 1., 1., 1.);
+	cairo_paint (cr);
+
+	for (i = 0; i < page->ops->len; i++) {
+		DviCairoOp *op = &g_array_index (page->ops, DviCairoOp, i);
+
+		switch (op->type) {
+		case DVI_CAIRO_OP_GLYPH:
+		case DVI_CAIRO_OP_BOX:
+			/* Glyphs are alpha masks painted with the current
+			 * color. Keep the source between glyphs instead of
+			 * saving and restoring the state for every one of them.
+			 */
+			if (!source_is_color || source_color != op->color) {
+				dvi_cairo_page_set_color (cr, op->color);
+				source_is_color = TRUE;
+				source_color = op->color;
+			}
+
+			if (op->type == DVI_CAIRO_OP_GLYPH) {
+				cairo_mask_surface (cr, op->surface, op->x, op->y);
+			} else {
+				cairo_rectangle (cr, op->x, op->y, op->width, op->height);
+				cairo_stroke (cr);
+			}
+			break;
+		case DVI_CAIRO_OP_RULE:
+		case DVI_CAIRO_OP_FILLED_RULE:
+			cairo_save (cr);
+			cairo_scale (cr, page->xscale, page->yscale);
+			dvi_cairo_page_set_color (cr, op->color);
+			cairo_rectangle (cr,
+					 op->x / page->xscale,
+					 op->y / page->yscale,
+					 op->width / page->xscale,
+					 op->height / page->yscale);
+			if (op->type == DVI_CAIRO_OP_RULE)
+				cairo_stroke (cr);
+			else
+				cairo_fill (cr);
+			cairo_restore (cr);
+			source_is_color = FALSE;
+			break;
+		case DVI_CAIRO_OP_IMAGE:
+			cairo_save (cr);
+			cairo_translate (cr, op->x, op->y);
+			cairo_set_source_surface (cr, op->surface, 0, 0);
+			cairo_paint (cr);
+			cairo_restore (cr);
+			source_is_color = FALSE;
+			break;
+		}
+	}
 
-	if (cairo_device->cr)
-		cairo_destroy (cairo_device->cr);
+	cairo_destroy (cr);
 
-	page_width = dvi->dvi_page_w * dvi->params.conv + 2 * cairo_device->xmargin;
-	page_height = dvi->dvi_page_h * dvi->params.vconv + 2 * cairo_device->ymargin;
+	return surface;
+}
 
-	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                              page_width, page_height);
+void
+mdvi_cairo_page_free (DviCairoPage *page)
+{
+	guint i;
 
-	cairo_device->cr = cairo_create (surface);
-        cairo_surface_destroy (surface);
+	for (i = 0; i < page->ops->len; i++) {
+		DviCairoOp *op = &g_array_index (page->ops, DviCairoOp, i);
 
-        cairo_set_source_rgb (cairo_device->cr, 1., 1., 1.);
-        cairo_paint (cairo_device->cr);
+		if (op->surface)
+			cairo_surface_destroy (op->surface);
+	}
 
-	mdvi_dopage (dvi, dvi->currpage);
+	g_array_free (page->ops, TRUE);
+	g_free (page);
 }
 
 void
@@ -26,16 +26,20 @@
 
 G_BEGIN_DECLS
 
-void             mdvi_cairo_device_init        (DviDevice *device);
-void             mdvi_cairo_device_free        (DviDevice *device);
-cairo_surface_t *mdvi_cairo_device_get_surface (DviDevice *device);
-void             mdvi_cairo_device_render      (DviContext* dvi);
-void             mdvi_cairo_device_set_margins (DviDevice *device,
-						gint       xmargin,
-						gint       ymargin);
-void             mdvi_cairo_device_set_scale   (DviDevice *device,
-                                                gdouble    xscale,
-                                                gdouble    yscale);
+typedef struct _DviCairoPage DviCairoPage;
+
+void             mdvi_cairo_device_init        (DviDevice    *device);
+void             mdvi_cairo_device_free        (DviDevice    *device);
+DviCairoPage    *mdvi_cairo_device_record_page (DviContext   *dvi);
+void             mdvi_cairo_device_set_margins (DviDevice    *device,
+						gint          xmargin,
+						gint          ymargin);
+void             mdvi_cairo_device_set_scale   (DviDevice    *device,
+                                                gdouble       xscale,
+                                                gdouble       yscale);
+
+cairo_surface_t *mdvi_cairo_page_render        (DviCairoPage *page);
+void             mdvi_cairo_page_free          (DviCairoPage *page);
 
 G_END_DECLS
 
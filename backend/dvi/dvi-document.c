@@ -163,15 +163,17 @@ dvi_document_render (EvDocument      *document,
 {
 	cairo_surface_t *surface;
 	cairo_surface_t *rotated_surface;
+	DviCairoPage *page;
 	DviDocument *dvi_document = DVI_DOCUMENT(document);
 	gdouble xscale, yscale;
 	gint required_width, required_height;
 	gint proposed_width, proposed_height;
 	gint xmargin = 0, ymargin = 0;
 
-	/* We should protect our context since it's not 
-	 * thread safe. The work to the future - 
-	 * let context render page independently
+	/* The context is not thread safe, and the fonts loaded in
+	 * it are shared with all other documents. It's only needed
+	 * to record the page though, the page itself is rasterized
+	 * without the lock, so several pages can be drawn at once.
 	 */
 	g_mutex_lock (&dvi_context_mutex);
 	
@@ -195,11 +197,13 @@ dvi_document_render (EvDocument      *document,
 	    
 	mdvi_cairo_device_set_margins (&dvi_document->context->device, xmargin, ymargin);
 	mdvi_cairo_device_set_scale (&dvi_document->context->device, xscale, yscale);
-	mdvi_cairo_device_render (dvi_document->context);
-	surface = mdvi_cairo_device_get_surface (&dvi_document->context->device);
+	page = mdvi_cairo_device_record_page (dvi_document->context);
 
 	g_mutex_unlock (&dvi_context_mutex);
 
+	surface = mdvi_cairo_page_render (page);
+	mdvi_cairo_page_free (page);
+
 	rotated_surface = ev_document_misc_surface_rotate_and_scale (surface,
 								     required_width,
 								     required_height, 
@@ -241,6 +245,13 @@ dvi_document_support_synctex (EvDocument *document)
 	return TRUE;
 }
 
+static gboolean
+dvi_document_support_concurrent_render (EvDocument *document)
+{
+	/* Only recording the page needs the context lock */
+	return TRUE;
+}
+
 static void
 dvi_document_class_init (DviDocumentClass *klass)
 {
@@ -263,6 +274,7 @@ dvi_document_class_init (DviDocumentClass *klass)
 	ev_document_class->get_page_size = dvi_document_get_page_size;
 	ev_document_class->render = dvi_document_render;
 	ev_document_class->support_synctex = dvi_document_support_synctex;
+	ev_document_class->support_concurrent_render = dvi_document_support_concurrent_render;
 }
 
 /* EvFileExporterIface */
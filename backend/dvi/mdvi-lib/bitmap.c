@@ -960,6 +960,14 @@ void	mdvi_shrink_glyph_grey(DviContext *dvi, DviFont *font,
 	}
 	h = y + ROUND((int)glyph->h - cols, vs) + 1;
 	ASSERT(w && h);
+
+	/* the device may still have this glyph from an earlier shrink */
+	if(dev->lookup_glyph &&
+	   dev->lookup_glyph(dev->device_data, font, pk, hs, vs, dest)) {
+		pk->fg = MDVI_CURRFG(dvi);
+		pk->bg = MDVI_CURRBG(dvi);
+		return;
+	}
 	
 	/* before touching anything, do this */
 	image = dev->create_image(dev->device_data, w, h, BITMAP_BITS);
@@ -1028,6 +1036,8 @@ void	mdvi_shrink_glyph_grey(DviContext *dvi, DviFont *font,
 	}
 
         dev->image_done(image);
+	if(dev->store_glyph)
+		dev->store_glyph(dev->device_data, font, pk, hs, vs, dest);
 	DEBUG((DBG_BITMAPS, "shrink_glyph_grey: (%dw,%dh,%dx,%dy) -> (%dw,%dh,%dx,%dy)\n",
 		glyph->w, glyph->h, glyph->x, glyph->y,
 		dest->w, dest->h, dest->x, dest->y));
@@ -893,6 +893,8 @@ DviContext *mdvi_init_context(DviParams *par, DviPageSpec *spec, const char *fil
 	dvi->device.free_image   = dummy_free_image;
 	dvi->device.dev_destroy  = dummy_dev_destroy;
 	dvi->device.put_pixel    = dummy_dev_putpixel;
+	dvi->device.lookup_glyph = NULL;
+	dvi->device.store_glyph  = NULL;
 	dvi->device.refresh      = dummy_dev_refresh;
 	dvi->device.set_color    = dummy_dev_set_color;
 	dvi->device.device_data  = NULL;
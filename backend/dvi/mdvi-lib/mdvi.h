@@ -100,6 +100,16 @@ typedef void *(*DviCreateImage)	__PROTO((void *device_data,
 typedef void (*DviFreeImage)	__PROTO((void *image));
 typedef void (*DviPutPixel)	__PROTO((void *image, int x, int y, Ulong color));
 typedef void (*DviImageDone)    __PROTO((void *image));
+typedef int  (*DviLookupGlyph)  __PROTO((void *device_data,
+					 DviFont *font,
+					 DviFontChar *ch,
+					 int hshrink, int vshrink,
+					 DviGlyph *dest));
+typedef void (*DviStoreGlyph)   __PROTO((void *device_data,
+					 DviFont *font,
+					 DviFontChar *ch,
+					 int hshrink, int vshrink,
+					 DviGlyph *glyph));
 typedef void (*DviDevDestroy)   __PROTO((void *data));
 typedef void (*DviRefresh)      __PROTO((DviContext *dvi, void *device_data));
 typedef void (*DviSetColor)	__PROTO((void *device_data, Ulong, Ulong));
@@ -116,6 +126,8 @@ struct _DviDevice {
 	DviFreeImage	free_image;
 	DviPutPixel	put_pixel;
         DviImageDone    image_done;
+	DviLookupGlyph  lookup_glyph;	/* optional cache of grey glyphs */
+	DviStoreGlyph   store_glyph;
 	DviDevDestroy	dev_destroy;
 	DviRefresh	refresh;
 	DviSetColor	set_color;
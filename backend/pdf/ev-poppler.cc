@@ -57,6 +57,7 @@
 #include "ev-image.h"
 #include "ev-media.h"
 #include "ev-file-helpers.h"
+#include "ev-trace.h"
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
@@ -107,13 +108,35 @@ struct _PdfDocument
 	gboolean annots_modified;
 
 	PopplerFontInfo *font_info;
-	PopplerFontsIter *fonts_iter;
 	int fonts_scanned_pages;
+	gboolean fonts_scan_completed;
 	gboolean missing_fonts;
 
+	/* Fonts found so far, without duplicates */
+	GMutex      fonts_mutex;
+	GPtrArray  *fonts;
+	GHashTable *fonts_seen;
+
 	PdfPrintContext *print_ctx;
 
 	GHashTable *annots;
+
+	/* Named destinations looked up so far, and all of them once
+	 * they have been read in a thread.
+	 */
+	GMutex      dests_mutex;
+	GHashTable *dests;
+	GHashTable *all_dests;
+	gboolean    all_dests_loading;
+	guint       dests_hits;
+	guint       dests_misses;
+};
+
+enum {
+	PROP_0,
+	PROP_DESTS_CACHE_SIZE,
+	PROP_DESTS_CACHE_HITS,
+	PROP_DESTS_CACHE_MISSES
 };
 
 static void pdf_document_security_iface_init             (EvDocumentSecurityInterface    *iface);
@@ -192,25 +215,87 @@ pdf_document_dispose (GObject *object)
 		pdf_document->annots = NULL;
 	}
 
+	if (pdf_document->dests) {
+		g_hash_table_destroy (pdf_document->dests);
+		pdf_document->dests = NULL;
+	}
+
+	if (pdf_document->all_dests) {
+		g_hash_table_destroy (pdf_document->all_dests);
+		pdf_document->all_dests = NULL;
+	}
+
 	if (pdf_document->document) {
 		g_object_unref (pdf_document->document);
 	}
 
 	if (pdf_document->font_info) { 
 		poppler_font_info_free (pdf_document->font_info);
+		pdf_document->font_info = NULL;
+	}
+
+	if (pdf_document->fonts) {
+		g_ptr_array_free (pdf_document->fonts, TRUE);
+		pdf_document->fonts = NULL;
 	}
 
-	if (pdf_document->fonts_iter) {
-		poppler_fonts_iter_free (pdf_document->fonts_iter);
+	if (pdf_document->fonts_seen) {
+		g_hash_table_destroy (pdf_document->fonts_seen);
+		pdf_document->fonts_seen = NULL;
 	}
 
 	G_OBJECT_CLASS (pdf_document_parent_class)->dispose (object);
 }
 
+static void
+pdf_document_finalize (GObject *object)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (object);
+
+	g_mutex_clear (&pdf_document->dests_mutex);
+	g_mutex_clear (&pdf_document->fonts_mutex);
+
+	G_OBJECT_CLASS (pdf_document_parent_class)->finalize (object);
+}
+
+static void
+pdf_document_get_property (GObject    *object,
+			   guint       prop_id,
+			   GValue     *value,
+			   GParamSpec *pspec)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (object);
+
+	g_mutex_lock (&pdf_document->dests_mutex);
+
+	switch (prop_id) {
+	case PROP_DESTS_CACHE_SIZE:
+		if (pdf_document->all_dests)
+			g_value_set_uint (value, g_hash_table_size (pdf_document->all_dests));
+		else if (pdf_document->dests)
+			g_value_set_uint (value, g_hash_table_size (pdf_document->dests));
+		else
+			g_value_set_uint (value, 0);
+		break;
+	case PROP_DESTS_CACHE_HITS:
+		g_value_set_uint (value, pdf_document->dests_hits);
+		break;
+	case PROP_DESTS_CACHE_MISSES:
+		g_value_set_uint (value, pdf_document->dests_misses);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+
+	g_mutex_unlock (&pdf_document->dests_mutex);
+}
+
 static void
 pdf_document_init (PdfDocument *pdf_document)
 {
 	pdf_document->password = NULL;
+	g_mutex_init (&pdf_document->dests_mutex);
+	g_mutex_init (&pdf_document->fonts_mutex);
 }
 
 static void
@@ -384,10 +469,11 @@ pdf_document_get_page_label (EvDocument *document,
 }
 
 static cairo_surface_t *
-pdf_page_render (PopplerPage     *page,
-		 gint             width,
-		 gint             height,
-		 EvRenderContext *rc)
+pdf_page_render_area (PopplerPage                 *page,
+		      gint                         width,
+		      gint                         height,
+		      const cairo_rectangle_int_t *area,
+		      EvRenderContext             *rc)
 {
 	cairo_surface_t *surface;
 	cairo_t *cr;
@@ -395,9 +481,14 @@ pdf_page_render (PopplerPage     *page,
 	double xscale, yscale;
 
 	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-					      width, height);
+					      area->width, area->height);
 	cr = cairo_create (surface);
 
+	/* Only the area is rendered, poppler skips everything
+	 * falling outside the surface.
+	 */
+	cairo_translate (cr, -area->x, -area->y);
+
 	switch (rc->rotation) {
 	        case 90:
 			cairo_translate (cr, width, 0);
@@ -429,6 +520,17 @@ pdf_page_render (PopplerPage     *page,
 	return surface;
 }
 
+static cairo_surface_t *
+pdf_page_render (PopplerPage     *page,
+		 gint             width,
+		 gint             height,
+		 EvRenderContext *rc)
+{
+	cairo_rectangle_int_t area = { 0, 0, width, height };
+
+	return pdf_page_render_area (page, width, height, &area, rc);
+}
+
 static cairo_surface_t *
 pdf_document_render (EvDocument      *document,
 		     EvRenderContext *rc)
@@ -448,6 +550,26 @@ pdf_document_render (EvDocument      *document,
 				width, height, rc);
 }
 
+static cairo_surface_t *
+pdf_document_render_area (EvDocument                  *document,
+			  EvRenderContext             *rc,
+			  const cairo_rectangle_int_t *area)
+{
+	PopplerPage *poppler_page;
+	double width_points, height_points;
+	gint width, height;
+
+	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+
+	poppler_page_get_size (poppler_page,
+			       &width_points, &height_points);
+
+	ev_render_context_compute_transformed_size (rc, width_points, height_points,
+						    &width, &height);
+	return pdf_page_render_area (poppler_page,
+				     width, height, area, rc);
+}
+
 static GdkPixbuf *
 make_thumbnail_for_page (PopplerPage     *poppler_page,
 			 EvRenderContext *rc,
@@ -979,6 +1101,8 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	EvDocumentClass *ev_document_class = EV_DOCUMENT_CLASS (klass);
 
 	g_object_class->dispose = pdf_document_dispose;
+	g_object_class->finalize = pdf_document_finalize;
+	g_object_class->get_property = pdf_document_get_property;
 
 	ev_document_class->save = pdf_document_save;
 	ev_document_class->load = pdf_document_load;
@@ -994,14 +1118,40 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	ev_document_class->get_info = pdf_document_get_info;
 	ev_document_class->get_backend_info = pdf_document_get_backend_info;
 	ev_document_class->support_synctex = pdf_document_support_synctex;
+	ev_document_class->render_area = pdf_document_render_area;
+
+	g_object_class_install_property (g_object_class,
+					 PROP_DESTS_CACHE_SIZE,
+					 g_param_spec_uint ("dests-cache-size",
+							    "Named destinations cache size",
+							    "Number of named destinations in the cache",
+							    0, G_MAXUINT, 0,
+							    G_PARAM_READABLE |
+							    G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (g_object_class,
+					 PROP_DESTS_CACHE_HITS,
+					 g_param_spec_uint ("dests-cache-hits",
+							    "Named destinations cache hits",
+							    "Number of named destinations found in the cache",
+							    0, G_MAXUINT, 0,
+							    G_PARAM_READABLE |
+							    G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property (g_object_class,
+					 PROP_DESTS_CACHE_MISSES,
+					 g_param_spec_uint ("dests-cache-misses",
+							    "Named destinations cache misses",
+							    "Number of named destinations looked up in the document",
+							    0, G_MAXUINT, 0,
+							    G_PARAM_READABLE |
+							    G_PARAM_STATIC_STRINGS));
 }
 
 /* EvDocumentSecurity */
 static gboolean
 pdf_document_has_document_security (EvDocumentSecurity *document_security)
 {
-	/* FIXME: do we really need to have this? */
-	return FALSE;
+	/* A password is only set when the document needed one to be opened */
+	return PDF_DOCUMENT (document_security)->password != NULL;
 }
 
 static void
@@ -1029,39 +1179,12 @@ pdf_document_fonts_get_progress (EvDocumentFonts *document_fonts)
 	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
 	int n_pages;
 
-        n_pages = pdf_document_get_n_pages (EV_DOCUMENT (pdf_document));
-
-	return (double)pdf_document->fonts_scanned_pages / (double)n_pages;
-}
-
-static gboolean
-pdf_document_fonts_scan (EvDocumentFonts *document_fonts,
-			 int              n_pages)
-{
-	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
-	gboolean result;
-
-	g_return_val_if_fail (PDF_IS_DOCUMENT (document_fonts), FALSE);
-
-	if (pdf_document->font_info == NULL) { 
-		pdf_document->font_info = poppler_font_info_new (pdf_document->document);
-	}
-
-	if (pdf_document->fonts_iter) {
-		poppler_fonts_iter_free (pdf_document->fonts_iter);
-	}
-
-	pdf_document->fonts_scanned_pages += n_pages;
+	if (pdf_document->fonts_scan_completed)
+		return 1.0;
 
-	result = poppler_font_info_scan (pdf_document->font_info, n_pages,
-				         &pdf_document->fonts_iter);
-	if (!result) {
-		pdf_document->fonts_scanned_pages = 0;
-		poppler_font_info_free (pdf_document->font_info);
-		pdf_document->font_info = NULL;	
-	}
+        n_pages = pdf_document_get_n_pages (EV_DOCUMENT (pdf_document));
 
-	return result;
+	return (double)MIN (pdf_document->fonts_scanned_pages, n_pages) / (double)MAX (n_pages, 1);
 }
 
 static const char *
@@ -1135,20 +1258,26 @@ pdf_document_fonts_get_fonts_summary (EvDocumentFonts *document_fonts)
 		return _("All fonts are either standard or embedded.");
 }
 
+typedef struct {
+	gchar *name;
+	gchar *details;
+} PdfFontEntry;
+
 static void
-pdf_document_fonts_fill_model (EvDocumentFonts *document_fonts,
-			       GtkTreeModel    *model)
+pdf_font_entry_free (PdfFontEntry *entry)
 {
-	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
-	PopplerFontsIter *iter = pdf_document->fonts_iter;
-
-	g_return_if_fail (PDF_IS_DOCUMENT (document_fonts));
-
-	if (!iter)
-		return;
+	g_free (entry->name);
+	g_free (entry->details);
+	g_slice_free (PdfFontEntry, entry);
+}
 
+/* Called with fonts_mutex held */
+static void
+pdf_document_fonts_add_entries (PdfDocument      *pdf_document,
+				PopplerFontsIter *iter)
+{
 	do {
-		GtkTreeIter list_iter;
+		PdfFontEntry *entry;
 		const char *name;
 		PopplerFontType type;
 		const char *type_str;
@@ -1160,6 +1289,7 @@ pdf_document_fonts_fill_model (EvDocumentFonts *document_fonts,
 		const gchar *encoding;
 		const gchar *encoding_text;
 		char *details;
+		char *key;
 		
 		name = poppler_fonts_iter_get_name (iter);
 
@@ -1219,14 +1349,92 @@ pdf_document_fonts_fill_model (EvDocumentFonts *document_fonts,
 							   type_str, standard_str,
 							   encoding_text, encoding, embedded);
 
+		/* The same font is often embedded once per page, list it once */
+		key = g_strconcat (name, "\n", details, NULL);
+		if (g_hash_table_contains (pdf_document->fonts_seen, key)) {
+			g_free (key);
+			g_free (details);
+			continue;
+		}
+		g_hash_table_add (pdf_document->fonts_seen, key);
+
+		entry = g_slice_new (PdfFontEntry);
+		entry->name = g_strdup (name);
+		entry->details = details;
+		g_ptr_array_add (pdf_document->fonts, entry);
+	} while (poppler_fonts_iter_next (iter));
+}
+
+static gboolean
+pdf_document_fonts_scan (EvDocumentFonts *document_fonts,
+			 int              n_pages)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
+	PopplerFontsIter *iter = NULL;
+	gboolean result;
+
+	g_return_val_if_fail (PDF_IS_DOCUMENT (document_fonts), FALSE);
+
+	/* A new scan carries on where the previous one stopped */
+	if (pdf_document->fonts_scan_completed)
+		return FALSE;
+
+	if (pdf_document->font_info == NULL) { 
+		pdf_document->font_info = poppler_font_info_new (pdf_document->document);
+	}
+
+	result = poppler_font_info_scan (pdf_document->font_info, n_pages, &iter);
+	pdf_document->fonts_scanned_pages += n_pages;
+
+	g_mutex_lock (&pdf_document->fonts_mutex);
+	if (!pdf_document->fonts) {
+		pdf_document->fonts = g_ptr_array_new_with_free_func ((GDestroyNotify)pdf_font_entry_free);
+		pdf_document->fonts_seen = g_hash_table_new_full (g_str_hash, g_str_equal,
+								  g_free, NULL);
+	}
+	if (iter) {
+		pdf_document_fonts_add_entries (pdf_document, iter);
+		poppler_fonts_iter_free (iter);
+	}
+	g_mutex_unlock (&pdf_document->fonts_mutex);
+
+	if (!result || pdf_document->fonts_scanned_pages >= pdf_document_get_n_pages (EV_DOCUMENT (pdf_document))) {
+		pdf_document->fonts_scan_completed = TRUE;
+		poppler_font_info_free (pdf_document->font_info);
+		pdf_document->font_info = NULL;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Appends the fonts found since the model was last filled */
+static void
+pdf_document_fonts_fill_model (EvDocumentFonts *document_fonts,
+			       GtkTreeModel    *model)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
+	guint i;
+
+	g_return_if_fail (PDF_IS_DOCUMENT (document_fonts));
+
+	g_mutex_lock (&pdf_document->fonts_mutex);
+	if (!pdf_document->fonts) {
+		g_mutex_unlock (&pdf_document->fonts_mutex);
+		return;
+	}
+
+	for (i = gtk_tree_model_iter_n_children (model, NULL); i < pdf_document->fonts->len; i++) {
+		PdfFontEntry *entry = (PdfFontEntry *)g_ptr_array_index (pdf_document->fonts, i);
+		GtkTreeIter   list_iter;
+
 		gtk_list_store_append (GTK_LIST_STORE (model), &list_iter);
 		gtk_list_store_set (GTK_LIST_STORE (model), &list_iter,
-				    EV_DOCUMENT_FONTS_COLUMN_NAME, name,
-				    EV_DOCUMENT_FONTS_COLUMN_DETAILS, details,
+				    EV_DOCUMENT_FONTS_COLUMN_NAME, entry->name,
+				    EV_DOCUMENT_FONTS_COLUMN_DETAILS, entry->details,
 				    -1);
-
-		g_free (details);
-	} while (poppler_fonts_iter_next (iter));
+	}
+	g_mutex_unlock (&pdf_document->fonts_mutex);
 }
 
 static void
@@ -1563,6 +1771,136 @@ pdf_document_links_get_links (EvDocumentLinks *document_links,
 	return ev_mapping_list_new (page->index, g_list_reverse (retval), (GDestroyNotify)g_object_unref);
 }
 
+#ifdef HAVE_POPPLER_DOCUMENT_CREATE_DESTS_TREE
+static gboolean
+add_dest_to_table (gchar       *name,
+		   PopplerDest *dest,
+		   GHashTable  *dests)
+{
+	g_hash_table_insert (dests, g_strdup (name), poppler_dest_copy (dest));
+
+	return FALSE;
+}
+
+/* Reads all the named destinations into a new table that is only
+ * published once complete, so lookups are never blocked on it.
+ */
+static void
+pdf_document_load_dests_thread (GTask        *task,
+				gpointer      source_object,
+				gpointer      task_data,
+				GCancellable *cancellable)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (source_object);
+	GHashTable  *dests;
+	GTree       *tree;
+
+	dests = g_hash_table_new_full (g_str_hash,
+				       g_str_equal,
+				       g_free,
+				       (GDestroyNotify)poppler_dest_free);
+
+	ev_document_lock (EV_DOCUMENT (pdf_document));
+	tree = poppler_document_create_dests_tree (pdf_document->document);
+	ev_document_unlock (EV_DOCUMENT (pdf_document));
+
+	if (tree) {
+		g_tree_foreach (tree, (GTraverseFunc)add_dest_to_table, dests);
+		g_tree_destroy (tree);
+	}
+
+	g_mutex_lock (&pdf_document->dests_mutex);
+	pdf_document->all_dests = dests;
+	g_mutex_unlock (&pdf_document->dests_mutex);
+
+	ev_trace_instant ("cache", "named dests loaded",
+			  "entries", g_hash_table_size (dests));
+}
+
+static void
+pdf_document_load_dests (PdfDocument *pdf_document)
+{
+	GTask *task;
+
+	task = g_task_new (pdf_document, NULL, NULL, NULL);
+	g_task_run_in_thread (task, pdf_document_load_dests_thread);
+	g_object_unref (task);
+}
+#endif
+
+/* Documents generated with hyperref have thousands of named
+ * destinations, and every link, outline item and history entry
+ * pointing to one looks it up by name. The first lookup starts
+ * reading all of them in a thread when poppler allows it, and
+ * until then, or with older poppler versions, every lookup is
+ * cached. The returned destination is owned by the document.
+ * Must be called with the document locked.
+ */
+static PopplerDest *
+pdf_document_find_dest (PdfDocument *pdf_document,
+			const gchar *link_name)
+{
+	PopplerDest *dest;
+	gpointer     value;
+	guint        n_entries;
+
+	g_mutex_lock (&pdf_document->dests_mutex);
+
+	if (pdf_document->all_dests) {
+		dest = (PopplerDest *)g_hash_table_lookup (pdf_document->all_dests, link_name);
+		pdf_document->dests_hits++;
+		n_entries = g_hash_table_size (pdf_document->all_dests);
+		g_mutex_unlock (&pdf_document->dests_mutex);
+
+		ev_trace_instant ("cache", "named dest cache hit",
+				  "entries", n_entries);
+
+		return dest;
+	}
+
+	if (!pdf_document->dests) {
+		pdf_document->dests = g_hash_table_new_full (g_str_hash,
+							     g_str_equal,
+							     g_free,
+							     (GDestroyNotify)poppler_dest_free);
+	}
+
+	if (g_hash_table_lookup_extended (pdf_document->dests, link_name, NULL, &value)) {
+		pdf_document->dests_hits++;
+		n_entries = g_hash_table_size (pdf_document->dests);
+		g_mutex_unlock (&pdf_document->dests_mutex);
+
+		ev_trace_instant ("cache", "named dest cache hit",
+				  "entries", n_entries);
+
+		return (PopplerDest *)value;
+	}
+
+#ifdef HAVE_POPPLER_DOCUMENT_CREATE_DESTS_TREE
+	if (!pdf_document->all_dests_loading) {
+		pdf_document->all_dests_loading = TRUE;
+		pdf_document_load_dests (pdf_document);
+	}
+#endif
+	pdf_document->dests_misses++;
+	g_mutex_unlock (&pdf_document->dests_mutex);
+
+	/* Names not found are cached too. Lookups are serialized by
+	 * the document lock, so nobody else can add this name.
+	 */
+	dest = poppler_document_find_dest (pdf_document->document, link_name);
+
+	g_mutex_lock (&pdf_document->dests_mutex);
+	g_hash_table_insert (pdf_document->dests, g_strdup (link_name), dest);
+	n_entries = g_hash_table_size (pdf_document->dests);
+	g_mutex_unlock (&pdf_document->dests_mutex);
+
+	ev_trace_instant ("cache", "named dest cache miss",
+			  "entries", n_entries);
+
+	return dest;
+}
+
 static EvLinkDest *
 pdf_document_links_find_link_dest (EvDocumentLinks  *document_links,
 				   const gchar      *link_name)
@@ -1572,12 +1910,9 @@ pdf_document_links_find_link_dest (EvDocumentLinks  *document_links,
 	EvLinkDest *ev_dest = NULL;
 
 	pdf_document = PDF_DOCUMENT (document_links);
-	dest = poppler_document_find_dest (pdf_document->document,
-					   link_name);
-	if (dest) {
+	dest = pdf_document_find_dest (pdf_document, link_name);
+	if (dest)
 		ev_dest = ev_link_dest_from_dest (pdf_document, dest);
-		poppler_dest_free (dest);
-	}
 
 	return ev_dest;
 }
@@ -1591,12 +1926,9 @@ pdf_document_links_find_link_page (EvDocumentLinks  *document_links,
 	gint         retval = -1;
 
 	pdf_document = PDF_DOCUMENT (document_links);
-	dest = poppler_document_find_dest (pdf_document->document,
-					   link_name);
-	if (dest) {
+	dest = pdf_document_find_dest (pdf_document, link_name);
+	if (dest)
 		retval = dest->page_num - 1;
-		poppler_dest_free (dest);
-	}
 
 	return retval;
 }
@@ -3061,11 +3393,19 @@ annot_set_unique_name (EvAnnotation *annot)
 }
 
 static void
-annot_area_changed_cb (EvAnnotation *annot,
-		       GParamSpec   *spec,
-		       EvMapping    *mapping)
+annot_area_changed_cb (EvAnnotation  *annot,
+		       GParamSpec    *spec,
+		       EvMappingList *mapping_list)
 {
-	ev_annotation_get_area (annot, &mapping->area);
+	EvMapping  *mapping;
+	EvRectangle area;
+
+	mapping = ev_mapping_list_find (mapping_list, annot);
+	if (!mapping)
+		return;
+
+	ev_annotation_get_area (annot, &area);
+	ev_mapping_list_move (mapping_list, mapping, &area);
 }
 
 static EvMappingList *
@@ -3126,9 +3466,6 @@ pdf_document_annotations_get_annotations (EvDocumentAnnotations *document_annota
 		}
 		annot_mapping->data = ev_annot;
 		ev_annotation_set_area (ev_annot, &annot_mapping->area);
-		g_signal_connect (ev_annot, "notify::area",
-				  G_CALLBACK (annot_area_changed_cb),
-				  annot_mapping);
 
 		g_object_set_data_full (G_OBJECT (ev_annot),
 					"poppler-annot",
@@ -3151,6 +3488,13 @@ pdf_document_annotations_get_annotations (EvDocumentAnnotations *document_annota
 	}
 
 	mapping_list = ev_mapping_list_new (page->index, g_list_reverse (retval), (GDestroyNotify)g_object_unref);
+	for (list = ev_mapping_list_get_list (mapping_list); list; list = list->next) {
+		EvMapping *annot_mapping = (EvMapping *)list->data;
+
+		g_signal_connect (annot_mapping->data, "notify::area",
+				  G_CALLBACK (annot_area_changed_cb),
+				  mapping_list);
+	}
 	g_hash_table_insert (pdf_document->annots,
 			     GINT_TO_POINTER (page->index),
 			     ev_mapping_list_ref (mapping_list));
@@ -3187,6 +3531,9 @@ pdf_document_annotations_remove_annotation (EvDocumentAnnotations *document_anno
         mapping_list = (EvMappingList *)g_hash_table_lookup (pdf_document->annots,
                                                              GINT_TO_POINTER (page->index));
         if (mapping_list) {
+                g_signal_handlers_disconnect_by_func (annot,
+                                                      (gpointer)annot_area_changed_cb,
+                                                      mapping_list);
                 annot_mapping = ev_mapping_list_find (mapping_list, annot);
                 ev_mapping_list_remove (mapping_list, annot_mapping);
 		if (ev_mapping_list_length (mapping_list) == 0)
@@ -3364,9 +3711,6 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 	annot_mapping = g_new (EvMapping, 1);
 	annot_mapping->area = rect;
 	annot_mapping->data = annot;
-	g_signal_connect (annot, "notify::area",
-			  G_CALLBACK (annot_area_changed_cb),
-			  annot_mapping);
 	g_object_set_data_full (G_OBJECT (annot),
 				"poppler-annot",
 				poppler_annot,
@@ -3388,6 +3732,7 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 	if (mapping_list) {
 		list = ev_mapping_list_get_list (mapping_list);
 		list = g_list_append (list, annot_mapping);
+		ev_mapping_list_update (mapping_list);
 	} else {
 		list = g_list_append (list, annot_mapping);
 		mapping_list = ev_mapping_list_new (page->index, list, (GDestroyNotify)g_object_unref);
@@ -3395,6 +3740,9 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 				     GINT_TO_POINTER (page->index),
 				     ev_mapping_list_ref (mapping_list));
 	}
+	g_signal_connect (annot, "notify::area",
+			  G_CALLBACK (annot_area_changed_cb),
+			  mapping_list);
 
 	pdf_document->annots_modified = TRUE;
 }
@@ -23,6 +23,7 @@
 
 #include <libview/ev-job-scheduler.h>
 #include <libview/ev-jobs.h>
+#include <libview/ev-text-index.h>
 #include <libview/ev-document-model.h>
 #include <libview/ev-print-operation.h>
 #include <libview/ev-view.h>
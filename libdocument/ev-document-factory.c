@@ -42,6 +42,8 @@
 
 static GList *ev_backends_list = NULL;
 static GHashTable *ev_module_hash = NULL;
+/* Documents can be created from different threads */
+G_LOCK_DEFINE_STATIC (ev_module_hash);
 static gchar *ev_backends_dir = NULL;
 
 static EvDocument* ev_document_factory_new_document_for_mime_type (const char *mime_type,
@@ -106,6 +108,8 @@ ev_document_factory_new_document_for_mime_type (const gchar *mime_type,
                 return NULL;
         }
 
+        G_LOCK (ev_module_hash);
+
         if (ev_module_hash != NULL) {
                 module = g_hash_table_lookup (ev_module_hash, info->module_name);
         }
@@ -131,12 +135,16 @@ ev_document_factory_new_document_for_mime_type (const gchar *mime_type,
                 g_set_error (error, EV_DOCUMENT_ERROR, EV_DOCUMENT_ERROR_INVALID,
                              "Failed to load backend for '%s': %s",
                              mime_type, err ? err : "unknown error");
+                G_UNLOCK (ev_module_hash);
+
                 return NULL;
         }
 
         document = EV_DOCUMENT (_ev_module_new_object (EV_MODULE (module)));
         g_type_module_unuse (module);
 
+        G_UNLOCK (ev_module_hash);
+
         g_object_set_data_full (G_OBJECT (document), BACKEND_DATA_KEY,
                                 _ev_backend_info_ref (info),
                                 (GDestroyNotify) _ev_backend_info_unref);
@@ -284,6 +292,27 @@ _ev_document_factory_shutdown (void)
  */
 EvDocument *
 ev_document_factory_get_document (const char *uri, GError **error)
+{
+	return ev_document_factory_get_document_full (uri, EV_DOCUMENT_LOAD_FLAG_NONE, error);
+}
+
+/**
+ * ev_document_factory_get_document_full:
+ * @uri: an URI
+ * @flags: flags from #EvDocumentLoadFlags
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Creates a #EvDocument for the document at @uri like
+ * ev_document_factory_get_document(), loading it with @flags.
+ *
+ * Returns: (transfer full): a new #EvDocument, or %NULL
+ *
+ * Since: 3.18
+ */
+EvDocument *
+ev_document_factory_get_document_full (const char         *uri,
+				       EvDocumentLoadFlags flags,
+				       GError            **error)
 {
 	EvDocument *document;
 	int result;
@@ -310,7 +339,7 @@ ev_document_factory_get_document (const char *uri, GError **error)
 			return NULL;
 		}
 
-		result = ev_document_load (document, uri_unc ? uri_unc : uri, &err);
+		result = ev_document_load_full (document, uri_unc ? uri_unc : uri, flags, &err);
 
 		if (result == FALSE || err) {
 			if (err &&
@@ -352,7 +381,7 @@ ev_document_factory_get_document (const char *uri, GError **error)
 		return NULL;
 	}
 
-	result = ev_document_load (document, uri_unc ? uri_unc : uri, &err);
+	result = ev_document_load_full (document, uri_unc ? uri_unc : uri, flags, &err);
 	if (result == FALSE) {
 		if (err == NULL) {
 			/* FIXME: this really should not happen; the backend should
@@ -83,9 +83,9 @@ ev_document_links_find_link_dest (EvDocumentLinks *document_links,
 	EvDocumentLinksInterface *iface = EV_DOCUMENT_LINKS_GET_IFACE (document_links);
 	EvLinkDest *retval;
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (EV_DOCUMENT (document_links));
 	retval = iface->find_link_dest (document_links, link_name);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (EV_DOCUMENT (document_links));
 
 	return retval;
 }
@@ -97,9 +97,9 @@ ev_document_links_find_link_page (EvDocumentLinks *document_links,
 	EvDocumentLinksInterface *iface = EV_DOCUMENT_LINKS_GET_IFACE (document_links);
 	gint retval;
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (EV_DOCUMENT (document_links));
 	retval = iface->find_link_page (document_links, link_name);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (EV_DOCUMENT (document_links));
 
 	return retval;
 }
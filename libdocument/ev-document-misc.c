@@ -463,6 +463,149 @@ ev_document_misc_surface_rotate_and_scale (cairo_surface_t *surface,
 	return new_surface;
 }
 
+/* Computes, for every destination pixel, the first source pixel it
+ * covers, the number of them and the fraction of every one of them
+ * in the destination pixel.
+ */
+static void
+box_filter_compute_weights (gint    src_size,
+			    gint    dest_size,
+			    gint    max_count,
+			    gint   *starts,
+			    gint   *counts,
+			    gfloat *weights)
+{
+	gdouble scale = (gdouble) src_size / dest_size;
+	gint    i, j;
+
+	for (i = 0; i < dest_size; i++) {
+		gdouble lo = i * scale;
+		gdouble hi = MIN ((i + 1) * scale, src_size);
+		gint    start = (gint) lo;
+		gint    end = MIN ((gint) ceil (hi), start + max_count);
+
+		starts[i] = start;
+		counts[i] = end - start;
+		for (j = start; j < end; j++)
+			weights[i * max_count + j - start] = (MIN (hi, j + 1) - MAX (lo, j)) / scale;
+	}
+}
+
+/**
+ * ev_document_misc_surface_downscale:
+ * @surface: an image surface
+ * @dest_width: the width of the new surface
+ * @dest_height: the height of the new surface
+ *
+ * Scales @surface down with a box filter, every pixel of the new
+ * surface being the average of the pixels of @surface it covers. This
+ * is slower than the bilinear filter used by
+ * ev_document_misc_surface_rotate_and_scale(), but doesn't skip any
+ * pixel, so the result doesn't alias when the scale factor is large,
+ * like when making a thumbnail from a page rendered for the view.
+ *
+ * Returns: (transfer full): a new surface
+ *
+ * Since: 3.18
+ */
+cairo_surface_t *
+ev_document_misc_surface_downscale (cairo_surface_t *surface,
+				    gint             dest_width,
+				    gint             dest_height)
+{
+	cairo_surface_t *new_surface;
+	cairo_format_t   format;
+	gint             width, height;
+	gint             src_stride, dest_stride;
+	const guchar    *src;
+	guchar          *dest;
+	gint             x_max, y_max;
+	gint            *x_starts, *x_counts;
+	gint            *y_starts, *y_counts;
+	gfloat          *x_weights, *y_weights;
+	gfloat          *acc;
+	gint             x, y, i, k;
+
+	g_return_val_if_fail (surface != NULL, NULL);
+	g_return_val_if_fail (dest_width > 0 && dest_height > 0, NULL);
+
+	width = cairo_image_surface_get_width (surface);
+	height = cairo_image_surface_get_height (surface);
+	format = cairo_image_surface_get_format (surface);
+
+	if (dest_width > width || dest_height > height ||
+	    (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24))
+		return ev_document_misc_surface_rotate_and_scale (surface, dest_width, dest_height, 0);
+
+	cairo_surface_flush (surface);
+	src = cairo_image_surface_get_data (surface);
+	src_stride = cairo_image_surface_get_stride (surface);
+
+	new_surface = cairo_image_surface_create (format, dest_width, dest_height);
+	dest = cairo_image_surface_get_data (new_surface);
+	dest_stride = cairo_image_surface_get_stride (new_surface);
+
+	x_max = (gint) ceil ((gdouble) width / dest_width) + 1;
+	x_starts = g_new (gint, dest_width);
+	x_counts = g_new (gint, dest_width);
+	x_weights = g_new (gfloat, dest_width * x_max);
+	box_filter_compute_weights (width, dest_width, x_max, x_starts, x_counts, x_weights);
+
+	y_max = (gint) ceil ((gdouble) height / dest_height) + 1;
+	y_starts = g_new (gint, dest_height);
+	y_counts = g_new (gint, dest_height);
+	y_weights = g_new (gfloat, dest_height * y_max);
+	box_filter_compute_weights (height, dest_height, y_max, y_starts, y_counts, y_weights);
+
+	/* Both formats have 4 bytes per pixel, and premultiplied
+	 * components can be averaged independently of each other.
+	 */
+	acc = g_new (gfloat, dest_width * 4);
+	for (y = 0; y < dest_height; y++) {
+		guchar *dest_row = dest + y * dest_stride;
+
+		memset (acc, 0, dest_width * 4 * sizeof (gfloat));
+
+		for (k = 0; k < y_counts[y]; k++) {
+			const guchar *src_row = src + (y_starts[y] + k) * src_stride;
+			gfloat        wy = y_weights[y * y_max + k];
+
+			for (x = 0; x < dest_width; x++) {
+				const guchar *p = src_row + x_starts[x] * 4;
+				const gfloat *wx = x_weights + x * x_max;
+				gfloat        c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+
+				for (i = 0; i < x_counts[x]; i++, p += 4) {
+					c0 += p[0] * wx[i];
+					c1 += p[1] * wx[i];
+					c2 += p[2] * wx[i];
+					c3 += p[3] * wx[i];
+				}
+
+				acc[x * 4] += c0 * wy;
+				acc[x * 4 + 1] += c1 * wy;
+				acc[x * 4 + 2] += c2 * wy;
+				acc[x * 4 + 3] += c3 * wy;
+			}
+		}
+
+		for (i = 0; i < dest_width * 4; i++)
+			dest_row[i] = (guchar) MIN (acc[i] + 0.5f, 255.f);
+	}
+
+	g_free (acc);
+	g_free (x_starts);
+	g_free (x_counts);
+	g_free (x_weights);
+	g_free (y_starts);
+	g_free (y_counts);
+	g_free (y_weights);
+
+	cairo_surface_mark_dirty (new_surface);
+
+	return new_surface;
+}
+
 void
 ev_document_misc_invert_surface (cairo_surface_t *surface) {
 	cairo_t *cr;
@@ -26,6 +26,7 @@
 
 #include "ev-document.h"
 #include "ev-document-misc.h"
+#include "ev-trace.h"
 #include "synctex_parser.h"
 
 #define EV_DOCUMENT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), EV_TYPE_DOCUMENT, EvDocumentPrivate))
@@ -57,7 +58,25 @@ struct _EvDocumentPrivate
 	EvPageSize     *page_sizes;
 	EvDocumentInfo *info;
 
+	/* Lazy page metadata: pages set up so far, pages still
+	 * pending, the next page to set up and the range of pages
+	 * set up since it was last retrieved. While pages are
+	 * pending, the page metadata fields are protected by
+	 * cache_mutex; once n_pending_pages drops to 0 they don't
+	 * change anymore and are read without locking.
+	 */
+	GMutex          cache_mutex;
+	gint            n_cached_pages;
+	gboolean       *cached_pages;
+	gint            n_pending_pages;
+	gint            next_pending_page;
+	gint            changed_first_page;
+	gint            changed_last_page;
+
 	synctex_scanner_t synctex_scanner;
+
+	GRWLock         lock;
+	gboolean        concurrent_render;
 };
 
 static guint64         _ev_document_get_size_gfile  (GFile      *file);
@@ -71,6 +90,8 @@ static gchar          *_ev_document_get_page_label  (EvDocument *document,
 						     EvPage     *page);
 static EvDocumentInfo *_ev_document_get_info        (EvDocument *document);
 static gboolean        _ev_document_support_synctex (EvDocument *document);
+static gboolean        _ev_document_support_concurrent_render
+                                                    (EvDocument *document);
 
 static GMutex ev_doc_mutex;
 static GMutex ev_fc_mutex;
@@ -115,6 +136,11 @@ ev_document_finalize (GObject *object)
 		document->priv->page_sizes = NULL;
 	}
 
+	if (document->priv->cached_pages) {
+		g_free (document->priv->cached_pages);
+		document->priv->cached_pages = NULL;
+	}
+
 	if (document->priv->page_labels) {
 		gint i;
 
@@ -135,6 +161,9 @@ ev_document_finalize (GObject *object)
 		document->priv->synctex_scanner = NULL;
 	}
 
+	g_rw_lock_clear (&document->priv->lock);
+	g_mutex_clear (&document->priv->cache_mutex);
+
 	G_OBJECT_CLASS (ev_document_parent_class)->finalize (object);
 }
 
@@ -143,6 +172,9 @@ ev_document_init (EvDocument *document)
 {
 	document->priv = EV_DOCUMENT_GET_PRIVATE (document);
 
+	g_rw_lock_init (&document->priv->lock);
+	g_mutex_init (&document->priv->cache_mutex);
+
 	/* Assume all pages are the same size until proven otherwise */
 	document->priv->uniform = TRUE;
 }
@@ -161,28 +193,200 @@ ev_document_class_init (EvDocumentClass *klass)
 	g_object_class->finalize = ev_document_finalize;
 }
 
+/**
+ * ev_document_doc_mutex_lock:
+ *
+ * Locks the process-wide document mutex.
+ *
+ * Deprecated: 3.18: Use ev_document_lock() instead, which only
+ * serializes access to a single document.
+ */
 void
 ev_document_doc_mutex_lock (void)
 {
 	g_mutex_lock (&ev_doc_mutex);
 }
 
+/**
+ * ev_document_doc_mutex_unlock:
+ *
+ * Deprecated: 3.18: Use ev_document_unlock() instead.
+ */
 void
 ev_document_doc_mutex_unlock (void)
 {
 	g_mutex_unlock (&ev_doc_mutex);
 }
 
+/**
+ * ev_document_doc_mutex_trylock:
+ *
+ * Deprecated: 3.18: Use ev_document_trylock() instead.
+ */
 gboolean
 ev_document_doc_mutex_trylock (void)
 {
 	return g_mutex_trylock (&ev_doc_mutex);
 }
 
+/* Only the time spent waiting for another thread is traced */
+static void
+ev_document_rw_lock (EvDocument  *document,
+		     gboolean     shared,
+		     const gchar *name)
+{
+	GRWLock *lock = &document->priv->lock;
+	gint64   start_time;
+
+	if (!EV_TRACE_ENABLED ()) {
+		if (shared)
+			g_rw_lock_reader_lock (lock);
+		else
+			g_rw_lock_writer_lock (lock);
+		return;
+	}
+
+	if (shared ? g_rw_lock_reader_trylock (lock) : g_rw_lock_writer_trylock (lock))
+		return;
+
+	start_time = ev_trace_now ();
+	if (shared)
+		g_rw_lock_reader_lock (lock);
+	else
+		g_rw_lock_writer_lock (lock);
+	ev_trace_complete ("lock", name, start_time, ev_trace_now (), NULL, 0);
+}
+
+/**
+ * ev_document_lock:
+ * @document: an #EvDocument
+ *
+ * Acquires exclusive access to @document. Backends are not thread-safe,
+ * so this must be held around any call to the backend that might be
+ * done while other threads are using the same document. Different
+ * documents can be used concurrently.
+ *
+ * Since: 3.18
+ */
+void
+ev_document_lock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	ev_document_rw_lock (document, FALSE, "ev_document_lock");
+}
+
+/**
+ * ev_document_unlock:
+ * @document: an #EvDocument
+ *
+ * Releases the lock acquired with ev_document_lock() or
+ * ev_document_trylock().
+ *
+ * Since: 3.18
+ */
+void
+ev_document_unlock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	g_rw_lock_writer_unlock (&document->priv->lock);
+}
+
+/**
+ * ev_document_trylock:
+ * @document: an #EvDocument
+ *
+ * Tries to acquire exclusive access to @document without blocking.
+ *
+ * Returns: %TRUE if the lock was acquired
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_trylock (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	return g_rw_lock_writer_trylock (&document->priv->lock);
+}
+
+/**
+ * ev_document_render_lock:
+ * @document: an #EvDocument
+ *
+ * Acquires access to @document for rendering a page, rendering a
+ * thumbnail or computing a selection. When the backend supports
+ * concurrent rendering (see ev_document_supports_concurrent_render())
+ * the lock is shared with other render locks, otherwise this is
+ * equivalent to ev_document_lock().
+ *
+ * Since: 3.18
+ */
+void
+ev_document_render_lock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	ev_document_rw_lock (document, document->priv->concurrent_render,
+			     "ev_document_render_lock");
+}
+
+/**
+ * ev_document_render_unlock:
+ * @document: an #EvDocument
+ *
+ * Releases the lock acquired with ev_document_render_lock().
+ *
+ * Since: 3.18
+ */
+void
+ev_document_render_unlock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	if (document->priv->concurrent_render)
+		g_rw_lock_reader_unlock (&document->priv->lock);
+	else
+		g_rw_lock_writer_unlock (&document->priv->lock);
+}
+
+/**
+ * ev_document_supports_concurrent_render:
+ * @document: an #EvDocument
+ *
+ * Whether different pages of @document can be rendered at the same
+ * time from different threads. Such backends are also expected not to
+ * need the fontconfig mutex while rendering.
+ *
+ * Returns: %TRUE if the backend rendering is reentrant
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_supports_concurrent_render (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	return document->priv->concurrent_render;
+}
+
 void
 ev_document_fc_mutex_lock (void)
 {
+	gint64 start_time;
+
+	if (!EV_TRACE_ENABLED ()) {
+		g_mutex_lock (&ev_fc_mutex);
+		return;
+	}
+
+	if (g_mutex_trylock (&ev_fc_mutex))
+		return;
+
+	start_time = ev_trace_now ();
 	g_mutex_lock (&ev_fc_mutex);
+	ev_trace_complete ("lock", "ev_document_fc_mutex_lock", start_time, ev_trace_now (), NULL, 0);
 }
 
 void
@@ -197,78 +401,166 @@ ev_document_fc_mutex_trylock (void)
 	return g_mutex_trylock (&ev_fc_mutex);
 }
 
+/* Locks the page metadata only while it can still change */
+static gboolean
+ev_document_cache_lock (EvDocument *document)
+{
+	if (g_atomic_int_get (&document->priv->n_pending_pages) == 0)
+		return FALSE;
+
+	g_mutex_lock (&document->priv->cache_mutex);
+
+	return TRUE;
+}
+
 static void
-ev_document_setup_cache (EvDocument *document)
+ev_document_cache_unlock (EvDocument *document,
+			  gboolean    locked)
+{
+	if (locked)
+		g_mutex_unlock (&document->priv->cache_mutex);
+}
+
+/* Must be called with cache_mutex held. Takes ownership of page_label */
+static void
+ev_document_cache_page_unlocked (EvDocument *document,
+                                 gint        i,
+                                 gdouble     page_width,
+                                 gdouble     page_height,
+                                 gchar      *page_label)
 {
         EvDocumentPrivate *priv = document->priv;
-        gint i;
+        EvPageSize        *page_size;
 
-        /* Cache some info about the document to avoid
-         * going to the backends since it requires locks
-         */
-	priv->info = _ev_document_get_info (document);
-        priv->n_pages = _ev_document_get_n_pages (document);
+        if (priv->cached_pages) {
+                /* Already set up by someone else */
+                if (priv->cached_pages[i]) {
+                        g_free (page_label);
+                        return;
+                }
 
-        for (i = 0; i < priv->n_pages; i++) {
-                EvPage     *page = ev_document_get_page (document, i);
-                gdouble     page_width = 0;
-                gdouble     page_height = 0;
-                EvPageSize *page_size;
-                gchar      *page_label;
-
-                _ev_document_get_page_size (document, page, &page_width, &page_height);
-
-                if (i == 0) {
-                        priv->uniform_width = page_width;
-                        priv->uniform_height = page_height;
-                        priv->max_width = priv->uniform_width;
-                        priv->max_height = priv->uniform_height;
-                        priv->min_width = priv->uniform_width;
-                        priv->min_height = priv->uniform_height;
-                } else if (priv->uniform &&
-                            (priv->uniform_width != page_width ||
-                            priv->uniform_height != page_height)) {
-                        /* It's a different page size.  Backfill the array. */
-                        int j;
-
-                        priv->page_sizes = g_new0 (EvPageSize, priv->n_pages);
-
-                        for (j = 0; j < i; j++) {
-                                page_size = &(priv->page_sizes[j]);
-                                page_size->width = priv->uniform_width;
-                                page_size->height = priv->uniform_height;
-                        }
-                        priv->uniform = FALSE;
+                priv->cached_pages[i] = TRUE;
+        }
+
+        if (priv->n_cached_pages == 0) {
+                priv->uniform_width = page_width;
+                priv->uniform_height = page_height;
+                priv->max_width = priv->uniform_width;
+                priv->max_height = priv->uniform_height;
+                priv->min_width = priv->uniform_width;
+                priv->min_height = priv->uniform_height;
+        } else if (priv->uniform &&
+                    (priv->uniform_width != page_width ||
+                    priv->uniform_height != page_height)) {
+                /* It's a different page size.  Backfill the array,
+                 * pages not set up yet are assumed to have the
+                 * size of the first one. */
+                int j;
+
+                priv->page_sizes = g_new0 (EvPageSize, priv->n_pages);
+
+                for (j = 0; j < priv->n_pages; j++) {
+                        page_size = &(priv->page_sizes[j]);
+                        page_size->width = priv->uniform_width;
+                        page_size->height = priv->uniform_height;
                 }
-                if (!priv->uniform) {
-                        page_size = &(priv->page_sizes[i]);
+                priv->uniform = FALSE;
+        }
+        if (!priv->uniform) {
+                page_size = &(priv->page_sizes[i]);
 
-                        page_size->width = page_width;
-                        page_size->height = page_height;
+                page_size->width = page_width;
+                page_size->height = page_height;
 
-                        if (page_width > priv->max_width)
-                                priv->max_width = page_width;
-                        if (page_width < priv->min_width)
-                                priv->min_width = page_width;
+                if (page_width > priv->max_width)
+                        priv->max_width = page_width;
+                if (page_width < priv->min_width)
+                        priv->min_width = page_width;
 
-                        if (page_height > priv->max_height)
-                                priv->max_height = page_height;
-                        if (page_height < priv->min_height)
-                                priv->min_height = page_height;
-                }
+                if (page_height > priv->max_height)
+                        priv->max_height = page_height;
+                if (page_height < priv->min_height)
+                        priv->min_height = page_height;
+        }
 
-                page_label = _ev_document_get_page_label (document, page);
-                if (page_label) {
-                        if (!priv->page_labels)
-                                priv->page_labels = g_new0 (gchar *, priv->n_pages);
+        if (page_label) {
+                if (!priv->page_labels)
+                        priv->page_labels = g_new0 (gchar *, priv->n_pages);
 
-                        priv->page_labels[i] = page_label;
-                        priv->max_label = MAX (priv->max_label,
-                                                g_utf8_strlen (page_label, 256));
-                }
+                priv->page_labels[i] = page_label;
+                priv->max_label = MAX (priv->max_label,
+                                        g_utf8_strlen (page_label, 256));
+        }
+
+        priv->n_cached_pages++;
+
+        if (priv->cached_pages) {
+                if (priv->changed_first_page == -1 || i < priv->changed_first_page)
+                        priv->changed_first_page = i;
+                if (i > priv->changed_last_page)
+                        priv->changed_last_page = i;
+
+                /* Last, so that readers seeing no pending pages see
+                 * everything written above. */
+                g_atomic_int_add (&priv->n_pending_pages, -1);
+        }
+}
+
+/* Queries the backend, so the document must be locked when
+ * setting up pages after loading it.
+ */
+static void
+ev_document_setup_page (EvDocument *document,
+                        gint        i)
+{
+        EvPage *page = ev_document_get_page (document, i);
+        gdouble page_width = 0;
+        gdouble page_height = 0;
+        gchar  *page_label;
+
+        _ev_document_get_page_size (document, page, &page_width, &page_height);
+        page_label = _ev_document_get_page_label (document, page);
+        g_object_unref (page);
+
+        g_mutex_lock (&document->priv->cache_mutex);
+        ev_document_cache_page_unlocked (document, i, page_width, page_height, page_label);
+        g_mutex_unlock (&document->priv->cache_mutex);
+}
+
+/* Documents with fewer pages are set up completely at load time,
+ * it's fast enough and saves the relayouts of lazy setup */
+#define EV_DOCUMENT_LAZY_METADATA_MIN_PAGES 500
 
-                g_object_unref (page);
+static void
+ev_document_setup_cache (EvDocument         *document,
+                         EvDocumentLoadFlags flags)
+{
+        EvDocumentPrivate *priv = document->priv;
+        gint i;
+
+        /* Cache some info about the document to avoid
+         * going to the backends since it requires locks
+         */
+	priv->info = _ev_document_get_info (document);
+        priv->n_pages = _ev_document_get_n_pages (document);
+
+        if (flags & EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA &&
+            priv->n_pages >= EV_DOCUMENT_LAZY_METADATA_MIN_PAGES) {
+                /* Only the first page is set up now, the rest is
+                 * set up later with ev_document_setup_page_metadata() */
+                priv->cached_pages = g_new0 (gboolean, priv->n_pages);
+                priv->n_pending_pages = priv->n_pages;
+                priv->next_pending_page = 1;
+                ev_document_setup_page (document, 0);
+                /* Nothing changed for anyone yet */
+                priv->changed_first_page = -1;
+                priv->changed_last_page = -1;
+
+                return;
         }
+
+        for (i = 0; i < priv->n_pages; i++)
+                ev_document_setup_page (document, i);
 }
 
 static void
@@ -310,6 +602,34 @@ gboolean
 ev_document_load (EvDocument  *document,
 		  const char  *uri,
 		  GError     **error)
+{
+	return ev_document_load_full (document, uri, EV_DOCUMENT_LOAD_FLAG_NONE, error);
+}
+
+/**
+ * ev_document_load_full:
+ * @document: a #EvDocument
+ * @uri: the document's URI
+ * @flags: flags from #EvDocumentLoadFlags
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Loads @document from @uri like ev_document_load().
+ *
+ * With %EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA only the size and label
+ * of the first page are retrieved while loading, see
+ * ev_document_setup_page_metadata(). The flag is ignored for documents
+ * with less than a few hundred pages, whose pages are all set up while
+ * loading as usual.
+ *
+ * Returns: %TRUE on success, or %FALSE on failure.
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_load_full (EvDocument         *document,
+		       const char         *uri,
+		       EvDocumentLoadFlags flags,
+		       GError            **error)
 {
 	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (document);
 	gboolean retval;
@@ -330,7 +650,8 @@ ev_document_load (EvDocument  *document,
 					     "Internal error in backend");
 		}
 	} else {
-                ev_document_setup_cache (document);
+                ev_document_setup_cache (document, flags);
+		document->priv->concurrent_render = _ev_document_support_concurrent_render (document);
 		document->priv->uri = g_strdup (uri);
 		document->priv->file_size = _ev_document_get_size (uri);
 		ev_document_initialize_synctex (document, uri);
@@ -378,7 +699,11 @@ ev_document_load_stream (EvDocument         *document,
         if (!klass->load_stream (document, stream, flags, cancellable, error))
                 return FALSE;
 
-        ev_document_setup_cache (document);
+        ev_document_setup_cache (document, flags);
+        /* Backends read from the stream by seeking and then reading,
+         * which can't be done from several threads at once.
+         */
+        document->priv->concurrent_render = FALSE;
 
         return TRUE;
 }
@@ -422,7 +747,8 @@ ev_document_load_gfile (EvDocument         *document,
         if (!klass->load_gfile (document, file, flags, cancellable, error))
                 return FALSE;
 
-        ev_document_setup_cache (document);
+        ev_document_setup_cache (document, flags);
+        document->priv->concurrent_render = _ev_document_support_concurrent_render (document);
 	document->priv->uri = g_file_get_uri (file);
 	document->priv->file_size = _ev_document_get_size_gfile (file);
 	ev_document_initialize_synctex (document, document->priv->uri);
@@ -474,6 +800,14 @@ _ev_document_support_synctex (EvDocument *document)
 	return klass->support_synctex ? klass->support_synctex (document) : FALSE;
 }
 
+static gboolean
+_ev_document_support_concurrent_render (EvDocument *document)
+{
+	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (document);
+
+	return klass->support_concurrent_render ? klass->support_concurrent_render (document) : FALSE;
+}
+
 gboolean
 ev_document_has_synctex (EvDocument *document)
 {
@@ -645,9 +979,12 @@ ev_document_get_page_size (EvDocument *document,
 			   double     *width,
 			   double     *height)
 {
+	gboolean locked;
+
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 	g_return_if_fail (page_index >= 0 || page_index < document->priv->n_pages);
 
+	locked = ev_document_cache_lock (document);
 	if (width)
 		*width = document->priv->uniform ?
 			document->priv->uniform_width :
@@ -656,6 +993,7 @@ ev_document_get_page_size (EvDocument *document,
 		*height = document->priv->uniform ?
 			document->priv->uniform_height :
 			document->priv->page_sizes[page_index].height;
+	ev_document_cache_unlock (document, locked);
 }
 
 static gchar *
@@ -672,12 +1010,19 @@ gchar *
 ev_document_get_page_label (EvDocument *document,
 			    gint        page_index)
 {
+	gchar   *page_label;
+	gboolean locked;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
 	g_return_val_if_fail (page_index >= 0 || page_index < document->priv->n_pages, NULL);
 
-	return (document->priv->page_labels && document->priv->page_labels[page_index]) ?
+	locked = ev_document_cache_lock (document);
+	page_label = (document->priv->page_labels && document->priv->page_labels[page_index]) ?
 		g_strdup (document->priv->page_labels[page_index]) :
 		g_strdup_printf ("%d", page_index + 1);
+	ev_document_cache_unlock (document, locked);
+
+	return page_label;
 }
 
 static EvDocumentInfo *
@@ -719,6 +1064,74 @@ ev_document_render (EvDocument      *document,
 	return klass->render (document, rc);
 }
 
+/**
+ * ev_document_supports_render_area:
+ * @document: an #EvDocument
+ *
+ * Whether the backend of @document can render a portion of a page
+ * without rendering the whole page, see ev_document_render_area().
+ *
+ * Returns: %TRUE if rendering a page area is cheaper than rendering the page
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_supports_render_area (EvDocument *document)
+{
+	EvDocumentClass *klass;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	klass = EV_DOCUMENT_GET_CLASS (document);
+
+	return klass->render_area != NULL;
+}
+
+/**
+ * ev_document_render_area:
+ * @document: an #EvDocument
+ * @rc: an #EvRenderContext
+ * @area: the area of the rendered page to return, in device pixels
+ *
+ * Renders the portion @area of the page described by @rc. @area is
+ * relative to the page as ev_document_render() would render it, that
+ * is, once scaled and rotated. The returned surface has the size of
+ * @area. Backends not implementing area rendering render the whole
+ * page and crop it.
+ *
+ * Returns: (transfer full): a new #cairo_surface_t
+ *
+ * Since: 3.18
+ */
+cairo_surface_t *
+ev_document_render_area (EvDocument                  *document,
+			 EvRenderContext             *rc,
+			 const cairo_rectangle_int_t *area)
+{
+	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (document);
+	cairo_surface_t *surface;
+	cairo_surface_t *area_surface;
+	cairo_t         *cr;
+
+	if (klass->render_area)
+		return klass->render_area (document, rc, area);
+
+	surface = klass->render (document, rc);
+	if (!surface)
+		return NULL;
+
+	area_surface = cairo_surface_create_similar (surface,
+						     cairo_surface_get_content (surface),
+						     area->width, area->height);
+	cr = cairo_create (area_surface);
+	cairo_set_source_surface (cr, surface, -area->x, -area->y);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+	cairo_surface_destroy (surface);
+
+	return area_surface;
+}
+
 static GdkPixbuf *
 _ev_document_get_thumbnail (EvDocument      *document,
 			    EvRenderContext *rc)
@@ -794,9 +1207,16 @@ ev_document_get_title (EvDocument *document)
 gboolean
 ev_document_is_page_size_uniform (EvDocument *document)
 {
+	gboolean uniform;
+	gboolean locked;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), TRUE);
 
-	return document->priv->uniform;
+	locked = ev_document_cache_lock (document);
+	uniform = document->priv->uniform;
+	ev_document_cache_unlock (document, locked);
+
+	return uniform;
 }
 
 void
@@ -804,12 +1224,16 @@ ev_document_get_max_page_size (EvDocument *document,
 			       gdouble    *width,
 			       gdouble    *height)
 {
+	gboolean locked;
+
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 
+	locked = ev_document_cache_lock (document);
 	if (width)
 		*width = document->priv->max_width;
 	if (height)
 		*height = document->priv->max_height;
+	ev_document_cache_unlock (document, locked);
 }
 
 void
@@ -817,20 +1241,31 @@ ev_document_get_min_page_size (EvDocument *document,
 			       gdouble    *width,
 			       gdouble    *height)
 {
+	gboolean locked;
+
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 
+	locked = ev_document_cache_lock (document);
 	if (width)
 		*width = document->priv->min_width;
 	if (height)
 		*height = document->priv->min_height;
+	ev_document_cache_unlock (document, locked);
 }
 
 gboolean
 ev_document_check_dimensions (EvDocument *document)
 {
+	gboolean retval;
+	gboolean locked;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
-	return (document->priv->max_width > 0 && document->priv->max_height > 0);
+	locked = ev_document_cache_lock (document);
+	retval = (document->priv->max_width > 0 && document->priv->max_height > 0);
+	ev_document_cache_unlock (document, locked);
+
+	return retval;
 }
 
 guint64
@@ -844,19 +1279,211 @@ ev_document_get_size (EvDocument *document)
 gint
 ev_document_get_max_label_len (EvDocument *document)
 {
+	gint     max_label;
+	gboolean locked;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), -1);
 
-	return document->priv->max_label;
+	locked = ev_document_cache_lock (document);
+	max_label = document->priv->max_label;
+	ev_document_cache_unlock (document, locked);
+
+	return max_label;
 }
 
 gboolean
 ev_document_has_text_page_labels (EvDocument *document)
 {
+	gboolean retval;
+	gboolean locked;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
-	return document->priv->page_labels != NULL;
+	locked = ev_document_cache_lock (document);
+	retval = document->priv->page_labels != NULL;
+	ev_document_cache_unlock (document, locked);
+
+	return retval;
 }
 
+/**
+ * ev_document_has_pending_page_metadata:
+ * @document: an #EvDocument
+ *
+ * Whether @document was loaded with %EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA
+ * and the size and label of some of its pages haven't been retrieved
+ * yet. Until then, the size of those pages is assumed to be the size
+ * of the first page, and their label their page number.
+ *
+ * Returns: %TRUE if some pages are still pending
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_has_pending_page_metadata (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	return g_atomic_int_get (&document->priv->n_pending_pages) > 0;
+}
+
+/* Must be called with the document locked */
+static gboolean
+ev_document_setup_pending_pages (EvDocument *document,
+				 gint        n_pages)
+{
+	EvDocumentPrivate *priv = document->priv;
+	gint               i;
+
+	for (i = 0; i < n_pages; i++) {
+		gint page_index;
+
+		g_mutex_lock (&priv->cache_mutex);
+		if (priv->n_pending_pages == 0) {
+			g_mutex_unlock (&priv->cache_mutex);
+			break;
+		}
+
+		while (priv->cached_pages[priv->next_pending_page])
+			priv->next_pending_page = (priv->next_pending_page + 1) % priv->n_pages;
+		page_index = priv->next_pending_page;
+		priv->next_pending_page = (page_index + 1) % priv->n_pages;
+		g_mutex_unlock (&priv->cache_mutex);
+
+		ev_document_setup_page (document, page_index);
+	}
+
+	return g_atomic_int_get (&priv->n_pending_pages) > 0;
+}
+
+/**
+ * ev_document_setup_page_metadata:
+ * @document: an #EvDocument
+ * @n_pages: the maximum number of pages to set up
+ *
+ * Retrieves the size and label of the next @n_pages pending pages
+ * of @document from the backend, starting at the page given to
+ * ev_document_prioritize_page_metadata(). The document must be locked
+ * with ev_document_lock() or ev_document_render_lock(); it's safe to
+ * get page sizes and labels from other threads meanwhile.
+ *
+ * Returns: %TRUE if there are still pages pending
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_setup_page_metadata (EvDocument *document,
+				 gint        n_pages)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	return ev_document_setup_pending_pages (document, n_pages);
+}
+
+/**
+ * ev_document_get_changed_page_metadata:
+ * @document: an #EvDocument
+ * @first_page: (out): return location for the first page set up
+ * @last_page: (out): return location for the last page set up
+ *
+ * Retrieves the range of pages whose size and label were set up since
+ * the previous call, and starts a new range. Pages in the range may
+ * already have been set up before, so this is an upper bound.
+ *
+ * Returns: %TRUE if some pages were set up since the previous call
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_document_get_changed_page_metadata (EvDocument *document,
+				       gint       *first_page,
+				       gint       *last_page)
+{
+	EvDocumentPrivate *priv;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+	g_return_val_if_fail (first_page != NULL, FALSE);
+	g_return_val_if_fail (last_page != NULL, FALSE);
+
+	priv = document->priv;
+	if (!priv->cached_pages)
+		return FALSE;
+
+	g_mutex_lock (&priv->cache_mutex);
+	*first_page = priv->changed_first_page;
+	*last_page = priv->changed_last_page;
+	priv->changed_first_page = -1;
+	priv->changed_last_page = -1;
+	g_mutex_unlock (&priv->cache_mutex);
+
+	return *first_page != -1;
+}
+
+/**
+ * ev_document_prioritize_page_metadata:
+ * @document: an #EvDocument
+ * @page_index: index of page
+ *
+ * Makes ev_document_setup_page_metadata() continue at @page_index,
+ * e.g. because it's the page being shown.
+ *
+ * Since: 3.18
+ */
+void
+ev_document_prioritize_page_metadata (EvDocument *document,
+				      gint        page_index)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+	g_return_if_fail (page_index >= 0 && page_index < document->priv->n_pages);
+
+	if (!ev_document_cache_lock (document))
+		return;
+
+	if (document->priv->n_pending_pages > 0)
+		document->priv->next_pending_page = page_index;
+	ev_document_cache_unlock (document, TRUE);
+}
+
+/**
+ * ev_document_get_page_metadata_progress:
+ * @document: an #EvDocument
+ *
+ * Returns: the fraction of pages whose size and label are known
+ *
+ * Since: 3.18
+ */
+gdouble
+ev_document_get_page_metadata_progress (EvDocument *document)
+{
+	gdouble  progress;
+	gboolean locked;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), 0.0);
+
+	locked = ev_document_cache_lock (document);
+	progress = document->priv->n_pages > 0 ?
+		(gdouble)document->priv->n_cached_pages / document->priv->n_pages : 1.0;
+	ev_document_cache_unlock (document, locked);
+
+	return progress;
+}
+
+/**
+ * ev_document_find_page_by_label:
+ * @document: an #EvDocument
+ * @page_label: the page label to look for
+ * @page_index: (out): return location for the page index
+ *
+ * Finds the page whose label is @page_label, or whose number is
+ * @page_label if no page has that label.
+ *
+ * While the page metadata of @document is pending, only the labels
+ * of the pages already set up are matched, and %FALSE is returned if
+ * none of them matches, since any pending page could have the label.
+ * The lookup can be tried again when more pages are set up.
+ *
+ * Returns: %TRUE if the page was found
+ */
 gboolean
 ev_document_find_page_by_label (EvDocument  *document,
 				const gchar *page_label,
@@ -866,29 +1493,41 @@ ev_document_find_page_by_label (EvDocument  *document,
 	glong value;
 	gchar *endptr = NULL;
 	EvDocumentPrivate *priv = document->priv;
+	gboolean locked;
+	gboolean found = FALSE;
 
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 	g_return_val_if_fail (page_label != NULL, FALSE);
 	g_return_val_if_fail (page_index != NULL, FALSE);
 
+	locked = ev_document_cache_lock (document);
+
         /* First, look for a literal label match */
 	for (i = 0; priv->page_labels && i < priv->n_pages; i ++) {
 		if (priv->page_labels[i] != NULL &&
 		    ! strcmp (page_label, priv->page_labels[i])) {
 			*page_index = i;
-			return TRUE;
+			found = TRUE;
+			break;
 		}
 	}
 
 	/* Second, look for a match with case insensitively */
-	for (i = 0; priv->page_labels && i < priv->n_pages; i++) {
+	for (i = 0; !found && priv->page_labels && i < priv->n_pages; i++) {
 		if (priv->page_labels[i] != NULL &&
 		    ! strcasecmp (page_label, priv->page_labels[i])) {
 			*page_index = i;
-			return TRUE;
+			found = TRUE;
+			break;
 		}
 	}
 
+	ev_document_cache_unlock (document, locked);
+
+	/* A pending page could still have the label */
+	if (found || locked)
+		return found;
+
 	/* Next, parse the label, and see if the number fits */
 	value = strtol (page_label, &endptr, 10);
 	if (endptr[0] == '\0') {
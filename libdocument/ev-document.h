@@ -55,7 +55,8 @@ typedef struct _EvDocumentPrivate EvDocumentPrivate;
 #define EV_DOC_MUTEX_UNLOCK (ev_document_doc_mutex_unlock ())
 
 typedef enum /*< flags >*/ {
-        EV_DOCUMENT_LOAD_FLAG_NONE = 0
+        EV_DOCUMENT_LOAD_FLAG_NONE = 0,
+        EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA = 1 << 0
 } EvDocumentLoadFlags;
 
 typedef enum
@@ -130,6 +131,10 @@ struct _EvDocumentClass
 						     GError             **error);
 	cairo_surface_t * (* get_thumbnail_surface) (EvDocument          *document,
 						     EvRenderContext     *rc);
+        gboolean          (* support_concurrent_render) (EvDocument      *document);
+        cairo_surface_t * (* render_area)           (EvDocument          *document,
+						     EvRenderContext     *rc,
+						     const cairo_rectangle_int_t *area);
 };
 
 GType            ev_document_get_type             (void) G_GNUC_CONST;
@@ -141,6 +146,15 @@ void             ev_document_doc_mutex_lock       (void);
 void             ev_document_doc_mutex_unlock     (void);
 gboolean         ev_document_doc_mutex_trylock    (void);
 
+/* Per-document lock */
+void             ev_document_lock                 (EvDocument      *document);
+void             ev_document_unlock               (EvDocument      *document);
+gboolean         ev_document_trylock              (EvDocument      *document);
+void             ev_document_render_lock          (EvDocument      *document);
+void             ev_document_render_unlock        (EvDocument      *document);
+gboolean         ev_document_supports_concurrent_render
+                                                  (EvDocument      *document);
+
 /* FontConfig mutex */
 GMutex          *ev_document_get_fc_mutex         (void);
 void             ev_document_fc_mutex_lock        (void);
@@ -153,6 +167,10 @@ gboolean         ev_document_get_backend_info     (EvDocument      *document,
 gboolean         ev_document_load                 (EvDocument      *document,
 						   const char      *uri,
 						   GError         **error);
+gboolean         ev_document_load_full            (EvDocument         *document,
+                                                   const char         *uri,
+                                                   EvDocumentLoadFlags flags,
+                                                   GError            **error);
 gboolean         ev_document_load_stream          (EvDocument         *document,
                                                    GInputStream       *stream,
                                                    EvDocumentLoadFlags flags,
@@ -177,6 +195,10 @@ gchar           *ev_document_get_page_label       (EvDocument      *document,
 						   gint             page_index);
 cairo_surface_t *ev_document_render               (EvDocument      *document,
 						   EvRenderContext *rc);
+gboolean         ev_document_supports_render_area (EvDocument      *document);
+cairo_surface_t *ev_document_render_area          (EvDocument      *document,
+						   EvRenderContext *rc,
+						   const cairo_rectangle_int_t *area);
 GdkPixbuf       *ev_document_get_thumbnail        (EvDocument      *document,
 						   EvRenderContext *rc);
 cairo_surface_t *ev_document_get_thumbnail_surface (EvDocument      *document,
@@ -194,6 +216,19 @@ void             ev_document_get_min_page_size    (EvDocument      *document,
 gboolean         ev_document_check_dimensions     (EvDocument      *document);
 gint             ev_document_get_max_label_len    (EvDocument      *document);
 gboolean         ev_document_has_text_page_labels (EvDocument      *document);
+gboolean         ev_document_has_pending_page_metadata
+                                                  (EvDocument      *document);
+gboolean         ev_document_setup_page_metadata  (EvDocument      *document,
+						   gint             n_pages);
+gboolean         ev_document_get_changed_page_metadata
+                                                  (EvDocument      *document,
+						   gint            *first_page,
+						   gint            *last_page);
+void             ev_document_prioritize_page_metadata
+                                                  (EvDocument      *document,
+						   gint             page_index);
+gdouble          ev_document_get_page_metadata_progress
+                                                  (EvDocument      *document);
 gboolean         ev_document_find_page_by_label   (EvDocument      *document,
 						   const gchar     *page_label,
 						   gint            *page_index);
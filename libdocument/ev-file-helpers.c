@@ -588,6 +588,64 @@ static const char *compressor_cmds[] = {
 #define N_ARGS      4
 #define BUFFER_SIZE 1024
 
+/* Inflates gzip files in-process, streaming the data into the
+ * temporary file instead of going through an external command.
+ */
+static gchar *
+uncompress_gzip (const gchar *uri,
+		 GError     **error)
+{
+	GFile            *file;
+	GFile            *file_dst;
+	GFileInputStream *in;
+	GOutputStream    *out;
+	GInputStream     *stream;
+	GConverter       *decompressor;
+	gchar            *filename_dst = NULL;
+	gchar            *uri_dst = NULL;
+	gint              fd;
+
+	file = g_file_new_for_uri (uri);
+	in = g_file_read (file, NULL, error);
+	g_object_unref (file);
+	if (!in)
+		return NULL;
+
+        fd = ev_mkstemp ("comp.XXXXXX", &filename_dst, error);
+	if (fd == -1) {
+		g_object_unref (in);
+
+		return NULL;
+	}
+	close (fd);
+
+	file_dst = g_file_new_for_path (filename_dst);
+	out = G_OUTPUT_STREAM (g_file_append_to (file_dst, G_FILE_CREATE_PRIVATE, NULL, error));
+	if (out) {
+		decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+		stream = g_converter_input_stream_new (G_INPUT_STREAM (in), decompressor);
+		g_object_unref (decompressor);
+
+		if (g_output_stream_splice (out, stream,
+					    G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+					    G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+					    NULL, error) != -1)
+			uri_dst = g_file_get_uri (file_dst);
+
+		g_object_unref (stream);
+		g_object_unref (out);
+	}
+
+	if (!uri_dst)
+		g_unlink (filename_dst);
+
+	g_object_unref (file_dst);
+	g_object_unref (in);
+	g_free (filename_dst);
+
+	return uri_dst;
+}
+
 static gchar *
 compression_run (const gchar       *uri,
 		 EvCompressionType  type,
@@ -604,6 +662,9 @@ compression_run (const gchar       *uri,
 	if (type == EV_COMPRESSION_NONE)
 		return NULL;
 
+	if (type == EV_COMPRESSION_GZIP && !compress)
+		return uncompress_gzip (uri, error);
+
 	cmd = g_find_program_in_path (compressor_cmds[type]);
 	if (!cmd) {
 		/* FIXME: better error codes! */
@@ -26,15 +26,210 @@
  *
  * Since: 3.8
  */
+
+/* Lists shorter than this are searched linearly */
+#define MIN_INDEXED_MAPPINGS 32
+#define MAX_GRID_SIZE        64
+
+/* Uniform grid over the bounding box of all the mappings. Every cell
+ * keeps the ascending positions in the mappings array of the mappings
+ * overlapping it, or NULL if there are none. The mappings array is in
+ * list order, so the first hit in a cell is also the first hit in the
+ * list.
+ */
+typedef struct {
+	EvRectangle bounds;
+	guint       n_columns;
+	guint       n_rows;
+	gdouble     cell_width;
+	gdouble     cell_height;
+
+	guint       n_mappings;
+	EvMapping **mappings;
+	GArray    **cells;
+} EvMappingIndex;
+
 struct _EvMappingList {
-	guint          page;
-	GList         *list;
-	GDestroyNotify data_destroy_func;
-	volatile gint  ref_count;
+	guint           page;
+	GList          *list;
+	GDestroyNotify  data_destroy_func;
+	EvMappingIndex *index;
+	volatile gint   ref_count;
 };
 
 G_DEFINE_BOXED_TYPE (EvMappingList, ev_mapping_list, ev_mapping_list_ref, ev_mapping_list_unref)
 
+static guint
+ev_mapping_index_get_column (EvMappingIndex *index,
+			     gdouble         x)
+{
+	gint column = (gint)((x - index->bounds.x1) / index->cell_width);
+
+	return CLAMP (column, 0, (gint)index->n_columns - 1);
+}
+
+static guint
+ev_mapping_index_get_row (EvMappingIndex *index,
+			  gdouble         y)
+{
+	gint row = (gint)((y - index->bounds.y1) / index->cell_height);
+
+	return CLAMP (row, 0, (gint)index->n_rows - 1);
+}
+
+static void
+ev_mapping_index_free (EvMappingIndex *index)
+{
+	guint c;
+
+	if (!index)
+		return;
+
+	for (c = 0; c < index->n_columns * index->n_rows; c++) {
+		if (index->cells[c])
+			g_array_free (index->cells[c], TRUE);
+	}
+	g_free (index->cells);
+	g_free (index->mappings);
+	g_free (index);
+}
+
+/* Adds the mapping at @pos to the cells overlapping @area */
+static void
+ev_mapping_index_add (EvMappingIndex    *index,
+		      guint              pos,
+		      const EvRectangle *area)
+{
+	guint col1, col2, row1, row2, row, col;
+
+	/* Inverted areas never match, leave them out */
+	if (area->x1 > area->x2 || area->y1 > area->y2)
+		return;
+
+	col1 = ev_mapping_index_get_column (index, area->x1);
+	col2 = ev_mapping_index_get_column (index, area->x2);
+	row1 = ev_mapping_index_get_row (index, area->y1);
+	row2 = ev_mapping_index_get_row (index, area->y2);
+
+	for (row = row1; row <= row2; row++) {
+		for (col = col1; col <= col2; col++) {
+			GArray *cell;
+			guint   i;
+
+			cell = index->cells[row * index->n_columns + col];
+			if (!cell) {
+				cell = g_array_sized_new (FALSE, FALSE, sizeof (guint), 1);
+				index->cells[row * index->n_columns + col] = cell;
+			}
+
+			/* Mappings are added in list order when the index is
+			 * built, so this only walks back when one is moved.
+			 */
+			for (i = cell->len; i > 0 && g_array_index (cell, guint, i - 1) > pos; i--)
+				;
+			g_array_insert_val (cell, i, pos);
+		}
+	}
+}
+
+/* Removes the mapping at @pos from the cells overlapping @area */
+static void
+ev_mapping_index_remove (EvMappingIndex    *index,
+			 guint              pos,
+			 const EvRectangle *area)
+{
+	guint col1, col2, row1, row2, row, col;
+
+	if (area->x1 > area->x2 || area->y1 > area->y2)
+		return;
+
+	col1 = ev_mapping_index_get_column (index, area->x1);
+	col2 = ev_mapping_index_get_column (index, area->x2);
+	row1 = ev_mapping_index_get_row (index, area->y1);
+	row2 = ev_mapping_index_get_row (index, area->y2);
+
+	for (row = row1; row <= row2; row++) {
+		for (col = col1; col <= col2; col++) {
+			GArray *cell;
+			guint   i;
+
+			cell = index->cells[row * index->n_columns + col];
+			if (!cell)
+				continue;
+
+			for (i = 0; i < cell->len; i++) {
+				if (g_array_index (cell, guint, i) == pos) {
+					g_array_remove_index (cell, i);
+					break;
+				}
+			}
+		}
+	}
+}
+
+static EvMappingIndex *
+ev_mapping_index_new (GList *list)
+{
+	EvMappingIndex *index;
+	GList          *l;
+	guint           n_mappings;
+	guint           grid_size;
+	guint           i;
+
+	n_mappings = g_list_length (list);
+	if (n_mappings < MIN_INDEXED_MAPPINGS)
+		return NULL;
+
+	index = g_new0 (EvMappingIndex, 1);
+	index->n_mappings = n_mappings;
+	index->mappings = g_new (EvMapping *, n_mappings);
+
+	for (l = list, i = 0; l; l = g_list_next (l), i++) {
+		EvMapping *mapping = (EvMapping *)l->data;
+
+		index->mappings[i] = mapping;
+		if (i == 0) {
+			index->bounds = mapping->area;
+			continue;
+		}
+
+		index->bounds.x1 = MIN (index->bounds.x1, mapping->area.x1);
+		index->bounds.y1 = MIN (index->bounds.y1, mapping->area.y1);
+		index->bounds.x2 = MAX (index->bounds.x2, mapping->area.x2);
+		index->bounds.y2 = MAX (index->bounds.y2, mapping->area.y2);
+	}
+
+	/* About one mapping per cell for evenly spread mappings */
+	grid_size = 1;
+	while (grid_size < MAX_GRID_SIZE && grid_size * grid_size < n_mappings)
+		grid_size++;
+
+	index->n_columns = grid_size;
+	index->n_rows = grid_size;
+	index->cell_width = (index->bounds.x2 - index->bounds.x1) / grid_size;
+	index->cell_height = (index->bounds.y2 - index->bounds.y1) / grid_size;
+	if (index->cell_width <= 0)
+		index->cell_width = 1;
+	if (index->cell_height <= 0)
+		index->cell_height = 1;
+
+	index->cells = g_new0 (GArray *, index->n_columns * index->n_rows);
+	for (i = 0; i < n_mappings; i++)
+		ev_mapping_index_add (index, i, &index->mappings[i]->area);
+
+	return index;
+}
+
+static gint
+compare_positions (gconstpointer a,
+		   gconstpointer b)
+{
+	guint pos_a = *(const guint *)a;
+	guint pos_b = *(const guint *)b;
+
+	return pos_a < pos_b ? -1 : (pos_a > pos_b ? 1 : 0);
+}
+
 /**
  * ev_mapping_list_find:
  * @mapping_list: an #EvMappingList
@@ -96,6 +291,9 @@ ev_mapping_list_nth (EvMappingList *mapping_list,
 {
         g_return_val_if_fail (mapping_list != NULL, NULL);
 
+        if (mapping_list->index)
+                return n < mapping_list->index->n_mappings ? mapping_list->index->mappings[n] : NULL;
+
         return (EvMapping *)g_list_nth_data (mapping_list->list, n);
 }
 
@@ -114,10 +312,39 @@ ev_mapping_list_get (EvMappingList *mapping_list,
 		     gdouble        x,
 		     gdouble        y)
 {
-	GList *list;
+	EvMappingIndex *index;
+	GList          *list;
 
         g_return_val_if_fail (mapping_list != NULL, NULL);
 
+	index = mapping_list->index;
+	if (index) {
+		GArray *cell;
+		guint   i;
+
+		if (x < index->bounds.x1 || x > index->bounds.x2 ||
+		    y < index->bounds.y1 || y > index->bounds.y2)
+			return NULL;
+
+		cell = index->cells[ev_mapping_index_get_row (index, y) * index->n_columns +
+				    ev_mapping_index_get_column (index, x)];
+		if (!cell)
+			return NULL;
+
+		for (i = 0; i < cell->len; i++) {
+			EvMapping *mapping = index->mappings[g_array_index (cell, guint, i)];
+
+			if ((x >= mapping->area.x1) &&
+			    (y >= mapping->area.y1) &&
+			    (x <= mapping->area.x2) &&
+			    (y <= mapping->area.y2)) {
+				return mapping;
+			}
+		}
+
+		return NULL;
+	}
+
 	for (list = mapping_list->list; list; list = list->next) {
 		EvMapping *mapping = list->data;
 
@@ -132,6 +359,90 @@ ev_mapping_list_get (EvMappingList *mapping_list,
 	return NULL;
 }
 
+/**
+ * ev_mapping_list_get_in_area:
+ * @mapping_list: an #EvMappingList
+ * @area: an #EvRectangle in page coordinates
+ *
+ * Returns the mappings whose area intersects @area, in list order.
+ *
+ * Returns: (transfer container) (element-type EvMapping): a newly allocated
+ * #GList of the #EvMapping<!-- -->s in @area. The mappings are owned by
+ * @mapping_list, free the list with g_list_free().
+ *
+ * Since: 3.18
+ */
+GList *
+ev_mapping_list_get_in_area (EvMappingList     *mapping_list,
+			     const EvRectangle *area)
+{
+	EvMappingIndex *index;
+	GList          *retval = NULL;
+	GList          *list;
+
+	g_return_val_if_fail (mapping_list != NULL, NULL);
+	g_return_val_if_fail (area != NULL, NULL);
+
+	index = mapping_list->index;
+	if (index) {
+		GArray *positions;
+		guint   col1, col2, row1, row2, row, col;
+		guint   i, last = G_MAXUINT;
+
+		if (area->x2 < index->bounds.x1 || area->x1 > index->bounds.x2 ||
+		    area->y2 < index->bounds.y1 || area->y1 > index->bounds.y2)
+			return NULL;
+
+		col1 = ev_mapping_index_get_column (index, MAX (area->x1, index->bounds.x1));
+		col2 = ev_mapping_index_get_column (index, MIN (area->x2, index->bounds.x2));
+		row1 = ev_mapping_index_get_row (index, MAX (area->y1, index->bounds.y1));
+		row2 = ev_mapping_index_get_row (index, MIN (area->y2, index->bounds.y2));
+
+		positions = g_array_new (FALSE, FALSE, sizeof (guint));
+		for (row = row1; row <= row2; row++) {
+			for (col = col1; col <= col2; col++) {
+				GArray *cell = index->cells[row * index->n_columns + col];
+
+				if (!cell)
+					continue;
+
+				for (i = 0; i < cell->len; i++) {
+					guint      pos = g_array_index (cell, guint, i);
+					EvMapping *mapping = index->mappings[pos];
+
+					if (mapping->area.x1 <= area->x2 && mapping->area.x2 >= area->x1 &&
+					    mapping->area.y1 <= area->y2 && mapping->area.y2 >= area->y1)
+						g_array_append_val (positions, pos);
+				}
+			}
+		}
+
+		/* Mappings spanning several cells are found more than once */
+		g_array_sort (positions, compare_positions);
+		for (i = positions->len; i > 0; i--) {
+			guint pos = g_array_index (positions, guint, i - 1);
+
+			if (pos == last)
+				continue;
+			retval = g_list_prepend (retval, index->mappings[pos]);
+			last = pos;
+		}
+		g_array_free (positions, TRUE);
+
+		return retval;
+	}
+
+	for (list = mapping_list->list; list; list = list->next) {
+		EvMapping *mapping = list->data;
+
+		if (mapping->area.x1 <= area->x2 && mapping->area.x2 >= area->x1 &&
+		    mapping->area.y1 <= area->y2 && mapping->area.y2 >= area->y1)
+			retval = g_list_prepend (retval, mapping);
+	}
+
+	return g_list_reverse (retval);
+}
+
 /**
  * ev_mapping_list_get_data:
  * @mapping_list: an #EvMappingList
@@ -178,10 +489,77 @@ ev_mapping_list_remove (EvMappingList *mapping_list,
 			EvMapping     *mapping)
 {
 	mapping_list->list = g_list_remove (mapping_list->list, mapping);
+	ev_mapping_list_update (mapping_list);
         mapping_list->data_destroy_func (mapping->data);
         g_free (mapping);
 }
 
+/**
+ * ev_mapping_list_update:
+ * @mapping_list: an #EvMappingList
+ *
+ * Updates the lookup data of @mapping_list after mappings have been
+ * appended to its list or their areas have changed.
+ *
+ * Since: 3.18
+ */
+void
+ev_mapping_list_update (EvMappingList *mapping_list)
+{
+	g_return_if_fail (mapping_list != NULL);
+
+	ev_mapping_index_free (mapping_list->index);
+	mapping_list->index = ev_mapping_index_new (mapping_list->list);
+}
+
+/**
+ * ev_mapping_list_move:
+ * @mapping_list: an #EvMappingList
+ * @mapping: an #EvMapping of @mapping_list
+ * @area: the new area of @mapping
+ *
+ * Moves @mapping to @area, updating only the lookup data of @mapping
+ * instead of the whole @mapping_list.
+ *
+ * Since: 3.18
+ */
+void
+ev_mapping_list_move (EvMappingList     *mapping_list,
+		      EvMapping         *mapping,
+		      const EvRectangle *area)
+{
+	EvMappingIndex *index;
+	guint           pos;
+
+	g_return_if_fail (mapping_list != NULL);
+	g_return_if_fail (mapping != NULL);
+	g_return_if_fail (area != NULL);
+
+	index = mapping_list->index;
+	if (!index) {
+		mapping->area = *area;
+		return;
+	}
+
+	/* The grid only covers the areas it was built for */
+	if (area->x1 < index->bounds.x1 || area->x2 > index->bounds.x2 ||
+	    area->y1 < index->bounds.y1 || area->y2 > index->bounds.y2) {
+		mapping->area = *area;
+		ev_mapping_list_update (mapping_list);
+		return;
+	}
+
+	for (pos = 0; pos < index->n_mappings; pos++) {
+		if (index->mappings[pos] == mapping)
+			break;
+	}
+	g_return_if_fail (pos < index->n_mappings);
+
+	ev_mapping_index_remove (index, pos, &mapping->area);
+	mapping->area = *area;
+	ev_mapping_index_add (index, pos, &mapping->area);
+}
+
 guint
 ev_mapping_list_get_page (EvMappingList *mapping_list)
 {
@@ -193,6 +571,9 @@ ev_mapping_list_length (EvMappingList *mapping_list)
 {
         g_return_val_if_fail (mapping_list != NULL, 0);
 
+        if (mapping_list->index)
+                return mapping_list->index->n_mappings;
+
         return g_list_length (mapping_list->list);
 }
 
@@ -202,6 +583,11 @@ ev_mapping_list_length (EvMappingList *mapping_list)
  * @list: (element-type EvMapping): a #GList of data for the page
  * @data_destroy_func: function to free a list element
  *
+ * Long lists get a spatial index, so that ev_mapping_list_get() does not
+ * need to test every mapping. If @list or the areas of its mappings are
+ * modified afterwards, other than with ev_mapping_list_remove() or
+ * ev_mapping_list_move(), ev_mapping_list_update() must be called.
+ *
  * Returns: an #EvMappingList
  */
 EvMappingList *
@@ -217,6 +603,7 @@ ev_mapping_list_new (guint          page,
 	mapping_list->page = page;
 	mapping_list->list = list;
 	mapping_list->data_destroy_func = data_destroy_func;
+	mapping_list->index = ev_mapping_index_new (list);
 	mapping_list->ref_count = 1;
 
 	return mapping_list;
@@ -252,6 +639,7 @@ ev_mapping_list_unref (EvMappingList *mapping_list)
 				(GFunc)mapping_list_free_foreach,
 				mapping_list->data_destroy_func);
 		g_list_free (mapping_list->list);
+		ev_mapping_index_free (mapping_list->index);
 		g_slice_free (EvMappingList, mapping_list);
 	}
 }
@@ -44,6 +44,10 @@ guint          ev_mapping_list_get_page    (EvMappingList *mapping_list);
 GList         *ev_mapping_list_get_list    (EvMappingList *mapping_list);
 void           ev_mapping_list_remove      (EvMappingList *mapping_list,
 					    EvMapping     *mapping);
+void           ev_mapping_list_update      (EvMappingList *mapping_list);
+void           ev_mapping_list_move        (EvMappingList     *mapping_list,
+					    EvMapping         *mapping,
+					    const EvRectangle *area);
 EvMapping     *ev_mapping_list_find        (EvMappingList *mapping_list,
 					    gconstpointer  data);
 EvMapping     *ev_mapping_list_find_custom (EvMappingList *mapping_list,
@@ -55,6 +59,8 @@ EvMapping     *ev_mapping_list_get         (EvMappingList *mapping_list,
 gpointer       ev_mapping_list_get_data    (EvMappingList *mapping_list,
 					    gdouble        x,
 					    gdouble        y);
+GList         *ev_mapping_list_get_in_area (EvMappingList     *mapping_list,
+					    const EvRectangle *area);
 EvMapping     *ev_mapping_list_nth         (EvMappingList *mapping_list,
                                             guint          n);
 guint          ev_mapping_list_length      (EvMappingList *mapping_list);
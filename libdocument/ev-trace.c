@@ -0,0 +1,303 @@
+/* ev-trace.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#ifdef G_OS_WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "ev-trace.h"
+
+/* Only the last events are kept, a trace of a few minutes
+ * of scrolling around a document fits in it.
+ */
+#define EV_TRACE_N_EVENTS (1 << 16)
+
+typedef struct {
+	const gchar *category;
+	const gchar *name;
+	const gchar *arg_name;
+	gint64       timestamp;
+	gint64       duration;
+	gint         arg_value;
+	guint        thread_id;
+	gchar        phase;
+} EvTraceEvent;
+
+static gboolean      trace_enabled = FALSE;
+static gchar        *trace_filename = NULL;
+
+G_LOCK_DEFINE_STATIC (trace);
+static EvTraceEvent *events = NULL;
+static guint64       n_events = 0;
+
+static GPrivate      thread_id;
+static gint          n_threads = 0;
+
+void
+_ev_trace_init (void)
+{
+	const gchar *env;
+
+	env = g_getenv ("EV_TRACE");
+	if (!env || env[0] == '\0')
+		return;
+
+	/* The shell changes the working directory after starting */
+	if (g_path_is_absolute (env)) {
+		trace_filename = g_strdup (env);
+	} else {
+		gchar *cwd = g_get_current_dir ();
+
+		trace_filename = g_build_filename (cwd, env, NULL);
+		g_free (cwd);
+	}
+	events = g_new0 (EvTraceEvent, EV_TRACE_N_EVENTS);
+	trace_enabled = TRUE;
+}
+
+void
+_ev_trace_shutdown (void)
+{
+	GError *error = NULL;
+
+	if (!trace_enabled)
+		return;
+
+	if (!ev_trace_dump (NULL, &error)) {
+		g_warning ("Failed to write trace: %s", error->message);
+		g_error_free (error);
+	}
+}
+
+/*
+ * ev_trace_is_enabled:
+ *
+ * Returns: whether events are being recorded. Callers should check it
+ * before doing any extra work to trace an event.
+ */
+gboolean
+ev_trace_is_enabled (void)
+{
+	return trace_enabled;
+}
+
+/*
+ * ev_trace_now:
+ *
+ * Returns: the current time in microseconds, in the time base of
+ * the events
+ */
+gint64
+ev_trace_now (void)
+{
+	return g_get_monotonic_time ();
+}
+
+static guint
+ev_trace_get_thread_id (void)
+{
+	guint id;
+
+	id = GPOINTER_TO_UINT (g_private_get (&thread_id));
+	if (id == 0) {
+		id = g_atomic_int_add (&n_threads, 1) + 1;
+		g_private_set (&thread_id, GUINT_TO_POINTER (id));
+	}
+
+	return id;
+}
+
+static void
+ev_trace_add_event (gchar        phase,
+		    const gchar *category,
+		    const gchar *name,
+		    gint64       timestamp,
+		    gint64       duration,
+		    const gchar *arg_name,
+		    gint         arg_value)
+{
+	EvTraceEvent *event;
+	guint         id;
+
+	id = ev_trace_get_thread_id ();
+
+	G_LOCK (trace);
+	event = &events[n_events++ % EV_TRACE_N_EVENTS];
+	event->phase = phase;
+	event->category = category;
+	event->name = name;
+	event->timestamp = timestamp;
+	event->duration = duration;
+	event->arg_name = arg_name;
+	event->arg_value = arg_value;
+	event->thread_id = id;
+	G_UNLOCK (trace);
+}
+
+/*
+ * ev_trace_complete:
+ * @category: the event category
+ * @name: the event name
+ * @start_time: when the event started, as returned by ev_trace_now()
+ * @end_time: when the event finished, as returned by ev_trace_now()
+ * @arg_name: (allow-none): the name of an argument of the event
+ * @arg_value: the value of the argument
+ *
+ * Records an event that lasted from @start_time to @end_time in the
+ * current thread.
+ */
+void
+ev_trace_complete (const gchar *category,
+		   const gchar *name,
+		   gint64       start_time,
+		   gint64       end_time,
+		   const gchar *arg_name,
+		   gint         arg_value)
+{
+	if (!trace_enabled)
+		return;
+
+	ev_trace_add_event ('X', category, name, start_time,
+			    MAX (end_time - start_time, 0),
+			    arg_name, arg_value);
+}
+
+/*
+ * ev_trace_instant:
+ * @category: the event category
+ * @name: the event name
+ * @arg_name: (allow-none): the name of an argument of the event
+ * @arg_value: the value of the argument
+ *
+ * Records an event happening now in the current thread.
+ */
+void
+ev_trace_instant (const gchar *category,
+		  const gchar *name,
+		  const gchar *arg_name,
+		  gint         arg_value)
+{
+	if (!trace_enabled)
+		return;
+
+	ev_trace_add_event ('i', category, name, ev_trace_now (), 0,
+			    arg_name, arg_value);
+}
+
+static void
+ev_trace_write_string (GString     *json,
+		       const gchar *str)
+{
+	g_string_append_c (json, '"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			g_string_append_c (json, '\\');
+		if ((guchar)*str >= 0x20)
+			g_string_append_c (json, *str);
+	}
+	g_string_append_c (json, '"');
+}
+
+static void
+ev_trace_write_event (GString            *json,
+		      const EvTraceEvent *event,
+		      gint                pid)
+{
+	g_string_append (json, "{\"name\":");
+	ev_trace_write_string (json, event->name);
+	g_string_append (json, ",\"cat\":");
+	ev_trace_write_string (json, event->category);
+	g_string_append_printf (json, ",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT,
+				event->phase, event->timestamp);
+	if (event->phase == 'X')
+		g_string_append_printf (json, ",\"dur\":%" G_GINT64_FORMAT, event->duration);
+	else
+		g_string_append (json, ",\"s\":\"t\"");
+	g_string_append_printf (json, ",\"pid\":%d,\"tid\":%u", pid, event->thread_id);
+	if (event->arg_name) {
+		g_string_append (json, ",\"args\":{");
+		ev_trace_write_string (json, event->arg_name);
+		g_string_append_printf (json, ":%d}", event->arg_value);
+	}
+	g_string_append_c (json, '}');
+}
+
+/*
+ * ev_trace_dump:
+ * @filename: (allow-none): the file to write the events to, or %NULL
+ *   to use the one given in the EV_TRACE environment variable
+ * @error: (allow-none): return location for an error, or %NULL
+ *
+ * Writes the recorded events to @filename in the Chrome trace event
+ * format, which can be loaded in chrome://tracing. Recording goes on
+ * while the file is written.
+ *
+ * Returns: %TRUE on success, or %FALSE if tracing is not enabled or
+ *   the file could not be written
+ */
+gboolean
+ev_trace_dump (const gchar *filename,
+	       GError     **error)
+{
+	EvTraceEvent *snapshot;
+	guint64       first, last, i;
+	GString      *json;
+	gint          pid;
+	gboolean      retval;
+
+	if (!trace_enabled) {
+		g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				     "Tracing is not enabled");
+		return FALSE;
+	}
+
+	/* Copy the buffer, so that other threads aren't blocked while
+	 * the JSON is generated and written.
+	 */
+	snapshot = g_new (EvTraceEvent, EV_TRACE_N_EVENTS);
+	G_LOCK (trace);
+	memcpy (snapshot, events, sizeof (EvTraceEvent) * EV_TRACE_N_EVENTS);
+	last = n_events;
+	G_UNLOCK (trace);
+
+	first = last > EV_TRACE_N_EVENTS ? last - EV_TRACE_N_EVENTS : 0;
+	pid = getpid ();
+
+	json = g_string_sized_new ((last - first) * 128 + 32);
+	g_string_append (json, "{\"traceEvents\":[");
+	for (i = first; i < last; i++) {
+		if (i > first)
+			g_string_append (json, ",\n");
+		ev_trace_write_event (json, &snapshot[i % EV_TRACE_N_EVENTS], pid);
+	}
+	g_string_append (json, "],\"displayTimeUnit\":\"ms\"}\n");
+	g_free (snapshot);
+
+	retval = g_file_set_contents (filename ? filename : trace_filename,
+				      json->str, json->len, error);
+	g_string_free (json, TRUE);
+
+	return retval;
+}
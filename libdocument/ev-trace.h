@@ -0,0 +1,59 @@
+/* ev-trace.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#ifndef EV_TRACE_H
+#define EV_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Set the EV_TRACE environment variable to the name of a file to
+ * record timing events in a ring buffer. They are written to that
+ * file, in the Chrome trace event format, when the library is shut
+ * down or when ev_trace_dump() is called. Categories and names must
+ * be static strings, they are not copied.
+ */
+#define EV_TRACE_ENABLED() G_UNLIKELY (ev_trace_is_enabled ())
+
+void     _ev_trace_init      (void);
+void     _ev_trace_shutdown  (void);
+
+gboolean ev_trace_is_enabled (void);
+gint64   ev_trace_now        (void);
+void     ev_trace_complete   (const gchar *category,
+			      const gchar *name,
+			      gint64       start_time,
+			      gint64       end_time,
+			      const gchar *arg_name,
+			      gint         arg_value);
+void     ev_trace_instant    (const gchar *category,
+			      const gchar *name,
+			      const gchar *arg_name,
+			      gint         arg_value);
+gboolean ev_trace_dump       (const gchar *filename,
+			      GError     **error);
+
+G_END_DECLS
+
+#endif /* EV_TRACE_H */
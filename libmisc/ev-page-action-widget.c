@@ -47,6 +47,7 @@ struct _EvPageActionWidget
 	GtkWidget *entry;
 	GtkWidget *label;
 	guint signal_id;
+	guint metadata_signal_id;
 	GtkTreeModel *filter_model;
 	GtkTreeModel *model;
 };
@@ -147,6 +148,25 @@ page_changed_cb (EvDocumentModel    *model,
 	ev_page_action_widget_set_current_page (action_widget, new_page);
 }
 
+static void
+page_metadata_changed_cb (EvDocumentModel    *model,
+			  gint                first_page,
+			  gint                last_page,
+			  EvPageActionWidget *action_widget)
+{
+	gint page = ev_document_model_get_page (model);
+
+	/* The real labels of lazily set up pages replace their page
+	 * numbers, but don't overwrite what's being typed */
+	if (page >= first_page && page <= last_page &&
+	    !gtk_widget_has_focus (action_widget->entry))
+		ev_page_action_widget_set_current_page (action_widget, page);
+	else
+		update_pages_label (action_widget, page);
+
+	ev_page_action_widget_update_max_width (action_widget);
+}
+
 static gboolean
 page_scroll_cb (EvPageActionWidget *action_widget, GdkEventScroll *event)
 {
@@ -266,6 +286,11 @@ ev_page_action_widget_set_document (EvPageActionWidget *action_widget,
                                              action_widget->signal_id);
                 action_widget->signal_id = 0;
         }
+        if (action_widget->metadata_signal_id > 0) {
+                g_signal_handler_disconnect (action_widget->doc_model,
+                                             action_widget->metadata_signal_id);
+                action_widget->metadata_signal_id = 0;
+        }
 
         if (action_widget->document)
                 g_object_unref (action_widget->document);
@@ -278,6 +303,11 @@ ev_page_action_widget_set_document (EvPageActionWidget *action_widget,
                                   "page-changed",
                                   G_CALLBACK (page_changed_cb),
                                   action_widget);
+        action_widget->metadata_signal_id =
+                g_signal_connect (action_widget->doc_model,
+                                  "page-metadata-changed",
+                                  G_CALLBACK (page_metadata_changed_cb),
+                                  action_widget);
 
         ev_page_action_widget_set_current_page (action_widget,
                                                 ev_document_model_get_page (action_widget->doc_model));
@@ -321,6 +351,11 @@ ev_page_action_widget_finalize (GObject *object)
 						     action_widget->signal_id);
 			action_widget->signal_id = 0;
 		}
+		if (action_widget->metadata_signal_id > 0) {
+			g_signal_handler_disconnect (action_widget->doc_model,
+						     action_widget->metadata_signal_id);
+			action_widget->metadata_signal_id = 0;
+		}
 		g_object_remove_weak_pointer (G_OBJECT (action_widget->doc_model),
 					      (gpointer)&action_widget->doc_model);
 		action_widget->doc_model = NULL;
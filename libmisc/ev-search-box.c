@@ -46,6 +46,7 @@ enum
 struct _EvSearchBoxPrivate {
         EvDocumentModel *model;
         EvJob           *job;
+        EvJob           *index_job;
         EvFindOptions    options;
         EvFindOptions    supported_options;
 
@@ -88,11 +89,62 @@ ev_search_box_clear_job (EvSearchBox *box)
         priv->job = NULL;
 }
 
+static void
+ev_search_box_clear_index_job (EvSearchBox *box)
+{
+        EvSearchBoxPrivate *priv = box->priv;
+
+        if (!priv->index_job)
+                return;
+
+        if (!ev_job_is_finished (priv->index_job))
+                ev_job_cancel (priv->index_job);
+
+        g_signal_handlers_disconnect_matched (priv->index_job, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, box);
+        g_object_unref (priv->index_job);
+        priv->index_job = NULL;
+}
+
+static void
+index_job_finished_cb (EvJob       *job,
+                       EvSearchBox *box)
+{
+        ev_search_box_clear_index_job (box);
+}
+
+/* Once the document has been searched, its text index is loaded or
+ * built in the background so that following searches, also in later
+ * sessions, don't need to extract the text again.
+ */
+static void
+ev_search_box_ensure_text_index (EvSearchBox *box,
+                                 EvDocument  *document)
+{
+        EvSearchBoxPrivate *priv = box->priv;
+        EvTextIndex        *index;
+
+        if (priv->index_job || !EV_IS_DOCUMENT_TEXT (document))
+                return;
+
+        index = ev_text_index_lookup (document);
+        if (index) {
+                ev_text_index_unref (index);
+                return;
+        }
+
+        priv->index_job = ev_job_text_index_new (document);
+        g_signal_connect (priv->index_job, "finished",
+                          G_CALLBACK (index_job_finished_cb),
+                          box);
+        ev_job_scheduler_push_job (priv->index_job, EV_JOB_PRIORITY_NONE);
+}
+
 static void
 find_job_finished_cb (EvJobFind   *job,
                       EvSearchBox *box)
 {
         g_signal_emit (box, signals[FINISHED], 0);
+        ev_search_box_ensure_text_index (box, EV_JOB (job)->document);
         ev_search_box_clear_job (box);
         ev_search_box_update_progress (box);
 
@@ -256,6 +308,7 @@ document_changed_cb (EvDocumentModel *model,
                      GParamSpec      *pspec,
                      EvSearchBox     *box)
 {
+        ev_search_box_clear_index_job (box);
         ev_search_box_setup_document (box, ev_document_model_get_document (model));
 }
 
@@ -410,6 +463,7 @@ ev_search_box_dispose (GObject *object)
         EvSearchBox *box = EV_SEARCH_BOX (object);
 
         ev_search_box_clear_job (box);
+        ev_search_box_clear_index_job (box);
 
         G_OBJECT_CLASS (ev_search_box_parent_class)->dispose (object);
 }
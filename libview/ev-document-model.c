@@ -21,6 +21,8 @@
 #include "config.h"
 
 #include "ev-document-model.h"
+#include "ev-jobs.h"
+#include "ev-job-scheduler.h"
 #include "ev-view-type-builtins.h"
 #include "ev-view-marshal.h"
 
@@ -44,6 +46,10 @@ struct _EvDocumentModel
 
 	gdouble max_scale;
 	gdouble min_scale;
+
+	EvJob *page_metadata_job;
+	/* Label not found yet because pages are still pending */
+	gchar *pending_page_label;
 };
 
 struct _EvDocumentModelClass
@@ -54,6 +60,9 @@ struct _EvDocumentModelClass
 	void (* page_changed) (EvDocumentModel *model,
 			       gint             old_page,
 			       gint             new_page);
+	void (* page_metadata_changed) (EvDocumentModel *model,
+					gint             first_page,
+					gint             last_page);
 };
 
 enum {
@@ -76,6 +85,7 @@ enum {
 enum
 {
 	PAGE_CHANGED,
+	PAGE_METADATA_CHANGED,
 	N_SIGNALS
 };
 
@@ -86,11 +96,26 @@ G_DEFINE_TYPE (EvDocumentModel, ev_document_model, G_TYPE_OBJECT)
 #define DEFAULT_MIN_SCALE 0.25
 #define DEFAULT_MAX_SCALE 5.0
 
+static void
+ev_document_model_clear_page_metadata_job (EvDocumentModel *model)
+{
+	if (!model->page_metadata_job)
+		return;
+
+	g_signal_handlers_disconnect_by_data (model->page_metadata_job, model);
+	ev_job_cancel (model->page_metadata_job);
+	g_object_unref (model->page_metadata_job);
+	model->page_metadata_job = NULL;
+}
+
 static void
 ev_document_model_finalize (GObject *object)
 {
 	EvDocumentModel *model = EV_DOCUMENT_MODEL (object);
 
+	ev_document_model_clear_page_metadata_job (model);
+	g_free (model->pending_page_label);
+
 	if (model->document) {
 		g_object_unref (model->document);
 		model->document = NULL;
@@ -332,6 +357,28 @@ ev_document_model_class_init (EvDocumentModelClass *klass)
 			      ev_view_marshal_VOID__INT_INT,
 			      G_TYPE_NONE, 2,
 			      G_TYPE_INT, G_TYPE_INT);
+
+	/**
+	 * EvDocumentModel::page-metadata-changed:
+	 * @model: the #EvDocumentModel
+	 * @first_page: the first page whose metadata changed
+	 * @last_page: the last page whose metadata changed
+	 *
+	 * Emitted when the size and label of pages of a document
+	 * loaded with %EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA become
+	 * known, see ev_document_get_changed_page_metadata().
+	 *
+	 * Since: 3.18
+	 */
+	signals [PAGE_METADATA_CHANGED] =
+		g_signal_new ("page-metadata-changed",
+			      EV_TYPE_DOCUMENT_MODEL,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvDocumentModelClass, page_metadata_changed),
+			      NULL, NULL,
+			      ev_view_marshal_VOID__INT_INT,
+			      G_TYPE_NONE, 2,
+			      G_TYPE_INT, G_TYPE_INT);
 }
 
 static void
@@ -346,6 +393,66 @@ ev_document_model_init (EvDocumentModel *model)
 	model->max_scale = DEFAULT_MAX_SCALE;
 }
 
+/* Goes to the page given to ev_document_model_set_page_by_label()
+ * once its label has been read.
+ */
+static void
+ev_document_model_resolve_pending_page_label (EvDocumentModel *model)
+{
+	gint page;
+
+	if (!model->pending_page_label)
+		return;
+
+	if (!ev_document_find_page_by_label (model->document, model->pending_page_label, &page)) {
+		if (!ev_document_has_pending_page_metadata (model->document))
+			g_clear_pointer (&model->pending_page_label, g_free);
+		return;
+	}
+
+	ev_document_model_set_page (model, page);
+}
+
+static void
+page_metadata_updated_cb (EvJob           *job,
+			  gint             first_page,
+			  gint             last_page,
+			  EvDocumentModel *model)
+{
+	g_signal_emit (model, signals[PAGE_METADATA_CHANGED], 0, first_page, last_page);
+	ev_document_model_resolve_pending_page_label (model);
+}
+
+static void
+page_metadata_job_finished_cb (EvJob           *job,
+			       EvDocumentModel *model)
+{
+	g_signal_handlers_disconnect_by_data (job, model);
+	g_object_unref (model->page_metadata_job);
+	model->page_metadata_job = NULL;
+
+	ev_document_model_resolve_pending_page_label (model);
+}
+
+static void
+ev_document_model_setup_page_metadata_job (EvDocumentModel *model)
+{
+	if (!ev_document_has_pending_page_metadata (model->document))
+		return;
+
+	if (model->page >= 0)
+		ev_document_prioritize_page_metadata (model->document, model->page);
+
+	model->page_metadata_job = ev_job_page_metadata_new (model->document);
+	g_signal_connect (model->page_metadata_job, "updated",
+			  G_CALLBACK (page_metadata_updated_cb),
+			  model);
+	g_signal_connect (model->page_metadata_job, "finished",
+			  G_CALLBACK (page_metadata_job_finished_cb),
+			  model);
+	ev_job_scheduler_push_job (model->page_metadata_job, EV_JOB_PRIORITY_NONE);
+}
+
 EvDocumentModel *
 ev_document_model_new (void)
 {
@@ -370,6 +477,9 @@ ev_document_model_set_document (EvDocumentModel *model,
 	if (document == model->document)
 		return;
 
+	ev_document_model_clear_page_metadata_job (model);
+	g_clear_pointer (&model->pending_page_label, g_free);
+
 	if (model->document)
 		g_object_unref (model->document);
 	model->document = g_object_ref (document);
@@ -377,6 +487,7 @@ ev_document_model_set_document (EvDocumentModel *model,
 	model->n_pages = ev_document_get_n_pages (document);
 	ev_document_model_set_page (model, CLAMP (model->page, 0,
 						  model->n_pages - 1));
+	ev_document_model_setup_page_metadata_job (model);
 
 	g_object_notify (G_OBJECT (model), "document");
 }
@@ -405,6 +516,9 @@ ev_document_model_set_page (EvDocumentModel *model,
 
 	g_return_if_fail (EV_IS_DOCUMENT_MODEL (model));
 
+	/* Going to another page cancels a pending label lookup */
+	g_clear_pointer (&model->pending_page_label, g_free);
+
 	if (model->page == page)
 		return;
 	if (page < 0 || (model->document && page >= model->n_pages))
@@ -412,6 +526,11 @@ ev_document_model_set_page (EvDocumentModel *model,
 
 	old_page = model->page;
 	model->page = page;
+
+	/* The pages shown are set up first */
+	if (model->page_metadata_job)
+		ev_document_prioritize_page_metadata (model->document, page);
+
 	g_signal_emit (model, signals[PAGE_CHANGED], 0, old_page, page);
 
 	g_object_notify (G_OBJECT (model), "page");
@@ -426,8 +545,15 @@ ev_document_model_set_page_by_label (EvDocumentModel *model,
 	g_return_if_fail (EV_IS_DOCUMENT_MODEL (model));
 	g_return_if_fail (model->document != NULL);
 
-	if (ev_document_find_page_by_label (model->document, page_label, &page))
+	if (ev_document_find_page_by_label (model->document, page_label, &page)) {
 		ev_document_model_set_page (model, page);
+	} else if (model->page_metadata_job) {
+		/* The label may belong to a page not set up yet, it's
+		 * looked up again as pages are set up.
+		 */
+		g_free (model->pending_page_label);
+		model->pending_page_label = g_strdup (page_label);
+	}
 }
 
 gint
@@ -19,19 +19,25 @@
  */
 
 #include "ev-debug.h"
+#include "ev-trace.h"
 #include "ev-job-scheduler.h"
 
+/* Upper bound for the number of worker threads, whatever
+ * EV_JOB_SCHEDULER_THREADS or the number of processors say.
+ */
+#define EV_JOB_SCHEDULER_MAX_THREADS 32
+
 typedef struct _EvSchedulerJob {
 	EvJob         *job;
 	EvJobPriority  priority;
 	GSList        *job_link;
+	gboolean       shared;
+	gint64         queued_time;
 } EvSchedulerJob;
 
 G_LOCK_DEFINE_STATIC(job_list);
 static GSList *job_list = NULL;
 
-static volatile EvJob *running_job = NULL;
-
 static gpointer ev_job_thread_proxy               (gpointer        data);
 static void     ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 						   GCancellable   *cancellable);
@@ -51,45 +57,224 @@ static GQueue *job_queue[EV_JOB_N_PRIORITIES] = {
 	&queue_none
 };
 
+/* Worker pool, protected by job_queue_mutex */
+static guint       max_threads = 0;
+static guint       n_threads = 0;
+static guint       n_idle_threads = 0;
+static GList      *running_jobs = NULL;
+/* EvDocument -> number of shared jobs running for it,
+ * or -1 when an exclusive job is running
+ */
+static GHashTable *busy_documents = NULL;
+
+static GPrivate    thread_running_job;
+
+static gboolean
+ev_scheduler_job_is_shared (EvJob *job)
+{
+	/* Render jobs only take the render lock, so they can
+	 * run concurrently if the backend supports it. The text
+	 * index and the page metadata are set up page by page
+	 * with the render lock too.
+	 */
+	if (!EV_IS_JOB_RENDER (job) && !EV_IS_JOB_THUMBNAIL (job) &&
+	    !EV_IS_JOB_TEXT_INDEX (job) && !EV_IS_JOB_PAGE_METADATA (job))
+		return FALSE;
+
+	return ev_document_supports_concurrent_render (job->document);
+}
+
+static gboolean
+ev_job_queue_job_is_runnable_unlocked (EvSchedulerJob *job)
+{
+	EvDocument *document = job->job->document;
+	gint        count;
+
+	/* Jobs without a document (i.e. loading a new one) never
+	 * conflict with other jobs. Jobs for the same document are
+	 * serialized, unless all of them are render jobs and the
+	 * backend supports concurrent rendering.
+	 */
+	if (!document)
+		return TRUE;
+
+	count = GPOINTER_TO_INT (g_hash_table_lookup (busy_documents, document));
+	if (count == 0)
+		return TRUE;
+
+	return count > 0 && job->shared;
+}
+
 static void
 ev_job_queue_push (EvSchedulerJob *job,
 		   EvJobPriority   priority)
 {
 	ev_debug_message (DEBUG_JOBS, "%s priority %d", EV_GET_TYPE_NAME (job->job), priority);
 	
+	if (EV_TRACE_ENABLED ())
+		job->queued_time = ev_trace_now ();
+
 	g_mutex_lock (&job_queue_mutex);
 
 	g_queue_push_tail (job_queue[priority], job);
+
+	/* Grow the pool when every worker is busy */
+	if (n_idle_threads == 0 && n_threads < max_threads) {
+		GThread *thread;
+		gchar   *name;
+
+		name = g_strdup_printf ("EvJobScheduler%u", n_threads);
+		thread = g_thread_new (name, ev_job_thread_proxy, NULL);
+		g_thread_unref (thread);
+		g_free (name);
+
+		n_threads++;
+	}
+
 	g_cond_broadcast (&job_queue_cond);
 	
 	g_mutex_unlock (&job_queue_mutex);
 }
 
+/* Documents shared by running jobs that an exclusive job is waiting for */
+static GSList *
+ev_job_queue_get_drained_documents_unlocked (void)
+{
+	GSList *documents = NULL;
+	gint    i;
+
+	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES; i++) {
+		GList *l;
+
+		for (l = job_queue[i]->head; l; l = g_list_next (l)) {
+			EvSchedulerJob *job = (EvSchedulerJob *)l->data;
+			EvDocument     *document = job->job->document;
+
+			if (!document || job->shared ||
+			    GPOINTER_TO_INT (g_hash_table_lookup (busy_documents, document)) <= 0)
+				continue;
+
+			if (!g_slist_find (documents, document))
+				documents = g_slist_prepend (documents, document);
+		}
+	}
+
+	return documents;
+}
+
 static EvSchedulerJob *
 ev_job_queue_get_next_unlocked (void)
 {
 	gint i;
 	EvSchedulerJob *job = NULL;
+	GSList *drained;
+
+	/* A steady stream of shared jobs would keep the document
+	 * busy forever, so no more of them are started while an
+	 * exclusive job is waiting for the running ones to finish.
+	 */
+	drained = ev_job_queue_get_drained_documents_unlocked ();
 	
-	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES; i++) {
-		job = (EvSchedulerJob *) g_queue_pop_head (job_queue[i]);
-		if (job)
-			break;
+	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES && !job; i++) {
+		GList *l;
+
+		/* Skip jobs whose document is being used by
+		 * another worker, so that the priority order is
+		 * kept for every document without blocking the
+		 * whole pool on a single one.
+		 */
+		for (l = job_queue[i]->head; l; l = g_list_next (l)) {
+			EvSchedulerJob *s_job = (EvSchedulerJob *)l->data;
+
+			if (s_job->job->document && g_slist_find (drained, s_job->job->document))
+				continue;
+
+			if (ev_job_queue_job_is_runnable_unlocked (s_job)) {
+				job = s_job;
+				g_queue_delete_link (job_queue[i], l);
+				break;
+			}
+		}
 	}
 
-	ev_debug_message (DEBUG_JOBS, "%s", job ? EV_GET_TYPE_NAME (job->job) : "No jobs in queue");
+	g_slist_free (drained);
+
+	ev_debug_message (DEBUG_JOBS, "%s", job ? EV_GET_TYPE_NAME (job->job) : "No runnable jobs in queue");
 
 	return job;
 }
 
+static void
+ev_job_queue_job_started_unlocked (EvSchedulerJob *job)
+{
+	EvDocument *document = job->job->document;
+
+	running_jobs = g_list_prepend (running_jobs, job->job);
+
+	if (document) {
+		gint count = GPOINTER_TO_INT (g_hash_table_lookup (busy_documents, document));
+
+		g_hash_table_insert (busy_documents, document,
+				     GINT_TO_POINTER (job->shared ? count + 1 : -1));
+	}
+}
+
+static void
+ev_job_queue_job_finished_unlocked (EvSchedulerJob *job,
+				    EvDocument     *document)
+{
+	running_jobs = g_list_remove (running_jobs, job->job);
+
+	if (document) {
+		gint count = GPOINTER_TO_INT (g_hash_table_lookup (busy_documents, document));
+
+		if (job->shared && count > 1)
+			g_hash_table_insert (busy_documents, document, GINT_TO_POINTER (count - 1));
+		else
+			g_hash_table_remove (busy_documents, document);
+	}
+
+	/* Jobs waiting for this document can run now */
+	g_cond_broadcast (&job_queue_cond);
+}
+
+static guint
+ev_job_scheduler_get_default_max_threads (void)
+{
+	const gchar *env;
+	guint64      n = 0;
+
+	env = g_getenv ("EV_JOB_SCHEDULER_THREADS");
+	if (env)
+		n = g_ascii_strtoull (env, NULL, 10);
+	if (n == 0)
+		n = g_get_num_processors ();
+
+	return CLAMP (n, 1, EV_JOB_SCHEDULER_MAX_THREADS);
+}
+
 static gpointer
 ev_job_scheduler_init (gpointer data)
 {
-	g_thread_new ("EvJobScheduler", ev_job_thread_proxy, NULL);
+	g_mutex_lock (&job_queue_mutex);
+
+	busy_documents = g_hash_table_new (g_direct_hash, g_direct_equal);
+	if (max_threads == 0)
+		max_threads = ev_job_scheduler_get_default_max_threads ();
+
+	g_mutex_unlock (&job_queue_mutex);
 
 	return NULL;
 }
 
+static void
+ev_job_scheduler_ensure_init (void)
+{
+	static GOnce once_init = G_ONCE_INIT;
+
+	g_once (&once_init, ev_job_scheduler_init, NULL);
+}
+
 static void
 ev_scheduler_job_list_add (EvSchedulerJob *job)
 {
@@ -169,23 +354,60 @@ ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 	}
 }
 
-static void
+static gint
+ev_job_get_trace_page (EvJob *job)
+{
+	if (EV_IS_JOB_RENDER (job))
+		return EV_JOB_RENDER (job)->page;
+	if (EV_IS_JOB_THUMBNAIL (job))
+		return EV_JOB_THUMBNAIL (job)->page;
+	if (EV_IS_JOB_PAGE_DATA (job))
+		return EV_JOB_PAGE_DATA (job)->page;
+
+	return -1;
+}
+
+static gboolean
+ev_job_run_traced (EvJob *job)
+{
+	gint64   start_time;
+	gint     page;
+	gboolean result;
+
+	if (!EV_TRACE_ENABLED ())
+		return ev_job_run (job);
+
+	start_time = ev_trace_now ();
+	result = ev_job_run (job);
+	page = ev_job_get_trace_page (job);
+	ev_trace_complete ("job", EV_GET_TYPE_NAME (job),
+			   start_time, ev_trace_now (),
+			   page >= 0 ? "page" : NULL, page);
+
+	return result;
+}
+
+/* Returns whether the job wants to be run again. Jobs doing long
+ * tasks in slices return TRUE after every slice, and they are queued
+ * again so that the document and the worker aren't held meanwhile.
+ */
+static gboolean
 ev_job_thread (EvJob *job)
 {
 	gboolean result;
 
 	ev_debug_message (DEBUG_JOBS, "%s", EV_GET_TYPE_NAME (job));
 
-	do {
-		if (g_cancellable_is_cancelled (job->cancellable))
-			result = FALSE;
-		else {
-                        g_atomic_pointer_set (&running_job, job);
-			result = ev_job_run (job);
-                }
-	} while (result);
+	g_private_set (&thread_running_job, job);
 
-        g_atomic_pointer_set (&running_job, NULL);
+	if (g_cancellable_is_cancelled (job->cancellable))
+		result = FALSE;
+	else
+		result = ev_job_run_traced (job);
+
+	g_private_set (&thread_running_job, NULL);
+
+	return result;
 }
 
 static gboolean
@@ -196,7 +418,7 @@ ev_job_idle (EvJob *job)
 	if (g_cancellable_is_cancelled (job->cancellable))
 		return FALSE;
 
-	return ev_job_run (job);
+	return ev_job_run_traced (job);
 }
 
 static gpointer
@@ -204,17 +426,46 @@ ev_job_thread_proxy (gpointer data)
 {
 	while (TRUE) {
 		EvSchedulerJob *job;
+		EvDocument     *document;
+		gboolean        result;
 
 		g_mutex_lock (&job_queue_mutex);
 		job = ev_job_queue_get_next_unlocked ();
 		if (!job) {
+			n_idle_threads++;
 			g_cond_wait (&job_queue_cond, &job_queue_mutex);
+			n_idle_threads--;
 			g_mutex_unlock (&job_queue_mutex);
 			continue;
 		}
+		ev_job_queue_job_started_unlocked (job);
 		g_mutex_unlock (&job_queue_mutex);
-		
-		ev_job_thread (job->job);
+
+		/* Time spent in the queue, for the priority it had */
+		if (EV_TRACE_ENABLED () && job->queued_time != 0) {
+			ev_trace_complete ("queue", EV_GET_TYPE_NAME (job->job),
+					   job->queued_time, ev_trace_now (),
+					   "priority", job->priority);
+		}
+
+		/* The document the job was scheduled for, a load
+		 * job might set job->document while running.
+		 */
+		document = job->job->document;
+
+		result = ev_job_thread (job->job);
+
+		g_mutex_lock (&job_queue_mutex);
+		ev_job_queue_job_finished_unlocked (job, document);
+		if (result && !g_cancellable_is_cancelled (job->job->cancellable)) {
+			if (EV_TRACE_ENABLED ())
+				job->queued_time = ev_trace_now ();
+			g_queue_push_tail (job_queue[job->priority], job);
+			g_mutex_unlock (&job_queue_mutex);
+			continue;
+		}
+		g_mutex_unlock (&job_queue_mutex);
+
 		ev_scheduler_job_destroy (job);
 	}
 
@@ -225,16 +476,16 @@ void
 ev_job_scheduler_push_job (EvJob         *job,
 			   EvJobPriority  priority)
 {
-	static GOnce once_init = G_ONCE_INIT;
 	EvSchedulerJob *s_job;
 
-	g_once (&once_init, ev_job_scheduler_init, NULL);
+	ev_job_scheduler_ensure_init ();
 
 	ev_debug_message (DEBUG_JOBS, "%s pirority %d", EV_GET_TYPE_NAME (job), priority);
 
 	s_job = g_new0 (EvSchedulerJob, 1);
 	s_job->job = g_object_ref (job);
 	s_job->priority = priority;
+	s_job->shared = job->document ? ev_scheduler_job_is_shared (job) : FALSE;
 
 	ev_scheduler_job_list_add (s_job);
 	
@@ -310,10 +561,95 @@ ev_job_scheduler_update_job (EvJob         *job,
 /**
  * ev_job_scheduler_get_running_thread_job:
  *
+ * When called from a scheduler thread, returns the job being run by
+ * that thread. Otherwise, returns the last job started by any of the
+ * scheduler threads, or %NULL if no thread job is running.
+ *
  * Returns: (transfer none): an #EvJob
  */
 EvJob *
 ev_job_scheduler_get_running_thread_job (void)
 {
-        return g_atomic_pointer_get (&running_job);
+	EvJob *job;
+
+	job = g_private_get (&thread_running_job);
+	if (job)
+		return job;
+
+	g_mutex_lock (&job_queue_mutex);
+	job = running_jobs ? running_jobs->data : NULL;
+	g_mutex_unlock (&job_queue_mutex);
+
+	return job;
+}
+
+/**
+ * ev_job_scheduler_is_job_running:
+ * @job: an #EvJob
+ *
+ * Returns: %TRUE if @job is currently being run by one of
+ * the scheduler threads
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_job_scheduler_is_job_running (EvJob *job)
+{
+	gboolean retval;
+
+	g_return_val_if_fail (EV_IS_JOB (job), FALSE);
+
+	g_mutex_lock (&job_queue_mutex);
+	retval = g_list_find (running_jobs, job) != NULL;
+	g_mutex_unlock (&job_queue_mutex);
+
+	return retval;
+}
+
+/**
+ * ev_job_scheduler_set_max_threads:
+ * @n_threads: the maximum number of threads, or 0 for the default
+ *
+ * Sets the maximum number of threads used to run #EvJob<!-- -->s
+ * in %EV_JOB_RUN_THREAD mode. Threads are created on demand when
+ * jobs are pushed and all existing threads are busy, so lowering
+ * the limit does not stop threads already running. Jobs for the
+ * same document are never run concurrently.
+ *
+ * The default is the number of processors, it can be overridden
+ * with the EV_JOB_SCHEDULER_THREADS environment variable.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_scheduler_set_max_threads (guint n_threads)
+{
+	ev_job_scheduler_ensure_init ();
+
+	g_mutex_lock (&job_queue_mutex);
+	max_threads = n_threads > 0 ?
+		MIN (n_threads, EV_JOB_SCHEDULER_MAX_THREADS) :
+		ev_job_scheduler_get_default_max_threads ();
+	g_mutex_unlock (&job_queue_mutex);
+}
+
+/**
+ * ev_job_scheduler_get_max_threads:
+ *
+ * Returns: the maximum number of threads used to run jobs
+ *
+ * Since: 3.18
+ */
+guint
+ev_job_scheduler_get_max_threads (void)
+{
+	guint retval;
+
+	ev_job_scheduler_ensure_init ();
+
+	g_mutex_lock (&job_queue_mutex);
+	retval = max_threads;
+	g_mutex_unlock (&job_queue_mutex);
+
+	return retval;
 }
@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "ev-jobs.h"
+#include "ev-job-scheduler.h"
 #include "ev-document-links.h"
 #include "ev-document-images.h"
 #include "ev-document-forms.h"
@@ -37,6 +38,8 @@
 #include "ev-document-attachments.h"
 #include "ev-document-media.h"
 #include "ev-document-text.h"
+#include "ev-surface-cache.h"
+#include "ev-view-marshal.h"
 #include "ev-debug.h"
 
 #include <errno.h>
@@ -48,6 +51,8 @@ static void ev_job_init                   (EvJob                 *job);
 static void ev_job_class_init             (EvJobClass            *class);
 static void ev_job_links_init             (EvJobLinks            *job);
 static void ev_job_links_class_init       (EvJobLinksClass       *class);
+static void ev_job_link_labels_init       (EvJobLinkLabels       *job);
+static void ev_job_link_labels_class_init (EvJobLinkLabelsClass  *class);
 static void ev_job_attachments_init       (EvJobAttachments      *job);
 static void ev_job_attachments_class_init (EvJobAttachmentsClass *class);
 static void ev_job_annots_init            (EvJobAnnots           *job);
@@ -58,16 +63,22 @@ static void ev_job_page_data_init         (EvJobPageData         *job);
 static void ev_job_page_data_class_init   (EvJobPageDataClass    *class);
 static void ev_job_thumbnail_init         (EvJobThumbnail        *job);
 static void ev_job_thumbnail_class_init   (EvJobThumbnailClass   *class);
+static void ev_job_page_metadata_init     (EvJobPageMetadata     *job);
+static void ev_job_page_metadata_class_init (EvJobPageMetadataClass *class);
 static void ev_job_load_init    	  (EvJobLoad	         *job);
 static void ev_job_load_class_init 	  (EvJobLoadClass	 *class);
 static void ev_job_save_init              (EvJobSave             *job);
 static void ev_job_save_class_init        (EvJobSaveClass        *class);
 static void ev_job_find_init              (EvJobFind             *job);
 static void ev_job_find_class_init        (EvJobFindClass        *class);
+static void ev_job_text_index_init        (EvJobTextIndex        *job);
+static void ev_job_text_index_class_init  (EvJobTextIndexClass   *class);
 static void ev_job_layers_init            (EvJobLayers           *job);
 static void ev_job_layers_class_init      (EvJobLayersClass      *class);
 static void ev_job_export_init            (EvJobExport           *job);
 static void ev_job_export_class_init      (EvJobExportClass      *class);
+static void ev_job_export_batch_init      (EvJobExportBatch      *job);
+static void ev_job_export_batch_class_init (EvJobExportBatchClass *class);
 static void ev_job_print_init             (EvJobPrint            *job);
 static void ev_job_print_class_init       (EvJobPrintClass       *class);
 
@@ -82,30 +93,56 @@ enum {
 	FONTS_LAST_SIGNAL
 };
 
+enum {
+	PAGE_METADATA_UPDATED,
+	PAGE_METADATA_LAST_SIGNAL
+};
+
+enum {
+	ANNOTS_UPDATED,
+	ANNOTS_LAST_SIGNAL
+};
+
 enum {
 	FIND_UPDATED,
 	FIND_LAST_SIGNAL
 };
 
+enum {
+	EXPORT_BATCH_UPDATED,
+	EXPORT_BATCH_LAST_SIGNAL
+};
+
+/* Time spent by jobs running in slices before returning to the
+ * scheduler, so that other jobs can use the document meanwhile */
+#define EV_JOB_SLICE_USEC (20 * 1000)
+
 static guint job_signals[LAST_SIGNAL] = { 0 };
 static guint job_fonts_signals[FONTS_LAST_SIGNAL] = { 0 };
+static guint job_page_metadata_signals[PAGE_METADATA_LAST_SIGNAL] = { 0 };
+static guint job_annots_signals[ANNOTS_LAST_SIGNAL] = { 0 };
 static guint job_find_signals[FIND_LAST_SIGNAL] = { 0 };
+static guint job_export_batch_signals[EXPORT_BATCH_LAST_SIGNAL] = { 0 };
 
 G_DEFINE_ABSTRACT_TYPE (EvJob, ev_job, G_TYPE_OBJECT)
 G_DEFINE_TYPE (EvJobLinks, ev_job_links, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobLinkLabels, ev_job_link_labels, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobAttachments, ev_job_attachments, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobAnnots, ev_job_annots, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobRender, ev_job_render, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobPageData, ev_job_page_data, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobThumbnail, ev_job_thumbnail, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobFonts, ev_job_fonts, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobPageMetadata, ev_job_page_metadata, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLoad, ev_job_load, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLoadStream, ev_job_load_stream, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLoadGFile, ev_job_load_gfile, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobSave, ev_job_save, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobFind, ev_job_find, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobTextIndex, ev_job_text_index, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLayers, ev_job_layers, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobExport, ev_job_export, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobExportBatch, ev_job_export_batch, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobPrint, ev_job_print, EV_TYPE_JOB)
 
 /* EvJob */
@@ -208,6 +245,23 @@ ev_job_emit_finished (EvJob *job)
 	}
 }
 
+/* Emits the progress of a threaded job from the main loop, unless an
+ * update is already queued. emit_updated has to reset pending.
+ */
+static void
+ev_job_queue_idle_update (EvJob       *job,
+			  gint        *pending,
+			  GSourceFunc  emit_updated)
+{
+	if (!g_atomic_int_compare_and_exchange (pending, FALSE, TRUE))
+		return;
+
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			 emit_updated,
+			 g_object_ref (job),
+			 (GDestroyNotify)g_object_unref);
+}
+
 gboolean
 ev_job_run (EvJob *job)
 {
@@ -345,38 +399,6 @@ ev_job_links_dispose (GObject *object)
 	(* G_OBJECT_CLASS (ev_job_links_parent_class)->dispose) (object);
 }
 
-static gboolean
-fill_page_labels (GtkTreeModel   *tree_model,
-		  GtkTreePath    *path,
-		  GtkTreeIter    *iter,
-		  EvJob          *job)
-{
-	EvDocumentLinks *document_links;
-	EvLink          *link;
-	gchar           *page_label;
-
-	gtk_tree_model_get (tree_model, iter,
-			    EV_DOCUMENT_LINKS_COLUMN_LINK, &link,
-			    -1);
-
-	if (!link)
-		return FALSE;
-
-	document_links = EV_DOCUMENT_LINKS (job->document);
-	page_label = ev_document_links_get_link_page_label (document_links, link);
-	if (!page_label)
-		return FALSE;
-
-	gtk_tree_store_set (GTK_TREE_STORE (tree_model), iter,
-			    EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL, page_label,
-			    -1);
-
-	g_free (page_label);
-	g_object_unref (link);
-
-	return FALSE;
-}
-
 static gboolean
 ev_job_links_run (EvJob *job)
 {
@@ -385,12 +407,13 @@ ev_job_links_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_links->model = ev_document_links_get_links_model (EV_DOCUMENT_LINKS (job->document));
-	ev_document_doc_mutex_unlock ();
-
-	gtk_tree_model_foreach (job_links->model, (GtkTreeModelForeachFunc)fill_page_labels, job);
+	ev_document_unlock (job->document);
 
+	/* Page labels are filled later with EvJobLinkLabels, only
+	 * for the rows shown, resolving them all can take seconds.
+	 */
 	ev_job_succeeded (job);
 	
 	return FALSE;
@@ -435,6 +458,105 @@ ev_job_links_get_model (EvJobLinks *job)
 	return job->model;
 }
 
+/* EvJobLinkLabels */
+static void
+ev_job_link_labels_init (EvJobLinkLabels *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static void
+ev_job_link_labels_dispose (GObject *object)
+{
+	EvJobLinkLabels *job = EV_JOB_LINK_LABELS (object);
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	/* Links without a label leave holes in labels */
+	if (job->labels) {
+		guint i;
+
+		for (i = 0; i < job->links->len; i++)
+			g_free (job->labels[i]);
+		g_free (job->labels);
+		job->labels = NULL;
+	}
+
+	if (job->links) {
+		g_ptr_array_unref (job->links);
+		job->links = NULL;
+	}
+
+	(* G_OBJECT_CLASS (ev_job_link_labels_parent_class)->dispose) (object);
+}
+
+static gboolean
+ev_job_link_labels_run (EvJob *job)
+{
+	EvJobLinkLabels *job_labels = EV_JOB_LINK_LABELS (job);
+	EvDocumentLinks *document_links = EV_DOCUMENT_LINKS (job->document);
+	guint            i;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	job_labels->labels = g_new0 (gchar *, job_labels->links->len);
+
+	/* Named destinations are looked up with the document locked by
+	 * ev_document_links_find_link_page(), so it must not be held here.
+	 */
+	for (i = 0; i < job_labels->links->len; i++) {
+		if (g_cancellable_is_cancelled (job->cancellable))
+			break;
+
+		job_labels->labels[i] =
+			ev_document_links_get_link_page_label (document_links,
+							       g_ptr_array_index (job_labels->links, i));
+	}
+
+	ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_link_labels_class_init (EvJobLinkLabelsClass *class)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+	EvJobClass   *job_class = EV_JOB_CLASS (class);
+
+	oclass->dispose = ev_job_link_labels_dispose;
+	job_class->run = ev_job_link_labels_run;
+}
+
+/**
+ * ev_job_link_labels_new:
+ * @document: an #EvDocument implementing #EvDocumentLinks
+ * @links: (element-type EvLink): the links to get the page labels of
+ *
+ * Creates a job that gets the labels of the pages @links point to.
+ * When it finishes, the labels field has a label, or %NULL, for every
+ * link in @links, in the same order.
+ *
+ * Returns: (transfer full): the new #EvJobLinkLabels
+ *
+ * Since: 3.18
+ */
+EvJob *
+ev_job_link_labels_new (EvDocument *document,
+			GPtrArray  *links)
+{
+	EvJob *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_LINK_LABELS, NULL);
+	job->document = g_object_ref (document);
+	EV_JOB_LINK_LABELS (job)->links = g_ptr_array_ref (links);
+
+	return job;
+}
+
 /* EvJobAttachments */
 static void
 ev_job_attachments_init (EvJobAttachments *job)
@@ -468,10 +590,10 @@ ev_job_attachments_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_attachments->attachments =
 		ev_document_attachments_get_attachments (EV_DOCUMENT_ATTACHMENTS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	ev_job_succeeded (job);
 
@@ -506,6 +628,10 @@ static void
 ev_job_annots_init (EvJobAnnots *job)
 {
 	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+
+	g_mutex_init (&job->mutex);
+	job->priority_start = -1;
+	job->priority_end = -1;
 }
 
 static void
@@ -523,22 +649,116 @@ ev_job_annots_dispose (GObject *object)
 		job->annots = NULL;
 	}
 
+	if (job->new_annots) {
+		g_list_foreach (job->new_annots, (GFunc)ev_mapping_list_unref, NULL);
+		g_list_free (job->new_annots);
+		job->new_annots = NULL;
+	}
+
 	G_OBJECT_CLASS (ev_job_annots_parent_class)->dispose (object);
 }
 
+static void
+ev_job_annots_finalize (GObject *object)
+{
+	EvJobAnnots *job = EV_JOB_ANNOTS (object);
+
+	g_free (job->scanned);
+	g_mutex_clear (&job->mutex);
+
+	G_OBJECT_CLASS (ev_job_annots_parent_class)->finalize (object);
+}
+
+static gint
+ev_job_annots_compare_page (EvMappingList *a,
+			    EvMappingList *b)
+{
+	return ev_mapping_list_get_page (a) - ev_mapping_list_get_page (b);
+}
+
+static gboolean
+ev_job_annots_emit_updated (EvJobAnnots *job)
+{
+	GList *new_annots;
+
+	g_atomic_int_set (&job->updated_pending, FALSE);
+
+	g_mutex_lock (&job->mutex);
+	new_annots = job->new_annots;
+	job->new_annots = NULL;
+	g_mutex_unlock (&job->mutex);
+
+	if (!new_annots)
+		return FALSE;
+
+	/* Pages are not scanned in order, but annots is kept sorted */
+	new_annots = g_list_sort (new_annots, (GCompareFunc)ev_job_annots_compare_page);
+	job->annots = g_list_sort (g_list_concat (job->annots, g_list_copy (new_annots)),
+				   (GCompareFunc)ev_job_annots_compare_page);
+
+	if (!EV_JOB (job)->cancelled)
+		g_signal_emit (job, job_annots_signals[ANNOTS_UPDATED], 0, new_annots);
+	g_list_free (new_annots);
+
+	return FALSE;
+}
+
+/* The first page not scanned yet, in the priority range if any */
+static gint
+ev_job_annots_get_next_page (EvJobAnnots *job)
+{
+	gint start, end, i;
+
+	start = g_atomic_int_get (&job->priority_start);
+	end = g_atomic_int_get (&job->priority_end);
+	if (start >= 0) {
+		for (i = start; i <= MIN (end, job->n_pages - 1); i++) {
+			if (!job->scanned[i])
+				return i;
+		}
+	}
+
+	while (job->next_page < job->n_pages && job->scanned[job->next_page])
+		job->next_page++;
+
+	return job->next_page < job->n_pages ? job->next_page : -1;
+}
+
 static gboolean
 ev_job_annots_run (EvJob *job)
 {
 	EvJobAnnots *job_annots = EV_JOB_ANNOTS (job);
-	gint         i;
+	GList       *found = NULL;
+	gint64       start_time;
+	gboolean     done = FALSE;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
-	for (i = 0; i < ev_document_get_n_pages (job->document); i++) {
+	if (!job_annots->scanned) {
+		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+		job_annots->n_pages = ev_document_get_n_pages (job->document);
+		job_annots->scanned = g_new0 (guint8, MAX (job_annots->n_pages, 1));
+	}
+
+	start_time = g_get_monotonic_time ();
+
+	/* Scan in slices, releasing the document so that
+	 * pages can be rendered meanwhile.
+	 */
+	ev_document_lock (job->document);
+	while (!g_cancellable_is_cancelled (job->cancellable) &&
+	       g_get_monotonic_time () - start_time < EV_JOB_SLICE_USEC) {
 		EvMappingList *mapping_list;
 		EvPage        *page;
+		gint           i;
+
+		i = ev_job_annots_get_next_page (job_annots);
+		if (i < 0) {
+			done = TRUE;
+			break;
+		}
+		job_annots->scanned[i] = TRUE;
 
 		page = ev_document_get_page (job->document, i);
 		mapping_list = ev_document_annotations_get_annotations (EV_DOCUMENT_ANNOTATIONS (job->document),
@@ -546,15 +766,24 @@ ev_job_annots_run (EvJob *job)
 		g_object_unref (page);
 
 		if (mapping_list)
-			job_annots->annots = g_list_prepend (job_annots->annots, mapping_list);
+			found = g_list_prepend (found, mapping_list);
 	}
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
-	job_annots->annots = g_list_reverse (job_annots->annots);
+	if (found) {
+		g_mutex_lock (&job_annots->mutex);
+		job_annots->new_annots = g_list_concat (found, job_annots->new_annots);
+		g_mutex_unlock (&job_annots->mutex);
 
-	ev_job_succeeded (job);
+		ev_job_queue_idle_update (job, &job_annots->updated_pending,
+					  (GSourceFunc)ev_job_annots_emit_updated);
+	}
 
-	return FALSE;
+	/* Scheduled after the last update, so it's emitted after it */
+	if (done)
+		ev_job_succeeded (job);
+
+	return !done;
 }
 
 static void
@@ -564,9 +793,32 @@ ev_job_annots_class_init (EvJobAnnotsClass *class)
 	EvJobClass   *job_class = EV_JOB_CLASS (class);
 
 	oclass->dispose = ev_job_annots_dispose;
+	oclass->finalize = ev_job_annots_finalize;
 	job_class->run = ev_job_annots_run;
+
+	job_annots_signals[ANNOTS_UPDATED] =
+		g_signal_new ("updated",
+			      EV_TYPE_JOB_ANNOTS,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvJobAnnotsClass, updated),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__POINTER,
+			      G_TYPE_NONE,
+			      1, G_TYPE_POINTER);
 }
 
+/**
+ * ev_job_annots_new:
+ * @document: an #EvDocument implementing #EvDocumentAnnotations
+ *
+ * Creates a job that gets the annotations of all the pages of
+ * @document. Pages are scanned in slices, and the annotations found
+ * are emitted with #EvJobAnnots::updated, as a list of #EvMappingList
+ * owned by the job. When the job finishes, its annots list has the
+ * annotations of all the pages, sorted by page.
+ *
+ * Returns: (transfer full): the new #EvJobAnnots
+ */
 EvJob *
 ev_job_annots_new (EvDocument *document)
 {
@@ -580,6 +832,32 @@ ev_job_annots_new (EvDocument *document)
 	return job;
 }
 
+/**
+ * ev_job_annots_set_priority_range:
+ * @job: an #EvJobAnnots
+ * @start_page: the first page to scan before the others
+ * @end_page: the last page to scan before the others
+ *
+ * Makes @job scan the pages from @start_page to @end_page, i.e. the
+ * visible ones, before the rest of the document. It can be called
+ * while the job is running.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_annots_set_priority_range (EvJobAnnots *job,
+				  gint         start_page,
+				  gint         end_page)
+{
+	g_return_if_fail (EV_IS_JOB_ANNOTS (job));
+
+	/* Read by the worker without locking, a range mixing
+	 * the old and new bounds for a slice is harmless.
+	 */
+	g_atomic_int_set (&job->priority_end, end_page);
+	g_atomic_int_set (&job->priority_start, start_page);
+}
+
 /* EvJobRender */
 static void
 ev_job_render_init (EvJobRender *job)
@@ -614,21 +892,63 @@ ev_job_render_dispose (GObject *object)
 	(* G_OBJECT_CLASS (ev_job_render_parent_class)->dispose) (object);
 }
 
+/* Largest dimension of the page previews thumbnails are made from */
+#define PAGE_PREVIEW_SIZE 320
+
+/* Keeps a downscaled copy of the rendered page, so that thumbnail jobs
+ * can be done without rendering the page again. It's made before the
+ * job finishes, since views modify the surface once they get it.
+ */
+static void
+ev_job_render_update_preview (EvJobRender *job_render)
+{
+	EvJob           *job = EV_JOB (job_render);
+	cairo_surface_t *preview;
+	gint             width, height;
+	gint             preview_width, preview_height;
+	gdouble          factor;
+
+	width = cairo_image_surface_get_width (job_render->surface);
+	height = cairo_image_surface_get_height (job_render->surface);
+	factor = MIN (1., (gdouble) PAGE_PREVIEW_SIZE / MAX (width, height));
+	preview_width = MAX (1, (gint) (width * factor + 0.5));
+	preview_height = MAX (1, (gint) (height * factor + 0.5));
+
+	/* Only replace previews made from smaller renderings */
+	preview = ev_surface_cache_get_preview (job->document, job_render->page, job_render->rotation);
+	if (preview) {
+		gboolean is_smaller;
+
+		is_smaller = cairo_image_surface_get_width (preview) < preview_width;
+		cairo_surface_destroy (preview);
+		if (!is_smaller)
+			return;
+	}
+
+	preview = ev_document_misc_surface_downscale (job_render->surface,
+						      preview_width, preview_height);
+	ev_surface_cache_add_preview (job->document, job_render->page, job_render->rotation, preview);
+}
+
 static gboolean
 ev_job_render_run (EvJob *job)
 {
 	EvJobRender     *job_render = EV_JOB_RENDER (job);
 	EvPage          *ev_page;
 	EvRenderContext *rc;
+	gboolean         need_fc_mutex;
 
 	ev_debug_message (DEBUG_JOBS, "page: %d (%p)", job_render->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_render_lock (job->document);
 
 	ev_profiler_start (EV_PROFILE_JOBS, "Rendering page %d", job_render->page);
-		
-	ev_document_fc_mutex_lock ();
+
+	/* Reentrant backends don't need the fontconfig mutex */
+	need_fc_mutex = !ev_document_supports_concurrent_render (job->document);
+	if (need_fc_mutex)
+		ev_document_fc_mutex_lock ();
 
 	ev_page = ev_document_get_page (job->document, job_render->page);
 	rc = ev_render_context_new (ev_page, job_render->rotation, job_render->scale);
@@ -636,13 +956,17 @@ ev_job_render_run (EvJob *job)
 					   job_render->target_width, job_render->target_height);
 	g_object_unref (ev_page);
 
-	job_render->surface = ev_document_render (job->document, rc);
+	if (job_render->has_area)
+		job_render->surface = ev_document_render_area (job->document, rc, &job_render->area);
+	else
+		job_render->surface = ev_document_render (job->document, rc);
 	/* If job was cancelled during the page rendering,
 	 * we return now, so that the thread is finished ASAP
 	 */
 	if (g_cancellable_is_cancelled (job->cancellable)) {
-		ev_document_fc_mutex_unlock ();
-		ev_document_doc_mutex_unlock ();
+		if (need_fc_mutex)
+			ev_document_fc_mutex_unlock ();
+		ev_document_render_unlock (job->document);
 		g_object_unref (rc);
 
 		return FALSE;
@@ -665,8 +989,12 @@ ev_job_render_run (EvJob *job)
 
 	g_object_unref (rc);
 
-	ev_document_fc_mutex_unlock ();
-	ev_document_doc_mutex_unlock ();
+	if (need_fc_mutex)
+		ev_document_fc_mutex_unlock ();
+	ev_document_render_unlock (job->document);
+
+	if (!job_render->has_area && job_render->surface)
+		ev_job_render_update_preview (job_render);
 	
 	ev_job_succeeded (job);
 	
@@ -722,6 +1050,29 @@ ev_job_render_set_selection_info (EvJobRender     *job,
 	job->base = *base;
 }
 
+/**
+ * ev_job_render_set_area:
+ * @job: an #EvJobRender
+ * @area: the area of the page to render, in device pixels
+ *
+ * Restricts the rendering of @job to @area of the page, relative to
+ * the page scaled to the job target size. The resulting surface has
+ * the size of @area. This is used to render tiles of pages that are
+ * too large to be rendered at once.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_render_set_area (EvJobRender                 *job,
+			const cairo_rectangle_int_t *area)
+{
+	g_return_if_fail (EV_IS_JOB_RENDER (job));
+	g_return_if_fail (area != NULL);
+
+	job->has_area = TRUE;
+	job->area = *area;
+}
+
 /* EvJobPageData */
 static void
 ev_job_page_data_init (EvJobPageData *job)
@@ -738,7 +1089,7 @@ ev_job_page_data_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, "page: %d (%p)", job_pd->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	ev_page = ev_document_get_page (job->document, job_pd->page);
 
 	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING) && EV_IS_DOCUMENT_TEXT (job->document))
@@ -783,7 +1134,7 @@ ev_job_page_data_run (EvJob *job)
                         ev_document_media_get_media_mapping (EV_DOCUMENT_MEDIA (job->document),
                                                              ev_page);
 	g_object_unref (ev_page);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	ev_job_succeeded (job);
 
@@ -850,8 +1201,35 @@ ev_job_thumbnail_run (EvJob *job)
 
 	ev_debug_message (DEBUG_JOBS, "%d (%p)", job_thumb->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	/* Pages already rendered by a view don't need to be rendered
+	 * again, the thumbnail is made from their preview.
+	 */
+	if (job_thumb->format == EV_JOB_THUMBNAIL_SURFACE &&
+	    job_thumb->target_width > 0 && job_thumb->target_height > 0) {
+		cairo_surface_t *preview;
+
+		preview = ev_surface_cache_get_preview (job->document, job_thumb->page,
+							job_thumb->rotation);
+		if (preview &&
+		    cairo_image_surface_get_width (preview) >= job_thumb->target_width &&
+		    cairo_image_surface_get_height (preview) >= job_thumb->target_height) {
+			ev_debug_message (DEBUG_JOBS, "page %d from preview", job_thumb->page);
+			job_thumb->thumbnail_surface =
+				ev_document_misc_surface_downscale (preview,
+								    job_thumb->target_width,
+								    job_thumb->target_height);
+			cairo_surface_destroy (preview);
+			ev_job_succeeded (job);
+
+			return FALSE;
+		}
+
+		if (preview)
+			cairo_surface_destroy (preview);
+	}
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_render_lock (job->document);
 
 	page = ev_document_get_page (job->document, job_thumb->page);
 	rc = ev_render_context_new (page, job_thumb->rotation, job_thumb->scale);
@@ -864,7 +1242,7 @@ ev_job_thumbnail_run (EvJob *job)
         else
                 job_thumb->thumbnail_surface = ev_document_get_thumbnail_surface (job->document, rc);
 	g_object_unref (rc);
-	ev_document_doc_mutex_unlock ();
+	ev_document_render_unlock (job->document);
 
         /* EV_JOB_THUMBNAIL_SURFACE is not compatible with has_frame = TRUE */
         if (job_thumb->format == EV_JOB_THUMBNAIL_PIXBUF && pixbuf) {
@@ -959,10 +1337,43 @@ ev_job_thumbnail_set_output_format (EvJobThumbnail      *job,
 }
 
 /* EvJobFonts */
+
+#define FONTS_SLICE_PAGES_MAX 256
+
 static void
 ev_job_fonts_init (EvJobFonts *job)
 {
-	EV_JOB (job)->run_mode = EV_JOB_RUN_MAIN_LOOP;
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+
+	g_mutex_init (&job->mutex);
+	job->slice_pages = 1;
+}
+
+static void
+ev_job_fonts_finalize (GObject *object)
+{
+	EvJobFonts *job = EV_JOB_FONTS (object);
+
+	g_mutex_clear (&job->mutex);
+
+	G_OBJECT_CLASS (ev_job_fonts_parent_class)->finalize (object);
+}
+
+static gboolean
+ev_job_fonts_emit_updated (EvJobFonts *job)
+{
+	gdouble progress;
+
+	g_atomic_int_set (&job->updated_pending, FALSE);
+
+	g_mutex_lock (&job->mutex);
+	progress = job->progress;
+	g_mutex_unlock (&job->mutex);
+
+	if (!EV_JOB (job)->cancelled)
+		g_signal_emit (job, job_fonts_signals[FONTS_UPDATED], 0, progress);
+
+	return FALSE;
 }
 
 static gboolean
@@ -970,15 +1381,13 @@ ev_job_fonts_run (EvJob *job)
 {
 	EvJobFonts      *job_fonts = EV_JOB_FONTS (job);
 	EvDocumentFonts *fonts = EV_DOCUMENT_FONTS (job->document);
+	gint64           start_time;
+	gboolean         pending = TRUE;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	
-	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
-		return TRUE;
-	
-	if (!ev_document_fc_mutex_trylock ())
-		return TRUE;
+
+	ev_document_lock (job->document);
+	ev_document_fc_mutex_lock ();
 
 #ifdef EV_ENABLE_DEBUG
 	/* We use the #ifdef in this case because of the if */
@@ -986,24 +1395,51 @@ ev_job_fonts_run (EvJob *job)
 		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 #endif
 
-	job_fonts->scan_completed = !ev_document_fonts_scan (fonts, 20);
-	g_signal_emit (job_fonts, job_fonts_signals[FONTS_UPDATED], 0,
-		       ev_document_fonts_get_progress (fonts));
+	start_time = g_get_monotonic_time ();
+	while (pending && !g_cancellable_is_cancelled (job->cancellable)) {
+		gint64 scan_start = g_get_monotonic_time ();
+		gint64 elapsed;
+
+		pending = ev_document_fonts_scan (fonts, job_fonts->slice_pages);
+
+		/* Pages differ a lot in the number of fonts they use,
+		 * so the number of pages per call follows the last one.
+		 */
+		elapsed = g_get_monotonic_time () - scan_start;
+		if (elapsed < EV_JOB_SLICE_USEC / 4)
+			job_fonts->slice_pages = MIN (job_fonts->slice_pages * 2, FONTS_SLICE_PAGES_MAX);
+		else if (elapsed > EV_JOB_SLICE_USEC / 2)
+			job_fonts->slice_pages = MAX (job_fonts->slice_pages / 2, 1);
+
+		if (g_get_monotonic_time () - start_time >= EV_JOB_SLICE_USEC)
+			break;
+	}
+
+	/* The backend is only used with the document locked */
+	g_mutex_lock (&job_fonts->mutex);
+	job_fonts->progress = ev_document_fonts_get_progress (fonts);
+	g_mutex_unlock (&job_fonts->mutex);
 
 	ev_document_fc_mutex_unlock ();
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
+
+	ev_job_queue_idle_update (job, &job_fonts->updated_pending,
+				  (GSourceFunc)ev_job_fonts_emit_updated);
 
+	job_fonts->scan_completed = !pending;
 	if (job_fonts->scan_completed)
 		ev_job_succeeded (job);
-	
+
 	return !job_fonts->scan_completed;
 }
 
 static void
 ev_job_fonts_class_init (EvJobFontsClass *class)
 {
-	EvJobClass *job_class = EV_JOB_CLASS (class);
-	
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+	EvJobClass   *job_class = EV_JOB_CLASS (class);
+
+	oclass->finalize = ev_job_fonts_finalize;
 	job_class->run = ev_job_fonts_run;
 	
 	job_fonts_signals[FONTS_UPDATED] =
@@ -1031,53 +1467,150 @@ ev_job_fonts_new (EvDocument *document)
 	return EV_JOB (job);
 }
 
-/* EvJobLoad */
+/* EvJobPageMetadata */
+
+#define PAGE_METADATA_SLICE_PAGES 8
+
 static void
-ev_job_load_init (EvJobLoad *job)
+ev_job_page_metadata_init (EvJobPageMetadata *job)
 {
 	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
 }
 
-static void
-ev_job_load_dispose (GObject *object)
+static gboolean
+ev_job_page_metadata_emit_updated (EvJobPageMetadata *job)
 {
-	EvJobLoad *job = EV_JOB_LOAD (object);
+	gint first_page, last_page;
 
-	ev_debug_message (DEBUG_JOBS, "%s", job->uri);
-	
-	if (job->uri) {
-		g_free (job->uri);
-		job->uri = NULL;
-	}
+	g_atomic_int_set (&job->updated_pending, FALSE);
 
-	if (job->password) {
-		g_free (job->password);
-		job->password = NULL;
-	}
+	if (!EV_JOB (job)->cancelled &&
+	    ev_document_get_changed_page_metadata (EV_JOB (job)->document,
+						   &first_page, &last_page))
+		g_signal_emit (job, job_page_metadata_signals[PAGE_METADATA_UPDATED], 0,
+			       first_page, last_page);
 
-	(* G_OBJECT_CLASS (ev_job_load_parent_class)->dispose) (object);
+	return FALSE;
 }
 
 static gboolean
-ev_job_load_run (EvJob *job)
+ev_job_page_metadata_run (EvJob *job)
 {
-	EvJobLoad *job_load = EV_JOB_LOAD (job);
-	GError    *error = NULL;
-	
-	ev_debug_message (DEBUG_JOBS, "%s", job_load->uri);
-	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
-	
-	ev_document_fc_mutex_lock ();
+	EvJobPageMetadata *job_metadata = EV_JOB_PAGE_METADATA (job);
+	gint64             start_time;
+	gboolean           pending = TRUE;
 
-	/* This job may already have a document even if the job didn't complete
-	   because, e.g., a password is required - if so, just reload rather than
-	   creating a new instance */
-	if (job->document) {
-		const gchar *uncompressed_uri;
+	ev_debug_message (DEBUG_JOBS, NULL);
 
-		if (job_load->password) {
-			ev_document_security_set_password (EV_DOCUMENT_SECURITY (job->document),
-							   job_load->password);
+	start_time = g_get_monotonic_time ();
+
+	ev_document_render_lock (job->document);
+	while (pending && !g_cancellable_is_cancelled (job->cancellable) &&
+	       g_get_monotonic_time () - start_time < EV_JOB_SLICE_USEC) {
+		pending = ev_document_setup_page_metadata (job->document,
+							   PAGE_METADATA_SLICE_PAGES);
+	}
+	ev_document_render_unlock (job->document);
+
+	ev_job_queue_idle_update (job, &job_metadata->updated_pending,
+				  (GSourceFunc)ev_job_page_metadata_emit_updated);
+
+	if (!pending)
+		ev_job_succeeded (job);
+
+	return pending;
+}
+
+static void
+ev_job_page_metadata_class_init (EvJobPageMetadataClass *class)
+{
+	EvJobClass *job_class = EV_JOB_CLASS (class);
+
+	job_class->run = ev_job_page_metadata_run;
+
+	job_page_metadata_signals[PAGE_METADATA_UPDATED] =
+		g_signal_new ("updated",
+			      EV_TYPE_JOB_PAGE_METADATA,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvJobPageMetadataClass, updated),
+			      NULL, NULL,
+			      ev_view_marshal_VOID__INT_INT,
+			      G_TYPE_NONE,
+			      2, G_TYPE_INT, G_TYPE_INT);
+}
+
+/**
+ * ev_job_page_metadata_new:
+ * @document: an #EvDocument loaded with %EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA
+ *
+ * Creates a job that retrieves the size and label of the pages of
+ * @document that are still pending, emitting #EvJobPageMetadata::updated
+ * with the range of pages set up as they become available.
+ *
+ * Returns: (transfer full): the new #EvJobPageMetadata
+ *
+ * Since: 3.18
+ */
+EvJob *
+ev_job_page_metadata_new (EvDocument *document)
+{
+	EvJob *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_PAGE_METADATA, NULL);
+	job->document = g_object_ref (document);
+
+	return job;
+}
+
+/* EvJobLoad */
+static void
+ev_job_load_init (EvJobLoad *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static void
+ev_job_load_dispose (GObject *object)
+{
+	EvJobLoad *job = EV_JOB_LOAD (object);
+
+	ev_debug_message (DEBUG_JOBS, "%s", job->uri);
+	
+	if (job->uri) {
+		g_free (job->uri);
+		job->uri = NULL;
+	}
+
+	if (job->password) {
+		g_free (job->password);
+		job->password = NULL;
+	}
+
+	(* G_OBJECT_CLASS (ev_job_load_parent_class)->dispose) (object);
+}
+
+static gboolean
+ev_job_load_run (EvJob *job)
+{
+	EvJobLoad *job_load = EV_JOB_LOAD (job);
+	GError    *error = NULL;
+	
+	ev_debug_message (DEBUG_JOBS, "%s", job_load->uri);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+	
+	ev_document_fc_mutex_lock ();
+
+	/* This job may already have a document even if the job didn't complete
+	   because, e.g., a password is required - if so, just reload rather than
+	   creating a new instance */
+	if (job->document) {
+		const gchar *uncompressed_uri;
+
+		if (job_load->password) {
+			ev_document_security_set_password (EV_DOCUMENT_SECURITY (job->document),
+							   job_load->password);
 		}
 		
 		job->failed = FALSE;
@@ -1086,12 +1619,14 @@ ev_job_load_run (EvJob *job)
 
 		uncompressed_uri = g_object_get_data (G_OBJECT (job->document),
 						      "uri-uncompressed");
-		ev_document_load (job->document,
-				  uncompressed_uri ? uncompressed_uri : job_load->uri,
-				  &error);
+		ev_document_load_full (job->document,
+				       uncompressed_uri ? uncompressed_uri : job_load->uri,
+				       job_load->flags,
+				       &error);
 	} else {
-		job->document = ev_document_factory_get_document (job_load->uri,
-								  &error);
+		job->document = ev_document_factory_get_document_full (job_load->uri,
+								       job_load->flags,
+								       &error);
 	}
 
 	ev_document_fc_mutex_unlock ();
@@ -1149,6 +1684,22 @@ ev_job_load_set_password (EvJobLoad *job, const gchar *password)
 	job->password = password ? g_strdup (password) : NULL;
 }
 
+/**
+ * ev_job_load_set_load_flags:
+ * @job: an #EvJobLoad
+ * @flags: flags from #EvDocumentLoadFlags
+ *
+ * Since: 3.18
+ */
+void
+ev_job_load_set_load_flags (EvJobLoad          *job,
+			    EvDocumentLoadFlags flags)
+{
+	g_return_if_fail (EV_IS_JOB_LOAD (job));
+
+	job->flags = flags;
+}
+
 /* EvJobLoadStream */
 
 /**
@@ -1483,7 +2034,7 @@ ev_job_save_run (EvJob *job)
 	}
 	close (fd);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	/* Save document to temp filename */
 	local_uri = g_filename_to_uri (tmp_filename, NULL, &error);
@@ -1491,7 +2042,7 @@ ev_job_save_run (EvJob *job)
                 ev_document_save (job->document, local_uri, &error);
         }
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	if (error) {
 		g_free (local_uri);
@@ -1590,7 +2141,9 @@ ev_job_save_new (EvDocument  *document,
 static void
 ev_job_find_init (EvJobFind *job)
 {
-	EV_JOB (job)->run_mode = EV_JOB_RUN_MAIN_LOOP;
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+
+	g_mutex_init (&job->mutex);
 }
 
 static void
@@ -1600,11 +2153,33 @@ ev_job_find_dispose (GObject *object)
 
 	ev_debug_message (DEBUG_JOBS, NULL);
 
+	if (job->pending_pages) {
+		gint i;
+
+		for (i = 0; i < job->n_pages; i++) {
+			g_list_foreach (job->pending_pages[i], (GFunc)ev_rectangle_free, NULL);
+			g_list_free (job->pending_pages[i]);
+		}
+
+		g_free (job->pending_pages);
+		job->pending_pages = NULL;
+	}
+
+	if (job->pages_done) {
+		g_free (job->pages_done);
+		job->pages_done = NULL;
+	}
+
 	if (job->text) {
 		g_free (job->text);
 		job->text = NULL;
 	}
 
+	if (job->index) {
+		ev_text_index_unref (job->index);
+		job->index = NULL;
+	}
+
 	if (job->pages) {
 		gint i;
 
@@ -1620,47 +2195,257 @@ ev_job_find_dispose (GObject *object)
 	(* G_OBJECT_CLASS (ev_job_find_parent_class)->dispose) (object);
 }
 
+static void
+ev_job_find_finalize (GObject *object)
+{
+	EvJobFind *job = EV_JOB_FIND (object);
+
+	g_mutex_clear (&job->mutex);
+
+	(* G_OBJECT_CLASS (ev_job_find_parent_class)->finalize) (object);
+}
+
+/* Moves the results of the pages already searched to pages, in page
+ * order starting at start_page, emitting updated for every page.
+ */
+static gboolean
+ev_job_find_flush_results (EvJobFind *job_find)
+{
+	EvJob *job = EV_JOB (job_find);
+
+	g_mutex_lock (&job_find->mutex);
+	job_find->flush_idle_id = 0;
+	g_mutex_unlock (&job_find->mutex);
+
+	/* The job was disposed while the idle was pending */
+	if (!job_find->pages_done)
+		return FALSE;
+
+	while (!job->cancelled && !ev_job_is_finished (job)) {
+		gint     page = job_find->current_page;
+		GList   *matches;
+		gboolean done;
+
+		g_mutex_lock (&job_find->mutex);
+		done = job_find->pages_done[page];
+		matches = job_find->pending_pages[page];
+		job_find->pending_pages[page] = NULL;
+		g_mutex_unlock (&job_find->mutex);
+
+		if (!done)
+			break;
+
+		if (!job_find->has_results)
+			job_find->has_results = (matches != NULL);
+		job_find->n_results += g_list_length (matches);
+
+		job_find->pages[page] = matches;
+		g_signal_emit (job_find, job_find_signals[FIND_UPDATED], 0, page);
+
+		job_find->current_page = (page + 1) % job_find->n_pages;
+		if (job_find->current_page == job_find->start_page ||
+		    (job_find->max_results > 0 && job_find->n_results >= job_find->max_results)) {
+			g_atomic_int_set (&job_find->stopped, TRUE);
+			ev_profiler_stop (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+			ev_job_succeeded (job);
+		}
+	}
+
+	return FALSE;
+}
+
+/* Called from a thread when page has been searched */
+static void
+ev_job_find_page_done (EvJobFind *job_find,
+		       gint       page,
+		       GList     *matches)
+{
+	g_mutex_lock (&job_find->mutex);
+	job_find->pending_pages[page] = matches;
+	job_find->pages_done[page] = TRUE;
+	if (!job_find->flush_idle_id && !g_atomic_int_get (&job_find->stopped)) {
+		job_find->flush_idle_id =
+			g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+					 (GSourceFunc)ev_job_find_flush_results,
+					 g_object_ref (job_find),
+					 (GDestroyNotify)g_object_unref);
+	}
+	g_mutex_unlock (&job_find->mutex);
+}
+
+/* A page to search in the pool, it keeps the job alive so that
+ * disposing it never has to wait for the pool */
+typedef struct {
+	EvJobFind *job;
+	gint       page;
+} EvJobFindPage;
+
+static GThreadPool *find_pool = NULL;
+
+static void
+ev_job_find_page_thread (EvJobFindPage *find_page,
+			 gpointer       user_data)
+{
+	EvJobFind *job_find = find_page->job;
+	EvJob     *job = EV_JOB (job_find);
+	gint       page = find_page->page;
+	GList     *matches = NULL;
+
+	if (!g_cancellable_is_cancelled (job->cancellable) &&
+	    !g_atomic_int_get (&job_find->stopped)) {
+		EvPage *ev_page;
+
+		ev_document_render_lock (job->document);
+		ev_page = ev_document_get_page (job->document, page);
+		matches = ev_document_find_find_text_with_options (EV_DOCUMENT_FIND (job->document),
+								   ev_page, job_find->text,
+								   job_find->options);
+		g_object_unref (ev_page);
+		ev_document_render_unlock (job->document);
+	}
+
+	ev_job_find_page_done (job_find, page, matches);
+
+	g_object_unref (job_find);
+	g_slice_free (EvJobFindPage, find_page);
+}
+
+/* Searching the index is cheap compared to extracting the text from
+ * the backend, so pages are searched in order from the job thread,
+ * and results are emitted like in the threaded search.
+ */
+static void
+ev_job_find_run_indexed (EvJobFind *job_find)
+{
+	EvJob *job = EV_JOB (job_find);
+	gint   i;
+
+	for (i = 0; i < job_find->n_pages; i++) {
+		gint   page = (job_find->start_page + i) % job_find->n_pages;
+		GList *matches = NULL;
+
+		if (!g_cancellable_is_cancelled (job->cancellable) &&
+		    !g_atomic_int_get (&job_find->stopped)) {
+			matches = ev_text_index_find_text (job_find->index, page,
+							   job_find->text,
+							   job_find->options);
+		}
+
+		ev_job_find_page_done (job_find, page, matches);
+	}
+}
+
+/* Fans the pages out to a pool of threads shared by all the find
+ * jobs. The job doesn't wait for them, so that it doesn't keep the
+ * document busy in the scheduler; it's finished from the main loop
+ * once all the results are in.
+ */
+static void
+ev_job_find_run_parallel (EvJobFind *job_find)
+{
+	gint i;
+
+	if (!find_pool) {
+		find_pool = g_thread_pool_new ((GFunc)ev_job_find_page_thread, NULL,
+					       ev_job_scheduler_get_max_threads (),
+					       FALSE, NULL);
+	}
+
+	/* The pool is FIFO, so pages are searched roughly in the order
+	 * their results are emitted. Pages of cancelled jobs are just
+	 * skipped. */
+	for (i = 0; i < job_find->n_pages; i++) {
+		EvJobFindPage *find_page;
+
+		find_page = g_slice_new (EvJobFindPage);
+		find_page->job = g_object_ref (job_find);
+		find_page->page = (job_find->start_page + i) % job_find->n_pages;
+		g_thread_pool_push (find_pool, find_page, NULL);
+	}
+}
+
+/* Backends that can't render concurrently are searched in order from
+ * the job thread, a slice of pages every time the job runs.
+ */
+static gboolean
+ev_job_find_run_slice (EvJobFind *job_find)
+{
+	EvJob  *job = EV_JOB (job_find);
+	gint64  start_time;
+
+	ev_document_render_lock (job->document);
+
+	start_time = g_get_monotonic_time ();
+	while (job_find->n_searched_pages < job_find->n_pages &&
+	       !g_cancellable_is_cancelled (job->cancellable) &&
+	       !g_atomic_int_get (&job_find->stopped)) {
+		gint    page;
+		EvPage *ev_page;
+		GList  *matches;
+
+		page = (job_find->start_page + job_find->n_searched_pages) % job_find->n_pages;
+		ev_page = ev_document_get_page (job->document, page);
+		matches = ev_document_find_find_text_with_options (EV_DOCUMENT_FIND (job->document),
+								   ev_page, job_find->text,
+								   job_find->options);
+		g_object_unref (ev_page);
+
+		ev_job_find_page_done (job_find, page, matches);
+		job_find->n_searched_pages++;
+
+		if (g_get_monotonic_time () - start_time >= EV_JOB_SLICE_USEC)
+			break;
+	}
+
+	ev_document_render_unlock (job->document);
+
+	return job_find->n_searched_pages < job_find->n_pages &&
+		!g_cancellable_is_cancelled (job->cancellable) &&
+		!g_atomic_int_get (&job_find->stopped);
+}
+
+/* Results are collected from threads and emitted in page order from
+ * the main loop, which also finishes the job, see
+ * ev_job_find_flush_results().
+ */
 static gboolean
 ev_job_find_run (EvJob *job)
 {
-	EvJobFind      *job_find = EV_JOB_FIND (job);
-	EvDocumentFind *find = EV_DOCUMENT_FIND (job->document);
-	EvPage         *ev_page;
-	GList          *matches;
+	EvJobFind *job_find = EV_JOB_FIND (job);
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	
-	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
-		return TRUE;
-	
-#ifdef EV_ENABLE_DEBUG
-	/* We use the #ifdef in this case because of the if */
-	if (job_find->current_page == job_find->start_page)
-		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
-#endif
 
-	ev_page = ev_document_get_page (job->document, job_find->current_page);
-	matches = ev_document_find_find_text_with_options (find, ev_page, job_find->text,
-                                                           job_find->options);
-	g_object_unref (ev_page);
-	
-	ev_document_doc_mutex_unlock ();
+	/* Later runs only continue a sliced search */
+	if (job_find->pending_pages)
+		return ev_job_find_run_slice (job_find);
 
-	if (!job_find->has_results)
-		job_find->has_results = (matches != NULL);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	job_find->pages[job_find->current_page] = matches;
-	g_signal_emit (job_find, job_find_signals[FIND_UPDATED], 0, job_find->current_page);
-		       
-	job_find->current_page = (job_find->current_page + 1) % job_find->n_pages;
-	if (job_find->current_page == job_find->start_page) {
-		ev_job_succeeded (job);
+	job_find->pending_pages = g_new0 (GList *, job_find->n_pages);
+	job_find->pages_done = g_new0 (gboolean, job_find->n_pages);
+
+	if (!job_find->index)
+		job_find->index = ev_text_index_load (job->document);
+	if (job_find->index &&
+	    ev_text_index_get_n_pages (job_find->index) != job_find->n_pages) {
+		ev_text_index_unref (job_find->index);
+		job_find->index = NULL;
+	}
+
+	if (job_find->index) {
+		ev_debug_message (DEBUG_JOBS, "using text index");
+		ev_job_find_run_indexed (job_find);
 
 		return FALSE;
 	}
 
-	return TRUE;
+	if (ev_document_supports_concurrent_render (job->document)) {
+		ev_job_find_run_parallel (job_find);
+
+		return FALSE;
+	}
+
+	return ev_job_find_run_slice (job_find);
 }
 
 static void
@@ -1671,6 +2456,7 @@ ev_job_find_class_init (EvJobFindClass *class)
 	
 	job_class->run = ev_job_find_run;
 	gobject_class->dispose = ev_job_find_dispose;
+	gobject_class->finalize = ev_job_find_finalize;
 	
 	job_find_signals[FIND_UPDATED] =
 		g_signal_new ("updated",
@@ -1708,6 +2494,11 @@ ev_job_find_new (EvDocument  *document,
         if (case_sensitive)
                 job->options |= EV_FIND_CASE_SENSITIVE;
 
+	/* Documents with a text index are searched from the index,
+	 * pages of reentrant backends are searched in parallel and the
+	 * others in slices */
+	job->index = ev_text_index_lookup (document);
+
 	return EV_JOB (job);
 }
 
@@ -1741,6 +2532,43 @@ ev_job_find_get_options (EvJobFind *job)
         return job->options;
 }
 
+/**
+ * ev_job_find_set_max_results:
+ * @job: an #EvJobFind
+ * @max_results: the number of matches, or 0 for no limit
+ *
+ * Makes @job finish as soon as @max_results matches have been found,
+ * counting from the start page, instead of searching the whole
+ * document. Pages not searched have no results. There's no limit by
+ * default.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_find_set_max_results (EvJobFind *job,
+			     gint       max_results)
+{
+	g_return_if_fail (EV_IS_JOB_FIND (job));
+
+	job->max_results = MAX (max_results, 0);
+}
+
+/**
+ * ev_job_find_get_max_results:
+ * @job: an #EvJobFind
+ *
+ * Returns: the maximum number of matches of @job, or 0 for no limit
+ *
+ * Since: 3.18
+ */
+gint
+ev_job_find_get_max_results (EvJobFind *job)
+{
+	g_return_val_if_fail (EV_IS_JOB_FIND (job), 0);
+
+	return job->max_results;
+}
+
 gint
 ev_job_find_get_n_results (EvJobFind *job,
 			   gint       page)
@@ -1785,6 +2613,115 @@ ev_job_find_get_results (EvJobFind *job)
 	return job->pages;
 }
 
+/* EvJobTextIndex */
+
+static void
+ev_job_text_index_init (EvJobTextIndex *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static void
+ev_job_text_index_dispose (GObject *object)
+{
+	EvJobTextIndex *job = EV_JOB_TEXT_INDEX (object);
+
+	if (job->builder) {
+		ev_text_index_builder_free (job->builder);
+		job->builder = NULL;
+	}
+
+	G_OBJECT_CLASS (ev_job_text_index_parent_class)->dispose (object);
+}
+
+static gboolean
+ev_job_text_index_run (EvJob *job)
+{
+	EvJobTextIndex *job_index = EV_JOB_TEXT_INDEX (job);
+	GError         *error = NULL;
+	gint64          start_time;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	if (!job_index->builder) {
+		EvTextIndex *index;
+
+		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+		/* Reuse the index of a previous session if it's still valid */
+		index = ev_text_index_load (job->document);
+		if (index) {
+			ev_text_index_unref (index);
+			ev_job_succeeded (job);
+
+			return FALSE;
+		}
+
+		job_index->builder = ev_text_index_builder_new (job->document, job->cancellable, &error);
+		if (!job_index->builder) {
+			ev_job_failed_from_error (job, error);
+			g_error_free (error);
+
+			return FALSE;
+		}
+	}
+
+	/* Pages are added in slices, so that the document can be
+	 * rendered meanwhile by backends without concurrent rendering.
+	 */
+	start_time = g_get_monotonic_time ();
+	while (!ev_text_index_builder_is_complete (job_index->builder) &&
+	       g_get_monotonic_time () - start_time < EV_JOB_SLICE_USEC) {
+		if (!ev_text_index_builder_add_page (job_index->builder, job->cancellable, &error)) {
+			ev_job_failed_from_error (job, error);
+			g_error_free (error);
+
+			return FALSE;
+		}
+	}
+
+	if (!ev_text_index_builder_is_complete (job_index->builder))
+		return TRUE;
+
+	ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_text_index_class_init (EvJobTextIndexClass *class)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+	EvJobClass   *job_class = EV_JOB_CLASS (class);
+
+	oclass->dispose = ev_job_text_index_dispose;
+	job_class->run = ev_job_text_index_run;
+}
+
+/**
+ * ev_job_text_index_new:
+ * @document: an #EvDocument implementing #EvDocumentText
+ *
+ * Creates a job that makes the text index of @document available,
+ * loading it from the disk or building it when needed.
+ *
+ * Returns: (transfer full): the new #EvJobTextIndex
+ *
+ * Since: 3.18
+ */
+EvJob *
+ev_job_text_index_new (EvDocument *document)
+{
+	EvJob *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_TEXT_INDEX, NULL);
+	job->document = g_object_ref (document);
+
+	return job;
+}
+
 /* EvJobLayers */
 static void
 ev_job_layers_init (EvJobLayers *job)
@@ -1817,9 +2754,9 @@ ev_job_layers_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_layers->model = ev_document_layers_get_layers (EV_DOCUMENT_LAYERS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -1849,7 +2786,12 @@ ev_job_layers_new (EvDocument *document)
 	return job;
 }
 
-/* EvJobExport */
+/* EvJobExport
+ *
+ * EvPrintOperation exports all the pages with a single EvJobExportBatch,
+ * this job exporting one page at a time is kept since it's part of the
+ * public API.
+ */
 static void
 ev_job_export_init (EvJobExport *job)
 {
@@ -1885,7 +2827,7 @@ ev_job_export_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	
 	ev_page = ev_document_get_page (job->document, job_export->page);
 	if (job_export->rc) {
@@ -1901,7 +2843,7 @@ ev_job_export_run (EvJob *job)
 	
 	ev_file_exporter_do_page (EV_FILE_EXPORTER (job->document), job_export->rc);
 	
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -1938,6 +2880,239 @@ ev_job_export_set_page (EvJobExport *job,
 	job->page = page;
 }
 
+/* EvJobExportBatch */
+
+/* Steps other than page numbers */
+#define EXPORT_BATCH_BEGIN_PAGE -1
+#define EXPORT_BATCH_END_PAGE   -2
+
+static void
+ev_job_export_batch_init (EvJobExportBatch *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+	job->steps = g_array_new (FALSE, FALSE, sizeof (gint));
+}
+
+static void
+ev_job_export_batch_dispose (GObject *object)
+{
+	EvJobExportBatch *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = EV_JOB_EXPORT_BATCH (object);
+
+	if (job->rc) {
+		g_object_unref (job->rc);
+		job->rc = NULL;
+	}
+
+	if (job->steps) {
+		g_array_free (job->steps, TRUE);
+		job->steps = NULL;
+	}
+
+	(* G_OBJECT_CLASS (ev_job_export_batch_parent_class)->dispose) (object);
+}
+
+static gboolean
+ev_job_export_batch_emit_updated (EvJobExportBatch *job)
+{
+	g_atomic_int_set (&job->updated_pending, FALSE);
+
+	if (!EV_JOB (job)->cancelled)
+		g_signal_emit (job, job_export_batch_signals[EXPORT_BATCH_UPDATED], 0,
+			       g_atomic_int_get (&job->n_exported));
+
+	return FALSE;
+}
+
+static void
+ev_job_export_batch_do_page (EvJobExportBatch *job,
+			     gint              page)
+{
+	EvDocument *document = EV_JOB (job)->document;
+	EvPage     *ev_page;
+
+	ev_page = ev_document_get_page (document, page);
+	if (job->rc)
+		ev_render_context_set_page (job->rc, ev_page);
+	else
+		job->rc = ev_render_context_new (ev_page, 0, 1.0);
+	g_object_unref (ev_page);
+
+	ev_file_exporter_do_page (EV_FILE_EXPORTER (document), job->rc);
+}
+
+static gboolean
+ev_job_export_batch_run (EvJob *job)
+{
+	EvJobExportBatch *job_batch = EV_JOB_EXPORT_BATCH (job);
+	gint64            start_time;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	start_time = g_get_monotonic_time ();
+
+	while (job_batch->next_step < job_batch->steps->len) {
+		gint step;
+
+		if (g_cancellable_is_cancelled (job->cancellable))
+			return FALSE;
+
+		if (g_get_monotonic_time () - start_time > EV_JOB_SLICE_USEC)
+			return TRUE;
+
+		step = g_array_index (job_batch->steps, gint, job_batch->next_step);
+		job_batch->next_step++;
+
+		ev_document_lock (job->document);
+		switch (step) {
+		case EXPORT_BATCH_BEGIN_PAGE:
+			ev_file_exporter_begin_page (EV_FILE_EXPORTER (job->document));
+			break;
+		case EXPORT_BATCH_END_PAGE:
+			ev_file_exporter_end_page (EV_FILE_EXPORTER (job->document));
+			break;
+		default:
+			ev_job_export_batch_do_page (job_batch, step);
+			break;
+		}
+		ev_document_unlock (job->document);
+
+		if (step < 0)
+			continue;
+
+		g_atomic_int_inc (&job_batch->n_exported);
+		ev_job_queue_idle_update (job, &job_batch->updated_pending,
+					  (GSourceFunc)ev_job_export_batch_emit_updated);
+	}
+
+	ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_export_batch_class_init (EvJobExportBatchClass *class)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+	EvJobClass   *job_class = EV_JOB_CLASS (class);
+
+	oclass->dispose = ev_job_export_batch_dispose;
+	job_class->run = ev_job_export_batch_run;
+
+	job_export_batch_signals[EXPORT_BATCH_UPDATED] =
+		g_signal_new ("updated",
+			      EV_TYPE_JOB_EXPORT_BATCH,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvJobExportBatchClass, updated),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__INT,
+			      G_TYPE_NONE,
+			      1, G_TYPE_INT);
+}
+
+/**
+ * ev_job_export_batch_new:
+ * @document: an #EvDocument implementing #EvFileExporter
+ *
+ * Creates a job that exports a sequence of pages, added with
+ * ev_job_export_batch_add_page() before the job is scheduled, in a single
+ * run. The exporter must have been started with ev_file_exporter_begin().
+ * #EvJobExportBatch::updated is emitted with the number of pages exported
+ * so far.
+ *
+ * Returns: (transfer full): the new #EvJobExportBatch
+ *
+ * Since: 3.18
+ */
+EvJob *
+ev_job_export_batch_new (EvDocument *document)
+{
+	EvJob *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_EXPORT_BATCH, NULL);
+	job->document = g_object_ref (document);
+
+	return job;
+}
+
+/**
+ * ev_job_export_batch_begin_page:
+ * @job: an #EvJobExportBatch
+ *
+ * Adds a call to ev_file_exporter_begin_page() to @job.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_export_batch_begin_page (EvJobExportBatch *job)
+{
+	gint step = EXPORT_BATCH_BEGIN_PAGE;
+
+	g_return_if_fail (EV_IS_JOB_EXPORT_BATCH (job));
+
+	g_array_append_val (job->steps, step);
+}
+
+/**
+ * ev_job_export_batch_add_page:
+ * @job: an #EvJobExportBatch
+ * @page: the index of the page to export
+ *
+ * Adds a call to ev_file_exporter_do_page() for @page to @job.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_export_batch_add_page (EvJobExportBatch *job,
+			      gint              page)
+{
+	g_return_if_fail (EV_IS_JOB_EXPORT_BATCH (job));
+	g_return_if_fail (page >= 0);
+
+	g_array_append_val (job->steps, page);
+	job->n_pages++;
+}
+
+/**
+ * ev_job_export_batch_end_page:
+ * @job: an #EvJobExportBatch
+ *
+ * Adds a call to ev_file_exporter_end_page() to @job.
+ *
+ * Since: 3.18
+ */
+void
+ev_job_export_batch_end_page (EvJobExportBatch *job)
+{
+	gint step = EXPORT_BATCH_END_PAGE;
+
+	g_return_if_fail (EV_IS_JOB_EXPORT_BATCH (job));
+
+	g_array_append_val (job->steps, step);
+}
+
+/**
+ * ev_job_export_batch_get_n_pages:
+ * @job: an #EvJobExportBatch
+ *
+ * Returns: the number of pages added to @job
+ *
+ * Since: 3.18
+ */
+gint
+ev_job_export_batch_get_n_pages (EvJobExportBatch *job)
+{
+	g_return_val_if_fail (EV_IS_JOB_EXPORT_BATCH (job), 0);
+
+	return job->n_pages;
+}
+
 /* EvJobPrint */
 static void
 ev_job_print_init (EvJobPrint *job)
@@ -1980,14 +3155,14 @@ ev_job_print_run (EvJob *job)
 	job->finished = FALSE;
 	g_clear_error (&job->error);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	ev_page = ev_document_get_page (job->document, job_print->page);
 	ev_document_print_print_page (EV_DOCUMENT_PRINT (job->document),
 				      ev_page, job_print->cr);
 	g_object_unref (ev_page);
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
         if (g_cancellable_is_cancelled (job->cancellable))
                 return FALSE;
@@ -31,6 +31,8 @@
 
 #include <evince-document.h>
 
+#include "ev-text-index.h"
+
 G_BEGIN_DECLS
 
 typedef struct _EvJob EvJob;
@@ -48,6 +50,9 @@ typedef struct _EvJobThumbnailClass EvJobThumbnailClass;
 typedef struct _EvJobLinks EvJobLinks;
 typedef struct _EvJobLinksClass EvJobLinksClass;
 
+typedef struct _EvJobLinkLabels EvJobLinkLabels;
+typedef struct _EvJobLinkLabelsClass EvJobLinkLabelsClass;
+
 typedef struct _EvJobAttachments EvJobAttachments;
 typedef struct _EvJobAttachmentsClass EvJobAttachmentsClass;
 
@@ -57,6 +62,9 @@ typedef struct _EvJobAnnotsClass EvJobAnnotsClass;
 typedef struct _EvJobFonts EvJobFonts;
 typedef struct _EvJobFontsClass EvJobFontsClass;
 
+typedef struct _EvJobPageMetadata EvJobPageMetadata;
+typedef struct _EvJobPageMetadataClass EvJobPageMetadataClass;
+
 typedef struct _EvJobLoad EvJobLoad;
 typedef struct _EvJobLoadClass EvJobLoadClass;
 
@@ -72,12 +80,18 @@ typedef struct _EvJobSaveClass EvJobSaveClass;
 typedef struct _EvJobFind EvJobFind;
 typedef struct _EvJobFindClass EvJobFindClass;
 
+typedef struct _EvJobTextIndex EvJobTextIndex;
+typedef struct _EvJobTextIndexClass EvJobTextIndexClass;
+
 typedef struct _EvJobLayers EvJobLayers;
 typedef struct _EvJobLayersClass EvJobLayersClass;
 
 typedef struct _EvJobExport EvJobExport;
 typedef struct _EvJobExportClass EvJobExportClass;
 
+typedef struct _EvJobExportBatch EvJobExportBatch;
+typedef struct _EvJobExportBatchClass EvJobExportBatchClass;
+
 typedef struct _EvJobPrint EvJobPrint;
 typedef struct _EvJobPrintClass EvJobPrintClass;
 
@@ -95,6 +109,13 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_IS_JOB_LINKS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_LINKS))
 #define EV_JOB_LINKS_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_LINKS, EvJobLinksClass))
 
+#define EV_TYPE_JOB_LINK_LABELS            (ev_job_link_labels_get_type())
+#define EV_JOB_LINK_LABELS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_LINK_LABELS, EvJobLinkLabels))
+#define EV_IS_JOB_LINK_LABELS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_LINK_LABELS))
+#define EV_JOB_LINK_LABELS_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_LINK_LABELS, EvJobLinkLabelsClass))
+#define EV_IS_JOB_LINK_LABELS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_LINK_LABELS))
+#define EV_JOB_LINK_LABELS_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_LINK_LABELS, EvJobLinkLabelsClass))
+
 #define EV_TYPE_JOB_ATTACHMENTS           (ev_job_attachments_get_type())
 #define EV_JOB_ATTACHMENTS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_ATTACHMENTS, EvJobAttachments))
 #define EV_IS_JOB_ATTACHMENTS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_ATTACHMENTS))
@@ -138,6 +159,13 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_JOB_FONTS_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_FONTS, EvJobFontsClass))
 
 
+#define EV_TYPE_JOB_PAGE_METADATA            (ev_job_page_metadata_get_type())
+#define EV_JOB_PAGE_METADATA(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_PAGE_METADATA, EvJobPageMetadata))
+#define EV_IS_JOB_PAGE_METADATA(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_PAGE_METADATA))
+#define EV_JOB_PAGE_METADATA_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_PAGE_METADATA, EvJobPageMetadataClass))
+#define EV_IS_JOB_PAGE_METADATA_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_PAGE_METADATA))
+#define EV_JOB_PAGE_METADATA_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_PAGE_METADATA, EvJobPageMetadataClass))
+
 #define EV_TYPE_JOB_LOAD            (ev_job_load_get_type())
 #define EV_JOB_LOAD(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_LOAD, EvJobLoad))
 #define EV_IS_JOB_LOAD(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_LOAD))
@@ -173,6 +201,13 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_IS_JOB_FIND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_FIND))
 #define EV_JOB_FIND_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_FIND, EvJobFindClass))
 
+#define EV_TYPE_JOB_TEXT_INDEX            (ev_job_text_index_get_type())
+#define EV_JOB_TEXT_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_TEXT_INDEX, EvJobTextIndex))
+#define EV_IS_JOB_TEXT_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_TEXT_INDEX))
+#define EV_JOB_TEXT_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_TEXT_INDEX, EvJobTextIndexClass))
+#define EV_IS_JOB_TEXT_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_TEXT_INDEX))
+#define EV_JOB_TEXT_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_TEXT_INDEX, EvJobTextIndexClass))
+
 #define EV_TYPE_JOB_LAYERS            (ev_job_layers_get_type())
 #define EV_JOB_LAYERS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_LAYERS, EvJobLayers))
 #define EV_IS_JOB_LAYERS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_LAYERS))
@@ -187,6 +222,13 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_IS_JOB_EXPORT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_EXPORT))
 #define EV_JOB_EXPORT_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_EXPORT, EvJobExportClass))
 
+#define EV_TYPE_JOB_EXPORT_BATCH            (ev_job_export_batch_get_type())
+#define EV_JOB_EXPORT_BATCH(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_EXPORT_BATCH, EvJobExportBatch))
+#define EV_IS_JOB_EXPORT_BATCH(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_EXPORT_BATCH))
+#define EV_JOB_EXPORT_BATCH_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_EXPORT_BATCH, EvJobExportBatchClass))
+#define EV_IS_JOB_EXPORT_BATCH_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_EXPORT_BATCH))
+#define EV_JOB_EXPORT_BATCH_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_EXPORT_BATCH, EvJobExportBatchClass))
+
 #define EV_TYPE_JOB_PRINT            (ev_job_print_get_type())
 #define EV_JOB_PRINT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_PRINT, EvJobPrint))
 #define EV_IS_JOB_PRINT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_PRINT))
@@ -241,6 +283,19 @@ struct _EvJobLinksClass
 	EvJobClass parent_class;
 };
 
+struct _EvJobLinkLabels
+{
+	EvJob parent;
+
+	GPtrArray *links;
+	gchar    **labels;
+};
+
+struct _EvJobLinkLabelsClass
+{
+	EvJobClass parent_class;
+};
+
 struct _EvJobAttachments
 {
 	EvJob parent;
@@ -258,11 +313,27 @@ struct _EvJobAnnots
 	EvJob parent;
 
 	GList *annots;
+
+	/* Scan state, used by the worker thread */
+	gint    n_pages;
+	gint    next_page;
+	guint8 *scanned;
+	gint    priority_start;
+	gint    priority_end;
+
+	/* Found by the worker, not emitted yet */
+	GMutex  mutex;
+	GList  *new_annots;
+	gint    updated_pending;
 };
 
 struct _EvJobAnnotsClass
 {
 	EvJobClass parent_class;
+
+	/* Signals */
+	void (* updated) (EvJobAnnots *job,
+			  GList       *annots);
 };
 
 struct _EvJobRender
@@ -285,6 +356,9 @@ struct _EvJobRender
 	EvSelectionStyle selection_style;
 	GdkColor base;
 	GdkColor text;
+
+	gboolean has_area;
+	cairo_rectangle_int_t area;
 };
 
 struct _EvJobRenderClass
@@ -364,6 +438,12 @@ struct _EvJobFonts
 {
 	EvJob parent;
 	gboolean scan_completed;
+	gint slice_pages;
+	gint updated_pending;
+
+	/* Progress of the scan as of the last slice, protected by mutex */
+	GMutex mutex;
+	gdouble progress;
 };
 
 struct _EvJobFontsClass
@@ -375,12 +455,30 @@ struct _EvJobFontsClass
 			   gdouble     progress);
 };
 
+struct _EvJobPageMetadata
+{
+	EvJob parent;
+
+	gint updated_pending;
+};
+
+struct _EvJobPageMetadataClass
+{
+	EvJobClass parent_class;
+
+	/* Signals */
+	void (* updated)  (EvJobPageMetadata *job,
+			   gint               first_page,
+			   gint               last_page);
+};
+
 struct _EvJobLoad
 {
 	EvJob parent;
 
 	gchar *uri;
 	gchar *password;
+	EvDocumentLoadFlags flags;
 };
 
 struct _EvJobLoadClass
@@ -441,6 +539,24 @@ struct _EvJobFind
 	gboolean case_sensitive;
 	gboolean has_results;
         EvFindOptions options;
+
+	gint max_results;
+	gint n_results;
+
+	/* Pages searched so far by a sliced search */
+	gint n_searched_pages;
+
+	/* Threaded search: pages are searched by a pool of threads or
+	 * in slices, and results are moved to pages in page order from
+	 * the main loop. Protected by mutex. */
+	GMutex mutex;
+	GList **pending_pages;
+	gboolean *pages_done;
+	guint flush_idle_id;
+	gint stopped;
+
+	/* Answers the search instead of the backend when present */
+	EvTextIndex *index;
 };
 
 struct _EvJobFindClass
@@ -452,6 +568,18 @@ struct _EvJobFindClass
 			   gint       page);
 };
 
+struct _EvJobTextIndex
+{
+	EvJob parent;
+
+	EvTextIndexBuilder *builder;
+};
+
+struct _EvJobTextIndexClass
+{
+	EvJobClass parent_class;
+};
+
 struct _EvJobLayers
 {
 	EvJob parent;
@@ -477,6 +605,27 @@ struct _EvJobExportClass
 	EvJobClass parent_class;
 };
 
+struct _EvJobExportBatch
+{
+	EvJob parent;
+
+	GArray *steps;
+	guint next_step;
+	gint n_pages;
+	gint n_exported;
+	gint updated_pending;
+	EvRenderContext *rc;
+};
+
+struct _EvJobExportBatchClass
+{
+	EvJobClass parent_class;
+
+	/* Signals */
+	void (* updated)  (EvJobExportBatch *job,
+			   gint              n_exported);
+};
+
 struct _EvJobPrint
 {
 	EvJob parent;
@@ -513,6 +662,11 @@ GType           ev_job_links_get_type     (void) G_GNUC_CONST;
 EvJob          *ev_job_links_new          (EvDocument     *document);
 GtkTreeModel   *ev_job_links_get_model    (EvJobLinks     *job);
 
+/* EvJobLinkLabels */
+GType           ev_job_link_labels_get_type (void) G_GNUC_CONST;
+EvJob          *ev_job_link_labels_new      (EvDocument     *document,
+					     GPtrArray      *links);
+
 /* EvJobAttachments */
 GType           ev_job_attachments_get_type (void) G_GNUC_CONST;
 EvJob          *ev_job_attachments_new      (EvDocument     *document);
@@ -520,6 +674,9 @@ EvJob          *ev_job_attachments_new      (EvDocument     *document);
 /* EvJobAnnots */
 GType           ev_job_annots_get_type      (void) G_GNUC_CONST;
 EvJob          *ev_job_annots_new           (EvDocument     *document);
+void            ev_job_annots_set_priority_range (EvJobAnnots *job,
+						  gint         start_page,
+						  gint         end_page);
 
 /* EvJobRender */
 GType           ev_job_render_get_type    (void) G_GNUC_CONST;
@@ -534,6 +691,8 @@ void     ev_job_render_set_selection_info (EvJobRender     *job,
 					   EvSelectionStyle selection_style,
 					   GdkColor        *text,
 					   GdkColor        *base);
+void     ev_job_render_set_area           (EvJobRender     *job,
+					   const cairo_rectangle_int_t *area);
 /* EvJobPageData */
 GType           ev_job_page_data_get_type (void) G_GNUC_CONST;
 EvJob          *ev_job_page_data_new      (EvDocument      *document,
@@ -559,6 +718,10 @@ void            ev_job_thumbnail_set_output_format (EvJobThumbnail      *job,
 GType 		ev_job_fonts_get_type 	  (void) G_GNUC_CONST;
 EvJob 	       *ev_job_fonts_new 	  (EvDocument      *document);
 
+/* EvJobPageMetadata */
+GType           ev_job_page_metadata_get_type (void) G_GNUC_CONST;
+EvJob          *ev_job_page_metadata_new      (EvDocument      *document);
+
 /* EvJobLoad */
 GType 		ev_job_load_get_type 	  (void) G_GNUC_CONST;
 EvJob 	       *ev_job_load_new 	  (const gchar 	   *uri);
@@ -566,6 +729,8 @@ void            ev_job_load_set_uri       (EvJobLoad       *load,
 					   const gchar     *uri);
 void            ev_job_load_set_password  (EvJobLoad       *job,
 					   const gchar     *password);
+void            ev_job_load_set_load_flags (EvJobLoad      *job,
+					    EvDocumentLoadFlags flags);
 
 /* EvJobLoadStream */
 GType           ev_job_load_stream_get_type       (void) G_GNUC_CONST;
@@ -604,12 +769,19 @@ EvJob          *ev_job_find_new           (EvDocument      *document,
 void            ev_job_find_set_options   (EvJobFind       *job,
                                            EvFindOptions    options);
 EvFindOptions   ev_job_find_get_options   (EvJobFind       *job);
+void            ev_job_find_set_max_results (EvJobFind     *job,
+					   gint             max_results);
+gint            ev_job_find_get_max_results (EvJobFind     *job);
 gint            ev_job_find_get_n_results (EvJobFind       *job,
 					   gint             pages);
 gdouble         ev_job_find_get_progress  (EvJobFind       *job);
 gboolean        ev_job_find_has_results   (EvJobFind       *job);
 GList         **ev_job_find_get_results   (EvJobFind       *job);
 
+/* EvJobTextIndex */
+GType           ev_job_text_index_get_type (void) G_GNUC_CONST;
+EvJob          *ev_job_text_index_new      (EvDocument    *document);
+
 /* EvJobLayers */
 GType           ev_job_layers_get_type    (void) G_GNUC_CONST;
 EvJob          *ev_job_layers_new         (EvDocument     *document);
@@ -619,6 +791,16 @@ GType           ev_job_export_get_type    (void) G_GNUC_CONST;
 EvJob          *ev_job_export_new         (EvDocument     *document);
 void            ev_job_export_set_page    (EvJobExport    *job,
 					   gint            page);
+
+/* EvJobExportBatch */
+GType           ev_job_export_batch_get_type   (void) G_GNUC_CONST;
+EvJob          *ev_job_export_batch_new        (EvDocument       *document);
+void            ev_job_export_batch_begin_page (EvJobExportBatch *job);
+void            ev_job_export_batch_add_page   (EvJobExportBatch *job,
+						gint              page);
+void            ev_job_export_batch_end_page   (EvJobExportBatch *job);
+gint            ev_job_export_batch_get_n_pages (EvJobExportBatch *job);
+
 /* EvJobPrint */
 GType           ev_job_print_get_type    (void) G_GNUC_CONST;
 EvJob          *ev_job_print_new         (EvDocument     *document);
@@ -731,13 +731,13 @@ ev_page_accessible_get_selection (AtkText *text,
 
 			page = ev_document_get_page (view->document, selection->page);
 
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			selected_text = ev_selection_get_selected_text (EV_SELECTION (view->document),
 									page,
 									selection->style,
 									&(selection->rect));
 
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 			g_object_unref (page);
 
@@ -882,31 +882,19 @@ ev_page_accessible_get_default_attributes (AtkText *text)
 }
 
 static void
-ev_page_accessible_get_character_extents (AtkText      *text,
-					  gint         offset,
-					  gint         *x,
-					  gint         *y,
-					  gint         *width,
-					  gint         *height,
-					  AtkCoordType coords)
+get_doc_rect_extents (EvPageAccessible *self,
+		      EvRectangle      *doc_rect,
+		      gint             *x,
+		      gint             *y,
+		      gint             *width,
+		      gint             *height,
+		      AtkCoordType      coords)
 {
-	EvPageAccessible *self = EV_PAGE_ACCESSIBLE (text);
 	EvView *view = ev_page_accessible_get_view (self);
 	GtkWidget *toplevel;
-	EvRectangle *areas = NULL;
-	EvRectangle *doc_rect;
-	guint n_areas = 0;
 	gint x_widget, y_widget;
 	GdkRectangle view_rect;
 
-	if (!view->page_cache)
-		return;
-
-	ev_page_cache_get_text_layout (view->page_cache, self->priv->page, &areas, &n_areas);
-	if (!areas || offset >= n_areas)
-		return;
-
-	doc_rect = areas + offset;
 	_ev_view_transform_doc_rect_to_view_rect (view, self->priv->page, doc_rect, &view_rect);
 	view_rect.x -= view->scroll_x;
 	view_rect.y -= view->scroll_y;
@@ -930,6 +918,71 @@ ev_page_accessible_get_character_extents (AtkText      *text,
 	*height = view_rect.height;
 }
 
+static void
+ev_page_accessible_get_character_extents (AtkText      *text,
+					  gint         offset,
+					  gint         *x,
+					  gint         *y,
+					  gint         *width,
+					  gint         *height,
+					  AtkCoordType coords)
+{
+	EvPageAccessible *self = EV_PAGE_ACCESSIBLE (text);
+	EvView *view = ev_page_accessible_get_view (self);
+	EvRectangle *areas = NULL;
+	guint n_areas = 0;
+
+	if (!view->page_cache)
+		return;
+
+	ev_page_cache_get_text_layout (view->page_cache, self->priv->page, &areas, &n_areas);
+	if (!areas || offset >= n_areas)
+		return;
+
+	get_doc_rect_extents (self, areas + offset, x, y, width, height, coords);
+}
+
+static void
+ev_page_accessible_get_range_extents (AtkText          *text,
+				      gint              start_offset,
+				      gint              end_offset,
+				      AtkCoordType      coord_type,
+				      AtkTextRectangle *rect)
+{
+	EvPageAccessible *self = EV_PAGE_ACCESSIBLE (text);
+	EvView *view = ev_page_accessible_get_view (self);
+	EvTextLayoutIndex *index;
+	EvRectangle *rects;
+	EvRectangle extents;
+	guint n_rects = 0;
+	guint i;
+
+	rect->x = rect->y = rect->width = rect->height = -1;
+
+	if (!view->page_cache || start_offset < 0 || end_offset <= start_offset)
+		return;
+
+	index = ev_page_cache_get_text_layout_index (view->page_cache, self->priv->page);
+	if (!index)
+		return;
+
+	rects = ev_text_layout_index_get_range_rects (index, start_offset, end_offset, &n_rects);
+	if (n_rects > 0) {
+		extents = rects[0];
+		for (i = 1; i < n_rects; i++) {
+			extents.x1 = MIN (extents.x1, rects[i].x1);
+			extents.y1 = MIN (extents.y1, rects[i].y1);
+			extents.x2 = MAX (extents.x2, rects[i].x2);
+			extents.y2 = MAX (extents.y2, rects[i].y2);
+		}
+
+		get_doc_rect_extents (self, &extents,
+				      &rect->x, &rect->y, &rect->width, &rect->height,
+				      coord_type);
+	}
+	g_free (rects);
+}
+
 static gint
 ev_page_accessible_get_offset_at_point (AtkText      *text,
 					gint         x,
@@ -939,12 +992,8 @@ ev_page_accessible_get_offset_at_point (AtkText      *text,
 	EvPageAccessible *self = EV_PAGE_ACCESSIBLE (text);
 	EvView *view = ev_page_accessible_get_view (self);
 	GtkWidget *toplevel;
-	EvRectangle *areas = NULL;
-	EvRectangle *rect = NULL;
-	guint n_areas = 0;
-	guint i;
+	EvTextLayoutIndex *index;
 	gint x_widget, y_widget;
-	gint offset=-1;
 	GdkPoint view_point;
 	gdouble doc_x, doc_y;
 	GtkBorder border;
@@ -953,8 +1002,8 @@ ev_page_accessible_get_offset_at_point (AtkText      *text,
 	if (!view->page_cache)
 		return -1;
 
-	ev_page_cache_get_text_layout (view->page_cache, self->priv->page, &areas, &n_areas);
-	if (!areas)
+	index = ev_page_cache_get_text_layout_index (view->page_cache, self->priv->page);
+	if (!index)
 		return -1;
 
 	view_point.x = x;
@@ -975,14 +1024,7 @@ ev_page_accessible_get_offset_at_point (AtkText      *text,
 	ev_view_get_page_extents (view, self->priv->page, &page_area, &border);
 	_ev_view_transform_view_point_to_doc_point (view, &view_point, &page_area, &border, &doc_x, &doc_y);
 
-	for (i = 0; i < n_areas; i++) {
-		rect = areas + i;
-		if (doc_x >= rect->x1 && doc_x <= rect->x2 &&
-		    doc_y >= rect->y1 && doc_y <= rect->y2)
-			offset = i;
-	}
-
-	return offset;
+	return ev_text_layout_index_get_offset_at_point (index, doc_x, doc_y);
 }
 
 /* ATK allows for multiple, non-contiguous selections within a single AtkText
@@ -1064,6 +1106,7 @@ ev_page_accessible_text_iface_init (AtkTextIface *iface)
 	iface->get_run_attributes = ev_page_accessible_get_run_attributes;
 	iface->get_default_attributes = ev_page_accessible_get_default_attributes;
 	iface->get_character_extents = ev_page_accessible_get_character_extents;
+	iface->get_range_extents = ev_page_accessible_get_range_extents;
 	iface->get_offset_at_point = ev_page_accessible_get_offset_at_point;
 }
 
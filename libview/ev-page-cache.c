@@ -53,6 +53,7 @@ typedef struct _EvPageCacheData {
 	cairo_region_t    *text_mapping;
 	EvRectangle       *text_layout;
 	guint              text_layout_length;
+	EvTextLayoutIndex *text_layout_index;
 	gchar             *text;
 	PangoAttrList     *text_attrs;
         PangoLogAttr      *text_log_attrs;
@@ -132,6 +133,11 @@ ev_page_cache_data_free (EvPageCacheData *data)
 		data->text_mapping = NULL;
 	}
 
+	if (data->text_layout_index) {
+		ev_text_layout_index_free (data->text_layout_index);
+		data->text_layout_index = NULL;
+	}
+
 	if (data->text_layout) {
 		g_free (data->text_layout);
 		data->text_layout = NULL;
@@ -324,6 +330,7 @@ job_page_data_finished_cb (EvJob       *job,
 	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING)
 		data->text_mapping = job_data->text_mapping;
 	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
+		g_clear_pointer (&data->text_layout_index, ev_text_layout_index_free);
 		data->text_layout = job_data->text_layout;
 		data->text_layout_length = job_data->text_layout_length;
 	}
@@ -468,6 +475,7 @@ ev_page_cache_mark_dirty (EvPageCache       *cache,
                 g_clear_pointer (&data->text, g_free);
 
 	if (flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
+                g_clear_pointer (&data->text_layout_index, ev_text_layout_index_free);
                 g_clear_pointer (&data->text_layout, g_free);
                 data->text_layout_length = 0;
         }
@@ -670,6 +678,39 @@ ev_page_cache_get_text_layout (EvPageCache  *cache,
 	return FALSE;
 }
 
+/**
+ * ev_page_cache_get_text_layout_index:
+ * @cache: a #EvPageCache
+ * @page:
+ *
+ * Returns the lines of the text layout of @page, built the first time
+ * it's requested once the page data is available.
+ *
+ * Returns: (transfer none): an #EvTextLayoutIndex or %NULL
+ */
+EvTextLayoutIndex *
+ev_page_cache_get_text_layout_index (EvPageCache *cache,
+				     gint         page)
+{
+	EvPageCacheData *data;
+
+	g_return_val_if_fail (EV_IS_PAGE_CACHE (cache), NULL);
+	g_return_val_if_fail (page >= 0 && page < cache->n_pages, NULL);
+
+	if (!(cache->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT))
+		return NULL;
+
+	data = &cache->page_list[page];
+	if (!data->done || !data->text_layout)
+		return NULL;
+
+	if (!data->text_layout_index)
+		data->text_layout_index = ev_text_layout_index_new (data->text_layout,
+								    data->text_layout_length);
+
+	return data->text_layout_index;
+}
+
 /**
  * ev_page_cache_get_text_attrs:
  * @cache: a #EvPageCache
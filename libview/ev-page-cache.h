@@ -28,6 +28,7 @@
 #include <gdk/gdk.h>
 #include <evince-document.h>
 #include <evince-view.h>
+#include "ev-text-layout-index.h"
 
 G_BEGIN_DECLS
 
@@ -71,6 +72,8 @@ gboolean           ev_page_cache_get_text_layout        (EvPageCache       *cach
 							 gint               page,
 							 EvRectangle      **areas,
 							 guint             *n_areas);
+EvTextLayoutIndex *ev_page_cache_get_text_layout_index  (EvPageCache       *cache,
+							 gint               page);
 PangoAttrList     *ev_page_cache_get_text_attrs         (EvPageCache       *cache,
                                                          gint               page);
 gboolean           ev_page_cache_get_text_log_attrs     (EvPageCache       *cache,
@@ -1,6 +1,8 @@
 #include <config.h>
+#include <math.h>
 #include "ev-pixbuf-cache.h"
 #include "ev-job-scheduler.h"
+#include "ev-surface-cache.h"
 #include "ev-view-private.h"
 
 typedef enum {
@@ -22,6 +24,9 @@ typedef struct _CacheJobInfo
 	/* Device scale factor of target widget */
 	int device_scale;
 
+	/* Rotation the surface was rendered with */
+	gint rotation;
+
 	/* Selection data. 
 	 * Selection_points are the coordinates encapsulated in selection.
 	 * target_points is the target selection size. */
@@ -38,6 +43,25 @@ typedef struct _CacheJobInfo
 	EvRectangle     selection_region_points;
 } CacheJobInfo;
 
+/* Pages too large to be rendered at once are split in tiles that are
+ * rendered on demand when drawn. */
+typedef struct _CacheTileInfo
+{
+	EvPixbufCache   *pixbuf_cache;
+	gint             page;
+	gint             column;
+	gint             row;
+
+	EvJob           *job;
+	cairo_surface_t *surface;
+
+	/* Frame of the view in which the tile was last drawn */
+	gint64           frame;
+
+	/* Link in the tiles LRU list */
+	GList           *link;
+} CacheTileInfo;
+
 struct _EvPixbufCache
 {
 	GObject parent;
@@ -63,6 +87,19 @@ struct _EvPixbufCache
 	CacheJobInfo *prev_job;
 	CacheJobInfo *job_list;
 	CacheJobInfo *next_job;
+
+	/* Tiles of the visible pages that are too large to be rendered
+	 * at once. Tiles are only valid for tiles_scale, tiles_rotation
+	 * and tiles_device_scale, and are evicted in LRU order when
+	 * tiles_size exceeds the tiles budget. Tiles drawn in the current
+	 * frame are never evicted.
+	 */
+	GHashTable   *tiles;
+	GQueue        tiles_lru;
+	gsize         tiles_size;
+	gdouble       tiles_scale;
+	gint          tiles_rotation;
+	gint          tiles_device_scale;
 };
 
 struct _EvPixbufCacheClass
@@ -87,6 +124,8 @@ static void          ev_pixbuf_cache_finalize   (GObject            *object);
 static void          ev_pixbuf_cache_dispose    (GObject            *object);
 static void          job_finished_cb            (EvJob              *job,
 						 EvPixbufCache      *pixbuf_cache);
+static void          tile_job_finished_cb       (EvJob              *job,
+						 CacheTileInfo      *tile);
 static CacheJobInfo *find_job_cache             (EvPixbufCache      *pixbuf_cache,
 						 int                 page);
 static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cache,
@@ -105,13 +144,85 @@ static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cac
 
 #define MAX_PRELOADED_PAGES 3
 
+/* Size in widget pixels of the tiles */
+#define TILE_SIZE 256
+/* A page is rendered in tiles when its surface would use more than
+ * 1/TILED_PAGE_FRACTION of the cache. A low resolution preview of the
+ * page using at most 1/TILED_PREVIEW_FRACTION of the cache is still
+ * rendered, and drawn while the tiles are not ready.
+ */
+#define TILED_PAGE_FRACTION 4
+#define TILED_PREVIEW_FRACTION 16
+
 G_DEFINE_TYPE (EvPixbufCache, ev_pixbuf_cache, G_TYPE_OBJECT)
 
+static guint
+cache_tile_info_hash (gconstpointer key)
+{
+	const CacheTileInfo *tile = key;
+
+	return (tile->page * 31 + tile->row) * 31 + tile->column;
+}
+
+static gboolean
+cache_tile_info_equal (gconstpointer a,
+		       gconstpointer b)
+{
+	const CacheTileInfo *tile_a = a;
+	const CacheTileInfo *tile_b = b;
+
+	return tile_a->page == tile_b->page &&
+		tile_a->row == tile_b->row &&
+		tile_a->column == tile_b->column;
+}
+
+static void
+end_tile_job (CacheTileInfo *tile)
+{
+	g_signal_handlers_disconnect_by_func (tile->job,
+					      G_CALLBACK (tile_job_finished_cb),
+					      tile);
+	ev_job_cancel (tile->job);
+	g_object_unref (tile->job);
+	tile->job = NULL;
+}
+
+static gsize
+get_surface_size (cairo_surface_t *surface)
+{
+	return cairo_image_surface_get_stride (surface) *
+		cairo_image_surface_get_height (surface);
+}
+
+static void
+cache_tile_info_free (CacheTileInfo *tile)
+{
+	EvPixbufCache *pixbuf_cache = tile->pixbuf_cache;
+
+	if (tile->job)
+		end_tile_job (tile);
+
+	if (tile->surface) {
+		pixbuf_cache->tiles_size -= get_surface_size (tile->surface);
+		cairo_surface_destroy (tile->surface);
+	}
+
+	g_queue_delete_link (&pixbuf_cache->tiles_lru, tile->link);
+
+	g_slice_free (CacheTileInfo, tile);
+}
+
 static void
 ev_pixbuf_cache_init (EvPixbufCache *pixbuf_cache)
 {
 	pixbuf_cache->start_page = -1;
 	pixbuf_cache->end_page = -1;
+
+	pixbuf_cache->tiles = g_hash_table_new_full (cache_tile_info_hash,
+						     cache_tile_info_equal,
+						     NULL,
+						     (GDestroyNotify) cache_tile_info_free);
+	g_queue_init (&pixbuf_cache->tiles_lru);
 }
 
 static void
@@ -158,6 +269,7 @@ ev_pixbuf_cache_finalize (GObject *object)
 		pixbuf_cache->next_job = NULL;
 	}
 
+	g_hash_table_destroy (pixbuf_cache->tiles);
 	g_object_unref (pixbuf_cache->model);
 
 	G_OBJECT_CLASS (ev_pixbuf_cache_parent_class)->finalize (object);
@@ -205,23 +317,68 @@ dispose_cache_job_info (CacheJobInfo *job_info,
 	job_info->points_set = FALSE;
 }
 
+/* Hands the surface of a page that is leaving the cache over to the
+ * process-wide surface cache, so that the page doesn't need to be
+ * rendered again if it's shown again soon.
+ */
 static void
-ev_pixbuf_cache_dispose (GObject *object)
+park_cache_job_info (EvPixbufCache *pixbuf_cache,
+		     CacheJobInfo  *job_info,
+		     gint           page)
 {
-	EvPixbufCache *pixbuf_cache;
-	int i;
+	if (!job_info->surface || !job_info->page_ready || job_info->job)
+		return;
 
-	pixbuf_cache = EV_PIXBUF_CACHE (object);
+	if (page < 0 || page >= ev_document_get_n_pages (pixbuf_cache->document))
+		return;
+
+	ev_surface_cache_add (pixbuf_cache->document, page,
+			      job_info->rotation,
+			      pixbuf_cache->inverted_colors,
+			      job_info->surface);
+	job_info->surface = NULL;
+}
+
+static void
+ev_pixbuf_cache_dispose_all (EvPixbufCache *pixbuf_cache,
+			     gboolean       park)
+{
+	int i, page;
 
+	page = pixbuf_cache->start_page - pixbuf_cache->preload_cache_size;
 	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
+		if (park)
+			park_cache_job_info (pixbuf_cache, pixbuf_cache->prev_job + i, page + i);
 		dispose_cache_job_info (pixbuf_cache->prev_job + i, pixbuf_cache);
-		dispose_cache_job_info (pixbuf_cache->next_job + i, pixbuf_cache);
 	}
 
 	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++) {
+		if (park)
+			park_cache_job_info (pixbuf_cache, pixbuf_cache->job_list + i,
+					     pixbuf_cache->start_page + i);
 		dispose_cache_job_info (pixbuf_cache->job_list + i, pixbuf_cache);
 	}
 
+	page = pixbuf_cache->end_page + 1;
+	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
+		if (park)
+			park_cache_job_info (pixbuf_cache, pixbuf_cache->next_job + i, page + i);
+		dispose_cache_job_info (pixbuf_cache->next_job + i, pixbuf_cache);
+	}
+}
+
+static void
+ev_pixbuf_cache_dispose (GObject *object)
+{
+	EvPixbufCache *pixbuf_cache;
+
+	pixbuf_cache = EV_PIXBUF_CACHE (object);
+
+	if (pixbuf_cache->job_list)
+		ev_pixbuf_cache_dispose_all (pixbuf_cache, TRUE);
+
+	g_hash_table_remove_all (pixbuf_cache->tiles);
+
 	G_OBJECT_CLASS (ev_pixbuf_cache_parent_class)->dispose (object);
 }
 
@@ -276,6 +433,56 @@ set_device_scale_on_surface (cairo_surface_t *surface,
 #endif
 }
 
+static gboolean
+ev_pixbuf_cache_page_is_tiled_for_scale (EvPixbufCache *pixbuf_cache,
+					 gint           page,
+					 gdouble        scale,
+					 gint           rotation)
+{
+	gint  width, height;
+	gint  device_scale;
+	gsize size;
+
+	if (!ev_document_supports_render_area (pixbuf_cache->document))
+		return FALSE;
+
+	device_scale = get_device_scale (pixbuf_cache);
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale * device_scale, rotation,
+					       &width, &height);
+	size = (gsize) height * cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
+
+	return size > pixbuf_cache->max_size / TILED_PAGE_FRACTION;
+}
+
+/* Size of the surface rendered for the whole page, which is a
+ * preview of the page for tiled pages.
+ */
+static void
+get_page_render_size (EvPixbufCache *pixbuf_cache,
+		      gint           page,
+		      gdouble        scale,
+		      gint           rotation,
+		      gint          *width,
+		      gint          *height)
+{
+	gint    device_scale;
+	gdouble factor;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale, rotation,
+					       width, height);
+
+	if (!ev_pixbuf_cache_page_is_tiled_for_scale (pixbuf_cache, page, scale, rotation))
+		return;
+
+	device_scale = get_device_scale (pixbuf_cache);
+	factor = sqrt ((gdouble) (pixbuf_cache->max_size / TILED_PREVIEW_FRACTION) /
+		       ((gdouble) *width * *height * 4 * device_scale * device_scale));
+	*width = MAX (1, (gint) (*width * factor));
+	*height = MAX (1, (gint) (*height * factor));
+}
+
 static void
 copy_job_to_job_info (EvJobRender   *job_render,
 		      CacheJobInfo  *job_info,
@@ -341,6 +548,179 @@ job_finished_cb (EvJob         *job,
 	g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, job_info->region);
 }
 
+static void
+copy_job_to_tile (EvJobRender   *job_render,
+		  CacheTileInfo *tile)
+{
+	EvPixbufCache *pixbuf_cache = tile->pixbuf_cache;
+
+	if (tile->surface) {
+		pixbuf_cache->tiles_size -= get_surface_size (tile->surface);
+		cairo_surface_destroy (tile->surface);
+		tile->surface = NULL;
+	}
+
+	if (job_render->surface) {
+		tile->surface = cairo_surface_reference (job_render->surface);
+		set_device_scale_on_surface (tile->surface, pixbuf_cache->tiles_device_scale);
+		if (pixbuf_cache->inverted_colors)
+			ev_document_misc_invert_surface (tile->surface);
+		pixbuf_cache->tiles_size += get_surface_size (tile->surface);
+	}
+
+	end_tile_job (tile);
+}
+
+static void
+tile_job_finished_cb (EvJob         *job,
+		      CacheTileInfo *tile)
+{
+	EvPixbufCache *pixbuf_cache = tile->pixbuf_cache;
+
+	copy_job_to_tile (EV_JOB_RENDER (job), tile);
+	g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, NULL);
+}
+
+static void
+tile_add_job (EvPixbufCache *pixbuf_cache,
+	      CacheTileInfo *tile)
+{
+	cairo_rectangle_int_t area;
+	gint                  width, height;
+	gint                  device_scale = pixbuf_cache->tiles_device_scale;
+	gint                  tile_size = TILE_SIZE * device_scale;
+
+	if (tile->job)
+		end_tile_job (tile);
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       tile->page,
+					       pixbuf_cache->tiles_scale,
+					       pixbuf_cache->tiles_rotation,
+					       &width, &height);
+	width *= device_scale;
+	height *= device_scale;
+
+	area.x = tile->column * tile_size;
+	area.y = tile->row * tile_size;
+	area.width = MIN (tile_size, width - area.x);
+	area.height = MIN (tile_size, height - area.y);
+
+	tile->job = ev_job_render_new (pixbuf_cache->document,
+				       tile->page,
+				       pixbuf_cache->tiles_rotation,
+				       pixbuf_cache->tiles_scale * device_scale,
+				       width, height);
+	ev_job_render_set_area (EV_JOB_RENDER (tile->job), &area);
+
+	g_signal_connect (tile->job, "finished",
+			  G_CALLBACK (tile_job_finished_cb),
+			  tile);
+	ev_job_scheduler_push_job (tile->job, EV_JOB_PRIORITY_URGENT);
+}
+
+/* Drops all the tiles when they no longer match the current scale,
+ * rotation or device scale.
+ */
+static void
+ev_pixbuf_cache_update_tiles (EvPixbufCache *pixbuf_cache)
+{
+	gdouble scale = ev_document_model_get_scale (pixbuf_cache->model);
+	gint    rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+	gint    device_scale = get_device_scale (pixbuf_cache);
+
+	if (pixbuf_cache->tiles_scale == scale &&
+	    pixbuf_cache->tiles_rotation == rotation &&
+	    pixbuf_cache->tiles_device_scale == device_scale)
+		return;
+
+	g_hash_table_remove_all (pixbuf_cache->tiles);
+
+	pixbuf_cache->tiles_scale = scale;
+	pixbuf_cache->tiles_rotation = rotation;
+	pixbuf_cache->tiles_device_scale = device_scale;
+}
+
+static gboolean
+tile_is_out_of_range (gpointer key,
+		      gpointer value,
+		      gpointer user_data)
+{
+	CacheTileInfo *tile = value;
+	EvPixbufCache *pixbuf_cache = user_data;
+
+	return tile->page < pixbuf_cache->start_page ||
+		tile->page > pixbuf_cache->end_page;
+}
+
+static gint64
+get_frame_counter (EvPixbufCache *pixbuf_cache)
+{
+	GdkFrameClock *frame_clock;
+
+	frame_clock = gtk_widget_get_frame_clock (pixbuf_cache->view);
+
+	return frame_clock ? gdk_frame_clock_get_frame_counter (frame_clock) : -1;
+}
+
+/* The tiles budget is at least twice the size of the tiles needed to
+ * cover the view, so that the visible tiles and the ones around them
+ * always fit, whatever the window size and the device scale.
+ */
+static gsize
+get_tiles_max_size (EvPixbufCache *pixbuf_cache)
+{
+	gint  device_scale = get_device_scale (pixbuf_cache);
+	gint  n_columns, n_rows;
+	gsize visible_size;
+
+	n_columns = gtk_widget_get_allocated_width (pixbuf_cache->view) / TILE_SIZE + 2;
+	n_rows = gtk_widget_get_allocated_height (pixbuf_cache->view) / TILE_SIZE + 2;
+	visible_size = (gsize) n_columns * n_rows *
+		TILE_SIZE * TILE_SIZE * device_scale * device_scale * 4;
+
+	return MAX (pixbuf_cache->max_size, 2 * visible_size);
+}
+
+/* Evicts the least recently drawn tiles until they fit in the tiles
+ * budget. Tiles are sorted by the last time they were drawn, so we
+ * stop at the first tile drawn in the current frame, since it and all
+ * the ones before it are visible.
+ */
+static void
+ev_pixbuf_cache_trim_tiles (EvPixbufCache *pixbuf_cache)
+{
+	gsize  max_size = get_tiles_max_size (pixbuf_cache);
+	gint64 frame = get_frame_counter (pixbuf_cache);
+
+	while (pixbuf_cache->tiles_size > max_size) {
+		CacheTileInfo *tile;
+
+		tile = g_queue_peek_tail (&pixbuf_cache->tiles_lru);
+		if (tile->frame == frame)
+			break;
+
+		g_hash_table_remove (pixbuf_cache->tiles, tile);
+	}
+}
+
+/* Renders the tiles of page again, keeping the current surfaces
+ * until the new ones are ready.
+ */
+static void
+ev_pixbuf_cache_reload_tiles (EvPixbufCache *pixbuf_cache,
+			      gint           page)
+{
+	GHashTableIter iter;
+	CacheTileInfo *tile;
+
+	g_hash_table_iter_init (&iter, pixbuf_cache->tiles);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &tile)) {
+		if (tile->page == page)
+			tile_add_job (pixbuf_cache, tile);
+	}
+}
+
 /* This checks a job to see if the job would generate the right sized pixbuf
  * given a scale.  If it won't, it removes the job and clears it to NULL.
  */
@@ -359,11 +739,11 @@ check_job_size_and_unref (EvPixbufCache *pixbuf_cache,
 
         device_scale = get_device_scale (pixbuf_cache);
 	if (job_info->device_scale == device_scale) {
-		_get_page_size_for_scale_and_rotation (job_info->job->document,
-						       EV_JOB_RENDER (job_info->job)->page,
-						       scale,
-						       EV_JOB_RENDER (job_info->job)->rotation,
-						       &width, &height);
+		get_page_render_size (pixbuf_cache,
+				      EV_JOB_RENDER (job_info->job)->page,
+				      scale,
+				      EV_JOB_RENDER (job_info->job)->rotation,
+				      &width, &height);
 		if (width * device_scale == EV_JOB_RENDER (job_info->job)->target_width &&
 		    height * device_scale == EV_JOB_RENDER (job_info->job)->target_height)
 			return;
@@ -393,6 +773,7 @@ move_one_job (CacheJobInfo  *job_info,
 
 	if (page < (start_page - new_preload_cache_size) ||
 	    page > (end_page + new_preload_cache_size)) {
+		park_cache_job_info (pixbuf_cache, job_info, page);
 		dispose_cache_job_info (job_info, pixbuf_cache);
 		return;
 	}
@@ -438,9 +819,9 @@ ev_pixbuf_cache_get_page_size (EvPixbufCache *pixbuf_cache,
 {
 	gint width, height;
 
-	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
-					       page_index, scale, rotation,
-					       &width, &height);
+	get_page_render_size (pixbuf_cache,
+			      page_index, scale, rotation,
+			      &width, &height);
 	return height * cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
 }
 
@@ -673,6 +1054,7 @@ add_job (EvPixbufCache  *pixbuf_cache,
 	 EvJobPriority   priority)
 {
 	job_info->device_scale = get_device_scale (pixbuf_cache);
+	job_info->rotation = rotation;
 	job_info->page_ready = FALSE;
 
 	if (job_info->region)
@@ -688,7 +1070,9 @@ add_job (EvPixbufCache  *pixbuf_cache,
 					   width * job_info->device_scale,
                                            height * job_info->device_scale);
 
-	if (new_selection_surface_needed (pixbuf_cache, job_info, page, scale)) {
+	/* Selections of tiled pages are drawn from the selection region */
+	if (new_selection_surface_needed (pixbuf_cache, job_info, page, scale) &&
+	    !ev_pixbuf_cache_page_is_tiled_for_scale (pixbuf_cache, page, scale, rotation)) {
 		GdkColor text, base;
 
 		get_selection_colors (EV_VIEW (pixbuf_cache->view), &text, &base);
@@ -714,13 +1098,14 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 {
 	gint device_scale = get_device_scale (pixbuf_cache);
 	gint width, height;
+	cairo_surface_t *surface;
 
 	if (job_info->job)
 		return;
 
-	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
-					       page, scale, rotation,
-					       &width, &height);
+	get_page_render_size (pixbuf_cache,
+			      page, scale, rotation,
+			      &width, &height);
 
 	if (job_info->surface &&
 	    job_info->device_scale == device_scale &&
@@ -728,8 +1113,28 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 	    cairo_image_surface_get_height (job_info->surface) == height * device_scale)
 		return;
 
+	/* The page might have been rendered recently by this or another view */
+	surface = ev_surface_cache_take (pixbuf_cache->document, page,
+					 width * device_scale, height * device_scale,
+					 rotation, pixbuf_cache->inverted_colors);
+	if (surface) {
+		park_cache_job_info (pixbuf_cache, job_info, page);
+		if (job_info->surface)
+			cairo_surface_destroy (job_info->surface);
+
+		job_info->surface = surface;
+		set_device_scale_on_surface (job_info->surface, device_scale);
+		job_info->device_scale = device_scale;
+		job_info->rotation = rotation;
+		job_info->page_ready = TRUE;
+		g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, job_info->region);
+
+		return;
+	}
+
 	/* Free old surfaces for non visible pages */
 	if (priority == EV_JOB_PRIORITY_LOW) {
+		park_cache_job_info (pixbuf_cache, job_info, page);
 		if (job_info->surface) {
 			cairo_surface_destroy (job_info->surface);
 			job_info->surface = NULL;
@@ -852,6 +1257,10 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 	 * mercilessly. */
 	ev_pixbuf_cache_update_range (pixbuf_cache, start_page, end_page, rotation, scale);
 
+	/* Tiles are only kept for the visible pages */
+	ev_pixbuf_cache_update_tiles (pixbuf_cache);
+	g_hash_table_foreach_remove (pixbuf_cache->tiles, tile_is_out_of_range, pixbuf_cache);
+
 	/* Then, we update the current jobs to see if any of them are the wrong
 	 * size, we remove them if we need to. */
 	ev_pixbuf_cache_clear_job_sizes (pixbuf_cache, scale);
@@ -868,7 +1277,8 @@ void
 ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 				     gboolean       inverted_colors)
 {
-	gint i;
+	GList *l;
+	gint   i;
 
 	if (pixbuf_cache->inverted_colors == inverted_colors)
 		return;
@@ -894,6 +1304,13 @@ ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
 	}
+
+	for (l = pixbuf_cache->tiles_lru.head; l; l = g_list_next (l)) {
+		CacheTileInfo *tile = l->data;
+
+		if (tile->surface)
+			ev_document_misc_invert_surface (tile->surface);
+	}
 }
 
 cairo_surface_t *
@@ -919,6 +1336,106 @@ ev_pixbuf_cache_get_surface (EvPixbufCache *pixbuf_cache,
 	return job_info->surface;
 }
 
+/**
+ * ev_pixbuf_cache_page_is_tiled:
+ * @pixbuf_cache: an #EvPixbufCache
+ * @page: a page index
+ *
+ * Whether @page is too large at the current scale to be rendered at
+ * once. For tiled pages, ev_pixbuf_cache_get_surface() returns a low
+ * resolution preview of the page, and the page contents should be
+ * drawn with ev_pixbuf_cache_get_tile_surface().
+ *
+ * Returns: %TRUE if @page is rendered in tiles
+ */
+gboolean
+ev_pixbuf_cache_page_is_tiled (EvPixbufCache *pixbuf_cache,
+			       gint           page)
+{
+	return ev_pixbuf_cache_page_is_tiled_for_scale (pixbuf_cache, page,
+							ev_document_model_get_scale (pixbuf_cache->model),
+							ev_document_model_get_rotation (pixbuf_cache->model));
+}
+
+/**
+ * ev_pixbuf_cache_get_tile_size:
+ * @pixbuf_cache: an #EvPixbufCache
+ *
+ * Returns: the size in widget pixels of the tiles of tiled pages
+ */
+gint
+ev_pixbuf_cache_get_tile_size (EvPixbufCache *pixbuf_cache)
+{
+	return TILE_SIZE;
+}
+
+/**
+ * ev_pixbuf_cache_get_tile_surface:
+ * @pixbuf_cache: an #EvPixbufCache
+ * @page: a visible page index
+ * @column: the tile column
+ * @row: the tile row
+ *
+ * Gets the tile at @column and @row of @page, rendered at the current
+ * scale. If the tile is not ready yet, it's rendered and the
+ * job-finished signal is emitted once it's available.
+ *
+ * Returns: (transfer none): the tile surface, or %NULL
+ */
+cairo_surface_t *
+ev_pixbuf_cache_get_tile_surface (EvPixbufCache *pixbuf_cache,
+				  gint           page,
+				  gint           column,
+				  gint           row)
+{
+	CacheTileInfo  key;
+	CacheTileInfo *tile;
+	gint           width, height;
+
+	if (page < pixbuf_cache->start_page || page > pixbuf_cache->end_page)
+		return NULL;
+
+	ev_pixbuf_cache_update_tiles (pixbuf_cache);
+
+	key.page = page;
+	key.column = column;
+	key.row = row;
+	tile = g_hash_table_lookup (pixbuf_cache->tiles, &key);
+	if (tile) {
+		/* Most recently drawn tiles are kept at the head */
+		g_queue_unlink (&pixbuf_cache->tiles_lru, tile->link);
+		g_queue_push_head_link (&pixbuf_cache->tiles_lru, tile->link);
+		tile->frame = get_frame_counter (pixbuf_cache);
+
+		return tile->surface;
+	}
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page,
+					       pixbuf_cache->tiles_scale,
+					       pixbuf_cache->tiles_rotation,
+					       &width, &height);
+	if (column < 0 || row < 0 ||
+	    column * TILE_SIZE >= width || row * TILE_SIZE >= height)
+		return NULL;
+
+	ev_pixbuf_cache_trim_tiles (pixbuf_cache);
+
+	tile = g_slice_new0 (CacheTileInfo);
+	tile->pixbuf_cache = pixbuf_cache;
+	tile->page = page;
+	tile->column = column;
+	tile->row = row;
+	tile->frame = get_frame_counter (pixbuf_cache);
+	g_queue_push_head (&pixbuf_cache->tiles_lru, tile);
+	tile->link = pixbuf_cache->tiles_lru.head;
+	g_hash_table_insert (pixbuf_cache->tiles, tile, tile);
+
+	tile_add_job (pixbuf_cache, tile);
+
+	return NULL;
+}
+
 static gboolean
 new_selection_surface_needed (EvPixbufCache *pixbuf_cache,
 			      CacheJobInfo  *job_info,
@@ -974,19 +1491,26 @@ clear_selection_region_if_needed (EvPixbufCache *pixbuf_cache,
 void
 ev_pixbuf_cache_clear (EvPixbufCache *pixbuf_cache)
 {
-	int i;
+	g_hash_table_remove_all (pixbuf_cache->tiles);
 
 	if (!pixbuf_cache->job_list)
 		return;
 
-	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
-		dispose_cache_job_info (pixbuf_cache->prev_job + i, pixbuf_cache);
-		dispose_cache_job_info (pixbuf_cache->next_job + i, pixbuf_cache);
-	}
+	ev_pixbuf_cache_dispose_all (pixbuf_cache, TRUE);
+}
 
-	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++) {
-		dispose_cache_job_info (pixbuf_cache->job_list + i, pixbuf_cache);
-	}
+/* Clears the cache of jobs and pixbufs, and drops the renderings of
+ * the document kept in the surface cache, since they are outdated.
+ */
+void
+ev_pixbuf_cache_reload (EvPixbufCache *pixbuf_cache)
+{
+	g_hash_table_remove_all (pixbuf_cache->tiles);
+
+	if (pixbuf_cache->job_list)
+		ev_pixbuf_cache_dispose_all (pixbuf_cache, FALSE);
+
+	ev_surface_cache_remove_document (pixbuf_cache->document);
 }
 
 
@@ -1048,6 +1572,10 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 	if (!job_info->points_set)
 		return NULL;
 
+	/* The selection of tiled pages is drawn from the selection region */
+	if (ev_pixbuf_cache_page_is_tiled (pixbuf_cache, page))
+		return NULL;
+
 	/* If we have a running job, we just return what we have under the
 	 * assumption that it'll be updated later and we can scale it as need
 	 * be */
@@ -1060,7 +1588,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 
 	/* Finally, we see if the two scales are the same, and get a new pixbuf
 	 * if needed.  We do this synchronously for now.  At some point, we
-	 * _should_ be able to get rid of the doc_mutex, so the synchronicity
+	 * _should_ be able to get rid of the document lock, so the synchronicity
 	 * doesn't kill us.  Rendering a few glyphs should really be fast.
 	 */
 	if (ev_rect_cmp (&(job_info->target_points), &(job_info->selection_points))) {
@@ -1071,7 +1599,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 		gint width, height;
 
 		/* we need to get a new selection pixbuf */
-		ev_document_doc_mutex_lock ();
+		ev_document_render_lock (pixbuf_cache->document);
 		if (job_info->selection_points.x1 < 0) {
 			g_assert (job_info->selection == NULL);
 			old_points = NULL;
@@ -1101,7 +1629,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 		job_info->selection_points = job_info->target_points;
 		job_info->selection_scale = scale * job_info->device_scale;
 		g_object_unref (rc);
-		ev_document_doc_mutex_unlock ();
+		ev_document_render_unlock (pixbuf_cache->document);
 	}
 	return job_info->selection;
 }
@@ -1144,7 +1672,7 @@ ev_pixbuf_cache_get_selection_region (EvPixbufCache *pixbuf_cache,
 		EvPage *ev_page;
 		gint width, height;
 
-		ev_document_doc_mutex_lock ();
+		ev_document_render_lock (pixbuf_cache->document);
 		ev_page = ev_document_get_page (pixbuf_cache->document, page);
 
 		_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
@@ -1164,7 +1692,7 @@ ev_pixbuf_cache_get_selection_region (EvPixbufCache *pixbuf_cache,
 		job_info->selection_region_points = job_info->target_points;
 		job_info->selection_region_scale = scale;
 		g_object_unref (rc);
-		ev_document_doc_mutex_unlock ();
+		ev_document_render_unlock (pixbuf_cache->document);
 	}
 	return job_info->selection_region && !cairo_region_is_empty(job_info->selection_region) ?
                 job_info->selection_region : NULL;
@@ -1362,13 +1890,18 @@ ev_pixbuf_cache_reload_page (EvPixbufCache  *pixbuf_cache,
 	CacheJobInfo *job_info;
         gint width, height;
 
+	/* Previous renderings of the page are no longer valid */
+	ev_surface_cache_remove_page (pixbuf_cache->document, page);
+
 	job_info = find_job_cache (pixbuf_cache, page);
 	if (job_info == NULL)
 		return;
 
-	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
-					       page, scale, rotation,
-					       &width, &height);
+	ev_pixbuf_cache_reload_tiles (pixbuf_cache, page);
+
+	get_page_render_size (pixbuf_cache,
+			      page, scale, rotation,
+			      &width, &height);
         add_job (pixbuf_cache, job_info, region,
 		 width, height, page, rotation, scale,
 		 EV_JOB_PRIORITY_URGENT);
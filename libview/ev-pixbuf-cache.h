@@ -69,6 +69,7 @@ void           ev_pixbuf_cache_set_page_range       (EvPixbufCache *pixbuf_cache
 cairo_surface_t *ev_pixbuf_cache_get_surface        (EvPixbufCache *pixbuf_cache,
 						     gint           page);
 void           ev_pixbuf_cache_clear                (EvPixbufCache *pixbuf_cache);
+void           ev_pixbuf_cache_reload               (EvPixbufCache *pixbuf_cache);
 void           ev_pixbuf_cache_style_changed        (EvPixbufCache *pixbuf_cache);
 void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
 						     cairo_region_t *region,
@@ -77,6 +78,14 @@ void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
 						     gdouble         scale);
 void           ev_pixbuf_cache_set_inverted_colors  (EvPixbufCache *pixbuf_cache,
 						     gboolean       inverted_colors);
+/* Tiles */
+gboolean       ev_pixbuf_cache_page_is_tiled        (EvPixbufCache *pixbuf_cache,
+						     gint           page);
+gint           ev_pixbuf_cache_get_tile_size        (EvPixbufCache *pixbuf_cache);
+cairo_surface_t *ev_pixbuf_cache_get_tile_surface   (EvPixbufCache *pixbuf_cache,
+						     gint           page,
+						     gint           column,
+						     gint           row);
 /* Selection */
 cairo_surface_t *ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 							gint             page,
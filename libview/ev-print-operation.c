@@ -385,7 +385,7 @@ typedef struct _EvPrintOperationExportClass EvPrintOperationExportClass;
 static GType    ev_print_operation_export_get_type (void) G_GNUC_CONST;
 
 static void     ev_print_operation_export_begin    (EvPrintOperationExport *export);
-static gboolean export_print_page                  (EvPrintOperationExport *export);
+static gboolean export_print_add_page              (EvPrintOperationExport *export);
 static void     export_cancel                      (EvPrintOperationExport *export);
 
 struct _EvPrintOperationExport {
@@ -410,14 +410,12 @@ struct _EvPrintOperationExport {
 	gchar *job_name;
 	gboolean embed_page_setup;
 
-	guint idle_id;
-	
 	/* Context */
 	EvFileExporterContext fc;
 	gint n_pages_to_print;
 	gint uncollated_copies;
 	gint collated_copies;
-	gint uncollated, collated, total;
+	gint uncollated, collated;
 
 	gint sheet, page_count;
 
@@ -717,7 +715,7 @@ export_print_inc_page (EvPrintOperationExport *export)
 	do {
 		export->page += export->inc;
 
-		/* note: when NOT collating, page_count is increased in export_print_page */
+		/* note: when NOT collating, page_count is increased in export_print_add_page */
 		if (export->collate) {
 			export->page_count++;
 			export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
@@ -734,9 +732,6 @@ export_print_inc_page (EvPrintOperationExport *export)
 				if (export->pages_per_sheet > 1 && export->collate == 1 &&
 				    (export->page_count - 1) % export->pages_per_sheet != 0) {
 
-					EvPrintOperation *op = EV_PRINT_OPERATION (export);
-					ev_document_doc_mutex_lock ();
-
 					/* keep track of all blanks but only actualise those
 					 * which are in the current odd / even sheet set */
 
@@ -744,9 +739,8 @@ export_print_inc_page (EvPrintOperationExport *export)
 					if (export->page_set == GTK_PAGE_SET_ALL ||
 						(export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0) ||
 						(export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1) ) {
-						ev_file_exporter_end_page (EV_FILE_EXPORTER (op->document));
+						ev_job_export_batch_end_page (EV_JOB_EXPORT_BATCH (export->job_export));
 					}
-					ev_document_doc_mutex_unlock ();
 					export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
 				}
 
@@ -951,58 +945,66 @@ export_print_done (EvPrintOperationExport *export)
 }
 
 static void
-export_print_page_idle_finished (EvPrintOperationExport *export)
+export_job_updated (EvJobExportBatch       *job,
+		    gint                    n_exported,
+		    EvPrintOperationExport *export)
 {
-	export->idle_id = 0;
+	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	gint              n_pages;
+
+	n_pages = ev_job_export_batch_get_n_pages (job);
+	ev_print_operation_update_status (op, n_exported, n_pages,
+					  n_exported / (gdouble)MAX (n_pages, 1));
 }
 
 static void
-export_job_finished (EvJobExport            *job,
+export_job_finished (EvJobExportBatch       *job,
 		     EvPrintOperationExport *export)
 {
 	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	gint              n_pages;
 
-	if (export->pages_per_sheet == 1 ||
-	   ( export->page_count % export->pages_per_sheet == 0 &&
-	   ( export->page_set == GTK_PAGE_SET_ALL ||
-	   ( export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0 ) ||
-	   ( export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1 ) ) ) ) {
+	ev_document_lock (op->document);
+	ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
+	ev_document_unlock (op->document);
 
-		ev_document_doc_mutex_lock ();
-		ev_file_exporter_end_page (EV_FILE_EXPORTER (op->document));
-		ev_document_doc_mutex_unlock ();
-	}
+	close (export->fd);
+	export->fd = -1;
+
+	n_pages = ev_job_export_batch_get_n_pages (job);
+	ev_print_operation_update_status (op, n_pages, n_pages, 1.0);
 
-	/* Reschedule */
-	export->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-					   (GSourceFunc)export_print_page,
-					   export,
-					   (GDestroyNotify)export_print_page_idle_finished);
+	export_print_done (export);
 }
 
 static void
-export_job_cancelled (EvJobExport            *job,
+export_job_cancelled (EvJobExportBatch       *job,
 		      EvPrintOperationExport *export)
 {
 	export_cancel (export);
 }
 
+static void
+export_disconnect_job (EvPrintOperationExport *export)
+{
+	g_signal_handlers_disconnect_by_func (export->job_export,
+					      export_job_updated,
+					      export);
+	g_signal_handlers_disconnect_by_func (export->job_export,
+					      export_job_finished,
+					      export);
+	g_signal_handlers_disconnect_by_func (export->job_export,
+					      export_job_cancelled,
+					      export);
+}
+
 static void
 export_cancel (EvPrintOperationExport *export)
 {
 	EvPrintOperation *op = EV_PRINT_OPERATION (export);
 
-	if (export->idle_id > 0)
-		g_source_remove (export->idle_id);
-	export->idle_id = 0;
-
 	if (export->job_export) {
-		g_signal_handlers_disconnect_by_func (export->job_export,
-						      export_job_finished,
-						      export);
-		g_signal_handlers_disconnect_by_func (export->job_export,
-						      export_job_cancelled,
-						      export);
+		export_disconnect_job (export);
 		g_object_unref (export->job_export);
 		export->job_export = NULL;
 	}
@@ -1019,25 +1021,14 @@ export_cancel (EvPrintOperationExport *export)
 	ev_print_operation_export_run_next (export);
 }
 
-static void
-update_progress (EvPrintOperationExport *export)
-{
-	EvPrintOperation *op = EV_PRINT_OPERATION (export);
-
-	ev_print_operation_update_status (op, export->total,
-					  export->n_pages_to_print,
-					  export->total / (gdouble)export->n_pages_to_print);
-}
-
+/* Adds the next page to print to the export job, with the begin and end
+ * of its sheet when needed. Returns FALSE when there are no more pages.
+ */
 static gboolean
-export_print_page (EvPrintOperationExport *export)
+export_print_add_page (EvPrintOperationExport *export)
 {
-	EvPrintOperation *op = EV_PRINT_OPERATION (export);
-
-	if (!export->temp_file)
-		return FALSE; /* cancelled */
+	EvJobExportBatch *job = EV_JOB_EXPORT_BATCH (export->job_export);
 
-	export->total++;
 	export->collated++;
 
 	/* note: when collating, page_count is increased in export_print_inc_page */
@@ -1048,18 +1039,8 @@ export_print_page (EvPrintOperationExport *export)
 
 	if (export->collated == export->collated_copies) {
 		export->collated = 0;
-		if (!export_print_inc_page (export)) {
-			ev_document_doc_mutex_lock ();
-			ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
-			ev_document_doc_mutex_unlock ();
-
-			close (export->fd);
-			export->fd = -1;
-			update_progress (export);
-			export_print_done (export);
-
+		if (!export_print_inc_page (export))
 			return FALSE;
-		}
 	}
 
 	/* we're not collating and we've reached a sheet from the wrong sheet set */
@@ -1075,19 +1056,8 @@ export_print_page (EvPrintOperationExport *export)
 			if (export->collated == export->collated_copies) {
 				export->collated = 0;
 
-				if (!export_print_inc_page (export)) {
-					ev_document_doc_mutex_lock ();
-					ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
-					ev_document_doc_mutex_unlock ();
-
-					close (export->fd);
-					export->fd = -1;
-
-					update_progress (export);
-
-					export_print_done (export);
+				if (!export_print_inc_page (export))
 					return FALSE;
-				}
 			}
 
 		} while ((export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 != 0) ||
@@ -1100,27 +1070,20 @@ export_print_page (EvPrintOperationExport *export)
 	    (export->page_set == GTK_PAGE_SET_ALL ||
 	    (export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0) ||
 	    (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1)))) {
-		ev_document_doc_mutex_lock ();
-		ev_file_exporter_begin_page (EV_FILE_EXPORTER (op->document));
-		ev_document_doc_mutex_unlock ();
+		ev_job_export_batch_begin_page (job);
 	}
 
-	if (!export->job_export) {
-		export->job_export = ev_job_export_new (op->document);
-		g_signal_connect (export->job_export, "finished",
-				  G_CALLBACK (export_job_finished),
-				  (gpointer)export);
-		g_signal_connect (export->job_export, "cancelled",
-				  G_CALLBACK (export_job_cancelled),
-				  (gpointer)export);
-	}
+	ev_job_export_batch_add_page (job, export->page);
 
-	ev_job_export_set_page (EV_JOB_EXPORT (export->job_export), export->page);
-	ev_job_scheduler_push_job (export->job_export, EV_JOB_PRIORITY_NONE);
+	if (export->pages_per_sheet == 1 ||
+	   ( export->page_count % export->pages_per_sheet == 0 &&
+	   ( export->page_set == GTK_PAGE_SET_ALL ||
+	   ( export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0 ) ||
+	   ( export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1 ) ) ) ) {
+		ev_job_export_batch_end_page (job);
+	}
 
-	update_progress (export);
-	
-	return FALSE;
+	return TRUE;
 }
 
 static void
@@ -1131,14 +1094,26 @@ ev_print_operation_export_begin (EvPrintOperationExport *export)
 	if (!export->temp_file)
 		return; /* cancelled */
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (op->document);
 	ev_file_exporter_begin (EV_FILE_EXPORTER (op->document), &export->fc);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (op->document);
 
-	export->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-					   (GSourceFunc)export_print_page,
-					   export,
-					   (GDestroyNotify)export_print_page_idle_finished);	
+	/* The whole page sequence is known up front, so it is exported by
+	 * a single job instead of a job per page.
+	 */
+	export->job_export = ev_job_export_batch_new (op->document);
+	while (export_print_add_page (export));
+
+	g_signal_connect (export->job_export, "updated",
+			  G_CALLBACK (export_job_updated),
+			  (gpointer)export);
+	g_signal_connect (export->job_export, "finished",
+			  G_CALLBACK (export_job_finished),
+			  (gpointer)export);
+	g_signal_connect (export->job_export, "cancelled",
+			  G_CALLBACK (export_job_cancelled),
+			  (gpointer)export);
+	ev_job_scheduler_push_job (export->job_export, EV_JOB_PRIORITY_NONE);
 }
 
 static EvFileExporterFormat
@@ -1428,11 +1403,6 @@ ev_print_operation_export_finalize (GObject *object)
 {
 	EvPrintOperationExport *export = EV_PRINT_OPERATION_EXPORT (object);
 
-	if (export->idle_id > 0) {
-		g_source_remove (export->idle_id);
-		export->idle_id = 0;
-	}
-
 	if (export->fd != -1) {
 		close (export->fd);
 		export->fd = -1;
@@ -1458,12 +1428,7 @@ ev_print_operation_export_finalize (GObject *object)
 	if (export->job_export) {
 		if (!ev_job_is_finished (export->job_export))
 			ev_job_cancel (export->job_export);
-		g_signal_handlers_disconnect_by_func (export->job_export,
-						      export_job_finished,
-						      export);
-		g_signal_handlers_disconnect_by_func (export->job_export,
-						      export_job_cancelled,
-						      export);
+		export_disconnect_job (export);
 		g_object_unref (export->job_export);
 		export->job_export = NULL;
 	}
@@ -1758,7 +1723,7 @@ print_job_finished (EvJobPrint            *job,
 static gboolean
 draw_page_finish_idle (EvPrintOperationPrint *print)
 {
-        if (ev_job_scheduler_get_running_thread_job () == print->job_print)
+        if (ev_job_scheduler_is_job_running (print->job_print))
                 return TRUE;
 
         gtk_print_operation_draw_page_finish (print->op);
@@ -1775,7 +1740,7 @@ print_job_cancelled (EvJobPrint            *job,
          * print operation. If the job is still
          * running, wait until it finishes.
          */
-        if (ev_job_scheduler_get_running_thread_job () == print->job_print)
+        if (ev_job_scheduler_is_job_running (print->job_print))
                 g_idle_add ((GSourceFunc)draw_page_finish_idle, print);
         else
                 gtk_print_operation_draw_page_finish (print->op);
@@ -0,0 +1,481 @@
+/* ev-surface-cache.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "ev-debug.h"
+#include "ev-trace.h"
+#include "ev-surface-cache.h"
+
+/* Process-wide cache of rendered pages that are no longer used by any
+ * view. Views hand their surfaces over to the cache when a page leaves
+ * their preload range, and take them back when the page is needed again
+ * at the same size, so that going back to recently seen pages doesn't
+ * require rendering them again. Surfaces are owned by either a view or
+ * the cache, never by both, since views modify them in place.
+ *
+ * Entries are keyed by document, page, surface size (which depends on
+ * the scale), rotation and whether colors are inverted, and evicted in
+ * LRU order when the total size exceeds the cache budget.
+ *
+ * The cache also keeps a small preview of the pages rendered by the
+ * views, that thumbnails are made from instead of rendering the pages
+ * again. Previews are never modified, so unlike pages they are shared
+ * by the cache and their users.
+ */
+
+#define DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+
+typedef struct _EvSurfaceCacheEntry {
+	EvDocument      *document;
+	gint             page;
+	gint             width;
+	gint             height;
+	gint             rotation;
+	gboolean         inverted;
+	/* Previews are looked up regardless of their size, their
+	 * width and height are always 0.
+	 */
+	gboolean         preview;
+
+	cairo_surface_t *surface;
+	gsize            size;
+
+	/* Link in the LRU list */
+	GList           *link;
+} EvSurfaceCacheEntry;
+
+G_LOCK_DEFINE_STATIC (surface_cache);
+static GHashTable *entries = NULL;
+/* Most recently added entries are at the head */
+static GQueue      lru = G_QUEUE_INIT;
+/* Documents with cached surfaces, and the number of entries of each */
+static GHashTable *documents = NULL;
+static gsize       cache_size = 0;
+static gsize       cache_max_size = DEFAULT_MAX_SIZE;
+static guint64     n_hits = 0;
+static guint64     n_misses = 0;
+static guint64     n_evictions = 0;
+
+static void document_finalized (gpointer  data,
+				GObject  *document);
+
+static guint
+ev_surface_cache_entry_hash (gconstpointer key)
+{
+	const EvSurfaceCacheEntry *entry = key;
+	guint                      hash;
+
+	hash = g_direct_hash (entry->document);
+	hash = hash * 31 + entry->page;
+	hash = hash * 31 + entry->width;
+	hash = hash * 31 + entry->height;
+	hash = hash * 31 + entry->rotation;
+
+	hash = hash * 2 + (entry->inverted ? 1 : 0);
+
+	return hash * 2 + (entry->preview ? 1 : 0);
+}
+
+static gboolean
+ev_surface_cache_entry_equal (gconstpointer a,
+			      gconstpointer b)
+{
+	const EvSurfaceCacheEntry *entry_a = a;
+	const EvSurfaceCacheEntry *entry_b = b;
+
+	return entry_a->document == entry_b->document &&
+		entry_a->page == entry_b->page &&
+		entry_a->width == entry_b->width &&
+		entry_a->height == entry_b->height &&
+		entry_a->rotation == entry_b->rotation &&
+		!entry_a->inverted == !entry_b->inverted &&
+		!entry_a->preview == !entry_b->preview;
+}
+
+/* Must be called with the lock held. The entry is freed, but the
+ * surface is only destroyed if destroy_surface is %TRUE.
+ */
+static void
+ev_surface_cache_remove_entry_unlocked (EvSurfaceCacheEntry *entry,
+					gboolean             destroy_surface)
+{
+	guint n_entries;
+
+	g_hash_table_remove (entries, entry);
+	g_queue_delete_link (&lru, entry->link);
+	cache_size -= entry->size;
+
+	n_entries = GPOINTER_TO_UINT (g_hash_table_lookup (documents, entry->document));
+	if (n_entries > 1) {
+		g_hash_table_insert (documents, entry->document, GUINT_TO_POINTER (n_entries - 1));
+	} else {
+		g_hash_table_remove (documents, entry->document);
+		g_object_weak_unref (G_OBJECT (entry->document), document_finalized, NULL);
+	}
+
+	if (destroy_surface)
+		cairo_surface_destroy (entry->surface);
+	g_slice_free (EvSurfaceCacheEntry, entry);
+}
+
+static void
+ev_surface_cache_trim_unlocked (gsize max_size)
+{
+	while (cache_size > max_size) {
+		EvSurfaceCacheEntry *entry;
+
+		entry = g_queue_peek_tail (&lru);
+		ev_debug_message (DEBUG_JOBS, "evicting page %d (%" G_GSIZE_FORMAT " bytes)",
+				  entry->page, entry->size);
+		ev_trace_instant ("cache", "surface cache eviction", "page", entry->page);
+		ev_surface_cache_remove_entry_unlocked (entry, TRUE);
+		n_evictions++;
+	}
+}
+
+static void
+ev_surface_cache_remove_matching_unlocked (EvDocument *document,
+					   gint        page)
+{
+	GList *l = lru.head;
+
+	while (l) {
+		EvSurfaceCacheEntry *entry = l->data;
+
+		l = g_list_next (l);
+		if (entry->document == document && (page < 0 || entry->page == page))
+			ev_surface_cache_remove_entry_unlocked (entry, TRUE);
+	}
+}
+
+static void
+document_finalized (gpointer  data,
+		    GObject  *document)
+{
+	GList *l;
+
+	G_LOCK (surface_cache);
+
+	/* The weak reference is gone already, so remove the entries by
+	 * hand instead of using ev_surface_cache_remove_entry_unlocked().
+	 */
+	l = lru.head;
+	while (l) {
+		EvSurfaceCacheEntry *entry = l->data;
+
+		l = g_list_next (l);
+		if ((GObject *) entry->document != document)
+			continue;
+
+		g_hash_table_remove (entries, entry);
+		g_queue_delete_link (&lru, entry->link);
+		cache_size -= entry->size;
+		cairo_surface_destroy (entry->surface);
+		g_slice_free (EvSurfaceCacheEntry, entry);
+	}
+	g_hash_table_remove (documents, document);
+
+	G_UNLOCK (surface_cache);
+}
+
+static void
+ev_surface_cache_ensure_init_unlocked (void)
+{
+	if (entries)
+		return;
+
+	entries = g_hash_table_new (ev_surface_cache_entry_hash,
+				    ev_surface_cache_entry_equal);
+	documents = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static void
+ev_surface_cache_insert (EvSurfaceCacheEntry *entry)
+{
+	EvSurfaceCacheEntry *old_entry;
+	guint                n_entries;
+
+	G_LOCK (surface_cache);
+
+	if (entry->size > cache_max_size) {
+		G_UNLOCK (surface_cache);
+		cairo_surface_destroy (entry->surface);
+		g_slice_free (EvSurfaceCacheEntry, entry);
+
+		return;
+	}
+
+	ev_surface_cache_ensure_init_unlocked ();
+
+	old_entry = g_hash_table_lookup (entries, entry);
+	if (old_entry)
+		ev_surface_cache_remove_entry_unlocked (old_entry, TRUE);
+
+	ev_surface_cache_trim_unlocked (cache_max_size - entry->size);
+
+	g_hash_table_insert (entries, entry, entry);
+	g_queue_push_head (&lru, entry);
+	entry->link = lru.head;
+	cache_size += entry->size;
+
+	n_entries = GPOINTER_TO_UINT (g_hash_table_lookup (documents, entry->document));
+	if (n_entries == 0)
+		g_object_weak_ref (G_OBJECT (entry->document), document_finalized, NULL);
+	g_hash_table_insert (documents, entry->document, GUINT_TO_POINTER (n_entries + 1));
+
+	G_UNLOCK (surface_cache);
+}
+
+/**
+ * ev_surface_cache_add:
+ * @document: the #EvDocument @surface was rendered from
+ * @page: the page index
+ * @rotation: the rotation @surface was rendered with
+ * @inverted: whether the colors of @surface are inverted
+ * @surface: an image surface
+ *
+ * Hands @surface over to the cache. The caller's reference is
+ * transferred to the cache, and @surface must not be used nor
+ * modified by the caller afterwards.
+ */
+void
+ev_surface_cache_add (EvDocument      *document,
+		      gint             page,
+		      gint             rotation,
+		      gboolean         inverted,
+		      cairo_surface_t *surface)
+{
+	EvSurfaceCacheEntry *entry;
+
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+	g_return_if_fail (surface != NULL);
+
+	entry = g_slice_new0 (EvSurfaceCacheEntry);
+	entry->document = document;
+	entry->page = page;
+	entry->width = cairo_image_surface_get_width (surface);
+	entry->height = cairo_image_surface_get_height (surface);
+	entry->rotation = rotation;
+	entry->inverted = inverted;
+	entry->surface = surface;
+	entry->size = cairo_image_surface_get_stride (surface) * entry->height;
+
+	ev_surface_cache_insert (entry);
+}
+
+/**
+ * ev_surface_cache_take:
+ * @document: an #EvDocument
+ * @page: the page index
+ * @width: the surface width in device pixels
+ * @height: the surface height in device pixels
+ * @rotation: the page rotation
+ * @inverted: whether colors should be inverted
+ *
+ * Looks for a rendering of @page matching the given parameters and
+ * removes it from the cache.
+ *
+ * Returns: (transfer full): the cached surface, or %NULL
+ */
+cairo_surface_t *
+ev_surface_cache_take (EvDocument *document,
+		       gint        page,
+		       gint        width,
+		       gint        height,
+		       gint        rotation,
+		       gboolean    inverted)
+{
+	EvSurfaceCacheEntry  key;
+	EvSurfaceCacheEntry *entry;
+	cairo_surface_t     *surface = NULL;
+
+	key.document = document;
+	key.page = page;
+	key.width = width;
+	key.height = height;
+	key.rotation = rotation;
+	key.inverted = inverted;
+	key.preview = FALSE;
+
+	G_LOCK (surface_cache);
+
+	entry = entries ? g_hash_table_lookup (entries, &key) : NULL;
+	if (entry) {
+		surface = entry->surface;
+		ev_surface_cache_remove_entry_unlocked (entry, FALSE);
+		n_hits++;
+	} else {
+		n_misses++;
+	}
+
+	G_UNLOCK (surface_cache);
+
+	ev_debug_message (DEBUG_JOBS, "page %d %s", page, surface ? "hit" : "miss");
+	ev_trace_instant ("cache", surface ? "surface cache hit" : "surface cache miss",
+			  "page", page);
+
+	return surface;
+}
+
+/**
+ * ev_surface_cache_add_preview:
+ * @document: the #EvDocument @surface was rendered from
+ * @page: the page index
+ * @rotation: the rotation @surface was rendered with
+ * @surface: an image surface, with colors not inverted
+ *
+ * Replaces the preview of @page with @surface. The caller's reference
+ * is transferred to the cache, and @surface must not be modified
+ * afterwards, since other threads can be reading it.
+ */
+void
+ev_surface_cache_add_preview (EvDocument      *document,
+			      gint             page,
+			      gint             rotation,
+			      cairo_surface_t *surface)
+{
+	EvSurfaceCacheEntry *entry;
+
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+	g_return_if_fail (surface != NULL);
+
+	entry = g_slice_new0 (EvSurfaceCacheEntry);
+	entry->document = document;
+	entry->page = page;
+	entry->rotation = rotation;
+	entry->preview = TRUE;
+	entry->surface = surface;
+	entry->size = cairo_image_surface_get_stride (surface) *
+		cairo_image_surface_get_height (surface);
+
+	ev_surface_cache_insert (entry);
+}
+
+/**
+ * ev_surface_cache_get_preview:
+ * @document: an #EvDocument
+ * @page: the page index
+ * @rotation: the page rotation
+ *
+ * Looks for the preview of @page rendered with @rotation. It stays in
+ * the cache, and must not be modified.
+ *
+ * Returns: (transfer full): the preview surface, or %NULL
+ */
+cairo_surface_t *
+ev_surface_cache_get_preview (EvDocument *document,
+			      gint        page,
+			      gint        rotation)
+{
+	EvSurfaceCacheEntry  key = { 0, };
+	EvSurfaceCacheEntry *entry;
+	cairo_surface_t     *surface = NULL;
+
+	key.document = document;
+	key.page = page;
+	key.rotation = rotation;
+	key.preview = TRUE;
+
+	G_LOCK (surface_cache);
+
+	entry = entries ? g_hash_table_lookup (entries, &key) : NULL;
+	if (entry) {
+		surface = cairo_surface_reference (entry->surface);
+		g_queue_unlink (&lru, entry->link);
+		g_queue_push_head_link (&lru, entry->link);
+	}
+
+	G_UNLOCK (surface_cache);
+
+	ev_trace_instant ("cache", surface ? "preview cache hit" : "preview cache miss",
+			  "page", page);
+
+	return surface;
+}
+
+/**
+ * ev_surface_cache_remove_page:
+ * @document: an #EvDocument
+ * @page: the page index
+ *
+ * Drops the cached renderings of @page, because its contents changed.
+ */
+void
+ev_surface_cache_remove_page (EvDocument *document,
+			      gint        page)
+{
+	G_LOCK (surface_cache);
+	if (entries)
+		ev_surface_cache_remove_matching_unlocked (document, page);
+	G_UNLOCK (surface_cache);
+}
+
+/**
+ * ev_surface_cache_remove_document:
+ * @document: an #EvDocument
+ *
+ * Drops all the cached renderings of @document.
+ */
+void
+ev_surface_cache_remove_document (EvDocument *document)
+{
+	G_LOCK (surface_cache);
+	if (entries)
+		ev_surface_cache_remove_matching_unlocked (document, -1);
+	G_UNLOCK (surface_cache);
+}
+
+/**
+ * ev_surface_cache_set_max_size:
+ * @max_size: the budget in bytes
+ *
+ * Sets the maximum amount of memory used by the cached surfaces of
+ * all documents.
+ */
+void
+ev_surface_cache_set_max_size (gsize max_size)
+{
+	G_LOCK (surface_cache);
+	cache_max_size = max_size;
+	if (entries)
+		ev_surface_cache_trim_unlocked (cache_max_size);
+	G_UNLOCK (surface_cache);
+}
+
+/**
+ * ev_surface_cache_get_stats:
+ * @stats: (out): return location for the cache counters
+ *
+ * Gets the number of hits, misses and evictions since the start of
+ * the process, and the current usage of the cache.
+ */
+void
+ev_surface_cache_get_stats (EvSurfaceCacheStats *stats)
+{
+	g_return_if_fail (stats != NULL);
+
+	G_LOCK (surface_cache);
+	stats->hits = n_hits;
+	stats->misses = n_misses;
+	stats->evictions = n_evictions;
+	stats->n_surfaces = lru.length;
+	stats->size = cache_size;
+	stats->max_size = cache_max_size;
+	G_UNLOCK (surface_cache);
+}
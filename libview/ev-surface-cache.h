@@ -0,0 +1,69 @@
+/* ev-surface-cache.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (__EV_EVINCE_VIEW_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-view.h> can be included directly."
+#endif
+
+#ifndef EV_SURFACE_CACHE_H
+#define EV_SURFACE_CACHE_H
+
+#include <glib.h>
+#include <cairo.h>
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvSurfaceCacheStats EvSurfaceCacheStats;
+
+struct _EvSurfaceCacheStats {
+	guint64 hits;
+	guint64 misses;
+	guint64 evictions;
+	guint   n_surfaces;
+	gsize   size;
+	gsize   max_size;
+};
+
+void             ev_surface_cache_add             (EvDocument          *document,
+						   gint                 page,
+						   gint                 rotation,
+						   gboolean             inverted,
+						   cairo_surface_t     *surface);
+cairo_surface_t *ev_surface_cache_take            (EvDocument          *document,
+						   gint                 page,
+						   gint                 width,
+						   gint                 height,
+						   gint                 rotation,
+						   gboolean             inverted);
+void             ev_surface_cache_add_preview     (EvDocument          *document,
+						   gint                 page,
+						   gint                 rotation,
+						   cairo_surface_t     *surface);
+cairo_surface_t *ev_surface_cache_get_preview     (EvDocument          *document,
+						   gint                 page,
+						   gint                 rotation);
+void             ev_surface_cache_remove_page     (EvDocument          *document,
+						   gint                 page);
+void             ev_surface_cache_remove_document (EvDocument          *document);
+void             ev_surface_cache_set_max_size    (gsize                max_size);
+void             ev_surface_cache_get_stats       (EvSurfaceCacheStats *stats);
+
+G_END_DECLS
+
+#endif /* EV_SURFACE_CACHE_H */
@@ -0,0 +1,1053 @@
+/* ev-text-index.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "ev-debug.h"
+#include "ev-text-index.h"
+
+/* On-disk copy of the text and text layout of every page of a
+ * document, so that searching it again, even in a later session,
+ * doesn't need to extract the text of every page from the backend.
+ *
+ * Indexes are stored in the user cache directory, named after the
+ * document URI, and are only used while the modification time of the
+ * document matches the one recorded in the index. Documents protected
+ * by a password are never indexed, their text must not reach the disk
+ * in clear. The least recently used indexes are removed when the
+ * directory grows too large or when they are too old.
+ *
+ * The file is mapped in memory and contains, in native byte order:
+ *
+ *  - a header (EvTextIndexHeader),
+ *  - for every page, a page header (EvTextIndexPage) followed by the
+ *    nul-terminated UTF-8 text of the page, padded to 4 bytes, and
+ *    the area of every character as 4 floats (x1, y1, x2, y2),
+ *  - the offset of every page record, as 64 bits integers,
+ *  - the offset of the page offsets table.
+ */
+
+#define TEXT_INDEX_MAGIC   "EVTXTIDX"
+#define TEXT_INDEX_VERSION 1
+
+#define TEXT_INDEX_CACHE_MAX_SIZE (256 * 1024 * 1024)
+#define TEXT_INDEX_CACHE_MAX_AGE  (30 * 24 * 60 * 60)
+
+typedef struct {
+	gchar   magic[8];
+	guint32 version;
+	guint32 n_pages;
+	guint64 mtime;
+	guint32 mtime_usec;
+	guint32 reserved;
+} EvTextIndexHeader;
+
+typedef struct {
+	guint32 text_len;
+	guint32 n_areas;
+} EvTextIndexPage;
+
+struct _EvTextIndex {
+	volatile gint ref_count;
+
+	GMappedFile  *file;
+	const gchar  *data;
+	gint          n_pages;
+	/* Offset of every page record */
+	guint64      *offsets;
+};
+
+struct _EvTextIndexBuilder {
+	EvDocument        *document;
+	gchar             *path;
+	GFile             *tmp_file;
+	GFileOutputStream *stream;
+	guint64           *offsets;
+	guint64            offset;
+	guint64            mtime;
+	guint32            mtime_usec;
+	gint               n_pages;
+	gint               next_page;
+	gboolean           complete;
+};
+
+G_DEFINE_BOXED_TYPE (EvTextIndex, ev_text_index, ev_text_index_ref, ev_text_index_unref)
+
+/* Protects the index attached to every document */
+G_LOCK_DEFINE_STATIC (text_index);
+
+#define ALIGN_TO(n, a) (((n) + (a) - 1) & ~((guint64)(a) - 1))
+
+static GQuark
+ev_text_index_quark (void)
+{
+	static GQuark quark = 0;
+
+	if (G_UNLIKELY (quark == 0))
+		quark = g_quark_from_static_string ("ev-text-index");
+
+	return quark;
+}
+
+/**
+ * ev_text_index_ref:
+ * @index: an #EvTextIndex
+ *
+ * Returns: (transfer full): @index
+ *
+ * Since: 3.18
+ */
+EvTextIndex *
+ev_text_index_ref (EvTextIndex *index)
+{
+	g_return_val_if_fail (index != NULL, NULL);
+
+	g_atomic_int_inc (&index->ref_count);
+
+	return index;
+}
+
+/**
+ * ev_text_index_unref:
+ * @index: an #EvTextIndex
+ *
+ * Since: 3.18
+ */
+void
+ev_text_index_unref (EvTextIndex *index)
+{
+	g_return_if_fail (index != NULL);
+
+	if (!g_atomic_int_dec_and_test (&index->ref_count))
+		return;
+
+	g_mapped_file_unref (index->file);
+	g_free (index->offsets);
+	g_slice_free (EvTextIndex, index);
+}
+
+static gchar *
+ev_text_index_get_path (EvDocument *document)
+{
+	const gchar *uri;
+	gchar       *checksum;
+	gchar       *path;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return NULL;
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	path = g_build_filename (g_get_user_cache_dir (), "evince", "text-index", checksum, NULL);
+	g_free (checksum);
+
+	return path;
+}
+
+static gboolean
+ev_text_index_is_allowed (EvDocument *document)
+{
+	return !EV_IS_DOCUMENT_SECURITY (document) ||
+		!ev_document_security_has_document_security (EV_DOCUMENT_SECURITY (document));
+}
+
+typedef struct {
+	gchar  *path;
+	goffset size;
+	gint64  mtime;
+} EvTextIndexCacheFile;
+
+static gint
+ev_text_index_cache_file_compare (const EvTextIndexCacheFile *a,
+				  const EvTextIndexCacheFile *b)
+{
+	return a->mtime < b->mtime ? -1 : (a->mtime > b->mtime ? 1 : 0);
+}
+
+/* Removes the indexes that weren't used for a long time, and the least
+ * recently used ones while the directory is too large. Loading an index
+ * updates its modification time.
+ */
+static void
+ev_text_index_prune_cache (const gchar *dir_path,
+			   const gchar *keep_path)
+{
+	GDir        *dir;
+	const gchar *name;
+	GArray      *files;
+	guint64      total_size = 0;
+	gint64       now;
+	guint        i;
+
+	dir = g_dir_open (dir_path, 0, NULL);
+	if (!dir)
+		return;
+
+	files = g_array_new (FALSE, FALSE, sizeof (EvTextIndexCacheFile));
+	while ((name = g_dir_read_name (dir))) {
+		EvTextIndexCacheFile file;
+		GStatBuf             buf;
+
+		file.path = g_build_filename (dir_path, name, NULL);
+		if (g_stat (file.path, &buf) != 0) {
+			g_free (file.path);
+			continue;
+		}
+
+		total_size += buf.st_size;
+		if (g_strcmp0 (file.path, keep_path) == 0) {
+			g_free (file.path);
+			continue;
+		}
+
+		file.size = buf.st_size;
+		file.mtime = buf.st_mtime;
+		g_array_append_val (files, file);
+	}
+	g_dir_close (dir);
+
+	g_array_sort (files, (GCompareFunc)ev_text_index_cache_file_compare);
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	for (i = 0; i < files->len; i++) {
+		EvTextIndexCacheFile *file = &g_array_index (files, EvTextIndexCacheFile, i);
+
+		if ((total_size > TEXT_INDEX_CACHE_MAX_SIZE ||
+		     now - file->mtime > TEXT_INDEX_CACHE_MAX_AGE) &&
+		    g_unlink (file->path) == 0)
+			total_size -= file->size;
+		g_free (file->path);
+	}
+	g_array_free (files, TRUE);
+}
+
+static gboolean
+ev_text_index_get_document_mtime (EvDocument *document,
+				  guint64    *mtime,
+				  guint32    *mtime_usec)
+{
+	const gchar *uri;
+	GFile       *file;
+	GFileInfo   *info;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return FALSE;
+
+	file = g_file_new_for_uri (uri);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_object_unref (file);
+	if (!info)
+		return FALSE;
+
+	if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		g_object_unref (info);
+		return FALSE;
+	}
+
+	*mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	*mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	g_object_unref (info);
+
+	return TRUE;
+}
+
+/* Maps the index at path, checking that it's complete and that it
+ * matches the given document.
+ */
+static EvTextIndex *
+ev_text_index_new_for_path (const gchar *path,
+			    guint        n_pages,
+			    guint64      mtime,
+			    guint32      mtime_usec)
+{
+	GMappedFile      *file;
+	const gchar      *data;
+	guint64           length;
+	guint64           table_offset;
+	guint64          *offsets;
+	EvTextIndexHeader header;
+	EvTextIndex      *index;
+	guint             i;
+
+	file = g_mapped_file_new (path, FALSE, NULL);
+	if (!file)
+		return NULL;
+
+	data = g_mapped_file_get_contents (file);
+	length = g_mapped_file_get_length (file);
+	if (length < sizeof (EvTextIndexHeader) + sizeof (guint64)) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	memcpy (&header, data, sizeof (EvTextIndexHeader));
+	if (memcmp (header.magic, TEXT_INDEX_MAGIC, sizeof (header.magic)) != 0 ||
+	    header.version != TEXT_INDEX_VERSION ||
+	    header.n_pages != n_pages ||
+	    header.mtime != mtime ||
+	    header.mtime_usec != mtime_usec) {
+		ev_debug_message (DEBUG_JOBS, "%s is outdated", path);
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	memcpy (&table_offset, data + length - sizeof (guint64), sizeof (guint64));
+	if (table_offset % sizeof (guint64) != 0 ||
+	    table_offset < sizeof (EvTextIndexHeader) ||
+	    table_offset + (guint64)n_pages * sizeof (guint64) + sizeof (guint64) != length) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	offsets = g_new (guint64, n_pages);
+	memcpy (offsets, data + table_offset, n_pages * sizeof (guint64));
+
+	for (i = 0; i < n_pages; i++) {
+		EvTextIndexPage page;
+		guint64         text_end;
+		guint64         areas_end;
+
+		if (offsets[i] % 4 != 0 ||
+		    offsets[i] < sizeof (EvTextIndexHeader) ||
+		    offsets[i] + sizeof (EvTextIndexPage) > table_offset)
+			break;
+
+		memcpy (&page, data + offsets[i], sizeof (EvTextIndexPage));
+		text_end = offsets[i] + sizeof (EvTextIndexPage) + page.text_len + 1;
+		areas_end = ALIGN_TO (text_end, 4) + (guint64)page.n_areas * 4 * sizeof (gfloat);
+		if (areas_end > table_offset || data[text_end - 1] != '\0')
+			break;
+
+		if (!g_utf8_validate (data + offsets[i] + sizeof (EvTextIndexPage), page.text_len, NULL))
+			break;
+	}
+
+	if (i < n_pages) {
+		g_warning ("Text index %s is corrupted", path);
+		g_free (offsets);
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	index = g_slice_new0 (EvTextIndex);
+	index->ref_count = 1;
+	index->file = file;
+	index->data = data;
+	index->n_pages = n_pages;
+	index->offsets = offsets;
+
+	return index;
+}
+
+static const gchar *
+ev_text_index_get_page_data (EvTextIndex   *index,
+			     gint           page,
+			     guint         *text_len,
+			     const gfloat **areas,
+			     guint         *n_areas)
+{
+	EvTextIndexPage page_header;
+	const gchar    *text;
+
+	memcpy (&page_header, index->data + index->offsets[page], sizeof (EvTextIndexPage));
+	text = index->data + index->offsets[page] + sizeof (EvTextIndexPage);
+
+	if (text_len)
+		*text_len = page_header.text_len;
+	if (n_areas)
+		*n_areas = page_header.n_areas;
+	if (areas) {
+		guint64 areas_offset;
+
+		areas_offset = ALIGN_TO (index->offsets[page] + sizeof (EvTextIndexPage) + page_header.text_len + 1, 4);
+		*areas = (const gfloat *)(index->data + areas_offset);
+	}
+
+	return text;
+}
+
+static void
+ev_text_index_attach (EvDocument  *document,
+		      EvTextIndex *index)
+{
+	G_LOCK (text_index);
+	g_object_set_qdata_full (G_OBJECT (document), ev_text_index_quark (),
+				 ev_text_index_ref (index),
+				 (GDestroyNotify)ev_text_index_unref);
+	G_UNLOCK (text_index);
+}
+
+/**
+ * ev_text_index_lookup:
+ * @document: an #EvDocument
+ *
+ * Gets the text index of @document if it has already been loaded or
+ * built. This never does any I/O, so it can be used from the main
+ * thread.
+ *
+ * Returns: (transfer full) (allow-none): the #EvTextIndex of @document
+ *
+ * Since: 3.18
+ */
+EvTextIndex *
+ev_text_index_lookup (EvDocument *document)
+{
+	EvTextIndex *index;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+
+	G_LOCK (text_index);
+	index = g_object_get_qdata (G_OBJECT (document), ev_text_index_quark ());
+	if (index)
+		ev_text_index_ref (index);
+	G_UNLOCK (text_index);
+
+	return index;
+}
+
+/**
+ * ev_text_index_load:
+ * @document: an #EvDocument
+ *
+ * Gets the text index of @document, loading it from the disk if it
+ * was built in a previous session and the document hasn't been
+ * modified since then.
+ *
+ * Returns: (transfer full) (allow-none): the #EvTextIndex of @document
+ *
+ * Since: 3.18
+ */
+EvTextIndex *
+ev_text_index_load (EvDocument *document)
+{
+	EvTextIndex *index;
+	gchar       *path;
+	guint64      mtime;
+	guint32      mtime_usec;
+
+	index = ev_text_index_lookup (document);
+	if (index)
+		return index;
+
+	if (!ev_text_index_is_allowed (document))
+		return NULL;
+
+	if (!ev_text_index_get_document_mtime (document, &mtime, &mtime_usec))
+		return NULL;
+
+	path = ev_text_index_get_path (document);
+	index = ev_text_index_new_for_path (path, ev_document_get_n_pages (document),
+					    mtime, mtime_usec);
+	if (index) {
+		/* Recently used indexes are kept when pruning the cache */
+		g_utime (path, NULL);
+		ev_text_index_attach (document, index);
+	}
+	g_free (path);
+
+	return index;
+}
+
+static gboolean
+ev_text_index_write (GOutputStream *stream,
+		     gconstpointer  buffer,
+		     gsize          count,
+		     guint64       *offset,
+		     GCancellable  *cancellable,
+		     GError       **error)
+{
+	if (!g_output_stream_write_all (stream, buffer, count, NULL, cancellable, error))
+		return FALSE;
+
+	*offset += count;
+
+	return TRUE;
+}
+
+static gboolean
+ev_text_index_write_padding (GOutputStream *stream,
+			     guint          alignment,
+			     guint64       *offset,
+			     GCancellable  *cancellable,
+			     GError       **error)
+{
+	static const gchar zeros[8] = { 0, };
+
+	return ev_text_index_write (stream, zeros, ALIGN_TO (*offset, alignment) - *offset,
+				    offset, cancellable, error);
+}
+
+static gboolean
+ev_text_index_write_page (GOutputStream *stream,
+			  const gchar   *text,
+			  EvRectangle   *areas,
+			  guint          n_areas,
+			  guint64       *offset,
+			  GCancellable  *cancellable,
+			  GError       **error)
+{
+	EvTextIndexPage page;
+	gfloat         *float_areas;
+	guint           i;
+	gboolean        retval;
+
+	page.text_len = strlen (text);
+	page.n_areas = n_areas;
+
+	if (!ev_text_index_write (stream, &page, sizeof (EvTextIndexPage), offset, cancellable, error) ||
+	    !ev_text_index_write (stream, text, page.text_len + 1, offset, cancellable, error) ||
+	    !ev_text_index_write_padding (stream, 4, offset, cancellable, error))
+		return FALSE;
+
+	if (n_areas == 0)
+		return TRUE;
+
+	float_areas = g_new (gfloat, n_areas * 4);
+	for (i = 0; i < n_areas; i++) {
+		float_areas[i * 4] = areas[i].x1;
+		float_areas[i * 4 + 1] = areas[i].y1;
+		float_areas[i * 4 + 2] = areas[i].x2;
+		float_areas[i * 4 + 3] = areas[i].y2;
+	}
+
+	retval = ev_text_index_write (stream, float_areas, n_areas * 4 * sizeof (gfloat),
+				      offset, cancellable, error);
+	g_free (float_areas);
+
+	return retval;
+}
+
+/**
+ * ev_text_index_builder_new: (skip)
+ * @document: an #EvDocument implementing #EvDocumentText
+ * @cancellable: (allow-none): a #GCancellable
+ * @error: (allow-none): return location for an error
+ *
+ * Starts building the text index of @document, replacing any outdated
+ * index. Pages are then added one by one with
+ * ev_text_index_builder_add_page(), so that the document can be used
+ * by other jobs between pages. Documents protected by a password are
+ * never indexed.
+ *
+ * Returns: (transfer full) (allow-none): a new #EvTextIndexBuilder, or
+ *   %NULL if the index can't be written
+ *
+ * Since: 3.18
+ */
+EvTextIndexBuilder *
+ev_text_index_builder_new (EvDocument   *document,
+			   GCancellable *cancellable,
+			   GError      **error)
+{
+	EvTextIndexBuilder *builder;
+	EvTextIndexHeader   header;
+	gchar              *dir;
+	gchar              *tmp_path;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT_TEXT (document), NULL);
+
+	if (!ev_text_index_is_allowed (document)) {
+		gchar *path;
+
+		/* Remove any index written before the document was protected */
+		path = ev_text_index_get_path (document);
+		if (path)
+			g_unlink (path);
+		g_free (path);
+
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+				     "Protected documents are not indexed");
+		return NULL;
+	}
+
+	builder = g_slice_new0 (EvTextIndexBuilder);
+	builder->document = g_object_ref (document);
+	builder->n_pages = ev_document_get_n_pages (document);
+	builder->offsets = g_new0 (guint64, builder->n_pages);
+
+	if (!ev_text_index_get_document_mtime (document, &builder->mtime, &builder->mtime_usec)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+				     "Document modification time is unknown");
+		ev_text_index_builder_free (builder);
+		return NULL;
+	}
+
+	builder->path = ev_text_index_get_path (document);
+	dir = g_path_get_dirname (builder->path);
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		int errsv = errno;
+
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+			     "Failed to create directory %s: %s", dir, g_strerror (errsv));
+		g_free (dir);
+		ev_text_index_builder_free (builder);
+		return NULL;
+	}
+	g_free (dir);
+
+	/* Write to a temporary file first, so that an incomplete index
+	 * never replaces a valid one */
+	tmp_path = g_strconcat (builder->path, ".tmp", NULL);
+	builder->tmp_file = g_file_new_for_path (tmp_path);
+	g_free (tmp_path);
+	builder->stream = g_file_replace (builder->tmp_file, NULL, FALSE, G_FILE_CREATE_PRIVATE,
+					  cancellable, error);
+	if (!builder->stream) {
+		ev_text_index_builder_free (builder);
+		return NULL;
+	}
+
+	memset (&header, 0, sizeof (EvTextIndexHeader));
+	memcpy (header.magic, TEXT_INDEX_MAGIC, sizeof (header.magic));
+	header.version = TEXT_INDEX_VERSION;
+	header.n_pages = builder->n_pages;
+	header.mtime = builder->mtime;
+	header.mtime_usec = builder->mtime_usec;
+	if (!ev_text_index_write (G_OUTPUT_STREAM (builder->stream), &header, sizeof (EvTextIndexHeader),
+				  &builder->offset, cancellable, error)) {
+		ev_text_index_builder_free (builder);
+		return NULL;
+	}
+
+	return builder;
+}
+
+static gboolean
+ev_text_index_builder_finish (EvTextIndexBuilder *builder,
+			      GCancellable       *cancellable,
+			      GError            **error)
+{
+	GOutputStream *stream = G_OUTPUT_STREAM (builder->stream);
+	EvTextIndex   *index;
+	GFile         *file;
+	gchar         *dir;
+	guint64        table_offset;
+	gboolean       retval;
+
+	if (!ev_text_index_write_padding (stream, sizeof (guint64),
+					  &builder->offset, cancellable, error))
+		return FALSE;
+
+	table_offset = builder->offset;
+	if (!ev_text_index_write (stream, builder->offsets, builder->n_pages * sizeof (guint64),
+				  &builder->offset, cancellable, error) ||
+	    !ev_text_index_write (stream, &table_offset, sizeof (guint64),
+				  &builder->offset, cancellable, error))
+		return FALSE;
+
+	if (!g_output_stream_close (stream, cancellable, error))
+		return FALSE;
+
+	file = g_file_new_for_path (builder->path);
+	retval = g_file_move (builder->tmp_file, file, G_FILE_COPY_OVERWRITE, cancellable,
+			      NULL, NULL, error);
+	g_object_unref (file);
+	if (!retval)
+		return FALSE;
+
+	builder->complete = TRUE;
+
+	index = ev_text_index_new_for_path (builder->path, builder->n_pages,
+					    builder->mtime, builder->mtime_usec);
+	if (index) {
+		ev_text_index_attach (builder->document, index);
+		ev_text_index_unref (index);
+	}
+
+	dir = g_path_get_dirname (builder->path);
+	ev_text_index_prune_cache (dir, builder->path);
+	g_free (dir);
+
+	return TRUE;
+}
+
+/**
+ * ev_text_index_builder_add_page: (skip)
+ * @builder: an #EvTextIndexBuilder
+ * @cancellable: (allow-none): a #GCancellable
+ * @error: (allow-none): return location for an error
+ *
+ * Extracts the text of the next page of the document, with the document
+ * render lock held, and adds it to the index. After the last page the
+ * index is saved and attached to the document.
+ *
+ * Returns: %TRUE on success, %FALSE if an error occurred
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_text_index_builder_add_page (EvTextIndexBuilder *builder,
+				GCancellable       *cancellable,
+				GError            **error)
+{
+	g_return_val_if_fail (builder != NULL, FALSE);
+	g_return_val_if_fail (!builder->complete, FALSE);
+
+	if (builder->next_page < builder->n_pages) {
+		EvDocument  *document = builder->document;
+		EvPage      *page;
+		gchar       *text;
+		EvRectangle *areas = NULL;
+		guint        n_areas = 0;
+		gboolean     success;
+
+		ev_document_render_lock (document);
+		page = ev_document_get_page (document, builder->next_page);
+		text = ev_document_text_get_text (EV_DOCUMENT_TEXT (document), page);
+		if (!ev_document_text_get_text_layout (EV_DOCUMENT_TEXT (document), page, &areas, &n_areas)) {
+			areas = NULL;
+			n_areas = 0;
+		}
+		g_object_unref (page);
+		ev_document_render_unlock (document);
+
+		if (!text || !g_utf8_validate (text, -1, NULL)) {
+			g_free (text);
+			text = g_strdup ("");
+			g_free (areas);
+			areas = NULL;
+			n_areas = 0;
+		}
+
+		builder->offsets[builder->next_page] = builder->offset;
+		success = ev_text_index_write_page (G_OUTPUT_STREAM (builder->stream), text, areas, n_areas,
+						    &builder->offset, cancellable, error);
+		g_free (text);
+		g_free (areas);
+
+		if (!success)
+			return FALSE;
+
+		builder->next_page++;
+	}
+
+	if (builder->next_page == builder->n_pages)
+		return ev_text_index_builder_finish (builder, cancellable, error);
+
+	return TRUE;
+}
+
+/**
+ * ev_text_index_builder_is_complete: (skip)
+ * @builder: an #EvTextIndexBuilder
+ *
+ * Returns: %TRUE if every page has been added and the index saved
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_text_index_builder_is_complete (EvTextIndexBuilder *builder)
+{
+	g_return_val_if_fail (builder != NULL, FALSE);
+
+	return builder->complete;
+}
+
+/**
+ * ev_text_index_builder_free: (skip)
+ * @builder: an #EvTextIndexBuilder
+ *
+ * Frees @builder, discarding the partial index if it isn't complete.
+ *
+ * Since: 3.18
+ */
+void
+ev_text_index_builder_free (EvTextIndexBuilder *builder)
+{
+	if (!builder)
+		return;
+
+	if (builder->stream) {
+		if (!builder->complete)
+			g_output_stream_close (G_OUTPUT_STREAM (builder->stream), NULL, NULL);
+		g_object_unref (builder->stream);
+	}
+
+	if (builder->tmp_file) {
+		if (!builder->complete)
+			g_file_delete (builder->tmp_file, NULL, NULL);
+		g_object_unref (builder->tmp_file);
+	}
+
+	g_object_unref (builder->document);
+	g_free (builder->offsets);
+	g_free (builder->path);
+	g_slice_free (EvTextIndexBuilder, builder);
+}
+
+/**
+ * ev_text_index_build:
+ * @document: an #EvDocument implementing #EvDocumentText
+ * @cancellable: (allow-none): a #GCancellable
+ * @error: (allow-none): return location for an error
+ *
+ * Extracts the text of every page of @document and saves it to the
+ * disk, replacing any outdated index of @document. This can take a
+ * long time for large documents, so it should be done from a thread,
+ * see #EvJobTextIndex. Pages are accessed with the document render
+ * lock held.
+ *
+ * Returns: %TRUE if the index was built
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_text_index_build (EvDocument   *document,
+		     GCancellable *cancellable,
+		     GError      **error)
+{
+	EvTextIndexBuilder *builder;
+	gboolean            retval;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT_TEXT (document), FALSE);
+
+	builder = ev_text_index_builder_new (document, cancellable, error);
+	if (!builder)
+		return FALSE;
+
+	while (!ev_text_index_builder_is_complete (builder)) {
+		if (!ev_text_index_builder_add_page (builder, cancellable, error))
+			break;
+	}
+
+	retval = ev_text_index_builder_is_complete (builder);
+	ev_text_index_builder_free (builder);
+
+	return retval;
+}
+
+/**
+ * ev_text_index_get_n_pages:
+ * @index: an #EvTextIndex
+ *
+ * Returns: the number of pages of the indexed document
+ *
+ * Since: 3.18
+ */
+gint
+ev_text_index_get_n_pages (EvTextIndex *index)
+{
+	g_return_val_if_fail (index != NULL, 0);
+
+	return index->n_pages;
+}
+
+/**
+ * ev_text_index_get_text:
+ * @index: an #EvTextIndex
+ * @page: the page index
+ *
+ * Returns: (transfer full): the text of @page, like ev_document_text_get_text()
+ *
+ * Since: 3.18
+ */
+gchar *
+ev_text_index_get_text (EvTextIndex *index,
+			gint         page)
+{
+	const gchar *text;
+	guint        text_len;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (page >= 0 && page < index->n_pages, NULL);
+
+	text = ev_text_index_get_page_data (index, page, &text_len, NULL, NULL);
+
+	return g_strndup (text, text_len);
+}
+
+/**
+ * ev_text_index_get_text_layout:
+ * @index: an #EvTextIndex
+ * @page: the page index
+ * @areas: (out) (transfer full): return location for the character areas
+ * @n_areas: (out): return location for the number of areas
+ *
+ * Gets the area of every character of @page, like
+ * ev_document_text_get_text_layout().
+ *
+ * Returns: %TRUE if @page has text
+ *
+ * Since: 3.18
+ */
+gboolean
+ev_text_index_get_text_layout (EvTextIndex  *index,
+			       gint          page,
+			       EvRectangle **areas,
+			       guint        *n_areas)
+{
+	const gfloat *page_areas;
+	guint         n_page_areas;
+	guint         i;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+	g_return_val_if_fail (page >= 0 && page < index->n_pages, FALSE);
+
+	ev_text_index_get_page_data (index, page, NULL, &page_areas, &n_page_areas);
+	if (n_page_areas == 0)
+		return FALSE;
+
+	*areas = g_new (EvRectangle, n_page_areas);
+	*n_areas = n_page_areas;
+	for (i = 0; i < n_page_areas; i++) {
+		(*areas)[i].x1 = page_areas[i * 4];
+		(*areas)[i].y1 = page_areas[i * 4 + 1];
+		(*areas)[i].x2 = page_areas[i * 4 + 2];
+		(*areas)[i].y2 = page_areas[i * 4 + 3];
+	}
+
+	return TRUE;
+}
+
+static gunichar *
+ev_text_index_normalize (const gchar  *text,
+			 gsize         len,
+			 gboolean      case_sensitive,
+			 glong        *n_chars)
+{
+	gunichar *chars;
+	glong     i;
+
+	chars = g_utf8_to_ucs4_fast (text, len, n_chars);
+	for (i = 0; i < *n_chars; i++) {
+		/* A match can continue on the next line */
+		if (chars[i] == '\n')
+			chars[i] = ' ';
+		else if (!case_sensitive)
+			chars[i] = g_unichar_tolower (chars[i]);
+	}
+
+	return chars;
+}
+
+/**
+ * ev_text_index_find_text:
+ * @index: an #EvTextIndex
+ * @page: the page index
+ * @text: text to find
+ * @options: a set of #EvFindOptions
+ *
+ * Finds @text in @page using the indexed text, like
+ * ev_document_find_find_text_with_options().
+ *
+ * Returns: (transfer full) (element-type EvRectangle): the area of
+ *   every match, in page order, with one area for every line of
+ *   matches spanning several lines
+ *
+ * Since: 3.18
+ */
+GList *
+ev_text_index_find_text (EvTextIndex  *index,
+			 gint          page,
+			 const gchar  *text,
+			 EvFindOptions options)
+{
+	const gchar  *page_text;
+	guint         text_len;
+	const gfloat *areas;
+	guint         n_areas;
+	gunichar     *page_chars;
+	gunichar     *haystack;
+	gunichar     *needle;
+	glong         n_haystack;
+	glong         n_needle;
+	gboolean      case_sensitive;
+	gboolean      whole_words;
+	glong         i;
+	GList        *retval = NULL;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (page >= 0 && page < index->n_pages, NULL);
+	g_return_val_if_fail (text != NULL, NULL);
+
+	page_text = ev_text_index_get_page_data (index, page, &text_len, &areas, &n_areas);
+	if (n_areas == 0)
+		return NULL;
+
+	case_sensitive = (options & EV_FIND_CASE_SENSITIVE) != 0;
+	whole_words = (options & EV_FIND_WHOLE_WORDS_ONLY) != 0;
+
+	needle = ev_text_index_normalize (text, strlen (text), case_sensitive, &n_needle);
+	if (n_needle == 0) {
+		g_free (needle);
+		return NULL;
+	}
+	haystack = ev_text_index_normalize (page_text, text_len, case_sensitive, &n_haystack);
+	page_chars = g_utf8_to_ucs4_fast (page_text, text_len, NULL);
+
+	/* Characters and areas are matched by position */
+	n_haystack = MIN (n_haystack, (glong)n_areas);
+
+	for (i = 0; i + n_needle <= n_haystack; i++) {
+		EvRectangle *rect = NULL;
+		glong        j;
+
+		if (haystack[i] != needle[0] ||
+		    memcmp (haystack + i, needle, n_needle * sizeof (gunichar)) != 0)
+			continue;
+
+		if (whole_words &&
+		    ((i > 0 && g_unichar_isalnum (haystack[i - 1])) ||
+		     (i + n_needle < n_haystack && g_unichar_isalnum (haystack[i + n_needle]))))
+			continue;
+
+		/* One area for every line, like the backends */
+		for (j = i; j < i + n_needle; j++) {
+			const gfloat *area = areas + j * 4;
+
+			if (page_chars[j] == '\n') {
+				rect = NULL;
+				continue;
+			}
+
+			if (rect && (area[1] >= rect->y2 || area[3] <= rect->y1))
+				rect = NULL;
+
+			if (!rect) {
+				rect = ev_rectangle_new ();
+				rect->x1 = area[0];
+				rect->y1 = area[1];
+				rect->x2 = area[2];
+				rect->y2 = area[3];
+				retval = g_list_prepend (retval, rect);
+			} else {
+				rect->x1 = MIN (rect->x1, area[0]);
+				rect->y1 = MIN (rect->y1, area[1]);
+				rect->x2 = MAX (rect->x2, area[2]);
+				rect->y2 = MAX (rect->y2, area[3]);
+			}
+		}
+
+		/* Matches don't overlap */
+		i += n_needle - 1;
+	}
+
+	g_free (page_chars);
+	g_free (haystack);
+	g_free (needle);
+
+	return g_list_reverse (retval);
+}
@@ -0,0 +1,69 @@
+/* ev-text-index.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (__EV_EVINCE_VIEW_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-view.h> can be included directly."
+#endif
+
+#ifndef EV_TEXT_INDEX_H
+#define EV_TEXT_INDEX_H
+
+#include <gio/gio.h>
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+#define EV_TYPE_TEXT_INDEX (ev_text_index_get_type ())
+
+typedef struct _EvTextIndex EvTextIndex;
+typedef struct _EvTextIndexBuilder EvTextIndexBuilder;
+
+GType        ev_text_index_get_type        (void) G_GNUC_CONST;
+EvTextIndex *ev_text_index_ref             (EvTextIndex   *index);
+void         ev_text_index_unref           (EvTextIndex   *index);
+
+EvTextIndex *ev_text_index_lookup          (EvDocument    *document);
+EvTextIndex *ev_text_index_load            (EvDocument    *document);
+gboolean     ev_text_index_build           (EvDocument    *document,
+					    GCancellable  *cancellable,
+					    GError       **error);
+
+EvTextIndexBuilder *ev_text_index_builder_new         (EvDocument         *document,
+						       GCancellable       *cancellable,
+						       GError            **error);
+gboolean            ev_text_index_builder_add_page    (EvTextIndexBuilder *builder,
+						       GCancellable       *cancellable,
+						       GError            **error);
+gboolean            ev_text_index_builder_is_complete (EvTextIndexBuilder *builder);
+void                ev_text_index_builder_free        (EvTextIndexBuilder *builder);
+
+gint         ev_text_index_get_n_pages     (EvTextIndex   *index);
+gchar       *ev_text_index_get_text        (EvTextIndex   *index,
+					    gint           page);
+gboolean     ev_text_index_get_text_layout (EvTextIndex   *index,
+					    gint           page,
+					    EvRectangle  **areas,
+					    guint         *n_areas);
+GList       *ev_text_index_find_text       (EvTextIndex   *index,
+					    gint           page,
+					    const gchar   *text,
+					    EvFindOptions  options);
+
+G_END_DECLS
+
+#endif /* EV_TEXT_INDEX_H */
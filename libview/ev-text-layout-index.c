@@ -0,0 +1,450 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "ev-text-layout-index.h"
+
+/* A line is a run of consecutive glyphs in text order that overlap
+ * vertically. Glyphs with an empty bounding box, like \n, end the line
+ * and don't belong to any.
+ */
+typedef struct {
+	guint       start;
+	guint       end;
+	EvRectangle extents;
+	gboolean    sorted; /* x1 doesn't decrease along the line */
+} EvTextLine;
+
+struct _EvTextLayoutIndex {
+	const EvRectangle *areas;
+	guint              n_areas;
+
+	EvTextLine        *lines;
+	guint              n_lines;
+
+	/* Lines sorted by their top, with the largest bottom seen so far */
+	guint             *by_y1;
+	gdouble           *max_y2;
+
+	/* For every glyph, the largest x2 from the start of its line */
+	gdouble           *max_x2;
+};
+
+static gboolean
+area_is_empty (const EvRectangle *area)
+{
+	return area->x2 <= area->x1 || area->y2 <= area->y1;
+}
+
+static gboolean
+area_contains_point (const EvRectangle *area,
+		     gdouble            x,
+		     gdouble            y)
+{
+	return x >= area->x1 && x <= area->x2 && y >= area->y1 && y <= area->y2;
+}
+
+static void
+area_union (EvRectangle       *area,
+	    const EvRectangle *other)
+{
+	area->x1 = MIN (area->x1, other->x1);
+	area->y1 = MIN (area->y1, other->y1);
+	area->x2 = MAX (area->x2, other->x2);
+	area->y2 = MAX (area->y2, other->y2);
+}
+
+static gint
+compare_lines_y1 (gconstpointer a,
+		  gconstpointer b,
+		  gpointer      user_data)
+{
+	EvTextLayoutIndex *index = (EvTextLayoutIndex *)user_data;
+	gdouble            y1_a = index->lines[*(const guint *)a].extents.y1;
+	gdouble            y1_b = index->lines[*(const guint *)b].extents.y1;
+
+	return y1_a < y1_b ? -1 : (y1_a > y1_b ? 1 : 0);
+}
+
+static gint
+compare_positions (gconstpointer a,
+		   gconstpointer b)
+{
+	guint pos_a = *(const guint *)a;
+	guint pos_b = *(const guint *)b;
+
+	return pos_a < pos_b ? -1 : (pos_a > pos_b ? 1 : 0);
+}
+
+/**
+ * ev_text_layout_index_new:
+ * @areas: the text layout of a page
+ * @n_areas: the number of glyphs in @areas
+ *
+ * Groups the glyphs of @areas into lines. @areas is not copied, and
+ * must outlive the returned index.
+ *
+ * Returns: a new #EvTextLayoutIndex
+ */
+EvTextLayoutIndex *
+ev_text_layout_index_new (const EvRectangle *areas,
+			  guint              n_areas)
+{
+	EvTextLayoutIndex *index;
+	GArray            *lines;
+	guint              i;
+
+	index = g_new0 (EvTextLayoutIndex, 1);
+	index->areas = areas;
+	index->n_areas = n_areas;
+	index->max_x2 = g_new (gdouble, MAX (n_areas, 1));
+
+	lines = g_array_new (FALSE, FALSE, sizeof (EvTextLine));
+
+	i = 0;
+	while (i < n_areas) {
+		EvTextLine line;
+
+		if (area_is_empty (areas + i)) {
+			i++;
+			continue;
+		}
+
+		line.start = i;
+		line.extents = areas[i];
+		line.sorted = TRUE;
+		index->max_x2[i] = areas[i].x2;
+
+		for (i++; i < n_areas; i++) {
+			const EvRectangle *area = areas + i;
+			const EvRectangle *prev = areas + i - 1;
+
+			if (area_is_empty (area) || area->y1 > prev->y2 || area->y2 < prev->y1)
+				break;
+
+			if (area->x1 < prev->x1)
+				line.sorted = FALSE;
+			area_union (&line.extents, area);
+			index->max_x2[i] = MAX (index->max_x2[i - 1], area->x2);
+		}
+		line.end = i;
+
+		g_array_append_val (lines, line);
+	}
+
+	index->n_lines = lines->len;
+	index->lines = (EvTextLine *)g_array_free (lines, FALSE);
+
+	index->by_y1 = g_new (guint, MAX (index->n_lines, 1));
+	index->max_y2 = g_new (gdouble, MAX (index->n_lines, 1));
+	for (i = 0; i < index->n_lines; i++)
+		index->by_y1[i] = i;
+	g_qsort_with_data (index->by_y1, index->n_lines, sizeof (guint),
+			   compare_lines_y1, index);
+
+	for (i = 0; i < index->n_lines; i++) {
+		gdouble y2 = index->lines[index->by_y1[i]].extents.y2;
+
+		index->max_y2[i] = i > 0 ? MAX (index->max_y2[i - 1], y2) : y2;
+	}
+
+	return index;
+}
+
+void
+ev_text_layout_index_free (EvTextLayoutIndex *index)
+{
+	if (!index)
+		return;
+
+	g_free (index->lines);
+	g_free (index->by_y1);
+	g_free (index->max_y2);
+	g_free (index->max_x2);
+	g_free (index);
+}
+
+/* Appends the lines whose extents contain @y to @result, in text order */
+static void
+ev_text_layout_index_get_lines_at_y (EvTextLayoutIndex *index,
+				     gdouble            y,
+				     GArray            *result)
+{
+	guint low = 0;
+	guint high = index->n_lines;
+	guint i;
+
+	/* Number of lines starting above y */
+	while (low < high) {
+		guint mid = (low + high) / 2;
+
+		if (index->lines[index->by_y1[mid]].extents.y1 <= y)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (i = low; i > 0 && index->max_y2[i - 1] >= y; i--) {
+		guint line = index->by_y1[i - 1];
+
+		if (index->lines[line].extents.y2 >= y)
+			g_array_append_val (result, line);
+	}
+
+	g_array_sort (result, compare_positions);
+}
+
+/* First glyph of the line whose horizontal extent contains x */
+static gint
+ev_text_line_find_first_at_x (EvTextLayoutIndex *index,
+			      EvTextLine        *line,
+			      gdouble            x)
+{
+	const EvRectangle *areas = index->areas;
+	guint              low = line->start;
+	guint              high = line->end;
+	guint              i;
+
+	if (!line->sorted) {
+		for (i = line->start; i < line->end; i++) {
+			if (x >= areas[i].x1 && x <= areas[i].x2)
+				return i;
+		}
+
+		return -1;
+	}
+
+	/* Skip the glyphs that end before x */
+	while (low < high) {
+		guint mid = (low + high) / 2;
+
+		if (index->max_x2[mid] < x)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (i = low; i < line->end && areas[i].x1 <= x; i++) {
+		if (x <= areas[i].x2)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Last glyph of the line containing (x, y) */
+static gint
+ev_text_line_find_last_at_point (EvTextLayoutIndex *index,
+				 EvTextLine        *line,
+				 gdouble            x,
+				 gdouble            y)
+{
+	const EvRectangle *areas = index->areas;
+	guint              low = line->start;
+	guint              high = line->end;
+	guint              i;
+
+	if (!line->sorted) {
+		for (i = line->end; i > line->start; i--) {
+			if (area_contains_point (areas + i - 1, x, y))
+				return i - 1;
+		}
+
+		return -1;
+	}
+
+	/* Skip the glyphs that start after x */
+	while (low < high) {
+		guint mid = (low + high) / 2;
+
+		if (areas[mid].x1 <= x)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (i = low; i > line->start && index->max_x2[i - 1] >= x; i--) {
+		if (area_contains_point (areas + i - 1, x, y))
+			return i - 1;
+	}
+
+	return -1;
+}
+
+/**
+ * ev_text_layout_index_get_offset_at_point:
+ * @index: an #EvTextLayoutIndex
+ * @x: X coordinate in page units
+ * @y: Y coordinate in page units
+ *
+ * Returns: the offset of the last glyph containing (@x, @y), or -1
+ */
+gint
+ev_text_layout_index_get_offset_at_point (EvTextLayoutIndex *index,
+					  gdouble            x,
+					  gdouble            y)
+{
+	GArray *lines;
+	gint    offset = -1;
+	guint   i;
+
+	g_return_val_if_fail (index != NULL, -1);
+
+	lines = g_array_new (FALSE, FALSE, sizeof (guint));
+	ev_text_layout_index_get_lines_at_y (index, y, lines);
+
+	for (i = lines->len; i > 0 && offset == -1; i--) {
+		EvTextLine *line = index->lines + g_array_index (lines, guint, i - 1);
+
+		offset = ev_text_line_find_last_at_point (index, line, x, y);
+	}
+	g_array_free (lines, TRUE);
+
+	return offset;
+}
+
+/**
+ * ev_text_layout_index_get_caret_offset:
+ * @index: an #EvTextLayoutIndex
+ * @x: X coordinate in page units
+ * @y: Y coordinate in page units
+ *
+ * Returns: the caret offset closest to (@x, @y) on the lines at @y, or -1
+ * if there's no line at @y
+ */
+gint
+ev_text_layout_index_get_caret_offset (EvTextLayoutIndex *index,
+				       gdouble            x,
+				       gdouble            y)
+{
+	const EvRectangle *areas;
+	GArray            *lines;
+	gint               offset = -1;
+	gint               last_line_offset = -1;
+	guint              i;
+
+	g_return_val_if_fail (index != NULL, -1);
+
+	areas = index->areas;
+	lines = g_array_new (FALSE, FALSE, sizeof (guint));
+	ev_text_layout_index_get_lines_at_y (index, y, lines);
+
+	for (i = 0; i < lines->len && offset == -1; i++) {
+		EvTextLine        *line = index->lines + g_array_index (lines, guint, i);
+		const EvRectangle *first = areas + line->start;
+		gint               glyph;
+
+		if (x <= first->x1) {
+			/* Location is before the start of the line. If there's
+			 * a previous line, check distances.
+			 */
+			offset = line->start;
+			if (last_line_offset != -1) {
+				const EvRectangle *last = areas + last_line_offset - 1;
+
+				if (x - last->x2 < first->x1 - x)
+					offset = last_line_offset;
+			}
+			break;
+		}
+
+		glyph = ev_text_line_find_first_at_x (index, line, x);
+		if (glyph != -1) {
+			const EvRectangle *area = areas + glyph;
+
+			/* Location is inside the line. Position the caret before
+			 * or after the character, depending on whether the point
+			 * falls within the left or right half of the bounding box.
+			 */
+			if (x <= area->x1 + (area->x2 - area->x1) / 2)
+				offset = glyph;
+			else
+				offset = glyph + 1;
+			break;
+		}
+
+		last_line_offset = line->end;
+	}
+	g_array_free (lines, TRUE);
+
+	if (offset == -1)
+		offset = last_line_offset;
+
+	return offset;
+}
+
+/**
+ * ev_text_layout_index_get_range_rects:
+ * @index: an #EvTextLayoutIndex
+ * @start: the first glyph of the range
+ * @end: the glyph after the last one of the range
+ * @n_rects: (out): the number of returned rectangles
+ *
+ * Returns: (transfer full) (array length=n_rects): the extents of the
+ * glyphs from @start to @end on each line they cover. Free with g_free().
+ */
+EvRectangle *
+ev_text_layout_index_get_range_rects (EvTextLayoutIndex *index,
+				      guint              start,
+				      guint              end,
+				      guint             *n_rects)
+{
+	GArray *rects;
+	guint   low = 0;
+	guint   high;
+	guint   i;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (n_rects != NULL, NULL);
+
+	rects = g_array_new (FALSE, FALSE, sizeof (EvRectangle));
+
+	/* First line ending after start */
+	high = index->n_lines;
+	while (low < high) {
+		guint mid = (low + high) / 2;
+
+		if (index->lines[mid].end <= start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (i = low; i < index->n_lines && index->lines[i].start < end; i++) {
+		EvTextLine *line = index->lines + i;
+		EvRectangle rect;
+
+		if (line->start >= start && line->end <= end) {
+			rect = line->extents;
+		} else {
+			guint first = MAX (start, line->start);
+			guint last = MIN (end, line->end);
+			guint j;
+
+			rect = index->areas[first];
+			for (j = first + 1; j < last; j++)
+				area_union (&rect, index->areas + j);
+		}
+
+		g_array_append_val (rects, rect);
+	}
+
+	*n_rects = rects->len;
+
+	return (EvRectangle *)g_array_free (rects, FALSE);
+}
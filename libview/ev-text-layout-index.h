@@ -0,0 +1,48 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (__EV_EVINCE_VIEW_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-view.h> can be included directly."
+#endif
+
+#ifndef EV_TEXT_LAYOUT_INDEX_H
+#define EV_TEXT_LAYOUT_INDEX_H
+
+#include <glib.h>
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvTextLayoutIndex EvTextLayoutIndex;
+
+EvTextLayoutIndex *ev_text_layout_index_new                  (const EvRectangle *areas,
+							      guint              n_areas);
+void               ev_text_layout_index_free                 (EvTextLayoutIndex *index);
+gint               ev_text_layout_index_get_offset_at_point  (EvTextLayoutIndex *index,
+							      gdouble            x,
+							      gdouble            y);
+gint               ev_text_layout_index_get_caret_offset     (EvTextLayoutIndex *index,
+							      gdouble            x,
+							      gdouble            y);
+EvRectangle       *ev_text_layout_index_get_range_rects      (EvTextLayoutIndex *index,
+							      guint              start,
+							      guint              end,
+							      guint             *n_rects);
+
+G_END_DECLS
+
+#endif /* EV_TEXT_LAYOUT_INDEX_H */
@@ -30,6 +30,7 @@
 #include "ev-transition-animation.h"
 #include "ev-view-cursor.h"
 #include "ev-page-cache.h"
+#include "ev-surface-cache.h"
 
 enum {
 	PROP_0,
@@ -345,14 +346,9 @@ ev_view_presentation_animation_start (EvViewPresentation *pview,
 
 /* Page Navigation */
 static void
-job_finished_cb (EvJob              *job,
-		 EvViewPresentation *pview)
+ev_view_presentation_job_ready (EvViewPresentation *pview,
+				EvJob              *job)
 {
-	EvJobRender *job_render = EV_JOB_RENDER (job);
-
-	if (pview->inverted_colors)
-		ev_document_misc_invert_surface (job_render->surface);
-
 	if (job != pview->curr_job)
 		return;
 
@@ -365,13 +361,34 @@ job_finished_cb (EvJob              *job,
 	}
 }
 
+static void
+job_finished_cb (EvJob              *job,
+		 EvViewPresentation *pview)
+{
+	EvJobRender *job_render = EV_JOB_RENDER (job);
+
+	if (pview->inverted_colors)
+		ev_document_misc_invert_surface (job_render->surface);
+
+	ev_view_presentation_job_ready (pview, job);
+}
+
+static void
+cached_job_finished_cb (EvJob              *job,
+			EvViewPresentation *pview)
+{
+	/* Colors of cached surfaces are already right */
+	ev_view_presentation_job_ready (pview, job);
+}
+
 static EvJob *
 ev_view_presentation_schedule_new_job (EvViewPresentation *pview,
 				       gint                page,
 				       EvJobPriority       priority)
 {
-	EvJob *job;
-        int    view_width, view_height;
+	EvJob           *job;
+	cairo_surface_t *surface;
+        int              view_width, view_height;
 
 	if (page < 0 || page >= ev_document_get_n_pages (pview->document))
 		return NULL;
@@ -386,6 +403,23 @@ ev_view_presentation_schedule_new_job (EvViewPresentation *pview,
 #endif
         job = ev_job_render_new (pview->document, page, pview->rotation, 0.,
                                  view_width, view_height);
+
+	/* The page might have been rendered recently at the same size,
+	 * in that case the job is not run and just delivers the surface.
+	 */
+	surface = ev_surface_cache_take (pview->document, page,
+					 view_width, view_height,
+					 pview->rotation, pview->inverted_colors);
+	if (surface) {
+		EV_JOB_RENDER (job)->surface = surface;
+		g_signal_connect (job, "finished",
+				  G_CALLBACK (cached_job_finished_cb),
+				  pview);
+		ev_job_succeeded (job);
+
+		return job;
+	}
+
 	g_signal_connect (job, "finished",
 			  G_CALLBACK (job_finished_cb),
 			  pview);
@@ -398,10 +432,27 @@ static void
 ev_view_presentation_delete_job (EvViewPresentation *pview,
 				 EvJob              *job)
 {
+	cairo_surface_t *surface;
+
 	if (!job)
 		return;
 
-	g_signal_handlers_disconnect_by_func (job, job_finished_cb, pview);
+	g_signal_handlers_disconnect_by_data (job, pview);
+
+	/* Keep the rendered page around in case it's shown again. Only
+	 * surfaces whose finished signal was already handled have the
+	 * right colors.
+	 */
+	surface = EV_JOB_RENDER (job)->surface;
+	if (surface && pview->document &&
+	    ev_job_is_finished (job) && job->idle_finished_id == 0) {
+		ev_surface_cache_add (pview->document,
+				      EV_JOB_RENDER (job)->page,
+				      EV_JOB_RENDER (job)->rotation,
+				      pview->inverted_colors,
+				      cairo_surface_reference (surface));
+	}
+
 	ev_job_cancel (job);
 	g_object_unref (job);
 }
@@ -37,6 +37,7 @@
 #include "ev-document-misc.h"
 #include "ev-pixbuf-cache.h"
 #include "ev-page-cache.h"
+#include "ev-surface-cache.h"
 #include "ev-view-marshal.h"
 #include "ev-document-annotations.h"
 #include "ev-annotation-window.h"
@@ -103,6 +104,8 @@ typedef struct {
 } EvViewChild;
 
 #define MIN_SCALE 0.2
+/* Maximum scale when pages are rendered in tiles, see view_update_scale_limits() */
+#define MAX_TILED_SCALE 64.0
 #define ZOOM_IN_FACTOR  1.2
 #define ZOOM_OUT_FACTOR (1.0/ZOOM_IN_FACTOR)
 
@@ -128,6 +131,8 @@ static void       compute_border                             (EvView
 static void       get_page_y_offset                          (EvView             *view,
 							      int                 page,
 							      int                *y_offset);
+static gint       get_page_at_y_offset                       (EvView             *view,
+							      gint                y);
 static void       find_page_at_location                      (EvView             *view,
 							      gdouble             x,
 							      gdouble             y,
@@ -400,6 +405,72 @@ ev_view_build_height_to_page_cache (EvView		*view,
 	}
 }
 
+/* Updates the cache for pages from first_page to last_page, whose size
+ * may have changed; pages before first_page must not have changed */
+static void
+ev_view_update_height_to_page_cache (EvView              *view,
+				     EvHeightToPageCache *cache,
+				     gint                 first_page,
+				     gint                 last_page)
+{
+	gboolean swap;
+	gint i, first_pair, last_pair;
+	gdouble old_height, shift;
+	gint n_pages;
+	EvDocument *document = view->document;
+
+	if (first_page == 0 ||
+	    cache->rotation != view->rotation ||
+	    cache->dual_even_left != view->dual_even_left) {
+		ev_view_build_height_to_page_cache (view, cache);
+		return;
+	}
+
+	swap = (view->rotation == 90 || view->rotation == 270);
+	n_pages = ev_document_get_n_pages (document);
+
+	old_height = cache->height_to_page[last_page + 1];
+	for (i = first_page; i <= last_page; i++) {
+		gdouble w, h;
+
+		ev_document_get_page_size (document, i, &w, &h);
+		cache->height_to_page[i + 1] = cache->height_to_page[i] + (swap ? w : h);
+	}
+
+	/* Pages after the range only move */
+	shift = cache->height_to_page[last_page + 1] - old_height;
+	for (i = last_page + 2; shift != 0 && i <= n_pages; i++)
+		cache->height_to_page[i] += shift;
+
+	/* Same for the pairs of pages of the dual cache, see above */
+	first_pair = first_page - (first_page - cache->dual_even_left) % 2;
+	last_pair = last_page - (last_page - cache->dual_even_left) % 2;
+
+	old_height = cache->dual_height_to_page[last_pair + 2];
+	for (i = first_pair; i <= last_pair; i += 2) {
+		gdouble page_height = 0, next_page_height = 0;
+		gdouble w, h;
+
+		if (i < n_pages) {
+			ev_document_get_page_size (document, i, &w, &h);
+			page_height = swap ? w : h;
+		}
+		if (i + 1 < n_pages) {
+			ev_document_get_page_size (document, i + 1, &w, &h);
+			next_page_height = swap ? w : h;
+		}
+
+		cache->dual_height_to_page[i + 2] = cache->dual_height_to_page[i] +
+			MAX (page_height, next_page_height);
+		if (i + 3 < n_pages + 2)
+			cache->dual_height_to_page[i + 3] = cache->dual_height_to_page[i + 2];
+	}
+
+	shift = cache->dual_height_to_page[last_pair + 2] - old_height;
+	for (i = last_pair + 4; shift != 0 && i < n_pages + 2; i++)
+		cache->dual_height_to_page[i] += shift;
+}
+
 static void
 ev_height_to_page_cache_free (EvHeightToPageCache *cache)
 {
@@ -713,7 +784,8 @@ view_update_range_and_current_page (EvView *view)
 		gboolean found = FALSE;
 		gint area_max = -1, area;
 		gint best_current_page = -1;
-		int i, j = 0;
+		gint n_pages;
+		int i;
 
 		if (!(view->vadjustment && view->hadjustment))
 			return;
@@ -723,9 +795,19 @@ view_update_range_and_current_page (EvView *view)
 		current_area.y = gtk_adjustment_get_value (view->vadjustment);
 		current_area.height = gtk_adjustment_get_page_size (view->vadjustment);
 
-		for (i = 0; i < ev_document_get_n_pages (view->document); i++) {
+		/* Pages are sorted by their vertical offset, so only the pages
+		 * from the one at the top of the visible area to the first one
+		 * below it have to be checked.
+		 */
+		n_pages = ev_document_get_n_pages (view->document);
+		i = get_page_at_y_offset (view, current_area.y);
+		if (is_dual_page (view, NULL))
+			i = MAX (0, i - 1);
 
+		for (; i < n_pages; i++) {
 			ev_view_get_page_extents (view, i, &page_area, &border);
+			if (page_area.y >= current_area.y + current_area.height)
+				break;
 
 			if (gdk_rectangle_intersect (&current_area, &page_area, &unused)) {
 				area = unused.width * unused.height;
@@ -742,16 +824,6 @@ view_update_range_and_current_page (EvView *view)
 				}
 
 				view->end_page = i;
-				j = 0;
-			} else if (found && view->current_page <= view->end_page) {
-				if (is_dual_page (view, NULL) && j < 1) {
-					/* In dual mode  we stop searching
-					 * after two consecutive non-visible pages.
-					 */
-					j++;
-					continue;
-				}
-				break;
 			}
 		}
 
@@ -929,11 +1001,11 @@ compute_scroll_increment (EvView        *view,
 		doc_rect.x1 = doc_rect.x2 = rect.x + 0.5;
 		doc_rect.y1 = doc_rect.y2 = rect.y + 0.5;
 
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (view->document);
 		sel_region = ev_selection_get_selection_region (EV_SELECTION (view->document),
 								rc, EV_SELECTION_STYLE_LINE,
 								&doc_rect);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 
 		g_object_unref (rc);
 
@@ -1236,6 +1308,31 @@ get_page_y_offset (EvView *view, int page, int *y_offset)
 	return;
 }
 
+/* Returns the last page starting above @y in continuous mode. Page
+ * offsets grow with the page index, so they are binary searched using
+ * the cumulative page heights of the height to page cache.
+ */
+static gint
+get_page_at_y_offset (EvView *view,
+		      gint    y)
+{
+	gint low = 0;
+	gint high = ev_document_get_n_pages (view->document) - 1;
+
+	while (low < high) {
+		gint mid = low + (high - low + 1) / 2;
+		gint offset;
+
+		get_page_y_offset (view, mid, &offset);
+		if (offset <= y)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	return low;
+}
+
 gboolean
 ev_view_get_page_extents (EvView       *view,
 			  gint          page,
@@ -3078,10 +3175,10 @@ ev_view_annotation_save_contents (EvView       *view,
 	if (!view->document)
 		return;
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 	ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 						 annot, EV_ANNOTATIONS_SAVE_CONTENTS);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 }
 
 static GtkWidget *
@@ -3328,7 +3425,7 @@ ev_view_create_annotation (EvView *view)
 	_ev_view_transform_view_point_to_doc_point (view, &view->adding_annot_info.stop, &page_area, &border,
 						    &end.x, &end.y);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 	page = ev_document_get_page (view->document, annot_page);
         switch (view->adding_annot_info.type) {
         case EV_ANNOTATION_TYPE_TEXT:
@@ -3348,7 +3445,7 @@ ev_view_create_annotation (EvView *view)
 	case EV_ANNOTATION_TYPE_ATTACHMENT:
 		/* TODO */
 		g_object_unref (page);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 		return;
 	default:
 		g_assert_not_reached ();
@@ -3373,7 +3470,7 @@ ev_view_create_annotation (EvView *view)
 	}
 	ev_document_annotations_add_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 						annot, &doc_rect);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 
 	/* If the page didn't have annots, mark the cache as dirty */
 	if (!ev_page_cache_get_annot_mapping (view->page_cache, annot_page))
@@ -3456,10 +3553,10 @@ ev_view_remove_annotation (EvView       *view,
         }
         _ev_view_set_focused_element (view, NULL, -1);
 
-        ev_document_doc_mutex_lock ();
+        ev_document_lock (view->document);
         ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
                                                    annot);
-        ev_document_doc_mutex_unlock ();
+        ev_document_unlock (view->document);
 
         ev_page_cache_mark_dirty (view->page_cache, page, EV_PAGE_DATA_INCLUDE_ANNOTS);
 
@@ -4778,78 +4875,13 @@ _ev_view_get_caret_cursor_offset_at_doc_point (EvView *view,
 					       gdouble doc_x,
 					       gdouble doc_y)
 {
-	EvRectangle *areas = NULL;
-	guint        n_areas = 0;
-	gint         offset = -1;
-	gint         first_line_offset;
-	gint         last_line_offset = -1;
-	EvRectangle *rect;
-	guint        i;
-
-	ev_page_cache_get_text_layout (view->page_cache, page, &areas, &n_areas);
-	if (!areas)
-		return -1;
-
-	i = 0;
-	while (i < n_areas && offset == -1) {
-		rect = areas + i;
-
-		first_line_offset = -1;
-		while (doc_y >= rect->y1 && doc_y <= rect->y2) {
-			if (first_line_offset == -1) {
-				if (doc_x <= rect->x1) {
-					/* Location is before the start of the line */
-					if (last_line_offset != -1) {
-						EvRectangle *last = areas + last_line_offset;
-						gint         dx1, dx2;
-
-						/* If there's a previous line, check distances */
-
-						dx1 = doc_x - last->x2;
-						dx2 = rect->x1 - doc_x;
-
-						if (dx1 < dx2)
-							offset = last_line_offset;
-						else
-							offset = i;
-					} else {
-						offset = i;
-					}
-
-					last_line_offset = i + 1;
-					break;
-				}
-				first_line_offset = i;
-			}
-			last_line_offset = i + 1;
-
-			if (doc_x >= rect->x1 && doc_x <= rect->x2) {
-				/* Location is inside the line. Position the caret before
-				 * or after the character, depending on whether the point
-				 * falls within the left or right half of the bounding box.
-				 */
-				if (doc_x <= rect->x1 + (rect->x2 - rect->x1) / 2)
-					offset = i;
-				else
-					offset = i + 1;
-				break;
-			}
-
-			i++;
-			rect = areas + i;
-		}
-
-		if (first_line_offset == -1)
-			i++;
-	}
+	EvTextLayoutIndex *index;
 
-	if (last_line_offset == -1)
+	index = ev_page_cache_get_text_layout_index (view->page_cache, page);
+	if (!index)
 		return -1;
 
-	if (offset == -1)
-		offset = last_line_offset;
-
-	return offset;
+	return ev_text_layout_index_get_caret_offset (index, doc_x, doc_y);
 }
 
 static gboolean
@@ -5142,10 +5174,10 @@ ev_view_drag_data_get (GtkWidget        *widget,
 			if (view->image_dnd_info.image) {
 				GdkPixbuf *pixbuf;
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (view->document),
 								       view->image_dnd_info.image);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 				
 				gtk_selection_data_set_pixbuf (selection_data, pixbuf);
 				g_object_unref (pixbuf);
@@ -5157,10 +5189,10 @@ ev_view_drag_data_get (GtkWidget        *widget,
 				const gchar *tmp_uri;
 				gchar       *uris[2];
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (view->document),
 								       view->image_dnd_info.image);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 				
 				tmp_uri = ev_image_save_tmp (view->image_dnd_info.image, pixbuf);
 				g_object_unref (pixbuf);
@@ -5430,13 +5462,13 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 
 			/* Take the mutex before set_area, because the notify signal
 			 * updates the mappings in the backend */
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			if (ev_annotation_set_area (view->adding_annot_info.annot, &rect)) {
 				ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									 view->adding_annot_info.annot,
 									 EV_ANNOTATIONS_SAVE_AREA);
 			}
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 
 			/* FIXME: reload only annotation area */
@@ -5494,13 +5526,13 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 
 			/* Take the mutex before set_area, because the notify signal
 			 * updates the mappings in the backend */
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			if (ev_annotation_set_area (view->moving_annot_info.annot, &rect)) {
 				ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									 view->moving_annot_info.annot,
 									 EV_ANNOTATIONS_SAVE_AREA);
 			}
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 			/* FIXME: reload only annotation area */
 			ev_view_reload_page (view, annot_page, NULL);
@@ -5643,10 +5675,10 @@ ev_view_button_release_event (GtkWidget      *widget,
 				/* Do not create empty annots */
 				annot_added = FALSE;
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									   view->adding_annot_info.annot);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 
 				ev_page_cache_mark_dirty (view->page_cache,
 							  ev_annotation_get_page_index (view->adding_annot_info.annot),
@@ -5659,11 +5691,11 @@ ev_view_button_release_event (GtkWidget      *widget,
 
 				if (ev_annotation_markup_set_rectangle (EV_ANNOTATION_MARKUP (view->adding_annot_info.annot),
 									&popup_rect)) {
-					ev_document_doc_mutex_lock ();
+					ev_document_lock (view->document);
 					ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 										 view->adding_annot_info.annot,
 										 EV_ANNOTATIONS_SAVE_POPUP_RECT);
-					ev_document_doc_mutex_unlock ();
+					ev_document_unlock (view->document);
 				}
 
 				parent = GTK_WINDOW (gtk_widget_get_toplevel (GTK_WIDGET (view)));
@@ -6660,6 +6692,50 @@ draw_selection_region (cairo_t        *cr,
 	cairo_restore (cr);
 }
 
+static void
+draw_page_tiles (EvView       *view,
+		 cairo_t      *cr,
+		 gint          page,
+		 GdkRectangle *real_page_area,
+		 GdkRectangle *overlap)
+{
+	gint tile_size;
+	gint first_column, last_column;
+	gint first_row, last_row;
+	gint column, row;
+
+	tile_size = ev_pixbuf_cache_get_tile_size (view->pixbuf_cache);
+	first_column = (overlap->x - real_page_area->x) / tile_size;
+	last_column = (overlap->x + overlap->width - 1 - real_page_area->x) / tile_size;
+	first_row = (overlap->y - real_page_area->y) / tile_size;
+	last_row = (overlap->y + overlap->height - 1 - real_page_area->y) / tile_size;
+
+	cairo_save (cr);
+	gdk_cairo_rectangle (cr, overlap);
+	cairo_clip (cr);
+
+	for (row = first_row; row <= last_row; row++) {
+		for (column = first_column; column <= last_column; column++) {
+			cairo_surface_t *tile_surface;
+
+			/* Missing tiles are rendered in the background,
+			 * the page preview is shown meanwhile.
+			 */
+			tile_surface = ev_pixbuf_cache_get_tile_surface (view->pixbuf_cache,
+									 page, column, row);
+			if (!tile_surface)
+				continue;
+
+			cairo_set_source_surface (cr, tile_surface,
+						  real_page_area->x + column * tile_size,
+						  real_page_area->y + row * tile_size);
+			cairo_paint (cr);
+		}
+	}
+
+	cairo_restore (cr);
+}
+
 static void
 draw_one_page (EvView       *view,
 	       gint          page,
@@ -6709,8 +6785,10 @@ draw_one_page (EvView       *view,
 		cairo_surface_t *selection_surface = NULL;
 		gint offset_x, offset_y;
 		cairo_region_t *region = NULL;
+		gboolean tiled;
 
 		page_surface = ev_pixbuf_cache_get_surface (view->pixbuf_cache, page);
+		tiled = ev_pixbuf_cache_page_is_tiled (view->pixbuf_cache, page);
 
 		if (!page_surface) {
 			if (page == current_page)
@@ -6718,6 +6796,10 @@ draw_one_page (EvView       *view,
 
 			*page_ready = FALSE;
 
+			/* Tiles can be ready before the page preview */
+			if (tiled)
+				draw_page_tiles (view, cr, page, &real_page_area, &overlap);
+
 			return;
 		}
 
@@ -6729,6 +6811,8 @@ draw_one_page (EvView       *view,
 		offset_y = overlap.y - real_page_area.y;
 
 		draw_surface (cr, page_surface, overlap.x, overlap.y, offset_x, offset_y, width, height);
+		if (tiled)
+			draw_page_tiles (view, cr, page, &real_page_area, &overlap);
 
 		/* Get the selection pixbuf iff we have something to draw */
 		if (!find_selection_for_page (view, page))
@@ -6751,15 +6835,22 @@ draw_one_page (EvView       *view,
 			GdkRGBA color;
 			double device_scale_x = 1, device_scale_y = 1;
 
-			scale_x = (gdouble)width / cairo_image_surface_get_width (page_surface);
-			scale_y = (gdouble)height / cairo_image_surface_get_height (page_surface);
+			if (tiled) {
+				/* The region is already at the view scale, while
+				 * the page surface is just a preview.
+				 */
+				scale_x = scale_y = 1.0;
+			} else {
+				scale_x = (gdouble)width / cairo_image_surface_get_width (page_surface);
+				scale_y = (gdouble)height / cairo_image_surface_get_height (page_surface);
 
 #ifdef HAVE_HIDPI_SUPPORT
-			cairo_surface_get_device_scale (page_surface, &device_scale_x, &device_scale_y);
+				cairo_surface_get_device_scale (page_surface, &device_scale_x, &device_scale_y);
 #endif
 
-			scale_x *= device_scale_x;
-			scale_y *= device_scale_y;
+				scale_x *= device_scale_x;
+				scale_y *= device_scale_y;
+			}
 
 			_ev_view_get_selection_colors (view, &color, NULL);
 			draw_selection_region (cr, region, &color, real_page_area.x, real_page_area.y,
@@ -7015,6 +7106,13 @@ view_update_scale_limits (EvView *view)
 	height = (rotation == 0 || rotation == 180) ? min_height : min_width;
 	max_scale = sqrt (view->pixbuf_cache_size / (width * dpi * 4 * height * dpi));
 
+	/* Pages that don't fit in the cache are rendered in tiles when
+	 * the backend can render page areas, so the cache size doesn't
+	 * limit the scale.
+	 */
+	if (ev_document_supports_render_area (view->document))
+		max_scale = MAX (max_scale, MAX_TILED_SCALE);
+
 	ev_document_model_set_min_scale (view->model, MIN_SCALE * dpi);
 	ev_document_model_set_max_scale (view->model, max_scale * dpi);
 }
@@ -7820,6 +7918,41 @@ setup_caches (EvView *view)
 	g_signal_connect (view->pixbuf_cache, "job-finished", G_CALLBACK (job_finished_cb), view);
 }
 
+static void
+ev_view_page_metadata_changed_cb (EvDocumentModel *model,
+				  gint             first_page,
+				  gint             last_page,
+				  EvView          *view)
+{
+	gdouble width, height;
+	gint    i;
+
+	if (!view->document || !view->height_to_page_cache)
+		return;
+
+	/* Pending pages were laid out with the size of the first page, so
+	 * nothing moves unless a page turned out to be different.
+	 */
+	if (ev_document_is_page_size_uniform (view->document))
+		return;
+
+	ev_document_get_page_size (view->document, 0, &width, &height);
+	for (i = first_page; i <= last_page; i++) {
+		gdouble w, h;
+
+		ev_document_get_page_size (view->document, i, &w, &h);
+		if (w != width || h != height)
+			break;
+	}
+	if (i > last_page)
+		return;
+
+	ev_view_update_height_to_page_cache (view, view->height_to_page_cache, i, last_page);
+	view->pending_scroll = SCROLL_TO_KEEP_POSITION;
+	gtk_widget_queue_resize (GTK_WIDGET (view));
+	view_update_scale_limits (view);
+}
+
 static void
 clear_caches (EvView *view)
 {
@@ -7851,6 +7984,9 @@ void
 ev_view_set_page_cache_size (EvView *view,
 			     gsize   cache_size)
 {
+	/* Pages rendered by any view are kept with the same budget */
+	ev_surface_cache_set_max_size (cache_size);
+
 	if (view->pixbuf_cache_size == cache_size)
 		return;
 
@@ -8205,6 +8341,9 @@ ev_view_set_model (EvView          *view,
 	g_signal_connect (view->model, "page-changed",
 			  G_CALLBACK (ev_view_page_changed_cb),
 			  view);
+	g_signal_connect (view->model, "page-metadata-changed",
+			  G_CALLBACK (ev_view_page_metadata_changed_cb),
+			  view);
 
 	if (view->accessible)
 		ev_view_accessible_set_model (EV_VIEW_ACCESSIBLE (view->accessible),
@@ -8226,7 +8365,7 @@ ev_view_reload_page (EvView         *view,
 void
 ev_view_reload (EvView *view)
 {
-	ev_pixbuf_cache_clear (view->pixbuf_cache);
+	ev_pixbuf_cache_reload (view->pixbuf_cache);
 	view_update_range_and_current_page (view);
 }
 
@@ -9153,7 +9292,7 @@ get_selected_text (EvView *view)
 
 	text = g_string_new (NULL);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 
 	for (l = view->selection_info.selections; l != NULL; l = l->next) {
 		EvViewSelection *selection = (EvViewSelection *)l->data;
@@ -9169,7 +9308,7 @@ get_selected_text (EvView *view)
 		g_free (tmp);
 	}
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 	
 	normalized_text = g_utf8_normalize (text->str, text->len, G_NORMALIZE_NFKC);
 	g_string_free (text, TRUE);
@@ -391,13 +391,31 @@ get_page_text (EvDocument   *document,
                EvRectangle **areas,
                guint        *n_areas)
 {
-        gchar   *text;
-        gboolean success;
+        EvTextIndex *index;
+        gchar       *text;
+        gboolean     success;
+
+        /* The index has the same text and layout as the backend */
+        index = ev_text_index_lookup (document);
+        if (index && ev_text_index_get_n_pages (index) == ev_document_get_n_pages (document)) {
+                text = ev_text_index_get_text (index, page->index);
+                success = ev_text_index_get_text_layout (index, page->index, areas, n_areas);
+                ev_text_index_unref (index);
+
+                if (!success) {
+                        g_free (text);
+                        return NULL;
+                }
+
+                return text;
+        }
+        if (index)
+                ev_text_index_unref (index);
 
-        ev_document_doc_mutex_lock ();
+        ev_document_lock (document);
         text = ev_document_text_get_text (EV_DOCUMENT_TEXT (document), page);
         success = ev_document_text_get_text_layout (EV_DOCUMENT_TEXT (document), page, areas, n_areas);
-        ev_document_doc_mutex_unlock ();
+        ev_document_unlock (document);
 
         if (!success) {
                 g_free (text);
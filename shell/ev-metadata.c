@@ -29,6 +29,17 @@ struct _EvMetadata {
 
 	GFile      *file;
 	GHashTable *items;
+
+	/* Keys changed since the last write */
+	GHashTable *dirty_keys;
+	guint       flush_timeout_id;
+
+	/* Whether a write is running in a thread, protected by
+	 * write_mutex so that ev_metadata_flush() can wait for it */
+	GMutex      write_mutex;
+	GCond       write_cond;
+	gboolean    writing;
+	guint       n_flushes;
 };
 
 struct _EvMetadataClass {
@@ -39,11 +50,30 @@ G_DEFINE_TYPE (EvMetadata, ev_metadata, G_TYPE_OBJECT)
 
 #define EV_METADATA_NAMESPACE "metadata::evince"
 
+/* Changes are written in batches, at most once in this
+ * number of seconds, the page and the window size change
+ * very often while scrolling or resizing.
+ */
+#define EV_METADATA_FLUSH_DELAY 2
+
 static void
 ev_metadata_finalize (GObject *object)
 {
 	EvMetadata *metadata = EV_METADATA (object);
 
+	/* Writes in progress hold a reference */
+	ev_metadata_flush (metadata);
+
+	if (metadata->flush_timeout_id > 0) {
+		g_source_remove (metadata->flush_timeout_id);
+		metadata->flush_timeout_id = 0;
+	}
+
+	if (metadata->dirty_keys) {
+		g_hash_table_destroy (metadata->dirty_keys);
+		metadata->dirty_keys = NULL;
+	}
+
 	if (metadata->items) {
 		g_hash_table_destroy (metadata->items);
 		metadata->items = NULL;
@@ -54,6 +84,9 @@ ev_metadata_finalize (GObject *object)
 		metadata->file = NULL;
 	}
 
+	g_mutex_clear (&metadata->write_mutex);
+	g_cond_clear (&metadata->write_cond);
+
 	G_OBJECT_CLASS (ev_metadata_parent_class)->finalize (object);
 }
 
@@ -64,6 +97,12 @@ ev_metadata_init (EvMetadata *metadata)
 						 g_str_equal,
 						 g_free,
 						 g_free);
+	metadata->dirty_keys = g_hash_table_new_full (g_str_hash,
+						      g_str_equal,
+						      g_free,
+						      NULL);
+	g_mutex_init (&metadata->write_mutex);
+	g_cond_init (&metadata->write_cond);
 }
 
 static void
@@ -159,51 +198,188 @@ ev_metadata_get_string (EvMetadata  *metadata,
 	return TRUE;
 }
 
+/* Takes the changed keys, with their current values */
+static GFileInfo *
+ev_metadata_steal_dirty_info (EvMetadata *metadata)
+{
+	GFileInfo     *info;
+	GHashTableIter iter;
+	gpointer       key;
+
+	info = g_file_info_new ();
+
+	g_hash_table_iter_init (&iter, metadata->dirty_keys);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *value;
+		gchar       *gio_key;
+
+		value = g_hash_table_lookup (metadata->items, key);
+		gio_key = g_strconcat (EV_METADATA_NAMESPACE"::", key, NULL);
+		if (value) {
+			g_file_info_set_attribute_string (info, gio_key, value);
+		} else {
+			g_file_info_set_attribute (info, gio_key,
+						   G_FILE_ATTRIBUTE_TYPE_INVALID,
+						   NULL);
+		}
+		g_free (gio_key);
+	}
+	g_hash_table_remove_all (metadata->dirty_keys);
+
+	return info;
+}
+
 static void
-metadata_set_callback (GObject      *file,
-		       GAsyncResult *result,
-		       EvMetadata   *metadata)
+ev_metadata_write (EvMetadata *metadata,
+		   GFileInfo  *info)
 {
 	GError *error = NULL;
 
-	if (!g_file_set_attributes_finish (G_FILE (file), result, NULL, &error)) {
+	if (!g_file_set_attributes_from_info (metadata->file, info, 0, NULL, &error)) {
 		g_warning ("%s", error->message);
 		g_error_free (error);
 	}
 }
 
+static void ev_metadata_schedule_flush (EvMetadata *metadata);
+
+static void
+ev_metadata_write_thread (GTask        *task,
+			  EvMetadata   *metadata,
+			  GFileInfo    *info,
+			  GCancellable *cancellable)
+{
+	ev_metadata_write (metadata, info);
+
+	g_mutex_lock (&metadata->write_mutex);
+	metadata->writing = FALSE;
+	metadata->n_flushes++;
+	g_cond_broadcast (&metadata->write_cond);
+	g_mutex_unlock (&metadata->write_mutex);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+ev_metadata_write_cb (EvMetadata   *metadata,
+		      GAsyncResult *result,
+		      gpointer      user_data)
+{
+	/* Keys changed while writing */
+	if (g_hash_table_size (metadata->dirty_keys) > 0)
+		ev_metadata_schedule_flush (metadata);
+}
+
+static gboolean
+ev_metadata_flush_timeout_cb (EvMetadata *metadata)
+{
+	GFileInfo *info;
+	GTask     *task;
+	gboolean   writing;
+
+	metadata->flush_timeout_id = 0;
+
+	/* Only one write at a time, so that they are done in order */
+	g_mutex_lock (&metadata->write_mutex);
+	writing = metadata->writing;
+	metadata->writing = TRUE;
+	g_mutex_unlock (&metadata->write_mutex);
+
+	if (writing) {
+		ev_metadata_schedule_flush (metadata);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* The task keeps a reference to metadata until the write is done */
+	info = ev_metadata_steal_dirty_info (metadata);
+	task = g_task_new (metadata, NULL,
+			   (GAsyncReadyCallback)ev_metadata_write_cb, NULL);
+	g_task_set_task_data (task, info, g_object_unref);
+	g_task_run_in_thread (task, (GTaskThreadFunc)ev_metadata_write_thread);
+	g_object_unref (task);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+ev_metadata_schedule_flush (EvMetadata *metadata)
+{
+	if (metadata->flush_timeout_id > 0)
+		return;
+
+	metadata->flush_timeout_id =
+		g_timeout_add_seconds (EV_METADATA_FLUSH_DELAY,
+				       (GSourceFunc)ev_metadata_flush_timeout_cb,
+				       metadata);
+}
+
+/**
+ * ev_metadata_flush:
+ * @metadata: an #EvMetadata
+ *
+ * Writes the pending changes now. They are written synchronously, so
+ * that they are not lost if the application exits right after. A
+ * previous write still in progress is waited for first, so that the
+ * changes are not overwritten by older values.
+ */
+void
+ev_metadata_flush (EvMetadata *metadata)
+{
+	GFileInfo *info;
+
+	if (g_hash_table_size (metadata->dirty_keys) == 0)
+		return;
+
+	if (metadata->flush_timeout_id > 0) {
+		g_source_remove (metadata->flush_timeout_id);
+		metadata->flush_timeout_id = 0;
+	}
+
+	g_mutex_lock (&metadata->write_mutex);
+	while (metadata->writing)
+		g_cond_wait (&metadata->write_cond, &metadata->write_mutex);
+	metadata->n_flushes++;
+	g_mutex_unlock (&metadata->write_mutex);
+
+	info = ev_metadata_steal_dirty_info (metadata);
+	ev_metadata_write (metadata, info);
+	g_object_unref (info);
+}
+
+/**
+ * ev_metadata_get_n_flushes:
+ * @metadata: an #EvMetadata
+ *
+ * Returns: the number of times changes have been written to the file
+ */
+guint
+ev_metadata_get_n_flushes (EvMetadata *metadata)
+{
+	guint n_flushes;
+
+	g_mutex_lock (&metadata->write_mutex);
+	n_flushes = metadata->n_flushes;
+	g_mutex_unlock (&metadata->write_mutex);
+
+	return n_flushes;
+}
+
 gboolean
 ev_metadata_set_string (EvMetadata  *metadata,
 			const gchar *key,
 			const gchar *value)
 {
-	GFileInfo *info;
-	gchar     *gio_key;
+	/* Nothing to write if the value didn't change */
+	if (g_hash_table_contains (metadata->items, key) &&
+	    g_strcmp0 (g_hash_table_lookup (metadata->items, key), value) == 0)
+		return TRUE;
 
         g_hash_table_insert (metadata->items, g_strdup (key), g_strdup (value));
         if (!metadata->file)
                 return TRUE;
 
-	info = g_file_info_new ();
-
-	gio_key = g_strconcat (EV_METADATA_NAMESPACE"::", key, NULL);
-	if (value) {
-		g_file_info_set_attribute_string (info, gio_key, value);
-	} else {
-		g_file_info_set_attribute (info, gio_key,
-					   G_FILE_ATTRIBUTE_TYPE_INVALID,
-					   NULL);
-	}
-	g_free (gio_key);
-
-	g_file_set_attributes_async (metadata->file,
-				     info,
-				     0,
-				     G_PRIORITY_DEFAULT,
-				     NULL,
-				     (GAsyncReadyCallback)metadata_set_callback,
-				     metadata);
-	g_object_unref (info);
+	g_hash_table_add (metadata->dirty_keys, g_strdup (key));
+	ev_metadata_schedule_flush (metadata);
 
 	return TRUE;
 }
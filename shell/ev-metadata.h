@@ -64,6 +64,8 @@ gboolean    ev_metadata_set_boolean           (EvMetadata  *metadata,
 					       gboolean     value);
 gboolean    ev_metadata_has_key               (EvMetadata  *metadata,
                                                const gchar *key);
+void        ev_metadata_flush                 (EvMetadata  *metadata);
+guint       ev_metadata_get_n_flushes         (EvMetadata  *metadata);
 
 gboolean    ev_is_metadata_supported_for_file (GFile       *file);
 
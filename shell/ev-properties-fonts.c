@@ -186,6 +186,8 @@ job_fonts_finished_cb (EvJob *job, EvPropertiesFonts *properties)
 	g_object_unref (properties->fonts_job);
 	properties->fonts_job = NULL;
 
+	update_progress_label (properties->fonts_progress_label, 0);
+
 	font_summary = ev_document_fonts_get_fonts_summary (document_fonts);
 	if (font_summary) {
 		gtk_label_set_text (GTK_LABEL (properties->fonts_summary),
@@ -204,8 +206,8 @@ job_fonts_updated_cb (EvJobFonts *job, gdouble progress, EvPropertiesFonts *prop
 
 	update_progress_label (properties->fonts_progress_label, progress);
 
+	/* Only the fonts found since the last update are appended */
 	model = gtk_tree_view_get_model (GTK_TREE_VIEW (properties->fonts_treeview));
-	/* Documen lock is already held by the jop */
 	ev_document_fonts_fill_model (document_fonts, model);
 }
 
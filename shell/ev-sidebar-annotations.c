@@ -38,6 +38,7 @@ enum {
 	COLUMN_MARKUP,
 	COLUMN_ICON,
 	COLUMN_ANNOT_MAPPING,
+	COLUMN_PAGE,
 	N_COLUMNS
 };
 
@@ -47,17 +48,36 @@ enum {
 };
 
 struct _EvSidebarAnnotationsPrivate {
-	EvDocument  *document;
+	EvDocument      *document;
+	EvDocumentModel *doc_model;
 
         GtkWidget   *swindow;
 	GtkWidget   *tree_view;
 
 	EvJob       *job;
 	guint        selection_changed_id;
+
+	/* Filled as the job finds annotations */
+	GtkTreeStore *model;
+	GtkTreeIter   last_page_iter;
+	gint          last_page;
+	gboolean      has_last_page;
+	gboolean      streaming;
+
+	GdkPixbuf   *text_icon;
+	GdkPixbuf   *attachment_icon;
+	GdkPixbuf   *highlight_icon;
+	GdkPixbuf   *strike_out_icon;
+	GdkPixbuf   *underline_icon;
+	GdkPixbuf   *squiggly_icon;
 };
 
+/* Pages from the current one scanned before the rest of the document */
+#define PRIORITY_PAGES 10
+
 static void ev_sidebar_annotations_page_iface_init (EvSidebarPageInterface *iface);
 static void ev_sidebar_annotations_load            (EvSidebarAnnotations   *sidebar_annots);
+static void ev_sidebar_annotations_clear_job       (EvSidebarAnnotations   *sidebar_annots);
 
 static guint signals[N_SIGNALS];
 
@@ -77,6 +97,8 @@ ev_sidebar_annotations_dispose (GObject *object)
 	EvSidebarAnnotations *sidebar_annots = EV_SIDEBAR_ANNOTATIONS (object);
 	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
 
+	ev_sidebar_annotations_clear_job (sidebar_annots);
+
 	if (priv->document) {
 		g_object_unref (priv->document);
 		priv->document = NULL;
@@ -96,7 +118,8 @@ ev_sidebar_annotations_create_simple_model (const gchar *message)
 	retval = (GtkTreeModel *)gtk_list_store_new (N_COLUMNS,
 						     G_TYPE_STRING,
 						     GDK_TYPE_PIXBUF,
-						     G_TYPE_POINTER);
+						     G_TYPE_POINTER,
+						     G_TYPE_INT);
 
 	gtk_list_store_append (GTK_LIST_STORE (retval), &iter);
 	markup = g_strdup_printf ("<span size=\"larger\" style=\"italic\">%s</span>",
@@ -237,36 +260,169 @@ selection_changed_cb (GtkTreeSelection     *selection,
 	}
 }
 
-static void
-job_finished_callback (EvJobAnnots          *job,
-		       EvSidebarAnnotations *sidebar_annots)
+static GdkPixbuf *
+ev_sidebar_annotations_get_icon (EvSidebarAnnotations *sidebar_annots,
+				 EvAnnotation         *annot)
 {
-	EvSidebarAnnotationsPrivate *priv;
-	GtkTreeStore *model;
-	GtkTreeSelection *selection;
-	GList *l;
-	GdkPixbuf *text_icon = NULL;
-	GdkPixbuf *attachment_icon = NULL;
-        GdkPixbuf *highlight_icon = NULL;
-        GdkPixbuf *strike_out_icon = NULL;
-        GdkPixbuf *underline_icon = NULL;
-        GdkPixbuf *squiggly_icon = NULL;
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
 
-	priv = sidebar_annots->priv;
+	if (EV_IS_ANNOTATION_TEXT (annot)) {
+		if (!priv->text_icon) {
+			/* FIXME: use a better icon than EDIT */
+			priv->text_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
+									 GTK_STOCK_EDIT,
+									 GTK_ICON_SIZE_BUTTON);
+		}
+		return priv->text_icon;
+	} else if (EV_IS_ANNOTATION_ATTACHMENT (annot)) {
+		if (!priv->attachment_icon) {
+			priv->attachment_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
+									       EV_STOCK_ATTACHMENT,
+									       GTK_ICON_SIZE_BUTTON);
+		}
+		return priv->attachment_icon;
+	} else if (EV_IS_ANNOTATION_TEXT_MARKUP (annot)) {
+		switch (ev_annotation_text_markup_get_markup_type (EV_ANNOTATION_TEXT_MARKUP (annot))) {
+		case EV_ANNOTATION_TEXT_MARKUP_HIGHLIGHT:
+			if (!priv->highlight_icon) {
+				/* FIXME: use better icon than select all */
+				priv->highlight_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
+										      GTK_STOCK_SELECT_ALL,
+										      GTK_ICON_SIZE_BUTTON);
+			}
+			return priv->highlight_icon;
+		case EV_ANNOTATION_TEXT_MARKUP_STRIKE_OUT:
+			if (!priv->strike_out_icon) {
+				priv->strike_out_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
+										       GTK_STOCK_STRIKETHROUGH,
+										       GTK_ICON_SIZE_BUTTON);
+			}
+			return priv->strike_out_icon;
+		case EV_ANNOTATION_TEXT_MARKUP_UNDERLINE:
+			if (!priv->underline_icon) {
+				priv->underline_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
+										      GTK_STOCK_UNDERLINE,
+										      GTK_ICON_SIZE_BUTTON);
+			}
+			return priv->underline_icon;
+		case EV_ANNOTATION_TEXT_MARKUP_SQUIGGLY:
+			if (!priv->squiggly_icon) {
+				priv->squiggly_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
+										     GTK_STOCK_UNDERLINE,
+										     GTK_ICON_SIZE_BUTTON);
+			}
+			return priv->squiggly_icon;
+		}
+	}
 
-	if (!job->annots) {
-		GtkTreeModel *list;
+	return NULL;
+}
 
-		list = ev_sidebar_annotations_create_simple_model (_("Document contains no annotations"));
-		gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view), list);
-		g_object_unref (list);
+static void
+ev_sidebar_annotations_clear_icons (EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
 
-		g_object_unref (job);
-		priv->job = NULL;
+	g_clear_object (&priv->text_icon);
+	g_clear_object (&priv->attachment_icon);
+	g_clear_object (&priv->highlight_icon);
+	g_clear_object (&priv->strike_out_icon);
+	g_clear_object (&priv->underline_icon);
+	g_clear_object (&priv->squiggly_icon);
+}
 
+static void
+ev_sidebar_annotations_add_page (EvSidebarAnnotations *sidebar_annots,
+				 EvMappingList        *mapping_list)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+	GtkTreeModel *model = GTK_TREE_MODEL (priv->model);
+	GList        *l;
+	gchar        *page_label;
+	GtkTreeIter   iter;
+	GtkTreeIter   sibling;
+	gboolean      has_sibling;
+	gint          page;
+
+	for (l = ev_mapping_list_get_list (mapping_list); l; l = g_list_next (l)) {
+		if (EV_IS_ANNOTATION_MARKUP (((EvMapping *)(l->data))->data))
+			break;
+	}
+	if (!l)
 		return;
+
+	/* Pages are mostly found in order, so the position
+	 * is looked for from the last page backwards.
+	 */
+	page = ev_mapping_list_get_page (mapping_list);
+	has_sibling = priv->has_last_page;
+	sibling = priv->last_page_iter;
+	while (has_sibling) {
+		gint sibling_page;
+
+		gtk_tree_model_get (model, &sibling,
+				    COLUMN_PAGE, &sibling_page,
+				    -1);
+		if (sibling_page < page)
+			break;
+		has_sibling = gtk_tree_model_iter_previous (model, &sibling);
 	}
 
+	gtk_tree_store_insert_after (priv->model, &iter, NULL,
+				     has_sibling ? &sibling : NULL);
+	if (!priv->has_last_page || page > priv->last_page) {
+		priv->last_page_iter = iter;
+		priv->last_page = page;
+		priv->has_last_page = TRUE;
+	}
+
+	page_label = g_strdup_printf (_("Page %d"), page + 1);
+	gtk_tree_store_set (priv->model, &iter,
+			    COLUMN_MARKUP, page_label,
+			    COLUMN_PAGE, page,
+			    -1);
+	g_free (page_label);
+
+	for (l = ev_mapping_list_get_list (mapping_list); l; l = g_list_next (l)) {
+		EvAnnotation *annot;
+		const gchar  *label;
+		const gchar  *modified;
+		gchar        *markup;
+		GtkTreeIter   child_iter;
+
+		annot = ((EvMapping *)(l->data))->data;
+		if (!EV_IS_ANNOTATION_MARKUP (annot))
+			continue;
+
+		label = ev_annotation_markup_get_label (EV_ANNOTATION_MARKUP (annot));
+		modified = ev_annotation_get_modified (annot);
+		if (modified) {
+			markup = g_strdup_printf ("<span weight=\"bold\">%s</span>\n%s",
+						  label, modified);
+		} else {
+			markup = g_strdup_printf ("<span weight=\"bold\">%s</span>", label);
+		}
+
+		gtk_tree_store_append (priv->model, &child_iter, &iter);
+		gtk_tree_store_set (priv->model, &child_iter,
+				    COLUMN_MARKUP, markup,
+				    COLUMN_ICON, ev_sidebar_annotations_get_icon (sidebar_annots, annot),
+				    COLUMN_ANNOT_MAPPING, l->data,
+				    COLUMN_PAGE, page,
+				    -1);
+		g_free (markup);
+	}
+}
+
+static void
+ev_sidebar_annotations_show_model (EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+	GtkTreeSelection *selection;
+
+	if (gtk_tree_view_get_model (GTK_TREE_VIEW (priv->tree_view)) == GTK_TREE_MODEL (priv->model))
+		return;
+
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree_view));
 	gtk_tree_selection_set_mode (selection, GTK_SELECTION_SINGLE);
 	if (priv->selection_changed_id == 0) {
@@ -276,150 +432,94 @@ job_finished_callback (EvJobAnnots          *job,
 					  sidebar_annots);
 	}
 
-	model = gtk_tree_store_new (N_COLUMNS,
-				    G_TYPE_STRING,
-				    GDK_TYPE_PIXBUF,
-				    G_TYPE_POINTER);
-
-	for (l = job->annots; l; l = g_list_next (l)) {
-		EvMappingList *mapping_list;
-		GList         *ll;
-		gchar         *page_label;
-		GtkTreeIter    iter;
-		gboolean       found = FALSE;
-
-		mapping_list = (EvMappingList *)l->data;
-		page_label = g_strdup_printf (_("Page %d"),
-					      ev_mapping_list_get_page (mapping_list) + 1);
-		gtk_tree_store_append (model, &iter, NULL);
-		gtk_tree_store_set (model, &iter,
-				    COLUMN_MARKUP, page_label,
-				    -1);
-		g_free (page_label);
-
-		for (ll = ev_mapping_list_get_list (mapping_list); ll; ll = g_list_next (ll)) {
-			EvAnnotation *annot;
-			const gchar  *label;
-			const gchar  *modified;
-			gchar        *markup;
-			GtkTreeIter   child_iter;
-			GdkPixbuf    *pixbuf = NULL;
-
-			annot = ((EvMapping *)(ll->data))->data;
-			if (!EV_IS_ANNOTATION_MARKUP (annot))
-				continue;
-
-			label = ev_annotation_markup_get_label (EV_ANNOTATION_MARKUP (annot));
-			modified = ev_annotation_get_modified (annot);
-			if (modified) {
-				markup = g_strdup_printf ("<span weight=\"bold\">%s</span>\n%s",
-							  label, modified);
-			} else {
-				markup = g_strdup_printf ("<span weight=\"bold\">%s</span>", label);
-			}
+	gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view),
+				 GTK_TREE_MODEL (priv->model));
+}
 
-			if (EV_IS_ANNOTATION_TEXT (annot)) {
-				if (!text_icon) {
-					/* FIXME: use a better icon than EDIT */
-					text_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
-                                                                                   GTK_STOCK_EDIT,
-                                                                                   GTK_ICON_SIZE_BUTTON);
-				}
-				pixbuf = text_icon;
-			} else if (EV_IS_ANNOTATION_ATTACHMENT (annot)) {
-				if (!attachment_icon) {
-					attachment_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
-                                                                                         EV_STOCK_ATTACHMENT,
-                                                                                         GTK_ICON_SIZE_BUTTON);
-				}
-				pixbuf = attachment_icon;
-			} else if (EV_IS_ANNOTATION_TEXT_MARKUP (annot)) {
-                                switch (ev_annotation_text_markup_get_markup_type (EV_ANNOTATION_TEXT_MARKUP (annot))) {
-                                case EV_ANNOTATION_TEXT_MARKUP_HIGHLIGHT:
-                                        if (!highlight_icon) {
-                                                /* FIXME: use better icon than select all */
-                                                highlight_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
-                                                                                                GTK_STOCK_SELECT_ALL,
-                                                                                                GTK_ICON_SIZE_BUTTON);
-                                        }
-                                        pixbuf = highlight_icon;
-
-                                        break;
-                                case EV_ANNOTATION_TEXT_MARKUP_STRIKE_OUT:
-                                        if (!strike_out_icon) {
-                                                strike_out_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
-                                                                                                 GTK_STOCK_STRIKETHROUGH,
-                                                                                                 GTK_ICON_SIZE_BUTTON);
-                                        }
-                                        pixbuf = strike_out_icon;
-                                        break;
-                                case EV_ANNOTATION_TEXT_MARKUP_UNDERLINE:
-                                        if (!underline_icon) {
-                                                underline_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
-                                                                                                GTK_STOCK_UNDERLINE,
-                                                                                                GTK_ICON_SIZE_BUTTON);
-                                        }
-                                        pixbuf = underline_icon;
-                                        break;
-                                case EV_ANNOTATION_TEXT_MARKUP_SQUIGGLY:
-                                        if (!squiggly_icon) {
-                                                squiggly_icon = gtk_widget_render_icon_pixbuf (priv->tree_view,
-                                                                                               GTK_STOCK_UNDERLINE,
-                                                                                               GTK_ICON_SIZE_BUTTON);
-                                        }
-                                        pixbuf = squiggly_icon;
-                                        break;
-                                }
-                        }
-
-			gtk_tree_store_append (model, &child_iter, &iter);
-			gtk_tree_store_set (model, &child_iter,
-					    COLUMN_MARKUP, markup,
-					    COLUMN_ICON, pixbuf,
-					    COLUMN_ANNOT_MAPPING, ll->data,
-					    -1);
-			g_free (markup);
-			found = TRUE;
-		}
+static void
+job_updated_callback (EvJobAnnots          *job,
+		      GList                *annots,
+		      EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+	GList *l;
 
-		if (!found)
-			gtk_tree_store_remove (model, &iter);
+	for (l = annots; l; l = g_list_next (l))
+		ev_sidebar_annotations_add_page (sidebar_annots, l->data);
+
+	/* The first time annotations are shown as they are found,
+	 * reloads keep the previous list until they are done.
+	 */
+	if (priv->streaming && priv->has_last_page)
+		ev_sidebar_annotations_show_model (sidebar_annots);
+}
+
+static void
+job_finished_callback (EvJobAnnots          *job,
+		       EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+
+	if (!priv->has_last_page) {
+		GtkTreeModel *list;
+
+		list = ev_sidebar_annotations_create_simple_model (_("Document contains no annotations"));
+		gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view), list);
+		g_object_unref (list);
+	} else {
+		ev_sidebar_annotations_show_model (sidebar_annots);
 	}
 
-	gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view),
-				 GTK_TREE_MODEL (model));
-	g_object_unref (model);
-
-	if (text_icon)
-		g_object_unref (text_icon);
-	if (attachment_icon)
-		g_object_unref (attachment_icon);
-        if (highlight_icon)
-                g_object_unref (highlight_icon);
-        if (strike_out_icon)
-                g_object_unref (strike_out_icon);
-        if (underline_icon)
-                g_object_unref (underline_icon);
-        if (squiggly_icon)
-                g_object_unref (squiggly_icon);
-
-	g_object_unref (job);
-	priv->job = NULL;
+	ev_sidebar_annotations_clear_job (sidebar_annots);
 }
 
 static void
-ev_sidebar_annotations_load (EvSidebarAnnotations *sidebar_annots)
+ev_sidebar_annotations_clear_job (EvSidebarAnnotations *sidebar_annots)
 {
 	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
 
 	if (priv->job) {
+		g_signal_handlers_disconnect_by_func (priv->job,
+						      job_updated_callback,
+						      sidebar_annots);
 		g_signal_handlers_disconnect_by_func (priv->job,
 						      job_finished_callback,
 						      sidebar_annots);
+		ev_job_cancel (priv->job);
 		g_object_unref (priv->job);
+		priv->job = NULL;
 	}
 
+	/* The tree view keeps its own reference */
+	g_clear_object (&priv->model);
+	priv->has_last_page = FALSE;
+
+	ev_sidebar_annotations_clear_icons (sidebar_annots);
+}
+
+static void
+ev_sidebar_annotations_load (EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+	gint                         page;
+
+	ev_sidebar_annotations_clear_job (sidebar_annots);
+
+	priv->model = gtk_tree_store_new (N_COLUMNS,
+					  G_TYPE_STRING,
+					  GDK_TYPE_PIXBUF,
+					  G_TYPE_POINTER,
+					  G_TYPE_INT);
+	/* Only the loading and empty messages are list stores */
+	priv->streaming = !GTK_IS_TREE_STORE (gtk_tree_view_get_model (GTK_TREE_VIEW (priv->tree_view)));
+
 	priv->job = ev_job_annots_new (priv->document);
+	page = priv->doc_model ? ev_document_model_get_page (priv->doc_model) : 0;
+	ev_job_annots_set_priority_range (EV_JOB_ANNOTS (priv->job),
+					  MAX (page, 0), MAX (page, 0) + PRIORITY_PAGES - 1);
+	g_signal_connect (priv->job, "updated",
+			  G_CALLBACK (job_updated_callback),
+			  sidebar_annots);
 	g_signal_connect (priv->job, "finished",
 			  G_CALLBACK (job_finished_callback),
 			  sidebar_annots);
@@ -427,6 +527,21 @@ ev_sidebar_annotations_load (EvSidebarAnnotations *sidebar_annots)
 	ev_job_scheduler_push_job (priv->job, EV_JOB_PRIORITY_NONE);
 }
 
+static void
+ev_sidebar_annotations_page_changed_cb (EvDocumentModel      *model,
+					gint                  old_page,
+					gint                  new_page,
+					EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+
+	/* Annotations of the pages being read are found first */
+	if (priv->job && new_page >= 0) {
+		ev_job_annots_set_priority_range (EV_JOB_ANNOTS (priv->job),
+						  new_page, new_page + PRIORITY_PAGES - 1);
+	}
+}
+
 static void
 ev_sidebar_annotations_document_changed_cb (EvDocumentModel      *model,
 					    GParamSpec           *pspec,
@@ -450,9 +565,14 @@ static void
 ev_sidebar_annotations_set_model (EvSidebarPage   *sidebar_page,
 				  EvDocumentModel *model)
 {
+	EV_SIDEBAR_ANNOTATIONS (sidebar_page)->priv->doc_model = model;
+
 	g_signal_connect (model, "notify::document",
 			  G_CALLBACK (ev_sidebar_annotations_document_changed_cb),
 			  sidebar_page);
+	g_signal_connect (model, "page-changed",
+			  G_CALLBACK (ev_sidebar_annotations_page_changed_cb),
+			  sidebar_page);
 }
 
 static gboolean
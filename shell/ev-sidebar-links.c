@@ -47,8 +47,18 @@ struct _EvSidebarLinksPrivate {
 	GtkTreeModel *model;
 	EvDocument *document;
 	EvDocumentModel *doc_model;
+
+	/* Page labels are resolved in the background for the rows shown */
+	GHashTable *labels_requested;
+	GArray *labels_pending;
+	GArray *labels_job_iters;
+	EvJob *labels_job;
+	guint labels_idle_id;
 };
 
+/* Number of page labels resolved by every job */
+#define LABELS_BATCH_SIZE 64
+
 enum {
 	PROP_0,
 	PROP_MODEL,
@@ -67,6 +77,7 @@ static void row_activated_callback 			(GtkTreeView *treeview,
 		                                         GtkTreePath *arg1,
 	                                                 GtkTreeViewColumn *arg2,
 		                                         gpointer user_data);
+static void ev_sidebar_links_clear_labels               (EvSidebarLinks *links);
 static void ev_sidebar_links_set_links_model            (EvSidebarLinks *links,
 							 GtkTreeModel   *model);
 static void job_finished_callback 			(EvJobLinks     *job,
@@ -147,6 +158,14 @@ ev_sidebar_links_dispose (GObject *object)
 		sidebar->priv->job = NULL;
 	}
 
+	if (sidebar->priv->labels_requested) {
+		ev_sidebar_links_clear_labels (sidebar);
+		g_hash_table_destroy (sidebar->priv->labels_requested);
+		sidebar->priv->labels_requested = NULL;
+		g_array_free (sidebar->priv->labels_pending, TRUE);
+		sidebar->priv->labels_pending = NULL;
+	}
+
 	if (sidebar->priv->model) {
 		g_object_unref (sidebar->priv->model);
 		sidebar->priv->model = NULL;
@@ -383,6 +402,142 @@ button_press_cb (GtkWidget *treeview,
 }
 
 
+static void ev_sidebar_links_queue_labels (EvSidebarLinks *sidebar_links);
+
+static void
+labels_job_finished_callback (EvJobLinkLabels *job,
+			      EvSidebarLinks  *sidebar_links)
+{
+	EvSidebarLinksPrivate *priv = sidebar_links->priv;
+	guint                  i;
+
+	for (i = 0; i < priv->labels_job_iters->len; i++) {
+		if (!job->labels[i])
+			continue;
+
+		gtk_tree_store_set (GTK_TREE_STORE (priv->model),
+				    &g_array_index (priv->labels_job_iters, GtkTreeIter, i),
+				    EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL, job->labels[i],
+				    -1);
+	}
+
+	g_array_free (priv->labels_job_iters, TRUE);
+	priv->labels_job_iters = NULL;
+	g_object_unref (priv->labels_job);
+	priv->labels_job = NULL;
+
+	ev_sidebar_links_queue_labels (sidebar_links);
+}
+
+static gboolean
+labels_idle_callback (EvSidebarLinks *sidebar_links)
+{
+	EvSidebarLinksPrivate *priv = sidebar_links->priv;
+	GPtrArray             *links;
+	guint                  n_links, i;
+
+	priv->labels_idle_id = 0;
+
+	n_links = MIN (priv->labels_pending->len, LABELS_BATCH_SIZE);
+	links = g_ptr_array_new_full (n_links, (GDestroyNotify)g_object_unref);
+	priv->labels_job_iters = g_array_sized_new (FALSE, FALSE, sizeof (GtkTreeIter), n_links);
+
+	/* The rows requested last are the ones shown now */
+	for (i = 0; i < n_links; i++) {
+		GtkTreeIter *iter;
+		EvLink      *link;
+
+		iter = &g_array_index (priv->labels_pending, GtkTreeIter,
+				       priv->labels_pending->len - 1 - i);
+		gtk_tree_model_get (priv->model, iter,
+				    EV_DOCUMENT_LINKS_COLUMN_LINK, &link,
+				    -1);
+		g_ptr_array_add (links, link);
+		g_array_append_val (priv->labels_job_iters, *iter);
+	}
+	g_array_set_size (priv->labels_pending, priv->labels_pending->len - n_links);
+
+	priv->labels_job = ev_job_link_labels_new (priv->document, links);
+	g_ptr_array_unref (links);
+	g_signal_connect (priv->labels_job, "finished",
+			  G_CALLBACK (labels_job_finished_callback),
+			  sidebar_links);
+	ev_job_scheduler_push_job (priv->labels_job, EV_JOB_PRIORITY_LOW);
+
+	return FALSE;
+}
+
+static void
+ev_sidebar_links_queue_labels (EvSidebarLinks *sidebar_links)
+{
+	EvSidebarLinksPrivate *priv = sidebar_links->priv;
+
+	/* Rows drawn meanwhile are added to the next batch */
+	if (priv->labels_job || priv->labels_idle_id > 0 || priv->labels_pending->len == 0)
+		return;
+
+	priv->labels_idle_id = g_idle_add ((GSourceFunc)labels_idle_callback, sidebar_links);
+}
+
+static void
+ev_sidebar_links_clear_labels (EvSidebarLinks *sidebar_links)
+{
+	EvSidebarLinksPrivate *priv = sidebar_links->priv;
+
+	if (priv->labels_job) {
+		g_signal_handlers_disconnect_by_func (priv->labels_job,
+						      labels_job_finished_callback,
+						      sidebar_links);
+		ev_job_cancel (priv->labels_job);
+		g_object_unref (priv->labels_job);
+		priv->labels_job = NULL;
+	}
+
+	if (priv->labels_job_iters) {
+		g_array_free (priv->labels_job_iters, TRUE);
+		priv->labels_job_iters = NULL;
+	}
+
+	if (priv->labels_idle_id > 0) {
+		g_source_remove (priv->labels_idle_id);
+		priv->labels_idle_id = 0;
+	}
+
+	g_array_set_size (priv->labels_pending, 0);
+	g_hash_table_remove_all (priv->labels_requested);
+}
+
+static void
+page_label_cell_data_func (GtkTreeViewColumn *column,
+			   GtkCellRenderer   *renderer,
+			   GtkTreeModel      *model,
+			   GtkTreeIter       *iter,
+			   EvSidebarLinks    *sidebar_links)
+{
+	EvSidebarLinksPrivate *priv = sidebar_links->priv;
+	EvLink                *link;
+	gchar                 *page_label;
+
+	if (model != priv->model || !priv->labels_requested)
+		return;
+
+	gtk_tree_model_get (model, iter,
+			    EV_DOCUMENT_LINKS_COLUMN_LINK, &link,
+			    EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL, &page_label,
+			    -1);
+
+	/* Links are owned by the model, so they identify the rows */
+	if (link && !page_label && !g_hash_table_contains (priv->labels_requested, link)) {
+		g_hash_table_add (priv->labels_requested, link);
+		g_array_append_val (priv->labels_pending, *iter);
+		ev_sidebar_links_queue_labels (sidebar_links);
+	}
+
+	g_free (page_label);
+	if (link)
+		g_object_unref (link);
+}
+
 static void
 ev_sidebar_links_construct (EvSidebarLinks *ev_sidebar_links)
 {
@@ -437,6 +592,9 @@ ev_sidebar_links_construct (EvSidebarLinks *ev_sidebar_links)
 	gtk_tree_view_column_set_attributes (GTK_TREE_VIEW_COLUMN (column), renderer,
 					     "text", EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL,
 					     NULL);
+	gtk_tree_view_column_set_cell_data_func (GTK_TREE_VIEW_COLUMN (column), renderer,
+						 (GtkTreeCellDataFunc)page_label_cell_data_func,
+						 ev_sidebar_links, NULL);
 
 	g_signal_connect (priv->tree_view,
 			  "button_press_event",
@@ -453,6 +611,9 @@ ev_sidebar_links_init (EvSidebarLinks *ev_sidebar_links)
 {
 	ev_sidebar_links->priv = EV_SIDEBAR_LINKS_GET_PRIVATE (ev_sidebar_links);
 
+	ev_sidebar_links->priv->labels_requested = g_hash_table_new (g_direct_hash, g_direct_equal);
+	ev_sidebar_links->priv->labels_pending = g_array_new (FALSE, FALSE, sizeof (GtkTreeIter));
+
 	ev_sidebar_links_construct (ev_sidebar_links);
 }
 
@@ -608,6 +769,9 @@ ev_sidebar_links_set_links_model (EvSidebarLinks *sidebar_links,
 	if (priv->model == model)
 		return;
 
+	/* The rows waiting for a label belong to the old model */
+	ev_sidebar_links_clear_labels (sidebar_links);
+
 	if (priv->model)
 		g_object_unref (priv->model);
 	priv->model = g_object_ref (model);
@@ -670,6 +834,7 @@ ev_sidebar_links_document_changed_cb (EvDocumentModel *model,
 		return;
 
 	if (priv->document) {
+		ev_sidebar_links_clear_labels (sidebar_links);
 		gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view), NULL);
 		g_object_unref (priv->document);
 	}
@@ -31,12 +31,12 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
-#include <cairo-gobject.h>
-
 #include "ev-document-misc.h"
 #include "ev-job-scheduler.h"
 #include "ev-sidebar-page.h"
 #include "ev-sidebar-thumbnails.h"
+#include "ev-thumbnail-cache.h"
+#include "ev-thumbnails-model.h"
 #include "ev-utils.h"
 #include "ev-window.h"
 
@@ -46,6 +46,9 @@
  * limit its use */
 #define MAX_ICON_VIEW_PAGE_COUNT 1500
 
+/* Number of pages around the visible ones whose thumbnails are kept */
+#define PREFETCH_PAGE_COUNT 5
+
 typedef struct _EvThumbsSize
 {
 	gint width;
@@ -53,6 +56,7 @@ typedef struct _EvThumbsSize
 } EvThumbsSize;
 
 typedef struct _EvThumbsSizeCache {
+	EvDocument *document;
 	gboolean uniform;
 	gint uniform_width;
 	gint uniform_height;
@@ -64,11 +68,12 @@ struct _EvSidebarThumbnailsPrivate {
 	GtkWidget *icon_view;
 	GtkWidget *tree_view;
 	GtkAdjustment *vadjustment;
-	GtkListStore *list_store;
+	EvThumbnailsModel *thumbnails_model;
 	GHashTable *loading_icons;
 	EvDocument *document;
 	EvDocumentModel *model;
 	EvThumbsSizeCache *size_cache;
+	EvThumbnailCache *thumbnail_cache;
         gint width;
 
 	gint n_pages, pages_done;
@@ -80,14 +85,6 @@ struct _EvSidebarThumbnailsPrivate {
 	gint start_page, end_page;
 };
 
-enum {
-	COLUMN_PAGE_STRING,
-	COLUMN_SURFACE,
-	COLUMN_THUMBNAIL_SET,
-	COLUMN_JOB,
-	NUM_COLUMNS
-};
-
 enum {
 	PROP_0,
 	PROP_WIDGET,
@@ -102,6 +99,9 @@ static void         ev_sidebar_thumbnails_set_current_page (EvSidebarThumbnails
 							    gint     page);
 static void         thumbnail_job_completed_callback       (EvJobThumbnail          *job,
 							    EvSidebarThumbnails     *sidebar_thumbnails);
+static void         ev_sidebar_thumbnails_set_thumbnail    (EvSidebarThumbnails     *sidebar_thumbnails,
+							    gint                     page,
+							    cairo_surface_t         *thumbnail);
 static void         ev_sidebar_thumbnails_reload           (EvSidebarThumbnails     *sidebar_thumbnails);
 static void         adjustment_changed_cb                  (EvSidebarThumbnails     *sidebar_thumbnails);
 
@@ -134,14 +134,16 @@ get_thumbnail_size_for_page (EvDocument *document,
 	*height = MAX ((gint)(h * scale + 0.5), 1);
 }
 
+/* Sizes of non uniform documents are only computed for the pages
+ * that are shown.
+ */
 static EvThumbsSizeCache *
 ev_thumbnails_size_cache_new (EvDocument *document)
 {
 	EvThumbsSizeCache *cache;
-	gint               i, n_pages;
-	EvThumbsSize      *thumb_size;
 
 	cache = g_new0 (EvThumbsSizeCache, 1);
+	cache->document = document;
 
 	if (ev_document_is_page_size_uniform (document)) {
 		cache->uniform = TRUE;
@@ -151,15 +153,7 @@ ev_thumbnails_size_cache_new (EvDocument *document)
 		return cache;
 	}
 
-	n_pages = ev_document_get_n_pages (document);
-	cache->sizes = g_new0 (EvThumbsSize, n_pages);
-
-	for (i = 0; i < n_pages; i++) {
-		thumb_size = &(cache->sizes[i]);
-		get_thumbnail_size_for_page (document, i,
-					     &thumb_size->width,
-					     &thumb_size->height);
-	}
+	cache->sizes = g_new0 (EvThumbsSize, ev_document_get_n_pages (document));
 
 	return cache;
 }
@@ -180,6 +174,11 @@ ev_thumbnails_size_cache_get_size (EvThumbsSizeCache *cache,
 		EvThumbsSize *thumb_size;
 
 		thumb_size = &(cache->sizes[page]);
+		if (thumb_size->width == 0) {
+			get_thumbnail_size_for_page (cache->document, page,
+						     &thumb_size->width,
+						     &thumb_size->height);
+		}
 
 		w = thumb_size->width;
 		h = thumb_size->height;
@@ -194,6 +193,27 @@ ev_thumbnails_size_cache_get_size (EvThumbsSizeCache *cache,
 	}
 }
 
+/* Sizes computed before the metadata of the pages was read may be
+ * wrong, and documents first seen as uniform may turn out not to be.
+ */
+static void
+ev_thumbnails_size_cache_invalidate (EvThumbsSizeCache *cache,
+				     gint               first_page,
+				     gint               last_page)
+{
+	if (cache->uniform) {
+		if (ev_document_is_page_size_uniform (cache->document))
+			return;
+
+		cache->uniform = FALSE;
+		cache->sizes = g_new0 (EvThumbsSize, ev_document_get_n_pages (cache->document));
+		return;
+	}
+
+	memset (&cache->sizes[first_page], 0,
+		(last_page - first_page + 1) * sizeof (EvThumbsSize));
+}
+
 static void
 ev_thumbnails_size_cache_free (EvThumbsSizeCache *cache)
 {
@@ -222,6 +242,28 @@ ev_thumbnails_size_cache_get (EvDocument *document)
 	return cache;
 }
 
+/* Thumbnails on-disk cache */
+#define EV_THUMBNAILS_DISK_CACHE_KEY "ev-thumbnails-disk-cache"
+
+static EvThumbnailCache *
+ev_thumbnail_cache_get (EvDocument *document)
+{
+	EvThumbnailCache *cache;
+
+	cache = g_object_get_data (G_OBJECT (document), EV_THUMBNAILS_DISK_CACHE_KEY);
+	if (!cache) {
+		cache = ev_thumbnail_cache_new (document);
+		if (cache) {
+			g_object_set_data_full (G_OBJECT (document),
+						EV_THUMBNAILS_DISK_CACHE_KEY,
+						cache,
+						(GDestroyNotify)ev_thumbnail_cache_free);
+		}
+	}
+
+	return cache;
+}
+
 static gboolean
 ev_sidebar_thumbnails_page_is_in_visible_range (EvSidebarThumbnails *sidebar,
                                                 guint                page)
@@ -238,7 +280,7 @@ ev_sidebar_thumbnails_page_is_in_visible_range (EvSidebarThumbnails *sidebar,
                 if (!gtk_tree_selection_get_selected (selection, NULL, &iter))
                         return FALSE;
 
-                path = gtk_tree_model_get_path (GTK_TREE_MODEL (sidebar->priv->list_store), &iter);
+                path = gtk_tree_model_get_path (GTK_TREE_MODEL (sidebar->priv->thumbnails_model), &iter);
                 if (!gtk_tree_view_get_visible_range (GTK_TREE_VIEW (sidebar->priv->tree_view), &start, &end)) {
                         gtk_tree_path_free (path);
                         return FALSE;
@@ -280,11 +322,7 @@ ev_sidebar_thumbnails_dispose (GObject *object)
 		sidebar_thumbnails->priv->loading_icons = NULL;
 	}
 	
-	if (sidebar_thumbnails->priv->list_store) {
-		ev_sidebar_thumbnails_clear_model (sidebar_thumbnails);
-		g_object_unref (sidebar_thumbnails->priv->list_store);
-		sidebar_thumbnails->priv->list_store = NULL;
-	}
+	ev_sidebar_thumbnails_clear_model (sidebar_thumbnails);
 
 	G_OBJECT_CLASS (ev_sidebar_thumbnails_parent_class)->dispose (object);
 }
@@ -386,9 +424,12 @@ ev_sidebar_thumbnails_get_loading_icon (EvSidebarThumbnails *sidebar_thumbnails,
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
         cairo_surface_t *icon;
-	gchar           *key;
+	gchar            key[32];
 
-	key = g_strdup_printf ("%dx%d", width, height);
+	/* This is called for every row whenever the icon view is laid
+	 * out, so the key is only allocated for new sizes.
+	 */
+	g_snprintf (key, sizeof (key), "%dx%d", width, height);
 	icon = g_hash_table_lookup (priv->loading_icons, key);
 	if (!icon) {
 		gboolean inverted_colors;
@@ -403,9 +444,7 @@ ev_sidebar_thumbnails_get_loading_icon (EvSidebarThumbnails *sidebar_thumbnails,
                                                                           width * device_scale,
                                                                           height * device_scale,
                                                                           inverted_colors);
-		g_hash_table_insert (priv->loading_icons, key, icon);
-	} else {
-		g_free (key);
+		g_hash_table_insert (priv->loading_icons, g_strdup (key), icon);
 	}
 	
 	return icon;
@@ -417,52 +456,21 @@ clear_range (EvSidebarThumbnails *sidebar_thumbnails,
 	     gint                 end_page)
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	GtkTreePath *path;
-	GtkTreeIter iter;
-	gboolean result;
-	gint prev_width = -1;
-	gint prev_height = -1;
+	gint page;
 
 	g_assert (start_page <= end_page);
 
-	path = gtk_tree_path_new_from_indices (start_page, -1);
-	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->list_store), &iter, path);
-	     result && start_page <= end_page;
-	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->list_store), &iter), start_page ++) {
+	for (page = start_page; page <= end_page; page++) {
 		EvJobThumbnail *job;
-		cairo_surface_t *loading_icon = NULL;
-		gint width, height;
-
-		gtk_tree_model_get (GTK_TREE_MODEL (priv->list_store),
-				    &iter,
-				    COLUMN_JOB, &job,
-				    -1);
 
+		job = ev_thumbnails_model_get_job (priv->thumbnails_model, page);
 		if (job) {
 			g_signal_handlers_disconnect_by_func (job, thumbnail_job_completed_callback, sidebar_thumbnails);
 			ev_job_cancel (EV_JOB (job));
-			g_object_unref (job);
 		}
 
-		ev_thumbnails_size_cache_get_size (priv->size_cache, start_page,
-						  priv->rotation,
-						  &width, &height);
-		if (!loading_icon || (width != prev_width && height != prev_height)) {
-			loading_icon =
-				ev_sidebar_thumbnails_get_loading_icon (sidebar_thumbnails,
-									width, height);
-		}
-
-		prev_width = width;
-		prev_height = height;
-
-		gtk_list_store_set (priv->list_store, &iter,
-				    COLUMN_JOB, NULL,
-				    COLUMN_THUMBNAIL_SET, FALSE,
-				    COLUMN_SURFACE, loading_icon,
-				    -1);
+		ev_thumbnails_model_clear_page (priv->thumbnails_model, page);
 	}
-	gtk_tree_path_free (path);
 }
 
 static void
@@ -491,58 +499,96 @@ get_size_for_page (EvSidebarThumbnails *sidebar_thumbnails,
         }
 }
 
+typedef struct {
+	EvSidebarThumbnails *sidebar_thumbnails;
+	EvJob               *job;
+} ThumbnailCacheLookupData;
+
+static void
+thumbnail_cache_lookup_cb (GObject                  *source_object,
+			   GAsyncResult             *result,
+			   ThumbnailCacheLookupData *data)
+{
+	EvSidebarThumbnails        *sidebar_thumbnails = data->sidebar_thumbnails;
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	EvJob                      *job = data->job;
+	cairo_surface_t            *thumbnail;
+
+	thumbnail = ev_thumbnail_cache_lookup_finish (priv->thumbnail_cache, result);
+
+	if (job->cancelled ||
+	    !priv->thumbnails_model ||
+	    ev_thumbnails_model_get_job (priv->thumbnails_model,
+					 EV_JOB_THUMBNAIL (job)->page) != EV_JOB_THUMBNAIL (job)) {
+		/* Cleared meanwhile */
+	} else if (thumbnail) {
+		ev_sidebar_thumbnails_set_thumbnail (sidebar_thumbnails,
+						     EV_JOB_THUMBNAIL (job)->page,
+						     thumbnail);
+	} else {
+		ev_job_scheduler_push_job (job, EV_JOB_PRIORITY_HIGH);
+	}
+
+	if (thumbnail)
+		cairo_surface_destroy (thumbnail);
+	g_object_unref (job);
+	g_object_unref (sidebar_thumbnails);
+	g_slice_free (ThumbnailCacheLookupData, data);
+}
+
 static void
 add_range (EvSidebarThumbnails *sidebar_thumbnails,
 	   gint                 start_page,
 	   gint                 end_page)
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	GtkTreePath *path;
-	GtkTreeIter iter;
-	gboolean result;
-	gint page = start_page;
+	gint page;
 
 	g_assert (start_page <= end_page);
 
-	path = gtk_tree_path_new_from_indices (start_page, -1);
-	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->list_store), &iter, path);
-	     result && page <= end_page;
-	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->list_store), &iter), page ++) {
+	for (page = start_page; page <= end_page; page++) {
 		EvJob *job;
-		gboolean thumbnail_set;
-
-		gtk_tree_model_get (GTK_TREE_MODEL (priv->list_store), &iter,
-				    COLUMN_JOB, &job,
-				    COLUMN_THUMBNAIL_SET, &thumbnail_set,
-				    -1);
-
-		if (job == NULL && !thumbnail_set) {
-			gint thumbnail_width, thumbnail_height;
-			get_size_for_page (sidebar_thumbnails, page, &thumbnail_width, &thumbnail_height);
-
-			job = ev_job_thumbnail_new_with_target_size (priv->document,
-								     page, priv->rotation,
-								     thumbnail_width, thumbnail_height);
-                        ev_job_thumbnail_set_has_frame (EV_JOB_THUMBNAIL (job), FALSE);
-                        ev_job_thumbnail_set_output_format (EV_JOB_THUMBNAIL (job), EV_JOB_THUMBNAIL_SURFACE);
-			g_object_set_data_full (G_OBJECT (job), "tree_iter",
-						gtk_tree_iter_copy (&iter),
-						(GDestroyNotify) gtk_tree_iter_free);
-			g_signal_connect (job, "finished",
-					  G_CALLBACK (thumbnail_job_completed_callback),
-					  sidebar_thumbnails);
-			gtk_list_store_set (priv->list_store, &iter,
-					    COLUMN_JOB, job,
-					    -1);
-			ev_job_scheduler_push_job (EV_JOB (job), EV_JOB_PRIORITY_HIGH);
-			
-			/* The queue and the list own a ref to the job now */
-			g_object_unref (job);
-		} else if (job) {
-			g_object_unref (job);
+		gint thumbnail_width, thumbnail_height;
+
+		if (ev_thumbnails_model_get_job (priv->thumbnails_model, page) ||
+		    ev_thumbnails_model_get_thumbnail_set (priv->thumbnails_model, page))
+			continue;
+
+		get_size_for_page (sidebar_thumbnails, page, &thumbnail_width, &thumbnail_height);
+
+		job = ev_job_thumbnail_new_with_target_size (priv->document,
+							     page, priv->rotation,
+							     thumbnail_width, thumbnail_height);
+		ev_job_thumbnail_set_has_frame (EV_JOB_THUMBNAIL (job), FALSE);
+		ev_job_thumbnail_set_output_format (EV_JOB_THUMBNAIL (job), EV_JOB_THUMBNAIL_SURFACE);
+		g_signal_connect (job, "finished",
+				  G_CALLBACK (thumbnail_job_completed_callback),
+				  sidebar_thumbnails);
+		ev_thumbnails_model_set_job (priv->thumbnails_model, page, EV_JOB_THUMBNAIL (job));
+
+		if (priv->thumbnail_cache) {
+			ThumbnailCacheLookupData *data;
+
+			/* The job is only run if the thumbnail isn't on disk,
+			 * it's cancelled like any other job meanwhile */
+			data = g_slice_new (ThumbnailCacheLookupData);
+			data->sidebar_thumbnails = g_object_ref (sidebar_thumbnails);
+			data->job = job;
+			ev_thumbnail_cache_lookup_async (priv->thumbnail_cache, page,
+							 priv->rotation,
+							 thumbnail_width,
+							 thumbnail_height,
+							 job->cancellable,
+							 (GAsyncReadyCallback)thumbnail_cache_lookup_cb,
+							 data);
+			continue;
 		}
+
+		ev_job_scheduler_push_job (EV_JOB (job), EV_JOB_PRIORITY_HIGH);
+
+		/* The queue and the model own a ref to the job now */
+		g_object_unref (job);
 	}
-	gtk_tree_path_free (path);
 }
 
 /* This modifies start */
@@ -623,51 +669,48 @@ adjustment_changed_cb (EvSidebarThumbnails *sidebar_thumbnails)
 
 	if (path && path2) {
 		update_visible_range (sidebar_thumbnails,
-				      gtk_tree_path_get_indices (path)[0],
-				      gtk_tree_path_get_indices (path2)[0]);
+				      MAX (gtk_tree_path_get_indices (path)[0] - PREFETCH_PAGE_COUNT, 0),
+				      MIN (gtk_tree_path_get_indices (path2)[0] + PREFETCH_PAGE_COUNT,
+					   priv->n_pages - 1));
 	}
 
 	gtk_tree_path_free (path);
 	gtk_tree_path_free (path2);
 }
 
+static cairo_surface_t *
+ev_sidebar_thumbnails_get_loading_icon_for_page (gint                 page,
+						 EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	gint width, height;
+
+	ev_thumbnails_size_cache_get_size (priv->size_cache, page,
+					   priv->rotation,
+					   &width, &height);
+
+	return ev_sidebar_thumbnails_get_loading_icon (sidebar_thumbnails, width, height);
+}
+
+/* The model doesn't store a row per page, so it's replaced instead of
+ * being refilled.
+ */
 static void
 ev_sidebar_thumbnails_fill_model (EvSidebarThumbnails *sidebar_thumbnails)
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	GtkTreeIter iter;
-	int i;
-	gint prev_width = -1;
-	gint prev_height = -1;
-
-	for (i = 0; i < sidebar_thumbnails->priv->n_pages; i++) {
-		gchar     *page_label;
-		gchar     *page_string;
-		cairo_surface_t *loading_icon = NULL;
-		gint       width, height;
-
-		page_label = ev_document_get_page_label (priv->document, i);
-		page_string = g_markup_printf_escaped ("<i>%s</i>", page_label);
-		ev_thumbnails_size_cache_get_size (sidebar_thumbnails->priv->size_cache, i,
-						  sidebar_thumbnails->priv->rotation,
-						  &width, &height);
-		if (!loading_icon || (width != prev_width && height != prev_height)) {
-			loading_icon =
-				ev_sidebar_thumbnails_get_loading_icon (sidebar_thumbnails,
-									width, height);
-		}
 
-		prev_width = width;
-		prev_height = height;
-		
-		gtk_list_store_append (priv->list_store, &iter);
-		gtk_list_store_set (priv->list_store, &iter,
-				    COLUMN_PAGE_STRING, page_string,
-				    COLUMN_SURFACE, loading_icon,
-				    COLUMN_THUMBNAIL_SET, FALSE,
-				    -1);
-		g_free (page_label);
-		g_free (page_string);
+	priv->thumbnails_model =
+		ev_thumbnails_model_new (priv->document,
+					 (EvThumbnailsModelLoadingFunc)ev_sidebar_thumbnails_get_loading_icon_for_page,
+					 sidebar_thumbnails);
+
+	if (priv->tree_view) {
+		gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view),
+					 GTK_TREE_MODEL (priv->thumbnails_model));
+	} else if (priv->icon_view) {
+		gtk_icon_view_set_model (GTK_ICON_VIEW (priv->icon_view),
+					 GTK_TREE_MODEL (priv->thumbnails_model));
 	}
 }
 
@@ -683,7 +726,7 @@ ev_sidebar_tree_selection_changed (GtkTreeSelection *selection,
 	if (!gtk_tree_selection_get_selected (selection, NULL, &iter))
 		return;
 
-	path = gtk_tree_model_get_path (GTK_TREE_MODEL (priv->list_store),
+	path = gtk_tree_model_get_path (GTK_TREE_MODEL (priv->thumbnails_model),
 					&iter);
 	page = gtk_tree_path_get_indices (path)[0];
 	gtk_tree_path_free (path);
@@ -724,7 +767,7 @@ ev_sidebar_init_tree_view (EvSidebarThumbnails *ev_sidebar_thumbnails)
 	GtkCellRenderer *renderer;
 
 	priv = ev_sidebar_thumbnails->priv;
-	priv->tree_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->list_store));
+	priv->tree_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (priv->thumbnails_model));
 
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree_view));
 	g_signal_connect (selection, "changed",
@@ -753,7 +796,7 @@ ev_sidebar_init_icon_view (EvSidebarThumbnails *ev_sidebar_thumbnails)
 
 	priv = ev_sidebar_thumbnails->priv;
 
-	priv->icon_view = gtk_icon_view_new_with_model (GTK_TREE_MODEL (priv->list_store));
+	priv->icon_view = gtk_icon_view_new_with_model (GTK_TREE_MODEL (priv->thumbnails_model));
 
         renderer = g_object_new (GTK_TYPE_CELL_RENDERER_PIXBUF,
                                  "xalign", 0.5,
@@ -804,12 +847,6 @@ ev_sidebar_thumbnails_init (EvSidebarThumbnails *ev_sidebar_thumbnails)
 
 	priv = ev_sidebar_thumbnails->priv = EV_SIDEBAR_THUMBNAILS_GET_PRIVATE (ev_sidebar_thumbnails);
 
-	priv->list_store = gtk_list_store_new (NUM_COLUMNS,
-					       G_TYPE_STRING,
-					       CAIRO_GOBJECT_TYPE_SURFACE,
-					       G_TYPE_BOOLEAN,
-					       EV_TYPE_JOB_THUMBNAIL);
-
 	priv->swindow = gtk_scrolled_window_new (NULL, NULL);
 
 	gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (priv->swindow),
@@ -925,36 +962,45 @@ ev_sidebar_thumbnails_inverted_colors_changed_cb (EvDocumentModel     *model,
 }
 
 static void
-thumbnail_job_completed_callback (EvJobThumbnail      *job,
-				  EvSidebarThumbnails *sidebar_thumbnails)
+ev_sidebar_thumbnails_set_thumbnail (EvSidebarThumbnails *sidebar_thumbnails,
+				     gint                 page,
+				     cairo_surface_t     *thumbnail)
 {
         GtkWidget                  *widget = GTK_WIDGET (sidebar_thumbnails);
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	GtkTreeIter                *iter;
         cairo_surface_t            *surface;
 #ifdef HAVE_HIDPI_SUPPORT
         gint                        device_scale;
 
         device_scale = gtk_widget_get_scale_factor (widget);
-        cairo_surface_set_device_scale (job->thumbnail_surface, device_scale, device_scale);
+        cairo_surface_set_device_scale (thumbnail, device_scale, device_scale);
 #endif
 
         surface = ev_document_misc_render_thumbnail_surface_with_frame (widget,
-                                                                        job->thumbnail_surface,
+                                                                        thumbnail,
                                                                         -1, -1);
 
-	iter = (GtkTreeIter *) g_object_get_data (G_OBJECT (job), "tree_iter");
 	if (priv->inverted_colors)
 		ev_document_misc_invert_surface (surface);
-	gtk_list_store_set (priv->list_store,
-			    iter,
-			    COLUMN_SURFACE, surface,
-			    COLUMN_THUMBNAIL_SET, TRUE,
-			    COLUMN_JOB, NULL,
-			    -1);
+	ev_thumbnails_model_set_thumbnail (priv->thumbnails_model, page, surface);
         cairo_surface_destroy (surface);
 }
 
+static void
+thumbnail_job_completed_callback (EvJobThumbnail      *job,
+				  EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+
+	if (priv->thumbnail_cache && job->thumbnail_surface) {
+		ev_thumbnail_cache_store (priv->thumbnail_cache, job->page, job->rotation,
+					  job->target_width, job->target_height,
+					  job->thumbnail_surface);
+	}
+
+	ev_sidebar_thumbnails_set_thumbnail (sidebar_thumbnails, job->page, job->thumbnail_surface);
+}
+
 static void
 ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 					   GParamSpec          *pspec,
@@ -969,6 +1015,7 @@ ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 	}
 
 	priv->size_cache = ev_thumbnails_size_cache_get (document);
+	priv->thumbnail_cache = ev_thumbnail_cache_get (document);
 	priv->document = document;
 	priv->n_pages = ev_document_get_n_pages (document);
 	priv->rotation = ev_document_model_get_rotation (model);
@@ -1023,6 +1070,21 @@ ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 	adjustment_changed_cb (sidebar_thumbnails);
 }
 
+static void
+ev_sidebar_thumbnails_page_metadata_changed_cb (EvDocumentModel     *model,
+						gint                 first_page,
+						gint                 last_page,
+						EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+
+	if (!priv->thumbnails_model)
+		return;
+
+	ev_thumbnails_size_cache_invalidate (priv->size_cache, first_page, last_page);
+	ev_thumbnails_model_pages_changed (priv->thumbnails_model, first_page, last_page);
+}
+
 static void
 ev_sidebar_thumbnails_set_model (EvSidebarPage   *sidebar_page,
 				 EvDocumentModel *model)
@@ -1037,34 +1099,31 @@ ev_sidebar_thumbnails_set_model (EvSidebarPage   *sidebar_page,
 	g_signal_connect (model, "notify::document",
 			  G_CALLBACK (ev_sidebar_thumbnails_document_changed_cb),
 			  sidebar_page);
+	g_signal_connect (model, "page-metadata-changed",
+			  G_CALLBACK (ev_sidebar_thumbnails_page_metadata_changed_cb),
+			  sidebar_page);
 }
 
-static gboolean
-ev_sidebar_thumbnails_clear_job (GtkTreeModel *model,                                             
-			         GtkTreePath *path,
-			         GtkTreeIter *iter,
-				 gpointer data)
+static void
+ev_sidebar_thumbnails_clear_job (EvJob               *job,
+				 EvSidebarThumbnails *sidebar_thumbnails)
 {
-	EvJob *job;
-	
-	gtk_tree_model_get (model, iter, COLUMN_JOB, &job, -1);
-	
-	if (job != NULL) {
-		ev_job_cancel (job);
-		g_signal_handlers_disconnect_by_func (job, thumbnail_job_completed_callback, data);
-		g_object_unref (job);
-	}
-	
-	return FALSE;    
+	ev_job_cancel (job);
+	g_signal_handlers_disconnect_by_func (job, thumbnail_job_completed_callback, sidebar_thumbnails);
 }
 
-static void 
+static void
 ev_sidebar_thumbnails_clear_model (EvSidebarThumbnails *sidebar_thumbnails)
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	
-	gtk_tree_model_foreach (GTK_TREE_MODEL (priv->list_store), ev_sidebar_thumbnails_clear_job, sidebar_thumbnails);
-	gtk_list_store_clear (priv->list_store);
+
+	if (!priv->thumbnails_model)
+		return;
+
+	ev_thumbnails_model_foreach_job (priv->thumbnails_model,
+					 (GFunc)ev_sidebar_thumbnails_clear_job,
+					 sidebar_thumbnails);
+	g_clear_object (&priv->thumbnails_model);
 }
 
 static gboolean
@@ -0,0 +1,489 @@
+/* ev-thumbnail-cache.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "ev-document-misc.h"
+#include "ev-document-security.h"
+#include "ev-thumbnail-cache.h"
+
+/* On-disk copy of the sidebar thumbnails, so that opening a document
+ * again doesn't render them all from scratch.
+ *
+ * Thumbnails of a document are stored in the user cache directory, in
+ * a directory named after the document URI, and every file is named
+ * after the modification time of the document, the page and the size
+ * of the thumbnail. Thumbnails are always stored unrotated, other
+ * rotations are derived from them. Only local documents are cached,
+ * querying the modification time of remote ones could block. Documents
+ * protected with a password aren't cached, so that their contents
+ * don't end up unprotected on disk.
+ *
+ * Thumbnails are read, written, and outdated ones removed, from a
+ * thread. The directory of a document is touched when it's opened, and
+ * the least recently opened documents are removed once the cache grows
+ * too large, or when they haven't been opened in a while.
+ */
+
+#define THUMBNAIL_CACHE_MAX_SIZE (64 * 1024 * 1024)
+#define THUMBNAIL_CACHE_MAX_AGE  (30 * 24 * 60 * 60)
+
+struct _EvThumbnailCache {
+	gchar *dir;
+	/* Modification time of the document, prefix of all the files */
+	gchar *prefix;
+};
+
+typedef enum {
+	EV_THUMBNAIL_CACHE_TASK_WRITE,
+	EV_THUMBNAIL_CACHE_TASK_PRUNE,
+	EV_THUMBNAIL_CACHE_TASK_REMOVE
+} EvThumbnailCacheTaskType;
+
+typedef struct {
+	EvThumbnailCacheTaskType type;
+	gchar                   *path;
+	gchar                   *prefix;
+	cairo_surface_t         *surface;
+} EvThumbnailCacheTask;
+
+typedef struct {
+	gchar *path;
+	gint   rotation;
+} EvThumbnailCacheLookup;
+
+typedef struct {
+	gchar  *path;
+	guint64 size;
+	gint64  mtime;
+} EvThumbnailCacheDir;
+
+static GThreadPool *writer_pool = NULL;
+
+static void
+ev_thumbnail_cache_task_free (EvThumbnailCacheTask *task)
+{
+	g_free (task->path);
+	g_free (task->prefix);
+	if (task->surface)
+		cairo_surface_destroy (task->surface);
+	g_slice_free (EvThumbnailCacheTask, task);
+}
+
+static gchar *
+ev_thumbnail_cache_get_root (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "evince", "thumbnails", NULL);
+}
+
+/* Removes the files in dir_path not starting with prefix, and returns
+ * the size of the remaining ones */
+static guint64
+ev_thumbnail_cache_remove_files (const gchar *dir_path,
+				 const gchar *prefix)
+{
+	GDir        *dir;
+	const gchar *name;
+	guint64      size = 0;
+
+	dir = g_dir_open (dir_path, 0, NULL);
+	if (!dir)
+		return 0;
+
+	while ((name = g_dir_read_name (dir))) {
+		gchar    *path;
+		GStatBuf  buf;
+
+		path = g_build_filename (dir_path, name, NULL);
+		if (prefix && g_str_has_prefix (name, prefix)) {
+			if (g_stat (path, &buf) == 0)
+				size += buf.st_size;
+		} else {
+			g_unlink (path);
+		}
+		g_free (path);
+	}
+
+	g_dir_close (dir);
+
+	return size;
+}
+
+static void
+ev_thumbnail_cache_remove_dir (const gchar *dir_path)
+{
+	ev_thumbnail_cache_remove_files (dir_path, NULL);
+	g_rmdir (dir_path);
+}
+
+static gint
+ev_thumbnail_cache_dir_compare (const EvThumbnailCacheDir *a,
+				const EvThumbnailCacheDir *b)
+{
+	return a->mtime < b->mtime ? -1 : (a->mtime > b->mtime ? 1 : 0);
+}
+
+/* Removes the thumbnails of previous versions of the document, and the
+ * thumbnails of other documents not opened in a while or that don't
+ * fit in the cache anymore, least recently opened first */
+static void
+ev_thumbnail_cache_prune (const gchar *keep_path,
+			  const gchar *prefix)
+{
+	GDir        *dir;
+	const gchar *name;
+	gchar       *root;
+	GArray      *dirs;
+	guint64      total_size;
+	gint64       now;
+	guint        i;
+
+	total_size = ev_thumbnail_cache_remove_files (keep_path, prefix);
+	g_utime (keep_path, NULL);
+
+	root = ev_thumbnail_cache_get_root ();
+	dir = g_dir_open (root, 0, NULL);
+	if (!dir) {
+		g_free (root);
+		return;
+	}
+
+	dirs = g_array_new (FALSE, FALSE, sizeof (EvThumbnailCacheDir));
+	while ((name = g_dir_read_name (dir))) {
+		EvThumbnailCacheDir cache_dir;
+		GStatBuf            buf;
+
+		cache_dir.path = g_build_filename (root, name, NULL);
+		if (g_strcmp0 (cache_dir.path, keep_path) == 0 ||
+		    g_stat (cache_dir.path, &buf) != 0) {
+			g_free (cache_dir.path);
+			continue;
+		}
+
+		cache_dir.mtime = buf.st_mtime;
+		cache_dir.size = ev_thumbnail_cache_remove_files (cache_dir.path, "");
+		total_size += cache_dir.size;
+		g_array_append_val (dirs, cache_dir);
+	}
+	g_dir_close (dir);
+	g_free (root);
+
+	g_array_sort (dirs, (GCompareFunc)ev_thumbnail_cache_dir_compare);
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	for (i = 0; i < dirs->len; i++) {
+		EvThumbnailCacheDir *cache_dir = &g_array_index (dirs, EvThumbnailCacheDir, i);
+
+		if (total_size > THUMBNAIL_CACHE_MAX_SIZE ||
+		    now - cache_dir->mtime > THUMBNAIL_CACHE_MAX_AGE) {
+			ev_thumbnail_cache_remove_dir (cache_dir->path);
+			total_size -= cache_dir->size;
+		}
+		g_free (cache_dir->path);
+	}
+	g_array_free (dirs, TRUE);
+}
+
+static void
+ev_thumbnail_cache_write (const gchar     *path,
+			  cairo_surface_t *surface)
+{
+	gchar *dir;
+	gchar *tmp_path;
+
+	dir = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		g_free (dir);
+		return;
+	}
+	g_free (dir);
+
+	/* Write to a temporary file first, so that a thumbnail is never
+	 * read half written.
+	 */
+	tmp_path = g_strconcat (path, ".tmp", NULL);
+	if (cairo_surface_write_to_png (surface, tmp_path) == CAIRO_STATUS_SUCCESS)
+		g_rename (tmp_path, path);
+	else
+		g_unlink (tmp_path);
+	g_free (tmp_path);
+}
+
+static void
+ev_thumbnail_cache_writer_func (EvThumbnailCacheTask *task,
+				gpointer              user_data)
+{
+	switch (task->type) {
+	case EV_THUMBNAIL_CACHE_TASK_WRITE:
+		ev_thumbnail_cache_write (task->path, task->surface);
+		break;
+	case EV_THUMBNAIL_CACHE_TASK_PRUNE:
+		ev_thumbnail_cache_prune (task->path, task->prefix);
+		break;
+	case EV_THUMBNAIL_CACHE_TASK_REMOVE:
+		ev_thumbnail_cache_remove_dir (task->path);
+		break;
+	}
+
+	ev_thumbnail_cache_task_free (task);
+}
+
+static void
+ev_thumbnail_cache_push_task (EvThumbnailCacheTaskType type,
+			      gchar                   *path,
+			      gchar                   *prefix,
+			      cairo_surface_t         *surface)
+{
+	EvThumbnailCacheTask *task;
+
+	if (!writer_pool) {
+		writer_pool = g_thread_pool_new ((GFunc)ev_thumbnail_cache_writer_func,
+						 NULL, 1, FALSE, NULL);
+	}
+
+	task = g_slice_new (EvThumbnailCacheTask);
+	task->type = type;
+	task->path = path;
+	task->prefix = prefix;
+	task->surface = surface;
+
+	g_thread_pool_push (writer_pool, task, NULL);
+}
+
+static gchar *
+ev_thumbnail_cache_get_path (EvThumbnailCache *cache,
+			     gint              page,
+			     gint              width,
+			     gint              height)
+{
+	gchar *name;
+	gchar *path;
+
+	name = g_strdup_printf ("%s%d-%dx%d.png", cache->prefix, page, width, height);
+	path = g_build_filename (cache->dir, name, NULL);
+	g_free (name);
+
+	return path;
+}
+
+/* Thumbnails are looked up by the size they were requested for, not
+ * their actual size, which depends on how the backend rounds it.
+ */
+static gchar *
+ev_thumbnail_cache_get_unrotated_path (EvThumbnailCache *cache,
+				       gint              page,
+				       gint              rotation,
+				       gint              width,
+				       gint              height)
+{
+	if (rotation == 90 || rotation == 270)
+		return ev_thumbnail_cache_get_path (cache, page, height, width);
+
+	return ev_thumbnail_cache_get_path (cache, page, width, height);
+}
+
+EvThumbnailCache *
+ev_thumbnail_cache_new (EvDocument *document)
+{
+	EvThumbnailCache *cache;
+	const gchar      *uri;
+	GFile            *file;
+	GFileInfo        *info;
+	gchar            *checksum;
+	gchar            *root;
+	gchar            *dir;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return NULL;
+
+	root = ev_thumbnail_cache_get_root ();
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+	dir = g_build_filename (root, checksum, NULL);
+	g_free (checksum);
+	g_free (root);
+
+	if (EV_IS_DOCUMENT_SECURITY (document) &&
+	    ev_document_security_has_document_security (EV_DOCUMENT_SECURITY (document))) {
+		/* Remove any thumbnails written before the document was protected */
+		ev_thumbnail_cache_push_task (EV_THUMBNAIL_CACHE_TASK_REMOVE, dir, NULL, NULL);
+		return NULL;
+	}
+
+	file = g_file_new_for_uri (uri);
+	if (!g_file_is_native (file)) {
+		g_object_unref (file);
+		g_free (dir);
+		return NULL;
+	}
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_object_unref (file);
+	if (!info) {
+		g_free (dir);
+		return NULL;
+	}
+
+	if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		g_object_unref (info);
+		g_free (dir);
+		return NULL;
+	}
+
+	cache = g_new0 (EvThumbnailCache, 1);
+	cache->dir = dir;
+	cache->prefix = g_strdup_printf ("%" G_GUINT64_FORMAT ".%u-",
+					 g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+					 g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+	g_object_unref (info);
+
+	ev_thumbnail_cache_push_task (EV_THUMBNAIL_CACHE_TASK_PRUNE,
+				      g_strdup (cache->dir), g_strdup (cache->prefix), NULL);
+
+	return cache;
+}
+
+void
+ev_thumbnail_cache_free (EvThumbnailCache *cache)
+{
+	if (!cache)
+		return;
+
+	g_free (cache->dir);
+	g_free (cache->prefix);
+	g_free (cache);
+}
+
+static void
+ev_thumbnail_cache_lookup_free (EvThumbnailCacheLookup *lookup)
+{
+	g_free (lookup->path);
+	g_slice_free (EvThumbnailCacheLookup, lookup);
+}
+
+static void
+ev_thumbnail_cache_lookup_thread (GTask                  *task,
+				  gpointer                source_object,
+				  EvThumbnailCacheLookup *lookup,
+				  GCancellable           *cancellable)
+{
+	cairo_surface_t *cached;
+	cairo_surface_t *surface;
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	cached = cairo_image_surface_create_from_png (lookup->path);
+	if (cairo_surface_status (cached) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy (cached);
+		g_task_return_pointer (task, NULL, NULL);
+		return;
+	}
+
+	surface = ev_document_misc_surface_rotate_and_scale (cached,
+							     cairo_image_surface_get_width (cached),
+							     cairo_image_surface_get_height (cached),
+							     lookup->rotation);
+	cairo_surface_destroy (cached);
+
+	g_task_return_pointer (task, surface, (GDestroyNotify)cairo_surface_destroy);
+}
+
+/* Looks up the thumbnail of @page, of @width x @height pixels once
+ * rotated by @rotation, reading it from a thread. Get the result with
+ * ev_thumbnail_cache_lookup_finish() from @callback.
+ */
+void
+ev_thumbnail_cache_lookup_async (EvThumbnailCache   *cache,
+				 gint                page,
+				 gint                rotation,
+				 gint                width,
+				 gint                height,
+				 GCancellable       *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer            user_data)
+{
+	EvThumbnailCacheLookup *lookup;
+	GTask                  *task;
+
+	lookup = g_slice_new (EvThumbnailCacheLookup);
+	lookup->path = ev_thumbnail_cache_get_unrotated_path (cache, page, rotation, width, height);
+	lookup->rotation = rotation;
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, lookup, (GDestroyNotify)ev_thumbnail_cache_lookup_free);
+	g_task_run_in_thread (task, (GTaskThreadFunc)ev_thumbnail_cache_lookup_thread);
+	g_object_unref (task);
+}
+
+/* Returns the thumbnail looked up with ev_thumbnail_cache_lookup_async(),
+ * or %NULL if it's not in the cache or the lookup was cancelled.
+ */
+cairo_surface_t *
+ev_thumbnail_cache_lookup_finish (EvThumbnailCache *cache,
+				  GAsyncResult     *result)
+{
+	return g_task_propagate_pointer (G_TASK (result), NULL);
+}
+
+/* Stores @surface, the thumbnail of @page rendered with @rotation for
+ * a size of @width x @height pixels.
+ */
+void
+ev_thumbnail_cache_store (EvThumbnailCache *cache,
+			  gint              page,
+			  gint              rotation,
+			  gint              width,
+			  gint              height,
+			  cairo_surface_t  *surface)
+{
+	cairo_surface_t *unrotated;
+	gint             surface_width, surface_height;
+	cairo_t         *cr;
+
+	surface_width = cairo_image_surface_get_width (surface);
+	surface_height = cairo_image_surface_get_height (surface);
+
+	/* Always copy the surface, the caller keeps using it while
+	 * it's written.
+	 */
+	if (rotation == 0) {
+		unrotated = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+							surface_width, surface_height);
+		cr = cairo_create (unrotated);
+		cairo_set_source_surface (cr, surface, 0, 0);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+	} else {
+		unrotated = ev_document_misc_surface_rotate_and_scale (surface,
+								       surface_width, surface_height,
+								       360 - rotation);
+	}
+
+	ev_thumbnail_cache_push_task (EV_THUMBNAIL_CACHE_TASK_WRITE,
+				      ev_thumbnail_cache_get_unrotated_path (cache, page, rotation,
+									     width, height),
+				      NULL, unrotated);
+}
@@ -0,0 +1,498 @@
+/* ev-thumbnails-model.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <cairo-gobject.h>
+
+#include "ev-thumbnails-model.h"
+
+/* List model with a row per page of a document, that doesn't store
+ * the rows. The page string is built from the page label when it's
+ * asked for, and only the pages with a thumbnail or a thumbnail job,
+ * which the sidebar keeps to the visible range, have some state.
+ * Other pages show the surface returned by the loading function.
+ *
+ * Note that GtkIconView asks for the values of every row when it's
+ * laid out, so the page string and the loading surface must be cheap
+ * to get for pages without state.
+ *
+ * The number of rows never changes, a new model is used when the
+ * document changes or all the thumbnails must be rendered again.
+ */
+
+typedef struct {
+	cairo_surface_t *surface;
+	EvJobThumbnail  *job;
+} EvThumbnailsModelRow;
+
+struct _EvThumbnailsModel {
+	GObject parent;
+
+	EvDocument *document;
+	gint        n_pages;
+	gint        stamp;
+
+	EvThumbnailsModelLoadingFunc loading_func;
+	gpointer                     loading_data;
+
+	/* Page number -> EvThumbnailsModelRow */
+	GHashTable *rows;
+};
+
+struct _EvThumbnailsModelClass {
+	GObjectClass parent_class;
+};
+
+static void ev_thumbnails_model_tree_model_init (GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (EvThumbnailsModel, ev_thumbnails_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						ev_thumbnails_model_tree_model_init))
+
+#define ITER_PAGE(iter) (GPOINTER_TO_INT ((iter)->user_data))
+
+static void
+ev_thumbnails_model_row_free (EvThumbnailsModelRow *row)
+{
+	if (row->surface)
+		cairo_surface_destroy (row->surface);
+	if (row->job)
+		g_object_unref (row->job);
+	g_slice_free (EvThumbnailsModelRow, row);
+}
+
+static void
+ev_thumbnails_model_finalize (GObject *object)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (object);
+
+	g_hash_table_destroy (model->rows);
+	g_object_unref (model->document);
+
+	G_OBJECT_CLASS (ev_thumbnails_model_parent_class)->finalize (object);
+}
+
+static void
+ev_thumbnails_model_init (EvThumbnailsModel *model)
+{
+	model->stamp = g_random_int ();
+	model->rows = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+					     (GDestroyNotify)ev_thumbnails_model_row_free);
+}
+
+static void
+ev_thumbnails_model_class_init (EvThumbnailsModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = ev_thumbnails_model_finalize;
+}
+
+static void
+ev_thumbnails_model_set_iter (EvThumbnailsModel *model,
+			      GtkTreeIter       *iter,
+			      gint               page)
+{
+	iter->stamp = model->stamp;
+	iter->user_data = GINT_TO_POINTER (page);
+}
+
+/* GtkTreeModelIface */
+static GtkTreeModelFlags
+ev_thumbnails_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint
+ev_thumbnails_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return EV_THUMBNAILS_MODEL_N_COLUMNS;
+}
+
+static GType
+ev_thumbnails_model_get_column_type (GtkTreeModel *tree_model,
+				     gint          index)
+{
+	switch (index) {
+	case EV_THUMBNAILS_MODEL_COLUMN_PAGE_STRING:
+		return G_TYPE_STRING;
+	case EV_THUMBNAILS_MODEL_COLUMN_SURFACE:
+		return CAIRO_GOBJECT_TYPE_SURFACE;
+	case EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET:
+		return G_TYPE_BOOLEAN;
+	case EV_THUMBNAILS_MODEL_COLUMN_JOB:
+		return EV_TYPE_JOB_THUMBNAIL;
+	default:
+		g_assert_not_reached ();
+	}
+
+	return G_TYPE_INVALID;
+}
+
+static gboolean
+ev_thumbnails_model_get_iter (GtkTreeModel *tree_model,
+			      GtkTreeIter  *iter,
+			      GtkTreePath  *path)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+	gint               page;
+
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+
+	page = gtk_tree_path_get_indices (path)[0];
+	if (page < 0 || page >= model->n_pages)
+		return FALSE;
+
+	ev_thumbnails_model_set_iter (model, iter, page);
+
+	return TRUE;
+}
+
+static GtkTreePath *
+ev_thumbnails_model_get_path (GtkTreeModel *tree_model,
+			      GtkTreeIter  *iter)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+
+	g_return_val_if_fail (iter->stamp == model->stamp, NULL);
+
+	return gtk_tree_path_new_from_indices (ITER_PAGE (iter), -1);
+}
+
+static void
+ev_thumbnails_model_get_value (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter,
+			       gint          column,
+			       GValue       *value)
+{
+	EvThumbnailsModel    *model = EV_THUMBNAILS_MODEL (tree_model);
+	EvThumbnailsModelRow *row;
+	gint                  page;
+
+	g_return_if_fail (iter->stamp == model->stamp);
+
+	page = ITER_PAGE (iter);
+	row = g_hash_table_lookup (model->rows, GINT_TO_POINTER (page));
+
+	g_value_init (value, ev_thumbnails_model_get_column_type (tree_model, column));
+
+	switch (column) {
+	case EV_THUMBNAILS_MODEL_COLUMN_PAGE_STRING: {
+		gchar *page_label;
+
+		page_label = ev_document_get_page_label (model->document, page);
+		g_value_take_string (value, g_markup_printf_escaped ("<i>%s</i>", page_label));
+		g_free (page_label);
+	}
+		break;
+	case EV_THUMBNAILS_MODEL_COLUMN_SURFACE:
+		if (row && row->surface)
+			g_value_set_boxed (value, row->surface);
+		else
+			g_value_set_boxed (value, model->loading_func (page, model->loading_data));
+		break;
+	case EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET:
+		g_value_set_boolean (value, row && row->surface);
+		break;
+	case EV_THUMBNAILS_MODEL_COLUMN_JOB:
+		g_value_set_object (value, row ? row->job : NULL);
+		break;
+	}
+}
+
+static gboolean
+ev_thumbnails_model_iter_next (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+	gint               page;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+
+	page = ITER_PAGE (iter) + 1;
+	if (page >= model->n_pages) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	ev_thumbnails_model_set_iter (model, iter, page);
+
+	return TRUE;
+}
+
+static gboolean
+ev_thumbnails_model_iter_previous (GtkTreeModel *tree_model,
+				   GtkTreeIter  *iter)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+	gint               page;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+
+	page = ITER_PAGE (iter) - 1;
+	if (page < 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	ev_thumbnails_model_set_iter (model, iter, page);
+
+	return TRUE;
+}
+
+static gboolean
+ev_thumbnails_model_iter_nth_child (GtkTreeModel *tree_model,
+				    GtkTreeIter  *iter,
+				    GtkTreeIter  *parent,
+				    gint          n)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+
+	if (parent || n < 0 || n >= model->n_pages)
+		return FALSE;
+
+	ev_thumbnails_model_set_iter (model, iter, n);
+
+	return TRUE;
+}
+
+static gboolean
+ev_thumbnails_model_iter_children (GtkTreeModel *tree_model,
+				   GtkTreeIter  *iter,
+				   GtkTreeIter  *parent)
+{
+	return ev_thumbnails_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+ev_thumbnails_model_iter_has_child (GtkTreeModel *tree_model,
+				    GtkTreeIter  *iter)
+{
+	return FALSE;
+}
+
+static gint
+ev_thumbnails_model_iter_n_children (GtkTreeModel *tree_model,
+				     GtkTreeIter  *iter)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+
+	return iter ? 0 : model->n_pages;
+}
+
+static gboolean
+ev_thumbnails_model_iter_parent (GtkTreeModel *tree_model,
+				 GtkTreeIter  *iter,
+				 GtkTreeIter  *child)
+{
+	return FALSE;
+}
+
+static void
+ev_thumbnails_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = ev_thumbnails_model_get_flags;
+	iface->get_n_columns = ev_thumbnails_model_get_n_columns;
+	iface->get_column_type = ev_thumbnails_model_get_column_type;
+	iface->get_iter = ev_thumbnails_model_get_iter;
+	iface->get_path = ev_thumbnails_model_get_path;
+	iface->get_value = ev_thumbnails_model_get_value;
+	iface->iter_next = ev_thumbnails_model_iter_next;
+	iface->iter_previous = ev_thumbnails_model_iter_previous;
+	iface->iter_children = ev_thumbnails_model_iter_children;
+	iface->iter_has_child = ev_thumbnails_model_iter_has_child;
+	iface->iter_n_children = ev_thumbnails_model_iter_n_children;
+	iface->iter_nth_child = ev_thumbnails_model_iter_nth_child;
+	iface->iter_parent = ev_thumbnails_model_iter_parent;
+}
+
+static EvThumbnailsModelRow *
+ev_thumbnails_model_ensure_row (EvThumbnailsModel *model,
+				gint               page)
+{
+	EvThumbnailsModelRow *row;
+
+	row = g_hash_table_lookup (model->rows, GINT_TO_POINTER (page));
+	if (!row) {
+		row = g_slice_new0 (EvThumbnailsModelRow);
+		g_hash_table_insert (model->rows, GINT_TO_POINTER (page), row);
+	}
+
+	return row;
+}
+
+static void
+ev_thumbnails_model_page_changed (EvThumbnailsModel *model,
+				  gint               page)
+{
+	GtkTreePath *path;
+	GtkTreeIter  iter;
+
+	path = gtk_tree_path_new_from_indices (page, -1);
+	ev_thumbnails_model_set_iter (model, &iter, page);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+/* Public methods */
+EvThumbnailsModel *
+ev_thumbnails_model_new (EvDocument                  *document,
+			 EvThumbnailsModelLoadingFunc loading_func,
+			 gpointer                     user_data)
+{
+	EvThumbnailsModel *model;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+	g_return_val_if_fail (loading_func != NULL, NULL);
+
+	model = g_object_new (EV_TYPE_THUMBNAILS_MODEL, NULL);
+	model->document = g_object_ref (document);
+	model->n_pages = ev_document_get_n_pages (document);
+	model->loading_func = loading_func;
+	model->loading_data = user_data;
+
+	return model;
+}
+
+/* Sets the thumbnail of @page, and removes its job */
+void
+ev_thumbnails_model_set_thumbnail (EvThumbnailsModel *model,
+				   gint               page,
+				   cairo_surface_t   *surface)
+{
+	EvThumbnailsModelRow *row;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+	g_return_if_fail (page >= 0 && page < model->n_pages);
+
+	row = ev_thumbnails_model_ensure_row (model, page);
+	if (row->surface)
+		cairo_surface_destroy (row->surface);
+	row->surface = cairo_surface_reference (surface);
+	g_clear_object (&row->job);
+
+	ev_thumbnails_model_page_changed (model, page);
+}
+
+gboolean
+ev_thumbnails_model_get_thumbnail_set (EvThumbnailsModel *model,
+				       gint               page)
+{
+	EvThumbnailsModelRow *row;
+
+	g_return_val_if_fail (EV_IS_THUMBNAILS_MODEL (model), FALSE);
+
+	row = g_hash_table_lookup (model->rows, GINT_TO_POINTER (page));
+
+	return row && row->surface;
+}
+
+void
+ev_thumbnails_model_set_job (EvThumbnailsModel *model,
+			     gint               page,
+			     EvJobThumbnail    *job)
+{
+	EvThumbnailsModelRow *row;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+	g_return_if_fail (page >= 0 && page < model->n_pages);
+
+	row = ev_thumbnails_model_ensure_row (model, page);
+	if (job)
+		g_object_ref (job);
+	if (row->job)
+		g_object_unref (row->job);
+	row->job = job;
+}
+
+/* Returns: (transfer none): the thumbnail job of @page, or %NULL */
+EvJobThumbnail *
+ev_thumbnails_model_get_job (EvThumbnailsModel *model,
+			     gint               page)
+{
+	EvThumbnailsModelRow *row;
+
+	g_return_val_if_fail (EV_IS_THUMBNAILS_MODEL (model), NULL);
+
+	row = g_hash_table_lookup (model->rows, GINT_TO_POINTER (page));
+
+	return row ? row->job : NULL;
+}
+
+/* Drops the thumbnail and the job of @page, the loading surface is
+ * shown for it again.
+ */
+void
+ev_thumbnails_model_clear_page (EvThumbnailsModel *model,
+				gint               page)
+{
+	EvThumbnailsModelRow *row;
+	gboolean              had_thumbnail;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+
+	row = g_hash_table_lookup (model->rows, GINT_TO_POINTER (page));
+	if (!row)
+		return;
+
+	had_thumbnail = row->surface != NULL;
+	g_hash_table_remove (model->rows, GINT_TO_POINTER (page));
+
+	if (had_thumbnail)
+		ev_thumbnails_model_page_changed (model, page);
+}
+
+/* Notifies the views that the page string and the size of the pages
+ * from @first_page to @last_page have changed, when the labels and
+ * sizes of the pages of a large document are read after it's loaded.
+ */
+void
+ev_thumbnails_model_pages_changed (EvThumbnailsModel *model,
+				   gint               first_page,
+				   gint               last_page)
+{
+	gint page;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+
+	first_page = MAX (first_page, 0);
+	last_page = MIN (last_page, model->n_pages - 1);
+
+	for (page = first_page; page <= last_page; page++)
+		ev_thumbnails_model_page_changed (model, page);
+}
+
+void
+ev_thumbnails_model_foreach_job (EvThumbnailsModel *model,
+				 GFunc              func,
+				 gpointer           user_data)
+{
+	GHashTableIter        iter;
+	EvThumbnailsModelRow *row;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+
+	g_hash_table_iter_init (&iter, model->rows);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&row)) {
+		if (row->job)
+			func (row->job, user_data);
+	}
+}
@@ -0,0 +1,73 @@
+/* ev-thumbnails-model.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef EV_THUMBNAILS_MODEL_H
+#define EV_THUMBNAILS_MODEL_H
+
+#include <gtk/gtk.h>
+
+#include "ev-document.h"
+#include "ev-jobs.h"
+
+G_BEGIN_DECLS
+
+#define EV_TYPE_THUMBNAILS_MODEL         (ev_thumbnails_model_get_type ())
+#define EV_THUMBNAILS_MODEL(obj)         (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_THUMBNAILS_MODEL, EvThumbnailsModel))
+#define EV_IS_THUMBNAILS_MODEL(obj)      (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_THUMBNAILS_MODEL))
+
+typedef struct _EvThumbnailsModel      EvThumbnailsModel;
+typedef struct _EvThumbnailsModelClass EvThumbnailsModelClass;
+
+enum {
+	EV_THUMBNAILS_MODEL_COLUMN_PAGE_STRING,
+	EV_THUMBNAILS_MODEL_COLUMN_SURFACE,
+	EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET,
+	EV_THUMBNAILS_MODEL_COLUMN_JOB,
+	EV_THUMBNAILS_MODEL_N_COLUMNS
+};
+
+/* Returns the surface shown for pages without a thumbnail */
+typedef cairo_surface_t *(* EvThumbnailsModelLoadingFunc) (gint     page,
+							   gpointer user_data);
+
+GType              ev_thumbnails_model_get_type          (void) G_GNUC_CONST;
+EvThumbnailsModel *ev_thumbnails_model_new               (EvDocument                  *document,
+							  EvThumbnailsModelLoadingFunc loading_func,
+							  gpointer                     user_data);
+void               ev_thumbnails_model_set_thumbnail     (EvThumbnailsModel           *model,
+							  gint                         page,
+							  cairo_surface_t             *surface);
+gboolean           ev_thumbnails_model_get_thumbnail_set (EvThumbnailsModel           *model,
+							  gint                         page);
+void               ev_thumbnails_model_set_job           (EvThumbnailsModel           *model,
+							  gint                         page,
+							  EvJobThumbnail              *job);
+EvJobThumbnail    *ev_thumbnails_model_get_job           (EvThumbnailsModel           *model,
+							  gint                         page);
+void               ev_thumbnails_model_clear_page        (EvThumbnailsModel           *model,
+							  gint                         page);
+void               ev_thumbnails_model_pages_changed     (EvThumbnailsModel           *model,
+							  gint                         first_page,
+							  gint                         last_page);
+void               ev_thumbnails_model_foreach_job       (EvThumbnailsModel           *model,
+							  GFunc                        func,
+							  gpointer                     user_data);
+
+G_END_DECLS
+
+#endif /* EV_THUMBNAILS_MODEL_H */
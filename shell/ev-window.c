@@ -2222,6 +2222,8 @@ ev_window_open_uri (EvWindow       *ev_window,
 	setup_model_from_metadata (ev_window);
 
 	ev_window->priv->load_job = ev_job_load_new (uri);
+	ev_job_load_set_load_flags (EV_JOB_LOAD (ev_window->priv->load_job),
+				    EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA);
 	g_signal_connect (ev_window->priv->load_job,
 			  "finished",
 			  G_CALLBACK (ev_window_load_job_cb),
@@ -2348,6 +2350,8 @@ ev_window_reload_local (EvWindow *ev_window)
 	
 	uri = ev_window->priv->local_uri ? ev_window->priv->local_uri : ev_window->priv->uri;
 	ev_window->priv->reload_job = ev_job_load_new (uri);
+	ev_job_load_set_load_flags (EV_JOB_LOAD (ev_window->priv->reload_job),
+				    EV_DOCUMENT_LOAD_FLAG_LAZY_METADATA);
 	g_signal_connect (ev_window->priv->reload_job, "finished",
 			  G_CALLBACK (ev_window_reload_job_cb),
 			  ev_window);
@@ -5458,6 +5462,7 @@ ev_window_dispose (GObject *object)
 	}
 
 	if (priv->metadata) {
+		ev_metadata_flush (priv->metadata);
 		g_object_unref (priv->metadata);
 		priv->metadata = NULL;
 	}
@@ -6209,10 +6214,10 @@ image_save_dialog_response_cb (GtkWidget *fc,
                         goto has_error;
 	}
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (ev_window->priv->document);
 	pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (ev_window->priv->document),
 					       ev_window->priv->image);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (ev_window->priv->document);
 
 	file_format = gdk_pixbuf_format_get_name (format);
 	gdk_pixbuf_save (pixbuf, filename, file_format, &error, NULL);
@@ -6300,10 +6305,10 @@ ev_window_popup_cmd_copy_image (GSimpleAction *action,
 	
 	clipboard = gtk_widget_get_clipboard (GTK_WIDGET (window),
 					      GDK_SELECTION_CLIPBOARD);
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (window->priv->document);
 	pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (window->priv->document),
 					       window->priv->image);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (window->priv->document);
 	
 	gtk_clipboard_set_image (clipboard, pixbuf);
 	g_object_unref (pixbuf);
@@ -6368,11 +6373,11 @@ ev_window_popup_cmd_annot_properties (GSimpleAction *action,
 	}
 
 	if (mask != EV_ANNOTATIONS_SAVE_NONE) {
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (window->priv->document);
 		ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (window->priv->document),
 							 window->priv->annot,
 							 mask);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (window->priv->document);
 
 		/* FIXME: update annot region only */
 		ev_view_reload (EV_VIEW (window->priv->view));
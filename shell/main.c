@@ -28,6 +28,7 @@
 
 #include "ev-application.h"
 #include "ev-debug.h"
+#include "ev-trace.h"
 #include "ev-init.h"
 #include "ev-file-helpers.h"
 #include "ev-stock-icons.h"
@@ -42,6 +43,11 @@
 #include <windows.h>
 #endif
 
+#ifdef G_OS_UNIX
+#include <signal.h>
+#include <glib-unix.h>
+#endif
+
 static gchar   *ev_page_label;
 static gchar   *ev_find_string;
 static gint     ev_page_index = 0;
@@ -53,6 +59,21 @@ static gboolean unlink_temp_file = FALSE;
 static gchar   *print_settings;
 static const char **file_arguments = NULL;
 
+#ifdef G_OS_UNIX
+/* kill -USR1 writes the events recorded so far when EV_TRACE is set */
+static gboolean
+dump_trace_cb (gpointer data)
+{
+	GError *error = NULL;
+
+	if (!ev_trace_dump (NULL, &error)) {
+		g_printerr ("Failed to write trace: %s\n", error->message);
+		g_error_free (error);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+#endif
 
 static gboolean
 option_version_cb (const gchar *option_name,
@@ -294,6 +315,11 @@ main (int argc, char *argv[])
 
 	ev_stock_icons_init ();
 
+#ifdef G_OS_UNIX
+	if (ev_trace_is_enabled ())
+		g_unix_signal_add (SIGUSR1, dump_trace_cb, NULL);
+#endif
+
 	/* Manually set name and icon */
 	g_set_application_name (_("Document Viewer"));
 	gtk_window_set_default_icon_name ("evince");
@@ -41,11 +41,15 @@ static gboolean finished = TRUE;
 
 static gint size = THUMBNAIL_SIZE;
 static gboolean time_limit = TRUE;
+static gchar *batch_file = NULL;
+static gint n_workers = 0;
 static const gchar **file_arguments;
 
 static const GOptionEntry goption_options[] = {
 	{ "size", 's', 0, G_OPTION_ARG_INT, &size, NULL, "SIZE" },
         { "no-limit", 'l', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &time_limit, "Don't limit the thumbnailing time to 15 seconds", NULL },
+	{ "batch", 'b', 0, G_OPTION_ARG_FILENAME, &batch_file, "Thumbnail every input and output pair, separated by a tab, listed one per line in FILE, or in the standard input if FILE is -. There is no time limit in this mode", "FILE" },
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &n_workers, "Number of files thumbnailed at the same time in batch mode, the number of processors by default", "N" },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "<input> <ouput>" },
 	{ NULL }
 };
@@ -101,12 +105,12 @@ delete_temp_file (GFile *file)
 }
 
 static EvDocument *
-evince_thumbnailer_get_document (GFile *file)
+evince_thumbnailer_get_document (GFile   *file,
+				 GError **error)
 {
 	EvDocument *document = NULL;
 	gchar      *uri;
 	GFile      *tmp_file = NULL;
-	GError     *error = NULL;
 
 	if (!g_file_is_native (file)) {
 		gchar *base_name, *template;
@@ -115,20 +119,18 @@ evince_thumbnailer_get_document (GFile *file)
 		template = g_strdup_printf ("document.XXXXXX-%s", base_name);
 		g_free (base_name);
 
-		tmp_file = ev_mkstemp_file (template, &error);
+		tmp_file = ev_mkstemp_file (template, error);
 		g_free (template);
 		if (!tmp_file) {
-			g_printerr ("Error loading remote document: %s\n", error->message);
-			g_error_free (error);
+			g_prefix_error (error, "Error loading remote document: ");
 
 			return NULL;
 		}
 
-		g_file_copy (file, tmp_file, G_FILE_COPY_OVERWRITE,
-			     NULL, NULL, NULL, &error);
-		if (error) {
-			g_printerr ("Error loading remote document: %s\n", error->message);
-			g_error_free (error);
+		if (!g_file_copy (file, tmp_file, G_FILE_COPY_OVERWRITE,
+				  NULL, NULL, NULL, error)) {
+			g_prefix_error (error, "Error loading remote document: ");
+			ev_tmp_file_unlink (tmp_file);
 			g_object_unref (tmp_file);
 
 			return NULL;
@@ -138,7 +140,7 @@ evince_thumbnailer_get_document (GFile *file)
 		uri = g_file_get_uri (file);
 	}
 
-	document = ev_document_factory_get_document (uri, &error);
+	document = ev_document_factory_get_document (uri, error);
 	if (tmp_file) {
 		if (document) {
 			g_object_weak_ref (G_OBJECT (document),
@@ -150,15 +152,16 @@ evince_thumbnailer_get_document (GFile *file)
 		}
 	}
 	g_free (uri);
-	if (error) {
-		if (error->domain == EV_DOCUMENT_ERROR &&
-		    error->code == EV_DOCUMENT_ERROR_ENCRYPTED) {
-			/* FIXME: Create a thumb for cryp docs */
-			g_error_free (error);
-			return NULL;
-		}
-		g_printerr ("Error loading document: %s\n", error->message);
-		g_error_free (error);
+
+	/* Encrypted documents are returned with an error */
+	if (error && *error) {
+		if (document)
+			g_object_unref (document);
+
+		/* FIXME: Create a thumb for cryp docs */
+		if (!g_error_matches (*error, EV_DOCUMENT_ERROR, EV_DOCUMENT_ERROR_ENCRYPTED))
+			g_prefix_error (error, "Error loading document: ");
+
 		return NULL;
 	}
 
@@ -166,7 +169,10 @@ evince_thumbnailer_get_document (GFile *file)
 }
 
 static gboolean
-evince_thumbnail_pngenc_get (EvDocument *document, const char *thumbnail, int size)
+evince_thumbnail_pngenc_get (EvDocument  *document,
+			     const char  *thumbnail,
+			     int          size,
+			     GError     **error)
 {
 	EvRenderContext *rc;
 	double width, height;
@@ -183,12 +189,15 @@ evince_thumbnail_pngenc_get (EvDocument *document, const char *thumbnail, int si
 	g_object_unref (page);
 	
 	if (pixbuf != NULL) {
-		if (gdk_pixbuf_save (pixbuf, thumbnail, "png", NULL, NULL)) {
+		if (gdk_pixbuf_save (pixbuf, thumbnail, "png", error, NULL)) {
 			g_object_unref  (pixbuf);
 			return TRUE;
 		}
 
 		g_object_unref  (pixbuf);
+	} else {
+		g_set_error_literal (error, EV_DOCUMENT_ERROR, EV_DOCUMENT_ERROR_INVALID,
+				     "Error rendering the first page");
 	}
 	
 	return FALSE;
@@ -197,17 +206,175 @@ evince_thumbnail_pngenc_get (EvDocument *document, const char *thumbnail, int si
 static gpointer
 evince_thumbnail_pngenc_get_async (struct AsyncData *data)
 {
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (data->document);
 	data->success = evince_thumbnail_pngenc_get (data->document,
 						     data->output,
-						     data->size);
-	ev_document_doc_mutex_unlock ();
+						     data->size,
+						     NULL);
+	ev_document_unlock (data->document);
 	
 	g_idle_add ((GSourceFunc)gtk_main_quit, NULL);
 	
 	return NULL;
 }
 
+/* Batch mode: documents are thumbnailed by a pool of threads, sharing
+ * the backends loaded by the first documents of every type. The result
+ * of every file is printed in the standard output, tab separated: OK or
+ * FAILED, the time it took, the input and the error, if any.
+ */
+typedef struct {
+	gchar *input;
+	gchar *output;
+} ThumbnailTask;
+
+static GMutex output_mutex;
+static gint   n_failed = 0;
+
+static void
+thumbnail_task_free (ThumbnailTask *task)
+{
+	g_free (task->input);
+	g_free (task->output);
+	g_slice_free (ThumbnailTask, task);
+}
+
+static void
+thumbnail_task_report (ThumbnailTask *task,
+		       gint64         start_time,
+		       GError        *error)
+{
+	gdouble elapsed;
+
+	elapsed = (g_get_monotonic_time () - start_time) / 1000.;
+
+	g_mutex_lock (&output_mutex);
+	if (error) {
+		g_print ("FAILED\t%.1f ms\t%s\t%s\n", elapsed, task->input, error->message);
+	} else {
+		g_print ("OK\t%.1f ms\t%s\n", elapsed, task->input);
+	}
+	g_mutex_unlock (&output_mutex);
+
+	if (error)
+		g_atomic_int_inc (&n_failed);
+}
+
+static void
+thumbnail_task_run (ThumbnailTask *task,
+		    gpointer       user_data)
+{
+	EvDocument *document;
+	GFile      *file;
+	gint64      start_time;
+	gboolean    need_fc_mutex;
+	GError     *error = NULL;
+
+	start_time = g_get_monotonic_time ();
+
+	file = g_file_new_for_commandline_arg (task->input);
+	document = evince_thumbnailer_get_document (file, &error);
+	g_object_unref (file);
+
+	if (document) {
+		/* Reentrant backends don't need the fontconfig mutex */
+		need_fc_mutex = !ev_document_supports_concurrent_render (document);
+
+		ev_document_lock (document);
+		if (need_fc_mutex)
+			ev_document_fc_mutex_lock ();
+		evince_thumbnail_pngenc_get (document, task->output, size, &error);
+		if (need_fc_mutex)
+			ev_document_fc_mutex_unlock ();
+		ev_document_unlock (document);
+
+		g_object_unref (document);
+	}
+
+	thumbnail_task_report (task, start_time, error);
+	if (error)
+		g_error_free (error);
+
+	thumbnail_task_free (task);
+}
+
+static gint
+evince_thumbnailer_run_batch (const gchar *manifest)
+{
+	GIOChannel  *channel;
+	GThreadPool *pool;
+	gchar       *line;
+	gsize        terminator;
+	GIOStatus    status;
+	GError      *error = NULL;
+
+	if (g_strcmp0 (manifest, "-") == 0) {
+		channel = g_io_channel_unix_new (0);
+	} else {
+		channel = g_io_channel_new_file (manifest, "r", &error);
+		if (!channel) {
+			g_printerr ("Error opening %s: %s\n", manifest, error->message);
+			g_error_free (error);
+
+			return -1;
+		}
+	}
+	/* File names aren't necessarily UTF-8 */
+	g_io_channel_set_encoding (channel, NULL, NULL);
+
+	if (n_workers < 1)
+		n_workers = g_get_num_processors ();
+
+	pool = g_thread_pool_new ((GFunc)thumbnail_task_run, NULL,
+				  n_workers, TRUE, NULL);
+
+	while ((status = g_io_channel_read_line (channel, &line, NULL, &terminator, &error)) == G_IO_STATUS_NORMAL) {
+		ThumbnailTask *task;
+		gchar         *separator;
+
+		line[terminator] = '\0';
+		if (line[0] == '\0' || line[0] == '#') {
+			g_free (line);
+			continue;
+		}
+
+		task = g_slice_new0 (ThumbnailTask);
+
+		separator = strchr (line, '\t');
+		if (!separator) {
+			GError *line_error;
+
+			task->input = line;
+			line_error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+							  "Missing output file");
+			thumbnail_task_report (task, g_get_monotonic_time (), line_error);
+			g_error_free (line_error);
+			thumbnail_task_free (task);
+			continue;
+		}
+
+		task->input = g_strndup (line, separator - line);
+		task->output = g_strdup (separator + 1);
+		g_free (line);
+
+		g_thread_pool_push (pool, task, NULL);
+	}
+
+	if (status == G_IO_STATUS_ERROR) {
+		g_printerr ("Error reading %s: %s\n", manifest, error->message);
+		g_error_free (error);
+	}
+	g_io_channel_unref (channel);
+
+	/* Wait for all the files to be done */
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	if (status == G_IO_STATUS_ERROR)
+		return -1;
+
+	return g_atomic_int_get (&n_failed) > 0 ? -2 : 0;
+}
+
 static void
 print_usage (GOptionContext *context)
 {
@@ -240,6 +407,25 @@ main (int argc, char *argv[])
 		return -1;
 	}
 
+	if (batch_file) {
+		gint retval;
+
+		g_option_context_free (context);
+
+		if (size < 1) {
+			g_printerr ("Size cannot be smaller than 1 pixel\n");
+			return -1;
+		}
+
+		if (!ev_init ())
+			return -1;
+
+		retval = evince_thumbnailer_run_batch (batch_file);
+		ev_shutdown ();
+
+		return retval;
+	}
+
 	input = file_arguments ? file_arguments[0] : NULL;
 	output = input ? file_arguments[1] : NULL;
 	if (!input || !output) {
@@ -263,10 +449,13 @@ main (int argc, char *argv[])
                 return -1;
 
 	file = g_file_new_for_commandline_arg (input);
-	document = evince_thumbnailer_get_document (file);
+	document = evince_thumbnailer_get_document (file, &error);
 	g_object_unref (file);
 
 	if (!document) {
+		if (!g_error_matches (error, EV_DOCUMENT_ERROR, EV_DOCUMENT_ERROR_ENCRYPTED))
+			g_printerr ("%s\n", error->message);
+		g_error_free (error);
 		ev_shutdown ();
 		return -2;
 	}
@@ -295,7 +484,7 @@ main (int argc, char *argv[])
 		return data.success ? 0 : -2;
 	}
 
-	if (!evince_thumbnail_pngenc_get (document, output, size)) {
+	if (!evince_thumbnail_pngenc_get (document, output, size, NULL)) {
 		g_object_unref (document);
 		ev_shutdown ();
 		return -2;